@@ -1,5 +1,6 @@
 
 #include <Adaptor.h>
+#include <ApronProfile.h>
 #include <ap_ppl.h>
 
 ap_manager_t * create_manager() {
@@ -10,6 +11,7 @@ ap_manager_t * create_manager() {
 //	ap_funopt_t widening_options = ap_manager_get_funopt(manager, AP_FUNID_WIDENING);
 //	widening_options.algorithm = 1;
 //	ap_manager_set_funopt(manager, AP_FUNID_WIDENING, &widening_options);
+	ap_profile_wrap(manager);
 	return manager;
 }
 
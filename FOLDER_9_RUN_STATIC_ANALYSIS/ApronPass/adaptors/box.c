@@ -1,6 +1,7 @@
 #include <stdlib.h>
 
 #include <Adaptor.h>
+#include <ApronProfile.h>
 #include <box.h>
 
 static void set_algorithm(ap_manager_t * manager) {
@@ -18,6 +19,7 @@ static void set_algorithm(ap_manager_t * manager) {
 ap_manager_t * create_manager() {
 	ap_manager_t * result = box_manager_alloc();
 	set_algorithm(result);
+	ap_profile_wrap(result);
 	return result;
 }
 
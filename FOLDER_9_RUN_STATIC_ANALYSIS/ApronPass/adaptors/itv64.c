@@ -0,0 +1,10 @@
+#include <Adaptor.h>
+#include <ApronProfile.h>
+
+#include "native/itv64.h"
+
+ap_manager_t * create_manager() {
+	ap_manager_t * result = itv64_manager_alloc();
+	ap_profile_wrap(result);
+	return result;
+}
@@ -0,0 +1,68 @@
+#include <math.h>
+
+#include <gmp.h>
+#include <mpfr.h>
+
+#include "bound.h"
+
+static int64_t bound_of_double(double d, bool is_upper) {
+	d = is_upper ? ceil(d) : floor(d);
+	if (d >= 0x1p63) {
+		return is_upper ? BOUND_POS_INF : BOUND_MAX;
+	}
+	if (d <= -0x1p63) {
+		return is_upper ? BOUND_MIN : BOUND_NEG_INF;
+	}
+	return is_upper ? bound_hi((int64_t)d) : bound_lo((int64_t)d);
+}
+
+int64_t bound_of_scalar(ap_scalar_t * scalar, bool is_upper) {
+	int infty = ap_scalar_infty(scalar);
+	if (infty < 0) {
+		return BOUND_NEG_INF;
+	}
+	if (infty > 0) {
+		return BOUND_POS_INF;
+	}
+	switch (scalar->discr) {
+	case AP_SCALAR_DOUBLE:
+		return bound_of_double(scalar->val.dbl, is_upper);
+	case AP_SCALAR_MPQ: {
+		int64_t result;
+		mpz_t quotient;
+		mpz_init(quotient);
+		if (is_upper) {
+			mpz_cdiv_q(quotient, mpq_numref(scalar->val.mpq),
+					mpq_denref(scalar->val.mpq));
+		} else {
+			mpz_fdiv_q(quotient, mpq_numref(scalar->val.mpq),
+					mpq_denref(scalar->val.mpq));
+		}
+		if (mpz_fits_slong_p(quotient)) {
+			long value = mpz_get_si(quotient);
+			result = is_upper ? bound_hi(value) : bound_lo(value);
+		} else if (mpz_sgn(quotient) > 0) {
+			result = is_upper ? BOUND_POS_INF : BOUND_MAX;
+		} else {
+			result = is_upper ? BOUND_MIN : BOUND_NEG_INF;
+		}
+		mpz_clear(quotient);
+		return result;
+	}
+	default: {
+		double d;
+		ap_double_set_scalar(&d, scalar, is_upper ? GMP_RNDU : GMP_RNDD);
+		return bound_of_double(d, is_upper);
+	}
+	}
+}
+
+void bound_to_scalar(ap_scalar_t * scalar, int64_t b) {
+	if (b == BOUND_NEG_INF) {
+		ap_scalar_set_infty(scalar, -1);
+	} else if (b == BOUND_POS_INF) {
+		ap_scalar_set_infty(scalar, 1);
+	} else {
+		ap_scalar_set_int(scalar, (long)b);
+	}
+}
@@ -0,0 +1,107 @@
+#ifndef NATIVE_BOUND_H
+#define NATIVE_BOUND_H
+
+/* Bounds of the native domains: int64 with saturating arithmetic.
+ * INT64_MIN and INT64_MAX stand for -oo and +oo. A result that does not
+ * fit is rounded outwards: lower bounds down, upper bounds up, so every
+ * operation stays sound. Intermediate results are computed in 128 bits. */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <ap_scalar.h>
+
+#define BOUND_NEG_INF INT64_MIN
+#define BOUND_POS_INF INT64_MAX
+#define BOUND_MIN (INT64_MIN + 1)
+#define BOUND_MAX (INT64_MAX - 1)
+
+typedef __int128 bound_wide_t;
+
+static inline bool bound_is_inf(int64_t b) {
+	return (b == BOUND_NEG_INF) || (b == BOUND_POS_INF);
+}
+
+/* Round a wide value as a lower bound */
+static inline int64_t bound_lo(bound_wide_t v) {
+	if (v < BOUND_MIN) {
+		return BOUND_NEG_INF;
+	}
+	if (v > BOUND_MAX) {
+		return BOUND_MAX;
+	}
+	return (int64_t)v;
+}
+
+/* Round a wide value as an upper bound */
+static inline int64_t bound_hi(bound_wide_t v) {
+	if (v > BOUND_MAX) {
+		return BOUND_POS_INF;
+	}
+	if (v < BOUND_MIN) {
+		return BOUND_MIN;
+	}
+	return (int64_t)v;
+}
+
+/* Sum of lower bounds (or of upper bounds, with bound_add_hi) */
+static inline int64_t bound_add_lo(int64_t a, int64_t b) {
+	if ((a == BOUND_NEG_INF) || (b == BOUND_NEG_INF)) {
+		return BOUND_NEG_INF;
+	}
+	return bound_lo((bound_wide_t)a + b);
+}
+
+static inline int64_t bound_add_hi(int64_t a, int64_t b) {
+	if ((a == BOUND_POS_INF) || (b == BOUND_POS_INF)) {
+		return BOUND_POS_INF;
+	}
+	return bound_hi((bound_wide_t)a + b);
+}
+
+static inline int64_t bound_neg(int64_t a) {
+	if (a == BOUND_NEG_INF) {
+		return BOUND_POS_INF;
+	}
+	if (a == BOUND_POS_INF) {
+		return BOUND_NEG_INF;
+	}
+	return -a;
+}
+
+static inline int bound_sign(int64_t a) {
+	return (a > 0) - (a < 0);
+}
+
+/* Product of two bounds, as a wide value. Infinities are kept as
+ * +-2^100, beyond every finite product, and 0 * oo is 0. */
+#define BOUND_WIDE_INF (((bound_wide_t)1) << 100)
+static inline bound_wide_t bound_mul_wide(int64_t a, int64_t b) {
+	if (bound_is_inf(a) || bound_is_inf(b)) {
+		return bound_sign(a) * bound_sign(b) * BOUND_WIDE_INF;
+	}
+	return (bound_wide_t)a * b;
+}
+
+/* Floor and ceiling of a / b, for b != 0 */
+static inline bound_wide_t bound_div_floor(bound_wide_t a, bound_wide_t b) {
+	bound_wide_t q = a / b;
+	if ((q * b != a) && ((a < 0) != (b < 0))) {
+		q--;
+	}
+	return q;
+}
+
+static inline bound_wide_t bound_div_ceil(bound_wide_t a, bound_wide_t b) {
+	bound_wide_t q = a / b;
+	if ((q * b != a) && ((a < 0) == (b < 0))) {
+		q++;
+	}
+	return q;
+}
+
+/* The scalar as a lower bound (rounded down) or upper bound (rounded up) */
+int64_t bound_of_scalar(ap_scalar_t * scalar, bool is_upper);
+/* Set scalar to the bound, with infinities */
+void bound_to_scalar(ap_scalar_t * scalar, int64_t b);
+
+#endif /* NATIVE_BOUND_H */
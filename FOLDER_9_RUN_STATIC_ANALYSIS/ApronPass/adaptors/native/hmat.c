@@ -0,0 +1,276 @@
+#include <stdlib.h>
+
+#include "hmat.h"
+
+/* The AVX2 kernels are compiled for x86 whatever the flags, and picked at
+ * run time */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HMAT_AVX2_KERNELS
+#endif
+
+#if defined(HMAT_AVX2_KERNELS)
+#include <immintrin.h>
+
+#define HMAT_AVX2 __attribute__((target("avx2")))
+
+static inline bool has_avx2(void) {
+	return __builtin_cpu_supports("avx2");
+}
+
+/* AVX2 has no 64 bit min and max */
+static inline HMAT_AVX2 __m256i min_epi64(__m256i a, __m256i b) {
+	return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+}
+
+static inline HMAT_AVX2 __m256i max_epi64(__m256i a, __m256i b) {
+	return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+}
+
+static inline HMAT_AVX2 __m256i norm_epi64(__m256i v) {
+	const __m256i max = _mm256_set1_epi64x(HMAT_MAX);
+	const __m256i min = _mm256_set1_epi64x(-HMAT_MAX);
+	const __m256i inf = _mm256_set1_epi64x(HMAT_INF);
+	v = _mm256_blendv_epi8(v, inf, _mm256_cmpgt_epi64(v, max));
+	return _mm256_blendv_epi8(v, min, _mm256_cmpgt_epi64(min, v));
+}
+
+/* The AVX2 kernels return how far they got, the rest is left to the
+ * scalar loops */
+static HMAT_AVX2 size_t kernel_close_row_avx2(int64_t * restrict row,
+		const int64_t * restrict ra, const int64_t * restrict rb,
+		int64_t ta, int64_t tb, size_t n) {
+	size_t j = 0;
+	const __m256i vta = _mm256_set1_epi64x(ta);
+	const __m256i vtb = _mm256_set1_epi64x(tb);
+	for (; j + 4 <= n; j += 4) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(row + j));
+		__m256i a = _mm256_add_epi64(vta,
+				_mm256_loadu_si256((const __m256i *)(ra + j)));
+		__m256i b = _mm256_add_epi64(vtb,
+				_mm256_loadu_si256((const __m256i *)(rb + j)));
+		v = norm_epi64(min_epi64(v, min_epi64(a, b)));
+		_mm256_storeu_si256((__m256i *)(row + j), v);
+	}
+	return j;
+}
+
+static HMAT_AVX2 size_t kernel_join_avx2(int64_t * restrict m,
+		const int64_t * restrict m2, size_t size) {
+	size_t pos = 0;
+	for (; pos + 4 <= size; pos += 4) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(m + pos));
+		__m256i v2 = _mm256_loadu_si256((const __m256i *)(m2 + pos));
+		_mm256_storeu_si256((__m256i *)(m + pos), max_epi64(v, v2));
+	}
+	return pos;
+}
+
+static HMAT_AVX2 size_t kernel_widen_avx2(int64_t * restrict m,
+		const int64_t * restrict m2, size_t size) {
+	size_t pos = 0;
+	const __m256i inf = _mm256_set1_epi64x(HMAT_INF);
+	for (; pos + 4 <= size; pos += 4) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(m + pos));
+		__m256i v2 = _mm256_loadu_si256((const __m256i *)(m2 + pos));
+		v = _mm256_blendv_epi8(v, inf, _mm256_cmpgt_epi64(v2, v));
+		_mm256_storeu_si256((__m256i *)(m + pos), v);
+	}
+	return pos;
+}
+
+#endif
+
+/* row[j] = min(row[j], ta + ra[j], tb + rb[j]) */
+static void kernel_close_row(int64_t * restrict row,
+		const int64_t * restrict ra, const int64_t * restrict rb,
+		int64_t ta, int64_t tb, size_t n) {
+	size_t j = 0;
+#if defined(HMAT_AVX2_KERNELS)
+	if (has_avx2()) {
+		j = kernel_close_row_avx2(row, ra, rb, ta, tb, n);
+	}
+#endif
+	for (; j < n; j++) {
+		int64_t a = ta + ra[j];
+		int64_t b = tb + rb[j];
+		int64_t v = (a < b) ? a : b;
+		v = (v < row[j]) ? v : row[j];
+		v = (v > HMAT_MAX) ? HMAT_INF : v;
+		row[j] = (v < -HMAT_MAX) ? -HMAT_MAX : v;
+	}
+}
+
+void hmat_set_top(int64_t * m, size_t dim) {
+	size_t size = hmat_size(dim);
+	for (size_t pos = 0; pos < size; pos++) {
+		m[pos] = HMAT_INF;
+	}
+	for (size_t i = 0; i < 2 * dim; i++) {
+		m[hmat_pos(i, i)] = 0;
+	}
+}
+
+void hmat_meet(int64_t * restrict m, const int64_t * restrict m2, size_t dim) {
+	size_t size = hmat_size(dim);
+	for (size_t pos = 0; pos < size; pos++) {
+		m[pos] = (m2[pos] < m[pos]) ? m2[pos] : m[pos];
+	}
+}
+
+void hmat_join(int64_t * restrict m, const int64_t * restrict m2, size_t dim) {
+	size_t size = hmat_size(dim);
+	size_t pos = 0;
+#if defined(HMAT_AVX2_KERNELS)
+	if (has_avx2()) {
+		pos = kernel_join_avx2(m, m2, size);
+	}
+#endif
+	for (; pos < size; pos++) {
+		m[pos] = (m2[pos] > m[pos]) ? m2[pos] : m[pos];
+	}
+}
+
+void hmat_widen(int64_t * restrict m, const int64_t * restrict m2, size_t dim) {
+	size_t size = hmat_size(dim);
+	size_t pos = 0;
+#if defined(HMAT_AVX2_KERNELS)
+	if (has_avx2()) {
+		pos = kernel_widen_avx2(m, m2, size);
+	}
+#endif
+	for (; pos < size; pos++) {
+		m[pos] = (m2[pos] > m[pos]) ? HMAT_INF : m[pos];
+	}
+}
+
+bool hmat_is_leq(const int64_t * restrict m, const int64_t * restrict m2,
+		size_t dim) {
+	size_t size = hmat_size(dim);
+	int64_t is_greater = 0;
+	for (size_t pos = 0; pos < size; pos++) {
+		is_greater |= (m[pos] > m2[pos]);
+	}
+	return is_greater == 0;
+}
+
+bool hmat_is_eq(const int64_t * restrict m, const int64_t * restrict m2,
+		size_t dim) {
+	size_t size = hmat_size(dim);
+	int64_t is_different = 0;
+	for (size_t pos = 0; pos < size; pos++) {
+		is_different |= (m[pos] != m2[pos]);
+	}
+	return is_different == 0;
+}
+
+/* Tighten the unary bounds of the integer variables, strengthen, and check
+ * the diagonal. Turns a closed matrix into a strongly closed one. */
+static bool hmat_strengthen(int64_t * m, size_t dim, size_t intdim) {
+	size_t n = 2 * dim;
+	int64_t * unary = malloc(n * sizeof(*unary));
+	bool is_nonempty = true;
+	/* m[i][i^1] bounds V_i^1 - V_i, i.e. twice a variable */
+	for (size_t i = 0; i < n; i++) {
+		int64_t * bound = &m[hmat_pos(i, i ^ 1)];
+		if ((i < 2 * intdim) && (*bound != HMAT_INF)) {
+			*bound -= (*bound & 1);
+		}
+		unary[i] = *bound;
+	}
+	/* m[i][j] <= (m[i][i^1] + m[j^1][j]) / 2, rounded up */
+	for (size_t i = 0; i < n; i++) {
+		int64_t * row = m + hmat_pos(i, 0);
+		int64_t ui = unary[i];
+		size_t len = (i | 1) + 1;
+		if (ui == HMAT_INF) {
+			continue;
+		}
+		for (size_t j = 0; j < len; j++) {
+			int64_t v = (ui + unary[j ^ 1] + 1) >> 1;
+			v = (v > HMAT_MAX) ? HMAT_INF : v;
+			row[j] = (v < row[j]) ? v : row[j];
+		}
+	}
+	for (size_t i = 0; i < n; i++) {
+		int64_t * diagonal = &m[hmat_pos(i, i)];
+		if (*diagonal < 0) {
+			is_nonempty = false;
+		}
+		*diagonal = 0;
+	}
+	free(unary);
+	return is_nonempty;
+}
+
+bool hmat_close(int64_t * m, size_t dim, size_t intdim) {
+	size_t n = 2 * dim;
+	int64_t * ra = malloc(n * sizeof(*ra));
+	int64_t * rb = malloc(n * sizeof(*rb));
+	/* Floyd-Warshall, with the two values of a variable as pivots at
+	 * once (Mine's closure) */
+	for (size_t v = 0; v < dim; v++) {
+		size_t a = 2 * v;
+		size_t b = 2 * v + 1;
+		for (size_t j = 0; j < n; j++) {
+			ra[j] = m[hmat_pos2(a, j)];
+			rb[j] = m[hmat_pos2(b, j)];
+		}
+		int64_t mab = ra[b];
+		int64_t mba = rb[a];
+		for (size_t i = 0; i < n; i++) {
+			int64_t ia = m[hmat_pos2(i, a)];
+			int64_t ib = m[hmat_pos2(i, b)];
+			int64_t ta = hmat_min(ia, hmat_add(ib, mba));
+			int64_t tb = hmat_min(ib, hmat_add(ia, mab));
+			if ((ta == HMAT_INF) && (tb == HMAT_INF)) {
+				continue;
+			}
+			kernel_close_row(m + hmat_pos(i, 0), ra, rb, ta, tb, (i | 1) + 1);
+		}
+	}
+	free(ra);
+	free(rb);
+	return hmat_strengthen(m, dim, intdim);
+}
+
+bool hmat_close_edge(int64_t * m, size_t dim, size_t intdim, size_t a,
+		size_t b, int64_t c) {
+	size_t n = 2 * dim;
+	c = hmat_norm(c);
+	if (c >= m[hmat_pos2(a, b)]) {
+		return true;
+	}
+	/* The new edges are a -> b and b^1 -> a^1. A shortest path uses each
+	 * at most once (Chawdhary, Robbins and King's incremental closure). */
+	int64_t * rb = malloc(n * sizeof(*rb));
+	int64_t * ra1 = malloc(n * sizeof(*ra1));
+	int64_t * ca = malloc(n * sizeof(*ca));
+	int64_t * cb1 = malloc(n * sizeof(*cb1));
+	for (size_t k = 0; k < n; k++) {
+		rb[k] = m[hmat_pos2(b, k)];
+		ra1[k] = m[hmat_pos2(a ^ 1, k)];
+		ca[k] = m[hmat_pos2(k, a)];
+		cb1[k] = m[hmat_pos2(k, b ^ 1)];
+	}
+	int64_t mbb1 = rb[b ^ 1];
+	int64_t ma1a = ra1[a];
+	for (size_t i = 0; i < n; i++) {
+		/* i -> a -> b, and on through b^1 -> a^1 */
+		int64_t t1 = hmat_add(ca[i], c);
+		int64_t t3 = hmat_add(hmat_add(t1, mbb1), c);
+		/* i -> b^1 -> a^1, and on through a -> b */
+		int64_t t2 = hmat_add(cb1[i], c);
+		int64_t t4 = hmat_add(hmat_add(t2, ma1a), c);
+		int64_t tb = hmat_min(t1, t4);
+		int64_t ta1 = hmat_min(t2, t3);
+		if ((tb == HMAT_INF) && (ta1 == HMAT_INF)) {
+			continue;
+		}
+		kernel_close_row(m + hmat_pos(i, 0), rb, ra1, tb, ta1, (i | 1) + 1);
+	}
+	free(rb);
+	free(ra1);
+	free(ca);
+	free(cb1);
+	return hmat_strengthen(m, dim, intdim);
+}
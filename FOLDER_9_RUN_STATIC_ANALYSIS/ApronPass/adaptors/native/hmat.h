@@ -0,0 +1,93 @@
+#ifndef NATIVE_HMAT_H
+#define NATIVE_HMAT_H
+
+/* Half-matrix difference bound matrices, of the native octagon domain.
+ *
+ * An octagon over n variables is a DBM over the 2n values V_2k = x_k and
+ * V_2k+1 = -x_k, where m[i][j] bounds V_j - V_i. By coherence,
+ * m[i][j] = m[j^1][i^1], so only j <= (i|1) is stored, row after row.
+ *
+ * Bounds are int64. HMAT_INF is +oo, and finite bounds are kept within
+ * +-HMAT_MAX, so that the sum of two bounds neither overflows nor turns an
+ * infinite bound into a finite one. Finite bounds beyond that are rounded
+ * to +oo (or to -HMAT_MAX): an upper bound may always be raised.
+ *
+ * The kernels run over contiguous rows. On x86 the closure, join and
+ * widening kernels use AVX2 when the CPU has it, whatever the compiler
+ * flags. Otherwise they are left to the compiler. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bound.h"
+
+#define HMAT_INF (((int64_t)1) << 61)
+#define HMAT_MAX (((int64_t)1) << 58)
+
+static inline size_t hmat_size(size_t dim) {
+	return 2 * dim * (dim + 1);
+}
+
+/* Position of m[i][j], for j <= (i|1) */
+static inline size_t hmat_pos(size_t i, size_t j) {
+	return j + ((i + 1) * (i + 1)) / 2;
+}
+
+/* Position of m[i][j], for any i, j */
+static inline size_t hmat_pos2(size_t i, size_t j) {
+	return (j > (i | 1)) ? hmat_pos(j ^ 1, i ^ 1) : hmat_pos(i, j);
+}
+
+static inline int64_t hmat_norm(int64_t v) {
+	if (v > HMAT_MAX) {
+		return HMAT_INF;
+	}
+	return (v < -HMAT_MAX) ? -HMAT_MAX : v;
+}
+
+static inline int64_t hmat_add(int64_t a, int64_t b) {
+	return hmat_norm(a + b);
+}
+
+static inline int64_t hmat_min(int64_t a, int64_t b) {
+	return (a < b) ? a : b;
+}
+
+/* An upper bound (see bound.h), as a matrix bound */
+static inline int64_t hmat_of_bound(bound_wide_t b) {
+	if (b >= BOUND_POS_INF) {
+		return HMAT_INF;
+	}
+	if (b > HMAT_MAX) {
+		return HMAT_INF;
+	}
+	return (b < -HMAT_MAX) ? -HMAT_MAX : (int64_t)b;
+}
+
+static inline int64_t hmat_to_bound(int64_t v) {
+	return (v >= HMAT_INF) ? BOUND_POS_INF : v;
+}
+
+/* Every bound +oo, but the diagonal */
+void hmat_set_top(int64_t * m, size_t dim);
+
+/* m = min(m, m2), m = max(m, m2), and the standard widening of m by m2 */
+void hmat_meet(int64_t * restrict m, const int64_t * restrict m2, size_t dim);
+void hmat_join(int64_t * restrict m, const int64_t * restrict m2, size_t dim);
+void hmat_widen(int64_t * restrict m, const int64_t * restrict m2, size_t dim);
+
+bool hmat_is_leq(const int64_t * restrict m, const int64_t * restrict m2,
+		size_t dim);
+bool hmat_is_eq(const int64_t * restrict m, const int64_t * restrict m2,
+		size_t dim);
+
+/* Strong closure, tight for the first intdim variables. O(n^3). Returns
+ * false if the octagon is empty. */
+bool hmat_close(int64_t * m, size_t dim, size_t intdim);
+
+/* Closure of a closed m after m[a][b] = min(m[a][b], c), in O(n^2).
+ * Returns false if the octagon is empty. */
+bool hmat_close_edge(int64_t * m, size_t dim, size_t intdim, size_t a,
+		size_t b, int64_t c);
+
+#endif /* NATIVE_HMAT_H */
@@ -0,0 +1,995 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ap_abstract0.h>
+#include <ap_generator0.h>
+
+#include "bound.h"
+#include "itv64.h"
+#include "linexpr.h"
+
+#define ITV64_DEFAULT_MEET_ROUNDS 4
+
+typedef struct {
+	size_t intdim;
+	size_t realdim;
+	bool is_bottom;
+	/* The lower bounds of the dimensions, then the upper bounds */
+	int64_t bounds[];
+} itv64_t;
+
+static unsigned meet_rounds = ITV64_DEFAULT_MEET_ROUNDS;
+
+static inline size_t itv64_dims(const itv64_t * a) {
+	return a->intdim + a->realdim;
+}
+
+static inline int64_t * itv64_lo(itv64_t * a) {
+	return a->bounds;
+}
+
+static inline int64_t * itv64_hi(itv64_t * a) {
+	return a->bounds + itv64_dims(a);
+}
+
+static void set_exact(ap_manager_t * man, bool is_exact) {
+	man->result.flag_exact = is_exact;
+	man->result.flag_best = is_exact;
+}
+
+/* Kernels. Branch-free over the bounds, so that they are vectorized. */
+
+static void kernel_fill(int64_t * restrict lo, int64_t * restrict hi,
+		int64_t lo_value, int64_t hi_value, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		lo[i] = lo_value;
+		hi[i] = hi_value;
+	}
+}
+
+static void kernel_join(int64_t * restrict lo, int64_t * restrict hi,
+		const int64_t * restrict lo2, const int64_t * restrict hi2, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		lo[i] = (lo2[i] < lo[i]) ? lo2[i] : lo[i];
+		hi[i] = (hi2[i] > hi[i]) ? hi2[i] : hi[i];
+	}
+}
+
+/* Returns true if the result is empty */
+static bool kernel_meet(int64_t * restrict lo, int64_t * restrict hi,
+		const int64_t * restrict lo2, const int64_t * restrict hi2, size_t n) {
+	int64_t is_empty = 0;
+	for (size_t i = 0; i < n; i++) {
+		lo[i] = (lo2[i] > lo[i]) ? lo2[i] : lo[i];
+		hi[i] = (hi2[i] < hi[i]) ? hi2[i] : hi[i];
+		is_empty |= (lo[i] > hi[i]);
+	}
+	return is_empty != 0;
+}
+
+static bool kernel_is_leq(const int64_t * restrict lo1, const int64_t * restrict hi1,
+		const int64_t * restrict lo2, const int64_t * restrict hi2, size_t n) {
+	int64_t is_outside = 0;
+	for (size_t i = 0; i < n; i++) {
+		is_outside |= (lo1[i] < lo2[i]) | (hi1[i] > hi2[i]);
+	}
+	return is_outside == 0;
+}
+
+static bool kernel_is_eq(const int64_t * restrict lo1, const int64_t * restrict hi1,
+		const int64_t * restrict lo2, const int64_t * restrict hi2, size_t n) {
+	int64_t is_different = 0;
+	for (size_t i = 0; i < n; i++) {
+		is_different |= (lo1[i] != lo2[i]) | (hi1[i] != hi2[i]);
+	}
+	return is_different == 0;
+}
+
+static void kernel_widen(int64_t * restrict lo, int64_t * restrict hi,
+		const int64_t * restrict lo2, const int64_t * restrict hi2, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		lo[i] = (lo2[i] < lo[i]) ? BOUND_NEG_INF : lo[i];
+		hi[i] = (hi2[i] > hi[i]) ? BOUND_POS_INF : hi[i];
+	}
+}
+
+static bool kernel_is_top(const int64_t * restrict lo, const int64_t * restrict hi,
+		size_t n) {
+	int64_t is_bounded = 0;
+	for (size_t i = 0; i < n; i++) {
+		is_bounded |= (lo[i] != BOUND_NEG_INF) | (hi[i] != BOUND_POS_INF);
+	}
+	return is_bounded == 0;
+}
+
+/* Memory */
+
+static itv64_t * itv64_alloc(size_t intdim, size_t realdim) {
+	size_t n = intdim + realdim;
+	itv64_t * a = malloc(sizeof(*a) + 2 * n * sizeof(a->bounds[0]));
+	a->intdim = intdim;
+	a->realdim = realdim;
+	a->is_bottom = false;
+	return a;
+}
+
+static itv64_t * itv64_copy_internal(itv64_t * a) {
+	size_t size = sizeof(*a) + 2 * itv64_dims(a) * sizeof(a->bounds[0]);
+	itv64_t * result = malloc(size);
+	memcpy(result, a, size);
+	return result;
+}
+
+static itv64_t * itv64_top_internal(size_t intdim, size_t realdim) {
+	itv64_t * a = itv64_alloc(intdim, realdim);
+	kernel_fill(itv64_lo(a), itv64_hi(a), BOUND_NEG_INF, BOUND_POS_INF,
+			itv64_dims(a));
+	return a;
+}
+
+static itv64_t * itv64_bottom_internal(size_t intdim, size_t realdim) {
+	itv64_t * a = itv64_top_internal(intdim, realdim);
+	a->is_bottom = true;
+	return a;
+}
+
+static void itv64_set_bottom(itv64_t * a) {
+	a->is_bottom = true;
+	kernel_fill(itv64_lo(a), itv64_hi(a), BOUND_NEG_INF, BOUND_POS_INF,
+			itv64_dims(a));
+}
+
+static itv64_t * itv64_copy(ap_manager_t * man, itv64_t * a) {
+	set_exact(man, true);
+	return itv64_copy_internal(a);
+}
+
+static void itv64_free(ap_manager_t * man, itv64_t * a) {
+	free(a);
+}
+
+static size_t itv64_size(ap_manager_t * man, itv64_t * a) {
+	return 2 * itv64_dims(a);
+}
+
+/* Control of internal representation */
+
+static void itv64_minimize(ap_manager_t * man, itv64_t * a) {
+	set_exact(man, true);
+}
+
+static void itv64_canonicalize(ap_manager_t * man, itv64_t * a) {
+	set_exact(man, true);
+}
+
+static int itv64_hash(ap_manager_t * man, itv64_t * a) {
+	uint64_t hash = 14695981039346656037ULL;
+	if (a->is_bottom) {
+		return 0;
+	}
+	for (size_t i = 0; i < 2 * itv64_dims(a); i++) {
+		hash = (hash ^ (uint64_t)a->bounds[i]) * 1099511628211ULL;
+	}
+	return (int)(hash ^ (hash >> 32));
+}
+
+static void itv64_approximate(ap_manager_t * man, itv64_t * a, int algorithm) {
+	set_exact(man, true);
+}
+
+/* Printing and serialization */
+
+static void fprint_bound(FILE * stream, int64_t b) {
+	if (b == BOUND_NEG_INF) {
+		fprintf(stream, "-oo");
+	} else if (b == BOUND_POS_INF) {
+		fprintf(stream, "+oo");
+	} else {
+		fprintf(stream, "%" PRId64, b);
+	}
+}
+
+static void fprint_dim(FILE * stream, itv64_t * a, size_t dim,
+		char ** name_of_dim) {
+	if (name_of_dim) {
+		fprintf(stream, "%s", name_of_dim[dim]);
+	} else {
+		fprintf(stream, "x%zu", dim);
+	}
+	fprintf(stream, " in [");
+	fprint_bound(stream, itv64_lo(a)[dim]);
+	fprintf(stream, ", ");
+	fprint_bound(stream, itv64_hi(a)[dim]);
+	fprintf(stream, "]\n");
+}
+
+static void itv64_fprint(FILE * stream, ap_manager_t * man, itv64_t * a,
+		char ** name_of_dim) {
+	if (a->is_bottom) {
+		fprintf(stream, "bottom\n");
+		return;
+	}
+	if (kernel_is_top(itv64_lo(a), itv64_hi(a), itv64_dims(a))) {
+		fprintf(stream, "top\n");
+		return;
+	}
+	for (size_t i = 0; i < itv64_dims(a); i++) {
+		if ((itv64_lo(a)[i] != BOUND_NEG_INF) ||
+				(itv64_hi(a)[i] != BOUND_POS_INF)) {
+			fprint_dim(stream, a, i, name_of_dim);
+		}
+	}
+}
+
+static void itv64_fprintdiff(FILE * stream, ap_manager_t * man, itv64_t * a1,
+		itv64_t * a2, char ** name_of_dim) {
+	if (a1->is_bottom || a2->is_bottom) {
+		fprintf(stream, "%s -> %s\n", a1->is_bottom ? "bottom" : "value",
+				a2->is_bottom ? "bottom" : "value");
+		return;
+	}
+	for (size_t i = 0; i < itv64_dims(a1); i++) {
+		if ((itv64_lo(a1)[i] != itv64_lo(a2)[i]) ||
+				(itv64_hi(a1)[i] != itv64_hi(a2)[i])) {
+			fprint_dim(stream, a2, i, name_of_dim);
+		}
+	}
+}
+
+static void itv64_fdump(FILE * stream, ap_manager_t * man, itv64_t * a) {
+	fprintf(stream, "itv64 intdim=%zu realdim=%zu%s\n", a->intdim,
+			a->realdim, a->is_bottom ? " bottom" : "");
+	for (size_t i = 0; i < itv64_dims(a); i++) {
+		fprint_dim(stream, a, i, 0);
+	}
+}
+
+static ap_membuf_t itv64_serialize_raw(ap_manager_t * man, itv64_t * a) {
+	ap_membuf_t membuf = { 0, 0 };
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_SERIALIZE_RAW, "not implemented");
+	return membuf;
+}
+
+static itv64_t * itv64_deserialize_raw(ap_manager_t * man, void * ptr,
+		size_t * size) {
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_DESERIALIZE_RAW, "not implemented");
+	return 0;
+}
+
+/* Constructors */
+
+static itv64_t * itv64_bottom(ap_manager_t * man, size_t intdim, size_t realdim) {
+	set_exact(man, true);
+	return itv64_bottom_internal(intdim, realdim);
+}
+
+static itv64_t * itv64_top(ap_manager_t * man, size_t intdim, size_t realdim) {
+	set_exact(man, true);
+	return itv64_top_internal(intdim, realdim);
+}
+
+static itv64_t * itv64_of_box(ap_manager_t * man, size_t intdim,
+		size_t realdim, ap_interval_t ** tinterval) {
+	itv64_t * a = itv64_alloc(intdim, realdim);
+	int64_t * lo = itv64_lo(a);
+	int64_t * hi = itv64_hi(a);
+	set_exact(man, true);
+	for (size_t i = 0; i < itv64_dims(a); i++) {
+		/* Integer dimensions are rounded inwards */
+		bool is_int = i < intdim;
+		if (ap_interval_is_bottom(tinterval[i])) {
+			itv64_set_bottom(a);
+			return a;
+		}
+		lo[i] = bound_of_scalar(tinterval[i]->inf, is_int);
+		hi[i] = bound_of_scalar(tinterval[i]->sup, !is_int);
+		if (lo[i] > hi[i]) {
+			itv64_set_bottom(a);
+			return a;
+		}
+	}
+	return a;
+}
+
+/* Accessors and tests */
+
+static ap_dimension_t itv64_dimension(ap_manager_t * man, itv64_t * a) {
+	ap_dimension_t dimension = { a->intdim, a->realdim };
+	return dimension;
+}
+
+static bool itv64_is_bottom(ap_manager_t * man, itv64_t * a) {
+	set_exact(man, true);
+	return a->is_bottom;
+}
+
+static bool itv64_is_top(ap_manager_t * man, itv64_t * a) {
+	set_exact(man, true);
+	return !a->is_bottom &&
+			kernel_is_top(itv64_lo(a), itv64_hi(a), itv64_dims(a));
+}
+
+static bool itv64_is_leq(ap_manager_t * man, itv64_t * a1, itv64_t * a2) {
+	set_exact(man, true);
+	if (a1->is_bottom) {
+		return true;
+	}
+	if (a2->is_bottom) {
+		return false;
+	}
+	return kernel_is_leq(itv64_lo(a1), itv64_hi(a1), itv64_lo(a2),
+			itv64_hi(a2), itv64_dims(a1));
+}
+
+static bool itv64_is_eq(ap_manager_t * man, itv64_t * a1, itv64_t * a2) {
+	set_exact(man, true);
+	if (a1->is_bottom || a2->is_bottom) {
+		return a1->is_bottom == a2->is_bottom;
+	}
+	return kernel_is_eq(itv64_lo(a1), itv64_hi(a1), itv64_lo(a2),
+			itv64_hi(a2), itv64_dims(a1));
+}
+
+static bool itv64_is_dimension_unconstrained(ap_manager_t * man, itv64_t * a,
+		ap_dim_t dim) {
+	set_exact(man, true);
+	return !a->is_bottom && (itv64_lo(a)[dim] == BOUND_NEG_INF) &&
+			(itv64_hi(a)[dim] == BOUND_POS_INF);
+}
+
+static bool itv64_sat_interval(ap_manager_t * man, itv64_t * a, ap_dim_t dim,
+		ap_interval_t * interval) {
+	set_exact(man, true);
+	if (a->is_bottom) {
+		return true;
+	}
+	/* Within the integers inside the interval */
+	return (itv64_lo(a)[dim] >= bound_of_scalar(interval->inf, true)) &&
+			(itv64_hi(a)[dim] <= bound_of_scalar(interval->sup, false));
+}
+
+static void itv64_dim_bounds(void * ctx, ap_dim_t dim, int64_t * lo,
+		int64_t * hi) {
+	itv64_t * a = ctx;
+	*lo = itv64_lo(a)[dim];
+	*hi = itv64_hi(a)[dim];
+}
+
+/* The interval of texpr in a. Returns false if it is empty. */
+static bool itv64_eval(itv64_t * a, ap_texpr0_t * texpr, int64_t * lo,
+		int64_t * hi) {
+	native_linexpr_t expr;
+	native_linexpr_init(&expr);
+	bool is_nonempty = native_linearize(texpr, a->intdim, itv64_dim_bounds,
+			a, &expr);
+	if (is_nonempty) {
+		native_linexpr_bounds(&expr, itv64_dim_bounds, a, lo, hi);
+		is_nonempty = *lo <= *hi;
+	}
+	native_linexpr_clear(&expr);
+	return is_nonempty;
+}
+
+static bool itv64_sat_tcons(ap_manager_t * man, itv64_t * a,
+		ap_tcons0_t * cons) {
+	int64_t lo, hi;
+	set_exact(man, false);
+	if (a->is_bottom || !itv64_eval(a, cons->texpr0, &lo, &hi)) {
+		return true;
+	}
+	return native_sat_interval(cons->constyp, cons->scalar, lo, hi) ==
+			native_sat_true;
+}
+
+static bool itv64_sat_lincons(ap_manager_t * man, itv64_t * a,
+		ap_lincons0_t * lincons) {
+	ap_tcons0_t cons = ap_tcons0_from_lincons0(lincons);
+	bool result = itv64_sat_tcons(man, a, &cons);
+	ap_tcons0_clear(&cons);
+	return result;
+}
+
+static ap_interval_t * interval_of_bounds(int64_t lo, int64_t hi) {
+	ap_interval_t * interval = ap_interval_alloc();
+	bound_to_scalar(interval->inf, lo);
+	bound_to_scalar(interval->sup, hi);
+	return interval;
+}
+
+static ap_interval_t * itv64_bound_dimension(ap_manager_t * man, itv64_t * a,
+		ap_dim_t dim) {
+	set_exact(man, true);
+	if (a->is_bottom) {
+		ap_interval_t * interval = ap_interval_alloc();
+		ap_interval_set_bottom(interval);
+		return interval;
+	}
+	return interval_of_bounds(itv64_lo(a)[dim], itv64_hi(a)[dim]);
+}
+
+static ap_interval_t * itv64_bound_texpr(ap_manager_t * man, itv64_t * a,
+		ap_texpr0_t * texpr) {
+	int64_t lo, hi;
+	set_exact(man, false);
+	if (a->is_bottom || !itv64_eval(a, texpr, &lo, &hi)) {
+		ap_interval_t * interval = ap_interval_alloc();
+		ap_interval_set_bottom(interval);
+		return interval;
+	}
+	return interval_of_bounds(lo, hi);
+}
+
+static ap_interval_t * itv64_bound_linexpr(ap_manager_t * man, itv64_t * a,
+		ap_linexpr0_t * linexpr) {
+	ap_texpr0_t * texpr = ap_texpr0_from_linexpr0(linexpr);
+	ap_interval_t * interval = itv64_bound_texpr(man, a, texpr);
+	ap_texpr0_free(texpr);
+	return interval;
+}
+
+static ap_interval_t ** itv64_to_box(ap_manager_t * man, itv64_t * a) {
+	ap_interval_t ** box = ap_interval_array_alloc(itv64_dims(a));
+	set_exact(man, true);
+	for (size_t i = 0; i < itv64_dims(a); i++) {
+		if (a->is_bottom) {
+			ap_interval_set_bottom(box[i]);
+		} else {
+			bound_to_scalar(box[i]->inf, itv64_lo(a)[i]);
+			bound_to_scalar(box[i]->sup, itv64_hi(a)[i]);
+		}
+	}
+	return box;
+}
+
+/* The constraints of a dimension: lo == hi, or lo, hi, or none */
+static size_t count_constraints(itv64_t * a) {
+	size_t count = 0;
+	for (size_t i = 0; i < itv64_dims(a); i++) {
+		int64_t lo = itv64_lo(a)[i];
+		int64_t hi = itv64_hi(a)[i];
+		if ((lo == hi) && !bound_is_inf(lo)) {
+			count++;
+			continue;
+		}
+		count += (lo != BOUND_NEG_INF) + (hi != BOUND_POS_INF);
+	}
+	return count;
+}
+
+static ap_lincons0_t make_lincons(ap_constyp_t constyp, ap_dim_t dim,
+		long coeff, long cst) {
+	ap_linexpr0_t * linexpr = ap_linexpr0_alloc(AP_LINEXPR_SPARSE, 1);
+	linexpr->p.linterm[0].dim = dim;
+	ap_coeff_set_scalar_int(&linexpr->p.linterm[0].coeff, coeff);
+	ap_coeff_set_scalar_int(&linexpr->cst, cst);
+	return ap_lincons0_make(constyp, linexpr, 0);
+}
+
+static ap_lincons0_array_t itv64_to_lincons_array(ap_manager_t * man,
+		itv64_t * a) {
+	set_exact(man, true);
+	if (a->is_bottom) {
+		ap_lincons0_array_t array = ap_lincons0_array_make(1);
+		array.p[0] = ap_lincons0_make_unsat();
+		return array;
+	}
+	ap_lincons0_array_t array = ap_lincons0_array_make(count_constraints(a));
+	size_t count = 0;
+	for (size_t i = 0; i < itv64_dims(a); i++) {
+		int64_t lo = itv64_lo(a)[i];
+		int64_t hi = itv64_hi(a)[i];
+		if ((lo == hi) && !bound_is_inf(lo)) {
+			array.p[count++] = make_lincons(AP_CONS_EQ, i, 1, -lo);
+			continue;
+		}
+		if (lo != BOUND_NEG_INF) {
+			array.p[count++] = make_lincons(AP_CONS_SUPEQ, i, 1, -lo);
+		}
+		if (hi != BOUND_POS_INF) {
+			array.p[count++] = make_lincons(AP_CONS_SUPEQ, i, -1, hi);
+		}
+	}
+	return array;
+}
+
+/* x - b constyp 0, or b - x constyp 0 */
+static ap_tcons0_t make_tcons(ap_constyp_t constyp, ap_dim_t dim, int64_t b,
+		bool is_upper) {
+	ap_texpr0_t * x = ap_texpr0_dim(dim);
+	ap_texpr0_t * cst = ap_texpr0_cst_scalar_int((long)b);
+	ap_texpr0_t * texpr = is_upper ?
+			ap_texpr0_binop(AP_TEXPR_SUB, cst, x, AP_RTYPE_REAL, AP_RDIR_RND) :
+			ap_texpr0_binop(AP_TEXPR_SUB, x, cst, AP_RTYPE_REAL, AP_RDIR_RND);
+	return ap_tcons0_make(constyp, texpr, 0);
+}
+
+static ap_tcons0_array_t itv64_to_tcons_array(ap_manager_t * man,
+		itv64_t * a) {
+	set_exact(man, true);
+	if (a->is_bottom) {
+		ap_tcons0_array_t array = ap_tcons0_array_make(1);
+		array.p[0] = ap_tcons0_make_unsat();
+		return array;
+	}
+	ap_tcons0_array_t array = ap_tcons0_array_make(count_constraints(a));
+	size_t count = 0;
+	for (size_t i = 0; i < itv64_dims(a); i++) {
+		int64_t lo = itv64_lo(a)[i];
+		int64_t hi = itv64_hi(a)[i];
+		if ((lo == hi) && !bound_is_inf(lo)) {
+			array.p[count++] = make_tcons(AP_CONS_EQ, i, lo, false);
+			continue;
+		}
+		if (lo != BOUND_NEG_INF) {
+			array.p[count++] = make_tcons(AP_CONS_SUPEQ, i, lo, false);
+		}
+		if (hi != BOUND_POS_INF) {
+			array.p[count++] = make_tcons(AP_CONS_SUPEQ, i, hi, true);
+		}
+	}
+	return array;
+}
+
+static ap_generator0_array_t itv64_to_generator_array(ap_manager_t * man,
+		itv64_t * a) {
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_TO_GENERATOR_ARRAY, "not implemented");
+	return ap_generator0_array_make(0);
+}
+
+/* Meet and join */
+
+static itv64_t * itv64_meet(ap_manager_t * man, bool destructive, itv64_t * a1,
+		itv64_t * a2) {
+	itv64_t * result = destructive ? a1 : itv64_copy_internal(a1);
+	set_exact(man, true);
+	if ((a1 == a2) || result->is_bottom) {
+		return result;
+	}
+	if (a2->is_bottom || kernel_meet(itv64_lo(result), itv64_hi(result),
+			itv64_lo(a2), itv64_hi(a2), itv64_dims(result))) {
+		itv64_set_bottom(result);
+	}
+	return result;
+}
+
+static itv64_t * itv64_meet_array(ap_manager_t * man, itv64_t ** tab,
+		size_t size) {
+	itv64_t * result = itv64_copy_internal(tab[0]);
+	for (size_t i = 1; i < size; i++) {
+		result = itv64_meet(man, true, result, tab[i]);
+	}
+	set_exact(man, true);
+	return result;
+}
+
+static itv64_t * itv64_join(ap_manager_t * man, bool destructive, itv64_t * a1,
+		itv64_t * a2) {
+	set_exact(man, false);
+	if (a1->is_bottom) {
+		itv64_t * result = itv64_copy_internal(a2);
+		if (destructive) {
+			free(a1);
+		}
+		return result;
+	}
+	itv64_t * result = destructive ? a1 : itv64_copy_internal(a1);
+	if ((a1 != a2) && !a2->is_bottom) {
+		kernel_join(itv64_lo(result), itv64_hi(result), itv64_lo(a2),
+				itv64_hi(a2), itv64_dims(result));
+	}
+	return result;
+}
+
+static itv64_t * itv64_join_array(ap_manager_t * man, itv64_t ** tab,
+		size_t size) {
+	itv64_t * result = itv64_copy_internal(tab[0]);
+	for (size_t i = 1; i < size; i++) {
+		result = itv64_join(man, true, result, tab[i]);
+	}
+	set_exact(man, false);
+	return result;
+}
+
+typedef struct {
+	itv64_t * a;
+	bool is_changed;
+} tighten_ctx_t;
+
+static void tighten_ctx_bounds(void * ctx, ap_dim_t dim, int64_t * lo,
+		int64_t * hi) {
+	itv64_dim_bounds(((tighten_ctx_t *)ctx)->a, dim, lo, hi);
+}
+
+static bool tighten_ctx_tighten(void * ctx, ap_dim_t dim, int64_t lo,
+		int64_t hi) {
+	tighten_ctx_t * tctx = ctx;
+	int64_t * dim_lo = &itv64_lo(tctx->a)[dim];
+	int64_t * dim_hi = &itv64_hi(tctx->a)[dim];
+	if (lo > *dim_lo) {
+		*dim_lo = lo;
+		tctx->is_changed = true;
+	}
+	if (hi < *dim_hi) {
+		*dim_hi = hi;
+		tctx->is_changed = true;
+	}
+	return *dim_lo <= *dim_hi;
+}
+
+/* Propagate cons into tctx->a. Returns false if it is unsatisfiable. */
+static bool meet_tcons(tighten_ctx_t * tctx, ap_tcons0_t * cons) {
+	itv64_t * a = tctx->a;
+	native_linexpr_t expr;
+	int64_t lo, hi;
+	native_linexpr_init(&expr);
+	bool is_sat = native_linearize(cons->texpr0, a->intdim,
+			tighten_ctx_bounds, tctx, &expr) &&
+		native_propagate(&expr, cons->constyp, a->intdim,
+			tighten_ctx_bounds, tighten_ctx_tighten, tctx);
+	if (is_sat) {
+		native_linexpr_bounds(&expr, tighten_ctx_bounds, tctx, &lo, &hi);
+		is_sat = native_sat_interval(cons->constyp, cons->scalar, lo, hi) !=
+				native_sat_false;
+	}
+	native_linexpr_clear(&expr);
+	return is_sat;
+}
+
+static itv64_t * itv64_meet_tcons_array(ap_manager_t * man, bool destructive,
+		itv64_t * a, ap_tcons0_array_t * array) {
+	itv64_t * result = destructive ? a : itv64_copy_internal(a);
+	tighten_ctx_t tctx = { result, true };
+	set_exact(man, false);
+	for (unsigned round = 0; (round < meet_rounds) && tctx.is_changed &&
+			!result->is_bottom; round++) {
+		tctx.is_changed = false;
+		for (size_t i = 0; i < array->size; i++) {
+			if (!meet_tcons(&tctx, &array->p[i])) {
+				itv64_set_bottom(result);
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+static itv64_t * itv64_meet_lincons_array(ap_manager_t * man, bool destructive,
+		itv64_t * a, ap_lincons0_array_t * array) {
+	ap_tcons0_array_t tcons = ap_tcons0_array_make(array->size);
+	for (size_t i = 0; i < array->size; i++) {
+		tcons.p[i] = ap_tcons0_from_lincons0(&array->p[i]);
+	}
+	itv64_t * result = itv64_meet_tcons_array(man, destructive, a, &tcons);
+	ap_tcons0_array_clear(&tcons);
+	return result;
+}
+
+static itv64_t * itv64_add_ray_array(ap_manager_t * man, bool destructive,
+		itv64_t * a, ap_generator0_array_t * array) {
+	itv64_t * result = itv64_top_internal(a->intdim, a->realdim);
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_ADD_RAY_ARRAY, "not implemented");
+	if (destructive) {
+		free(a);
+	}
+	return result;
+}
+
+/* Assignments and substitutions */
+
+static itv64_t * itv64_meet_dest(ap_manager_t * man, itv64_t * result,
+		itv64_t * dest) {
+	if (dest) {
+		bool is_exact = man->result.flag_exact;
+		result = itv64_meet(man, true, result, dest);
+		set_exact(man, is_exact);
+	}
+	return result;
+}
+
+static itv64_t * itv64_assign_texpr_array(ap_manager_t * man, bool destructive,
+		itv64_t * a, ap_dim_t * tdim, ap_texpr0_t ** texpr, size_t size,
+		itv64_t * dest) {
+	itv64_t * result = destructive ? a : itv64_copy_internal(a);
+	set_exact(man, false);
+	if (result->is_bottom) {
+		return result;
+	}
+	/* In parallel: every expression is evaluated before any assignment */
+	int64_t * values = malloc(2 * size * sizeof(*values));
+	for (size_t i = 0; i < size; i++) {
+		if (!itv64_eval(result, texpr[i], &values[2 * i], &values[2 * i + 1])) {
+			free(values);
+			itv64_set_bottom(result);
+			return result;
+		}
+	}
+	for (size_t i = 0; i < size; i++) {
+		itv64_lo(result)[tdim[i]] = values[2 * i];
+		itv64_hi(result)[tdim[i]] = values[2 * i + 1];
+	}
+	free(values);
+	return itv64_meet_dest(man, result, dest);
+}
+
+static itv64_t * itv64_assign_linexpr_array(ap_manager_t * man,
+		bool destructive, itv64_t * a, ap_dim_t * tdim,
+		ap_linexpr0_t ** linexpr, size_t size, itv64_t * dest) {
+	ap_texpr0_t ** texpr = malloc(size * sizeof(*texpr));
+	for (size_t i = 0; i < size; i++) {
+		texpr[i] = ap_texpr0_from_linexpr0(linexpr[i]);
+	}
+	itv64_t * result = itv64_assign_texpr_array(man, destructive, a, tdim,
+			texpr, size, dest);
+	for (size_t i = 0; i < size; i++) {
+		ap_texpr0_free(texpr[i]);
+	}
+	free(texpr);
+	return result;
+}
+
+/* The states whose image is in a agree with a on the other dimensions */
+static itv64_t * itv64_substitute(ap_manager_t * man, bool destructive,
+		itv64_t * a, ap_dim_t * tdim, size_t size, itv64_t * dest) {
+	itv64_t * result = destructive ? a : itv64_copy_internal(a);
+	set_exact(man, false);
+	if (result->is_bottom) {
+		return result;
+	}
+	for (size_t i = 0; i < size; i++) {
+		itv64_lo(result)[tdim[i]] = BOUND_NEG_INF;
+		itv64_hi(result)[tdim[i]] = BOUND_POS_INF;
+	}
+	return itv64_meet_dest(man, result, dest);
+}
+
+static itv64_t * itv64_substitute_linexpr_array(ap_manager_t * man,
+		bool destructive, itv64_t * a, ap_dim_t * tdim,
+		ap_linexpr0_t ** linexpr, size_t size, itv64_t * dest) {
+	return itv64_substitute(man, destructive, a, tdim, size, dest);
+}
+
+static itv64_t * itv64_substitute_texpr_array(ap_manager_t * man,
+		bool destructive, itv64_t * a, ap_dim_t * tdim,
+		ap_texpr0_t ** texpr, size_t size, itv64_t * dest) {
+	return itv64_substitute(man, destructive, a, tdim, size, dest);
+}
+
+/* Projections */
+
+static itv64_t * itv64_forget_array(ap_manager_t * man, bool destructive,
+		itv64_t * a, ap_dim_t * tdim, size_t size, bool project) {
+	itv64_t * result = destructive ? a : itv64_copy_internal(a);
+	set_exact(man, true);
+	if (result->is_bottom) {
+		return result;
+	}
+	for (size_t i = 0; i < size; i++) {
+		itv64_lo(result)[tdim[i]] = project ? 0 : BOUND_NEG_INF;
+		itv64_hi(result)[tdim[i]] = project ? 0 : BOUND_POS_INF;
+	}
+	return result;
+}
+
+/* Change and permutation of dimensions */
+
+static itv64_t * itv64_add_dimensions(ap_manager_t * man, bool destructive,
+		itv64_t * a, ap_dimchange_t * dimchange, bool project) {
+	size_t n = itv64_dims(a);
+	size_t added = dimchange->intdim + dimchange->realdim;
+	itv64_t * result = itv64_alloc(a->intdim + dimchange->intdim,
+			a->realdim + dimchange->realdim);
+	int64_t * lo = itv64_lo(result);
+	int64_t * hi = itv64_hi(result);
+	size_t k = 0;
+	size_t j = 0;
+	set_exact(man, true);
+	result->is_bottom = a->is_bottom;
+	/* dimchange->dim[k] is the dimension of a the new one is inserted
+	 * before */
+	for (size_t i = 0; i <= n; i++) {
+		while ((k < added) && (dimchange->dim[k] == i)) {
+			lo[j] = project ? 0 : BOUND_NEG_INF;
+			hi[j] = project ? 0 : BOUND_POS_INF;
+			j++;
+			k++;
+		}
+		if (i < n) {
+			lo[j] = itv64_lo(a)[i];
+			hi[j] = itv64_hi(a)[i];
+			j++;
+		}
+	}
+	if (destructive) {
+		free(a);
+	}
+	return result;
+}
+
+static itv64_t * itv64_remove_dimensions(ap_manager_t * man, bool destructive,
+		itv64_t * a, ap_dimchange_t * dimchange) {
+	size_t n = itv64_dims(a);
+	size_t removed = dimchange->intdim + dimchange->realdim;
+	itv64_t * result = itv64_alloc(a->intdim - dimchange->intdim,
+			a->realdim - dimchange->realdim);
+	int64_t * lo = itv64_lo(result);
+	int64_t * hi = itv64_hi(result);
+	size_t k = 0;
+	size_t j = 0;
+	set_exact(man, true);
+	result->is_bottom = a->is_bottom;
+	for (size_t i = 0; i < n; i++) {
+		if ((k < removed) && (dimchange->dim[k] == i)) {
+			k++;
+			continue;
+		}
+		lo[j] = itv64_lo(a)[i];
+		hi[j] = itv64_hi(a)[i];
+		j++;
+	}
+	if (destructive) {
+		free(a);
+	}
+	return result;
+}
+
+static itv64_t * itv64_permute_dimensions(ap_manager_t * man,
+		bool destructive, itv64_t * a, ap_dimperm_t * perm) {
+	itv64_t * result = itv64_alloc(a->intdim, a->realdim);
+	int64_t * lo = itv64_lo(result);
+	int64_t * hi = itv64_hi(result);
+	set_exact(man, true);
+	result->is_bottom = a->is_bottom;
+	for (size_t i = 0; i < itv64_dims(a); i++) {
+		lo[perm->dim[i]] = itv64_lo(a)[i];
+		hi[perm->dim[i]] = itv64_hi(a)[i];
+	}
+	if (destructive) {
+		free(a);
+	}
+	return result;
+}
+
+/* Expansion and folding of dimensions */
+
+static itv64_t * itv64_expand(ap_manager_t * man, bool destructive,
+		itv64_t * a, ap_dim_t dim, size_t n) {
+	/* The copies are added after the dimensions of the same type */
+	bool is_int = dim < a->intdim;
+	ap_dimchange_t * dimchange = is_int ? ap_dimchange_alloc(n, 0) :
+			ap_dimchange_alloc(0, n);
+	for (size_t i = 0; i < n; i++) {
+		dimchange->dim[i] = is_int ? a->intdim : itv64_dims(a);
+	}
+	int64_t lo = itv64_lo(a)[dim];
+	int64_t hi = itv64_hi(a)[dim];
+	size_t first = is_int ? a->intdim : itv64_dims(a);
+	itv64_t * result = itv64_add_dimensions(man, destructive, a, dimchange,
+			false);
+	for (size_t i = 0; i < n; i++) {
+		itv64_lo(result)[first + i] = lo;
+		itv64_hi(result)[first + i] = hi;
+	}
+	ap_dimchange_free(dimchange);
+	return result;
+}
+
+static itv64_t * itv64_fold(ap_manager_t * man, bool destructive, itv64_t * a,
+		ap_dim_t * tdim, size_t size) {
+	itv64_t * result = destructive ? a : itv64_copy_internal(a);
+	int64_t * lo = itv64_lo(result);
+	int64_t * hi = itv64_hi(result);
+	/* Into the first dimension, then the others are removed */
+	for (size_t i = 1; i < size; i++) {
+		lo[tdim[0]] = (lo[tdim[i]] < lo[tdim[0]]) ? lo[tdim[i]] : lo[tdim[0]];
+		hi[tdim[0]] = (hi[tdim[i]] > hi[tdim[0]]) ? hi[tdim[i]] : hi[tdim[0]];
+	}
+	size_t intdim = 0;
+	for (size_t i = 1; i < size; i++) {
+		intdim += tdim[i] < result->intdim;
+	}
+	ap_dimchange_t dimchange = {
+		.dim = tdim + 1,
+		.intdim = intdim,
+		.realdim = size - 1 - intdim
+	};
+	result = itv64_remove_dimensions(man, true, result, &dimchange);
+	set_exact(man, false);
+	return result;
+}
+
+/* Widening and closure */
+
+static itv64_t * itv64_widening(ap_manager_t * man, itv64_t * a1,
+		itv64_t * a2) {
+	set_exact(man, false);
+	if (a1->is_bottom) {
+		return itv64_copy_internal(a2);
+	}
+	itv64_t * result = itv64_copy_internal(a1);
+	if (!a2->is_bottom) {
+		kernel_widen(itv64_lo(result), itv64_hi(result), itv64_lo(a2),
+				itv64_hi(a2), itv64_dims(result));
+	}
+	return result;
+}
+
+static itv64_t * itv64_closure(ap_manager_t * man, bool destructive,
+		itv64_t * a) {
+	set_exact(man, true);
+	return destructive ? a : itv64_copy_internal(a);
+}
+
+ap_manager_t * itv64_manager_alloc(void) {
+	ap_manager_t * man = ap_manager_alloc("itv64", "1.0", 0, 0);
+	void ** funptr;
+	char * rounds_str = getenv("ITV64_MEET_ROUNDS");
+	if (!man) {
+		return 0;
+	}
+	if (rounds_str && (atoi(rounds_str) > 0)) {
+		meet_rounds = atoi(rounds_str);
+	}
+	funptr = man->funptr;
+	funptr[AP_FUNID_COPY] = &itv64_copy;
+	funptr[AP_FUNID_FREE] = &itv64_free;
+	funptr[AP_FUNID_ASIZE] = &itv64_size;
+	funptr[AP_FUNID_MINIMIZE] = &itv64_minimize;
+	funptr[AP_FUNID_CANONICALIZE] = &itv64_canonicalize;
+	funptr[AP_FUNID_HASH] = &itv64_hash;
+	funptr[AP_FUNID_APPROXIMATE] = &itv64_approximate;
+	funptr[AP_FUNID_FPRINT] = &itv64_fprint;
+	funptr[AP_FUNID_FPRINTDIFF] = &itv64_fprintdiff;
+	funptr[AP_FUNID_FDUMP] = &itv64_fdump;
+	funptr[AP_FUNID_SERIALIZE_RAW] = &itv64_serialize_raw;
+	funptr[AP_FUNID_DESERIALIZE_RAW] = &itv64_deserialize_raw;
+	funptr[AP_FUNID_BOTTOM] = &itv64_bottom;
+	funptr[AP_FUNID_TOP] = &itv64_top;
+	funptr[AP_FUNID_OF_BOX] = &itv64_of_box;
+	funptr[AP_FUNID_DIMENSION] = &itv64_dimension;
+	funptr[AP_FUNID_IS_BOTTOM] = &itv64_is_bottom;
+	funptr[AP_FUNID_IS_TOP] = &itv64_is_top;
+	funptr[AP_FUNID_IS_LEQ] = &itv64_is_leq;
+	funptr[AP_FUNID_IS_EQ] = &itv64_is_eq;
+	funptr[AP_FUNID_IS_DIMENSION_UNCONSTRAINED] =
+			&itv64_is_dimension_unconstrained;
+	funptr[AP_FUNID_SAT_INTERVAL] = &itv64_sat_interval;
+	funptr[AP_FUNID_SAT_LINCONS] = &itv64_sat_lincons;
+	funptr[AP_FUNID_SAT_TCONS] = &itv64_sat_tcons;
+	funptr[AP_FUNID_BOUND_DIMENSION] = &itv64_bound_dimension;
+	funptr[AP_FUNID_BOUND_LINEXPR] = &itv64_bound_linexpr;
+	funptr[AP_FUNID_BOUND_TEXPR] = &itv64_bound_texpr;
+	funptr[AP_FUNID_TO_BOX] = &itv64_to_box;
+	funptr[AP_FUNID_TO_LINCONS_ARRAY] = &itv64_to_lincons_array;
+	funptr[AP_FUNID_TO_TCONS_ARRAY] = &itv64_to_tcons_array;
+	funptr[AP_FUNID_TO_GENERATOR_ARRAY] = &itv64_to_generator_array;
+	funptr[AP_FUNID_MEET] = &itv64_meet;
+	funptr[AP_FUNID_MEET_ARRAY] = &itv64_meet_array;
+	funptr[AP_FUNID_MEET_LINCONS_ARRAY] = &itv64_meet_lincons_array;
+	funptr[AP_FUNID_MEET_TCONS_ARRAY] = &itv64_meet_tcons_array;
+	funptr[AP_FUNID_JOIN] = &itv64_join;
+	funptr[AP_FUNID_JOIN_ARRAY] = &itv64_join_array;
+	funptr[AP_FUNID_ADD_RAY_ARRAY] = &itv64_add_ray_array;
+	funptr[AP_FUNID_ASSIGN_LINEXPR_ARRAY] = &itv64_assign_linexpr_array;
+	funptr[AP_FUNID_SUBSTITUTE_LINEXPR_ARRAY] =
+			&itv64_substitute_linexpr_array;
+	funptr[AP_FUNID_ASSIGN_TEXPR_ARRAY] = &itv64_assign_texpr_array;
+	funptr[AP_FUNID_SUBSTITUTE_TEXPR_ARRAY] = &itv64_substitute_texpr_array;
+	funptr[AP_FUNID_ADD_DIMENSIONS] = &itv64_add_dimensions;
+	funptr[AP_FUNID_REMOVE_DIMENSIONS] = &itv64_remove_dimensions;
+	funptr[AP_FUNID_PERMUTE_DIMENSIONS] = &itv64_permute_dimensions;
+	funptr[AP_FUNID_FORGET_ARRAY] = &itv64_forget_array;
+	funptr[AP_FUNID_EXPAND] = &itv64_expand;
+	funptr[AP_FUNID_FOLD] = &itv64_fold;
+	funptr[AP_FUNID_WIDENING] = &itv64_widening;
+	funptr[AP_FUNID_CLOSURE] = &itv64_closure;
+	for (int exception = 0; exception < AP_EXC_SIZE; exception++) {
+		ap_manager_set_abort_if_exception(man, exception, false);
+	}
+	return man;
+}
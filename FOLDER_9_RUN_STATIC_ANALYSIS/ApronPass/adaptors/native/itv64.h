@@ -0,0 +1,24 @@
+#ifndef NATIVE_ITV64_H
+#define NATIVE_ITV64_H
+
+/* Native interval domain. An apron manager whose abstract values are two
+ * flat int64 arrays, the lower and the upper bounds of the dimensions (see
+ * bound.h), instead of an array of MPQ intervals. The lattice operations
+ * are branch-free loops over these arrays, which the compiler vectorizes.
+ * Constraints are quasi-linearized and propagated as by the box domain.
+ *
+ * The environment variable ITV64_MEET_ROUNDS sets the number of
+ * propagation rounds of meet_tcons_array (4). */
+#include <ap_manager.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ap_manager_t * itv64_manager_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NATIVE_ITV64_H */
@@ -0,0 +1,577 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "linexpr.h"
+
+typedef struct {
+	size_t intdim;
+	native_dim_bounds_t bounds;
+	void * ctx;
+} linearize_ctx_t;
+
+void native_linexpr_init(native_linexpr_t * expr) {
+	memset(expr, 0, sizeof(*expr));
+	expr->is_exact = true;
+}
+
+void native_linexpr_clear(native_linexpr_t * expr) {
+	free(expr->dims);
+	free(expr->coeffs);
+	native_linexpr_init(expr);
+}
+
+/* Add [lo, hi] to the constant */
+static void add_constant(native_linexpr_t * expr, int64_t lo, int64_t hi) {
+	expr->cst_lo = bound_add_lo(expr->cst_lo, lo);
+	expr->cst_hi = bound_add_hi(expr->cst_hi, hi);
+}
+
+/* Add scale * [lo, hi] to the constant */
+static void add_scaled_constant(native_linexpr_t * expr, int64_t scale,
+		int64_t lo, int64_t hi) {
+	bound_wide_t a = bound_mul_wide(scale, lo);
+	bound_wide_t b = bound_mul_wide(scale, hi);
+	if (scale < 0) {
+		bound_wide_t tmp = a;
+		a = b;
+		b = tmp;
+	}
+	add_constant(expr, bound_lo(a), bound_hi(b));
+}
+
+/* Add coeff * dim. A coefficient that overflows is replaced by the interval
+ * of the term. */
+static void add_term(native_linexpr_t * expr, linearize_ctx_t * lctx,
+		ap_dim_t dim, int64_t coeff) {
+	size_t idx;
+	for (idx = 0; idx < expr->size; idx++) {
+		if (expr->dims[idx] == dim) {
+			break;
+		}
+	}
+	if (idx == expr->size) {
+		if (expr->size == expr->capacity) {
+			expr->capacity = expr->capacity ? 2 * expr->capacity : 4;
+			expr->dims = realloc(expr->dims,
+					expr->capacity * sizeof(*expr->dims));
+			expr->coeffs = realloc(expr->coeffs,
+					expr->capacity * sizeof(*expr->coeffs));
+		}
+		expr->dims[idx] = dim;
+		expr->coeffs[idx] = 0;
+		expr->size++;
+	}
+	bound_wide_t sum = (bound_wide_t)expr->coeffs[idx] + coeff;
+	if ((sum < BOUND_MIN) || (sum > BOUND_MAX)) {
+		int64_t lo, hi;
+		lctx->bounds(lctx->ctx, dim, &lo, &hi);
+		add_scaled_constant(expr, expr->coeffs[idx], lo, hi);
+		add_scaled_constant(expr, coeff, lo, hi);
+		expr->coeffs[idx] = 0;
+		expr->is_exact = false;
+		return;
+	}
+	expr->coeffs[idx] = (int64_t)sum;
+}
+
+/* Whether the value of expr is always an integer */
+static bool is_integral(native_linexpr_t * expr, size_t intdim) {
+	if (!expr->is_exact) {
+		return false;
+	}
+	for (size_t idx = 0; idx < expr->size; idx++) {
+		if ((expr->coeffs[idx] != 0) && (expr->dims[idx] >= intdim)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool eval(ap_texpr0_t * texpr, linearize_ctx_t * lctx,
+		int64_t * lo, int64_t * hi);
+
+static bool linearize(ap_texpr0_t * texpr, int64_t scale,
+		linearize_ctx_t * lctx, native_linexpr_t * expr);
+
+/* The constant of a CST node, and whether it is exactly an integer */
+static bool eval_constant(ap_coeff_t * coeff, int64_t * lo, int64_t * hi,
+		bool * is_exact) {
+	if (coeff->discr == AP_COEFF_SCALAR) {
+		*lo = bound_of_scalar(coeff->val.scalar, false);
+		*hi = bound_of_scalar(coeff->val.scalar, true);
+		*is_exact = (*lo == *hi);
+		return true;
+	}
+	if (ap_interval_is_bottom(coeff->val.interval)) {
+		return false;
+	}
+	*lo = bound_of_scalar(coeff->val.interval->inf, false);
+	*hi = bound_of_scalar(coeff->val.interval->sup, true);
+	*is_exact = false;
+	return true;
+}
+
+/* Add scale * texpr to expr, as an interval */
+static bool linearize_interval(ap_texpr0_t * texpr, int64_t scale,
+		linearize_ctx_t * lctx, native_linexpr_t * expr) {
+	int64_t lo, hi;
+	if (!eval(texpr, lctx, &lo, &hi)) {
+		return false;
+	}
+	add_scaled_constant(expr, scale, lo, hi);
+	expr->is_exact = false;
+	return true;
+}
+
+/* Linear operators, without the rounding of the node */
+static bool linearize_node(ap_texpr0_t * texpr, int64_t scale,
+		linearize_ctx_t * lctx, native_linexpr_t * expr) {
+	ap_texpr0_node_t * node = texpr->val.node;
+	int64_t lo, hi;
+	bound_wide_t product;
+	switch (node->op) {
+	case AP_TEXPR_ADD:
+		return linearize(node->exprA, scale, lctx, expr) &&
+				linearize(node->exprB, scale, lctx, expr);
+	case AP_TEXPR_SUB:
+		if (scale == BOUND_MIN) {
+			break;
+		}
+		return linearize(node->exprA, scale, lctx, expr) &&
+				linearize(node->exprB, -scale, lctx, expr);
+	case AP_TEXPR_NEG:
+		if (scale == BOUND_MIN) {
+			break;
+		}
+		return linearize(node->exprA, -scale, lctx, expr);
+	case AP_TEXPR_CAST:
+		return linearize(node->exprA, scale, lctx, expr);
+	case AP_TEXPR_MUL:
+		/* Linear if either side has a single value in this state */
+		if (!eval(node->exprA, lctx, &lo, &hi)) {
+			return false;
+		}
+		if ((lo == hi) && !bound_is_inf(lo)) {
+			product = (bound_wide_t)scale * lo;
+			if ((product >= BOUND_MIN) && (product <= BOUND_MAX)) {
+				return linearize(node->exprB, (int64_t)product, lctx, expr);
+			}
+		}
+		if (!eval(node->exprB, lctx, &lo, &hi)) {
+			return false;
+		}
+		if ((lo == hi) && !bound_is_inf(lo)) {
+			product = (bound_wide_t)scale * lo;
+			if ((product >= BOUND_MIN) && (product <= BOUND_MAX)) {
+				return linearize(node->exprA, (int64_t)product, lctx, expr);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+	return linearize_interval(texpr, scale, lctx, expr);
+}
+
+static bool linearize(ap_texpr0_t * texpr, int64_t scale,
+		linearize_ctx_t * lctx, native_linexpr_t * expr) {
+	int64_t lo, hi;
+	bool is_exact;
+	switch (texpr->discr) {
+	case AP_TEXPR_CST:
+		if (!eval_constant(&texpr->val.cst, &lo, &hi, &is_exact)) {
+			return false;
+		}
+		add_scaled_constant(expr, scale, lo, hi);
+		expr->is_exact = expr->is_exact && is_exact;
+		return true;
+	case AP_TEXPR_DIM:
+		add_term(expr, lctx, texpr->val.dim, scale);
+		return true;
+	case AP_TEXPR_NODE:
+		break;
+	}
+	ap_texpr0_node_t * node = texpr->val.node;
+	if ((node->type != AP_RTYPE_REAL) && (node->type != AP_RTYPE_INT)) {
+		/* Floating point rounding is not modelled */
+		add_constant(expr, BOUND_NEG_INF, BOUND_POS_INF);
+		expr->is_exact = false;
+		return true;
+	}
+	switch (node->op) {
+	case AP_TEXPR_ADD:
+	case AP_TEXPR_SUB:
+	case AP_TEXPR_NEG:
+	case AP_TEXPR_CAST:
+	case AP_TEXPR_MUL:
+		break;
+	default:
+		return linearize_interval(texpr, scale, lctx, expr);
+	}
+	if (node->type == AP_RTYPE_REAL) {
+		return linearize_node(texpr, scale, lctx, expr);
+	}
+	/* Rounded to an integer: linear only if the value is already one.
+	 * Otherwise, since bounds are integers, the rounded value stays within
+	 * the bounds of the inner one. */
+	native_linexpr_t inner;
+	native_linexpr_init(&inner);
+	if (!linearize_node(texpr, 1, lctx, &inner)) {
+		native_linexpr_clear(&inner);
+		return false;
+	}
+	bool is_linear = is_integral(&inner, lctx->intdim);
+	for (size_t idx = 0; is_linear && (idx < inner.size); idx++) {
+		bound_wide_t coeff = (bound_wide_t)inner.coeffs[idx] * scale;
+		is_linear = (coeff >= BOUND_MIN) && (coeff <= BOUND_MAX);
+	}
+	if (is_linear) {
+		for (size_t idx = 0; idx < inner.size; idx++) {
+			add_term(expr, lctx, inner.dims[idx], inner.coeffs[idx] * scale);
+		}
+		add_scaled_constant(expr, scale, inner.cst_lo, inner.cst_hi);
+	} else {
+		native_linexpr_bounds(&inner, lctx->bounds, lctx->ctx, &lo, &hi);
+		add_scaled_constant(expr, scale, lo, hi);
+		expr->is_exact = false;
+	}
+	native_linexpr_clear(&inner);
+	return true;
+}
+
+bool native_linearize(ap_texpr0_t * texpr, size_t intdim,
+		native_dim_bounds_t bounds, void * ctx, native_linexpr_t * expr) {
+	linearize_ctx_t lctx = { intdim, bounds, ctx };
+	return linearize(texpr, 1, &lctx, expr);
+}
+
+static void eval_div(int64_t alo, int64_t ahi, int64_t blo, int64_t bhi,
+		int64_t * lo, int64_t * hi) {
+	if ((blo <= 0) && (bhi >= 0)) {
+		*lo = BOUND_NEG_INF;
+		*hi = BOUND_POS_INF;
+		return;
+	}
+	/* Monotonic in each argument: the extremes are at the corners. A
+	 * finite value divided by oo tends to 0. */
+	int64_t as[2] = { alo, ahi };
+	int64_t bs[2] = { blo, bhi };
+	bound_wide_t min = BOUND_WIDE_INF;
+	bound_wide_t max = -BOUND_WIDE_INF;
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 2; j++) {
+			bound_wide_t floor_q, ceil_q;
+			if (bound_is_inf(as[i])) {
+				floor_q = ceil_q = bound_sign(as[i]) * bound_sign(bs[j]) *
+						BOUND_WIDE_INF;
+			} else if (bound_is_inf(bs[j])) {
+				floor_q = ceil_q = 0;
+			} else {
+				floor_q = bound_div_floor(as[i], bs[j]);
+				ceil_q = bound_div_ceil(as[i], bs[j]);
+			}
+			min = (floor_q < min) ? floor_q : min;
+			max = (ceil_q > max) ? ceil_q : max;
+		}
+	}
+	*lo = bound_lo(min);
+	*hi = bound_hi(max);
+}
+
+static void eval_mod(int64_t alo, int64_t ahi, int64_t blo, int64_t bhi,
+		bool is_int, int64_t * lo, int64_t * hi) {
+	if ((blo <= 0) && (bhi >= 0)) {
+		*lo = BOUND_NEG_INF;
+		*hi = BOUND_POS_INF;
+		return;
+	}
+	/* The remainder has the sign of the dividend, and is smaller than the
+	 * divisor in absolute value */
+	int64_t max = (blo > 0) ? bhi : bound_neg(blo);
+	if (is_int && !bound_is_inf(max)) {
+		max = max - 1;
+	}
+	*lo = (alo >= 0) ? 0 : ((alo > bound_neg(max)) ? alo : bound_neg(max));
+	*hi = (ahi <= 0) ? 0 : ((ahi < max) ? ahi : max);
+}
+
+static bool eval(ap_texpr0_t * texpr, linearize_ctx_t * lctx,
+		int64_t * lo, int64_t * hi) {
+	bool is_exact;
+	switch (texpr->discr) {
+	case AP_TEXPR_CST:
+		return eval_constant(&texpr->val.cst, lo, hi, &is_exact);
+	case AP_TEXPR_DIM:
+		lctx->bounds(lctx->ctx, texpr->val.dim, lo, hi);
+		return *lo <= *hi;
+	case AP_TEXPR_NODE:
+		break;
+	}
+	ap_texpr0_node_t * node = texpr->val.node;
+	int64_t alo, ahi, blo = 0, bhi = 0;
+	if (!eval(node->exprA, lctx, &alo, &ahi)) {
+		return false;
+	}
+	if (node->exprB && !eval(node->exprB, lctx, &blo, &bhi)) {
+		return false;
+	}
+	if ((node->type != AP_RTYPE_REAL) && (node->type != AP_RTYPE_INT)) {
+		*lo = BOUND_NEG_INF;
+		*hi = BOUND_POS_INF;
+		return true;
+	}
+	switch (node->op) {
+	case AP_TEXPR_ADD:
+		*lo = bound_add_lo(alo, blo);
+		*hi = bound_add_hi(ahi, bhi);
+		break;
+	case AP_TEXPR_SUB:
+		*lo = bound_add_lo(alo, bound_neg(bhi));
+		*hi = bound_add_hi(ahi, bound_neg(blo));
+		break;
+	case AP_TEXPR_NEG:
+		*lo = bound_neg(ahi);
+		*hi = bound_neg(alo);
+		break;
+	case AP_TEXPR_CAST:
+		*lo = alo;
+		*hi = ahi;
+		break;
+	case AP_TEXPR_MUL: {
+		bound_wide_t corners[4] = {
+			bound_mul_wide(alo, blo), bound_mul_wide(alo, bhi),
+			bound_mul_wide(ahi, blo), bound_mul_wide(ahi, bhi)
+		};
+		bound_wide_t min = corners[0];
+		bound_wide_t max = corners[0];
+		for (int idx = 1; idx < 4; idx++) {
+			min = (corners[idx] < min) ? corners[idx] : min;
+			max = (corners[idx] > max) ? corners[idx] : max;
+		}
+		*lo = bound_lo(min);
+		*hi = bound_hi(max);
+		break;
+	}
+	case AP_TEXPR_DIV:
+		eval_div(alo, ahi, blo, bhi, lo, hi);
+		break;
+	case AP_TEXPR_MOD:
+		eval_mod(alo, ahi, blo, bhi, node->type == AP_RTYPE_INT, lo, hi);
+		break;
+	default:
+		/* POW, SQRT */
+		*lo = BOUND_NEG_INF;
+		*hi = BOUND_POS_INF;
+		break;
+	}
+	return true;
+}
+
+bool native_eval_texpr(ap_texpr0_t * texpr, native_dim_bounds_t bounds,
+		void * ctx, int64_t * lo, int64_t * hi) {
+	linearize_ctx_t lctx = { 0, bounds, ctx };
+	return eval(texpr, &lctx, lo, hi);
+}
+
+/* Upper bound of coeff * dim */
+static int64_t term_hi(int64_t coeff, int64_t lo, int64_t hi) {
+	return bound_hi(bound_mul_wide(coeff, (coeff > 0) ? hi : lo));
+}
+
+void native_linexpr_bounds(native_linexpr_t * expr, native_dim_bounds_t bounds,
+		void * ctx, int64_t * lo, int64_t * hi) {
+	int64_t result_lo = expr->cst_lo;
+	int64_t result_hi = expr->cst_hi;
+	for (size_t idx = 0; idx < expr->size; idx++) {
+		int64_t coeff = expr->coeffs[idx];
+		int64_t dim_lo, dim_hi;
+		if (coeff == 0) {
+			continue;
+		}
+		bounds(ctx, expr->dims[idx], &dim_lo, &dim_hi);
+		result_lo = bound_add_lo(result_lo,
+				bound_neg(term_hi(-coeff, dim_lo, dim_hi)));
+		result_hi = bound_add_hi(result_hi, term_hi(coeff, dim_lo, dim_hi));
+	}
+	*lo = result_lo;
+	*hi = result_hi;
+}
+
+native_sat_e native_sat_interval(ap_constyp_t constyp, ap_scalar_t * modulo,
+		int64_t lo, int64_t hi) {
+	switch (constyp) {
+	case AP_CONS_EQ:
+		if ((lo == 0) && (hi == 0)) {
+			return native_sat_true;
+		}
+		return ((lo > 0) || (hi < 0)) ? native_sat_false : native_sat_unknown;
+	case AP_CONS_SUPEQ:
+		if (lo >= 0) {
+			return native_sat_true;
+		}
+		return (hi < 0) ? native_sat_false : native_sat_unknown;
+	case AP_CONS_SUP:
+		if (lo > 0) {
+			return native_sat_true;
+		}
+		return (hi <= 0) ? native_sat_false : native_sat_unknown;
+	case AP_CONS_DISEQ:
+		if ((lo > 0) || (hi < 0)) {
+			return native_sat_true;
+		}
+		return ((lo == 0) && (hi == 0)) ? native_sat_false : native_sat_unknown;
+	case AP_CONS_EQMOD: {
+		if ((lo != hi) || bound_is_inf(lo) || !modulo) {
+			return native_sat_unknown;
+		}
+		int64_t modulo_lo = bound_of_scalar(modulo, false);
+		int64_t modulo_hi = bound_of_scalar(modulo, true);
+		if ((modulo_lo != modulo_hi) || bound_is_inf(modulo_lo)) {
+			return native_sat_unknown;
+		}
+		if (modulo_lo == 0) {
+			return (lo == 0) ? native_sat_true : native_sat_false;
+		}
+		return (lo % modulo_lo == 0) ? native_sat_true : native_sat_false;
+	}
+	default:
+		return native_sat_unknown;
+	}
+}
+
+/* Propagate sign * expr + offset >= 0. Each term is bounded by the upper
+ * bounds of the others, if at most one of those is infinite. */
+static bool propagate_supeq(native_linexpr_t * expr, int sign, int64_t offset,
+		size_t intdim, native_dim_bounds_t bounds,
+		native_dim_tighten_t tighten, void * ctx) {
+	int64_t cst_hi = (sign > 0) ? expr->cst_hi : bound_neg(expr->cst_lo);
+	bound_wide_t finite_sum = offset;
+	unsigned inf_count = 0;
+	if (cst_hi == BOUND_POS_INF) {
+		inf_count++;
+	} else {
+		finite_sum += cst_hi;
+	}
+	for (size_t idx = 0; idx < expr->size; idx++) {
+		int64_t coeff = sign * expr->coeffs[idx];
+		int64_t lo, hi;
+		if (coeff == 0) {
+			continue;
+		}
+		bounds(ctx, expr->dims[idx], &lo, &hi);
+		if (lo > hi) {
+			return false;
+		}
+		int64_t term = term_hi(coeff, lo, hi);
+		if (term == BOUND_POS_INF) {
+			inf_count++;
+		} else {
+			finite_sum += term;
+		}
+	}
+	if ((inf_count == 0) && (finite_sum < 0)) {
+		return false;
+	}
+	if (inf_count > 1) {
+		return true;
+	}
+	for (size_t idx = 0; idx < expr->size; idx++) {
+		int64_t coeff = sign * expr->coeffs[idx];
+		ap_dim_t dim = expr->dims[idx];
+		int64_t lo, hi;
+		if (coeff == 0) {
+			continue;
+		}
+		bounds(ctx, dim, &lo, &hi);
+		int64_t term = term_hi(coeff, lo, hi);
+		if ((inf_count == 1) && (term != BOUND_POS_INF)) {
+			continue;
+		}
+		bound_wide_t rest = (term == BOUND_POS_INF) ? finite_sum : finite_sum - term;
+		/* coeff * dim >= -rest */
+		bool is_int = dim < intdim;
+		bool is_nonempty;
+		if (coeff > 0) {
+			bound_wide_t bound = is_int ? bound_div_ceil(-rest, coeff) :
+					bound_div_floor(-rest, coeff);
+			is_nonempty = tighten(ctx, dim, bound_lo(bound), BOUND_POS_INF);
+		} else {
+			bound_wide_t bound = is_int ? bound_div_floor(-rest, coeff) :
+					bound_div_ceil(-rest, coeff);
+			is_nonempty = tighten(ctx, dim, BOUND_NEG_INF, bound_hi(bound));
+		}
+		if (!is_nonempty) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Only a single integer dimension against a constant: cut the value off
+ * the ends of its interval */
+static bool propagate_diseq(native_linexpr_t * expr, size_t intdim,
+		native_dim_bounds_t bounds, native_dim_tighten_t tighten,
+		void * ctx) {
+	if (!expr->is_exact || (expr->cst_lo != expr->cst_hi) ||
+			bound_is_inf(expr->cst_lo)) {
+		return true;
+	}
+	size_t terms = 0;
+	size_t term = 0;
+	for (size_t idx = 0; idx < expr->size; idx++) {
+		if (expr->coeffs[idx] != 0) {
+			terms++;
+			term = idx;
+		}
+	}
+	if (terms == 0) {
+		return expr->cst_lo != 0;
+	}
+	if (terms > 1) {
+		return true;
+	}
+	int64_t coeff = expr->coeffs[term];
+	ap_dim_t dim = expr->dims[term];
+	bound_wide_t cst = -(bound_wide_t)expr->cst_lo;
+	if (cst % coeff != 0) {
+		return true;
+	}
+	int64_t value = (int64_t)(cst / coeff);
+	int64_t lo, hi;
+	bounds(ctx, dim, &lo, &hi);
+	if ((lo == value) && (hi == value)) {
+		return false;
+	}
+	if (dim >= intdim) {
+		return true;
+	}
+	if (lo == value) {
+		return tighten(ctx, dim, value + 1, BOUND_POS_INF);
+	}
+	if (hi == value) {
+		return tighten(ctx, dim, BOUND_NEG_INF, value - 1);
+	}
+	return true;
+}
+
+bool native_propagate(native_linexpr_t * expr, ap_constyp_t constyp,
+		size_t intdim, native_dim_bounds_t bounds,
+		native_dim_tighten_t tighten, void * ctx) {
+	switch (constyp) {
+	case AP_CONS_EQ:
+		return propagate_supeq(expr, 1, 0, intdim, bounds, tighten, ctx) &&
+				propagate_supeq(expr, -1, 0, intdim, bounds, tighten, ctx);
+	case AP_CONS_SUPEQ:
+		return propagate_supeq(expr, 1, 0, intdim, bounds, tighten, ctx);
+	case AP_CONS_SUP:
+		/* An integer expression > 0 is >= 1 */
+		return propagate_supeq(expr, 1,
+				is_integral(expr, intdim) ? -1 : 0,
+				intdim, bounds, tighten, ctx);
+	case AP_CONS_DISEQ:
+		return propagate_diseq(expr, intdim, bounds, tighten, ctx);
+	default:
+		/* EQMOD */
+		return true;
+	}
+}
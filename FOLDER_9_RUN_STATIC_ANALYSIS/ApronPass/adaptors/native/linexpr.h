@@ -0,0 +1,76 @@
+#ifndef NATIVE_LINEXPR_H
+#define NATIVE_LINEXPR_H
+
+/* Tree expressions and constraints for the native domains.
+ *
+ * A tree expression is quasi-linearized: its linear part (sums, negations
+ * and products by constants) is kept as integer coefficients per
+ * dimension, and every other subtree (e.g. divisions, products of
+ * variables) is evaluated to an interval and added to the constant. The
+ * domain provides the intervals of its dimensions with a callback. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ap_dimension.h>
+#include <ap_tcons0.h>
+#include <ap_texpr0.h>
+
+#include "bound.h"
+
+/* Set *lo and *hi to the bounds of dim */
+typedef void (*native_dim_bounds_t)(void * ctx, ap_dim_t dim,
+		int64_t * lo, int64_t * hi);
+/* Intersect the bounds of dim with [lo, hi]. Returns false if the result
+ * is empty. */
+typedef bool (*native_dim_tighten_t)(void * ctx, ap_dim_t dim,
+		int64_t lo, int64_t hi);
+
+typedef struct {
+	size_t size;
+	size_t capacity;
+	ap_dim_t * dims;
+	int64_t * coeffs;
+	/* Constant part */
+	int64_t cst_lo;
+	int64_t cst_hi;
+	/* False if a subtree was evaluated, or coefficients were rounded */
+	bool is_exact;
+} native_linexpr_t;
+
+void native_linexpr_init(native_linexpr_t * expr);
+void native_linexpr_clear(native_linexpr_t * expr);
+
+/* Quasi-linearize texpr into expr. Dimensions below intdim are integers.
+ * Returns false if its value set is empty (e.g. a dimension has empty
+ * bounds). */
+bool native_linearize(ap_texpr0_t * texpr, size_t intdim,
+		native_dim_bounds_t bounds, void * ctx, native_linexpr_t * expr);
+
+/* Interval of texpr. Returns false if it is empty. */
+bool native_eval_texpr(ap_texpr0_t * texpr, native_dim_bounds_t bounds,
+		void * ctx, int64_t * lo, int64_t * hi);
+
+/* Interval of a linearized expression */
+void native_linexpr_bounds(native_linexpr_t * expr, native_dim_bounds_t bounds,
+		void * ctx, int64_t * lo, int64_t * hi);
+
+typedef enum {
+	native_sat_false,
+	native_sat_true,
+	native_sat_unknown
+} native_sat_e;
+
+/* Whether every value of the expression's interval satisfies the
+ * constraint type (expr constyp 0) */
+native_sat_e native_sat_interval(ap_constyp_t constyp, ap_scalar_t * modulo,
+		int64_t lo, int64_t hi);
+
+/* Tighten the bounds of the dimensions of expr by the constraint
+ * expr constyp 0, once. Returns false if the constraint is
+ * unsatisfiable. */
+bool native_propagate(native_linexpr_t * expr, ap_constyp_t constyp,
+		size_t intdim, native_dim_bounds_t bounds,
+		native_dim_tighten_t tighten, void * ctx);
+
+#endif /* NATIVE_LINEXPR_H */
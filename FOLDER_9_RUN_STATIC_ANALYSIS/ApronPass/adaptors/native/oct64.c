@@ -0,0 +1,1348 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ap_abstract0.h>
+#include <ap_generator0.h>
+
+#include "bound.h"
+#include "hmat.h"
+#include "linexpr.h"
+#include "oct64.h"
+
+#define OCT64_DEFAULT_MEET_ROUNDS 2
+
+typedef struct {
+	size_t intdim;
+	size_t realdim;
+	bool is_bottom;
+	/* Strongly closed. Only widened values are not. */
+	bool is_closed;
+	int64_t m[];
+} oct64_t;
+
+static unsigned meet_rounds = OCT64_DEFAULT_MEET_ROUNDS;
+
+static inline size_t oct64_dims(const oct64_t * a) {
+	return a->intdim + a->realdim;
+}
+
+/* The matrix index of s * x */
+static inline size_t oct64_index(int sign, ap_dim_t dim) {
+	return 2 * dim + (sign < 0);
+}
+
+static void set_exact(ap_manager_t * man, bool is_exact) {
+	man->result.flag_exact = is_exact;
+	man->result.flag_best = is_exact;
+}
+
+/* Memory */
+
+static oct64_t * oct64_alloc(size_t intdim, size_t realdim) {
+	size_t size = hmat_size(intdim + realdim);
+	oct64_t * a = malloc(sizeof(*a) + size * sizeof(a->m[0]));
+	a->intdim = intdim;
+	a->realdim = realdim;
+	a->is_bottom = false;
+	a->is_closed = true;
+	return a;
+}
+
+static oct64_t * oct64_copy_internal(oct64_t * a) {
+	size_t size = sizeof(*a) + hmat_size(oct64_dims(a)) * sizeof(a->m[0]);
+	oct64_t * result = malloc(size);
+	memcpy(result, a, size);
+	return result;
+}
+
+static oct64_t * oct64_top_internal(size_t intdim, size_t realdim) {
+	oct64_t * a = oct64_alloc(intdim, realdim);
+	hmat_set_top(a->m, oct64_dims(a));
+	return a;
+}
+
+static oct64_t * oct64_bottom_internal(size_t intdim, size_t realdim) {
+	oct64_t * a = oct64_top_internal(intdim, realdim);
+	a->is_bottom = true;
+	return a;
+}
+
+static void oct64_set_bottom(oct64_t * a) {
+	a->is_bottom = true;
+	a->is_closed = true;
+	hmat_set_top(a->m, oct64_dims(a));
+}
+
+static void oct64_close(oct64_t * a) {
+	if (a->is_bottom || a->is_closed) {
+		return;
+	}
+	a->is_closed = true;
+	if (!hmat_close(a->m, oct64_dims(a), a->intdim)) {
+		oct64_set_bottom(a);
+	}
+}
+
+/* a if it is closed, or else a closed copy of it, which is also set in
+ * *tmp to be freed */
+static oct64_t * oct64_closed(oct64_t * a, oct64_t ** tmp) {
+	*tmp = 0;
+	if (a->is_bottom || a->is_closed) {
+		return a;
+	}
+	*tmp = oct64_copy_internal(a);
+	oct64_close(*tmp);
+	return *tmp;
+}
+
+static oct64_t * oct64_copy(ap_manager_t * man, oct64_t * a) {
+	set_exact(man, true);
+	return oct64_copy_internal(a);
+}
+
+static void oct64_free(ap_manager_t * man, oct64_t * a) {
+	free(a);
+}
+
+static size_t oct64_size(ap_manager_t * man, oct64_t * a) {
+	return hmat_size(oct64_dims(a));
+}
+
+/* Constraints. a is closed, and is kept closed. */
+
+/* m[i][j] = min(m[i][j], c). Returns true if the bound changed. */
+static bool oct64_add_edge(oct64_t * a, size_t i, size_t j, int64_t c) {
+	if (a->is_bottom || (c >= a->m[hmat_pos2(i, j)])) {
+		return false;
+	}
+	if (!hmat_close_edge(a->m, oct64_dims(a), a->intdim, i, j, c)) {
+		oct64_set_bottom(a);
+	}
+	return true;
+}
+
+/* signs[0] * x_dims[0] + signs[1] * x_dims[1] <= c, or the first term
+ * alone if count is 1 */
+static bool oct64_add_upper(oct64_t * a, size_t count, const ap_dim_t * dims,
+		const int * signs, int64_t c) {
+	if (c == BOUND_POS_INF) {
+		return false;
+	}
+	size_t p = oct64_index(signs[0], dims[0]);
+	if (count == 1) {
+		return oct64_add_edge(a, p ^ 1, p, hmat_of_bound(2 * (bound_wide_t)c));
+	}
+	return oct64_add_edge(a, oct64_index(-signs[1], dims[1]), p,
+			hmat_of_bound(c));
+}
+
+/* Every constraint on x is removed */
+static void oct64_forget_dim(oct64_t * a, ap_dim_t dim) {
+	size_t n = 2 * oct64_dims(a);
+	for (size_t j = 0; j < n; j++) {
+		a->m[hmat_pos2(2 * dim, j)] = HMAT_INF;
+		a->m[hmat_pos2(2 * dim + 1, j)] = HMAT_INF;
+	}
+	a->m[hmat_pos(2 * dim, 2 * dim)] = 0;
+	a->m[hmat_pos(2 * dim + 1, 2 * dim + 1)] = 0;
+}
+
+static void oct64_dim_bounds(void * ctx, ap_dim_t dim, int64_t * lo,
+		int64_t * hi) {
+	oct64_t * a = ctx;
+	/* Twice the upper bounds of x and of -x */
+	int64_t up = a->m[hmat_pos(2 * dim + 1, 2 * dim)];
+	int64_t down = a->m[hmat_pos(2 * dim, 2 * dim + 1)];
+	*hi = (up == HMAT_INF) ? BOUND_POS_INF : (up + 1) >> 1;
+	*lo = (down == HMAT_INF) ? BOUND_NEG_INF : -((down + 1) >> 1);
+}
+
+/* The terms of expr, if there are at most two and their coefficients are
+ * +-1 */
+static bool oct64_terms(native_linexpr_t * expr, size_t * count,
+		ap_dim_t * dims, int * signs) {
+	*count = 0;
+	for (size_t idx = 0; idx < expr->size; idx++) {
+		int64_t coeff = expr->coeffs[idx];
+		if (coeff == 0) {
+			continue;
+		}
+		if (((coeff != 1) && (coeff != -1)) || (*count == 2)) {
+			return false;
+		}
+		dims[*count] = expr->dims[idx];
+		signs[*count] = (int)coeff;
+		(*count)++;
+	}
+	return true;
+}
+
+/* The interval of expr in a closed a. +-x +-y is bounded by the matrix,
+ * anything else by the bounds of its dimensions. */
+static void oct64_linexpr_bounds(oct64_t * a, native_linexpr_t * expr,
+		int64_t * lo, int64_t * hi) {
+	size_t count;
+	ap_dim_t dims[2];
+	int signs[2];
+	if (!oct64_terms(expr, &count, dims, signs) || (count != 2)) {
+		native_linexpr_bounds(expr, oct64_dim_bounds, a, lo, hi);
+		return;
+	}
+	size_t p = oct64_index(signs[0], dims[0]);
+	size_t q = oct64_index(-signs[1], dims[1]);
+	*hi = bound_add_hi(hmat_to_bound(a->m[hmat_pos2(q, p)]), expr->cst_hi);
+	*lo = bound_add_lo(bound_neg(hmat_to_bound(a->m[hmat_pos2(p, q)])),
+			expr->cst_lo);
+}
+
+/* The interval of texpr in a closed a. Returns false if it is empty. */
+static bool oct64_eval(oct64_t * a, ap_texpr0_t * texpr, int64_t * lo,
+		int64_t * hi) {
+	native_linexpr_t expr;
+	native_linexpr_init(&expr);
+	bool is_nonempty = native_linearize(texpr, a->intdim, oct64_dim_bounds,
+			a, &expr);
+	if (is_nonempty) {
+		oct64_linexpr_bounds(a, &expr, lo, hi);
+		is_nonempty = *lo <= *hi;
+	}
+	native_linexpr_clear(&expr);
+	return is_nonempty;
+}
+
+/* Control of internal representation */
+
+static void oct64_minimize(ap_manager_t * man, oct64_t * a) {
+	set_exact(man, true);
+	oct64_close(a);
+}
+
+static void oct64_canonicalize(ap_manager_t * man, oct64_t * a) {
+	set_exact(man, true);
+	oct64_close(a);
+}
+
+static int oct64_hash(ap_manager_t * man, oct64_t * a) {
+	uint64_t hash = 14695981039346656037ULL;
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	bool is_bottom = closed->is_bottom;
+	if (!is_bottom) {
+		for (size_t pos = 0; pos < hmat_size(oct64_dims(a)); pos++) {
+			hash = (hash ^ (uint64_t)closed->m[pos]) * 1099511628211ULL;
+		}
+	}
+	free(tmp);
+	return is_bottom ? 0 : (int)(hash ^ (hash >> 32));
+}
+
+static void oct64_approximate(ap_manager_t * man, oct64_t * a, int algorithm) {
+	set_exact(man, true);
+}
+
+/* Printing and serialization */
+
+static void fprint_var(FILE * stream, size_t index, char ** name_of_dim) {
+	if (index & 1) {
+		fprintf(stream, "-");
+	}
+	if (name_of_dim) {
+		fprintf(stream, "%s", name_of_dim[index / 2]);
+	} else {
+		fprintf(stream, "x%zu", index / 2);
+	}
+}
+
+/* V_j - V_i <= c */
+static void fprint_cons(FILE * stream, size_t i, size_t j, int64_t c,
+		char ** name_of_dim) {
+	fprint_var(stream, j, name_of_dim);
+	if (j == (i ^ 1)) {
+		/* 2 * V_j <= c */
+		fprintf(stream, " <= %" PRId64 "%s\n", (c & 1) ? c : c / 2,
+				(c & 1) ? "/2" : "");
+		return;
+	}
+	fprintf(stream, " %s ", (i & 1) ? "+" : "-");
+	fprint_var(stream, i & ~(size_t)1, name_of_dim);
+	fprintf(stream, " <= %" PRId64 "\n", c);
+}
+
+static void oct64_fprint(FILE * stream, ap_manager_t * man, oct64_t * a,
+		char ** name_of_dim) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	size_t n = 2 * oct64_dims(a);
+	bool is_top = true;
+	if (closed->is_bottom) {
+		fprintf(stream, "bottom\n");
+		free(tmp);
+		return;
+	}
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j <= (i | 1); j++) {
+			int64_t c = closed->m[hmat_pos(i, j)];
+			if ((i != j) && (c != HMAT_INF)) {
+				fprint_cons(stream, i, j, c, name_of_dim);
+				is_top = false;
+			}
+		}
+	}
+	if (is_top) {
+		fprintf(stream, "top\n");
+	}
+	free(tmp);
+}
+
+static void oct64_fprintdiff(FILE * stream, ap_manager_t * man, oct64_t * a1,
+		oct64_t * a2, char ** name_of_dim) {
+	oct64_t * tmp1;
+	oct64_t * tmp2;
+	oct64_t * closed1 = oct64_closed(a1, &tmp1);
+	oct64_t * closed2 = oct64_closed(a2, &tmp2);
+	size_t n = 2 * oct64_dims(a1);
+	if (closed1->is_bottom || closed2->is_bottom) {
+		fprintf(stream, "%s -> %s\n", closed1->is_bottom ? "bottom" : "value",
+				closed2->is_bottom ? "bottom" : "value");
+	} else {
+		for (size_t i = 0; i < n; i++) {
+			for (size_t j = 0; j <= (i | 1); j++) {
+				int64_t c = closed2->m[hmat_pos(i, j)];
+				if ((i != j) && (c != closed1->m[hmat_pos(i, j)])) {
+					fprint_cons(stream, i, j, c, name_of_dim);
+				}
+			}
+		}
+	}
+	free(tmp1);
+	free(tmp2);
+}
+
+static void oct64_fdump(FILE * stream, ap_manager_t * man, oct64_t * a) {
+	size_t n = 2 * oct64_dims(a);
+	fprintf(stream, "oct64 intdim=%zu realdim=%zu%s%s\n", a->intdim,
+			a->realdim, a->is_bottom ? " bottom" : "",
+			a->is_closed ? "" : " unclosed");
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j <= (i | 1); j++) {
+			int64_t c = a->m[hmat_pos(i, j)];
+			if (c == HMAT_INF) {
+				fprintf(stream, " +oo");
+			} else {
+				fprintf(stream, " %" PRId64, c);
+			}
+		}
+		fprintf(stream, "\n");
+	}
+}
+
+static ap_membuf_t oct64_serialize_raw(ap_manager_t * man, oct64_t * a) {
+	ap_membuf_t membuf = { 0, 0 };
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_SERIALIZE_RAW, "not implemented");
+	return membuf;
+}
+
+static oct64_t * oct64_deserialize_raw(ap_manager_t * man, void * ptr,
+		size_t * size) {
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_DESERIALIZE_RAW, "not implemented");
+	return 0;
+}
+
+/* Constructors */
+
+static oct64_t * oct64_bottom(ap_manager_t * man, size_t intdim,
+		size_t realdim) {
+	set_exact(man, true);
+	return oct64_bottom_internal(intdim, realdim);
+}
+
+static oct64_t * oct64_top(ap_manager_t * man, size_t intdim, size_t realdim) {
+	set_exact(man, true);
+	return oct64_top_internal(intdim, realdim);
+}
+
+static oct64_t * oct64_of_box(ap_manager_t * man, size_t intdim,
+		size_t realdim, ap_interval_t ** tinterval) {
+	oct64_t * a = oct64_top_internal(intdim, realdim);
+	set_exact(man, true);
+	for (size_t i = 0; i < oct64_dims(a); i++) {
+		/* Integer dimensions are rounded inwards */
+		bool is_int = i < intdim;
+		if (ap_interval_is_bottom(tinterval[i])) {
+			oct64_set_bottom(a);
+			return a;
+		}
+		int64_t lo = bound_of_scalar(tinterval[i]->inf, is_int);
+		int64_t hi = bound_of_scalar(tinterval[i]->sup, !is_int);
+		a->m[hmat_pos(2 * i + 1, 2 * i)] = hmat_of_bound(2 * (bound_wide_t)hi);
+		a->m[hmat_pos(2 * i, 2 * i + 1)] = hmat_of_bound(-2 * (bound_wide_t)lo);
+	}
+	a->is_closed = false;
+	oct64_close(a);
+	return a;
+}
+
+/* Accessors and tests */
+
+static ap_dimension_t oct64_dimension(ap_manager_t * man, oct64_t * a) {
+	ap_dimension_t dimension = { a->intdim, a->realdim };
+	return dimension;
+}
+
+static bool oct64_is_bottom(ap_manager_t * man, oct64_t * a) {
+	oct64_t * tmp;
+	bool result = oct64_closed(a, &tmp)->is_bottom;
+	set_exact(man, true);
+	free(tmp);
+	return result;
+}
+
+static bool oct64_is_top(ap_manager_t * man, oct64_t * a) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	size_t n = 2 * oct64_dims(a);
+	int64_t is_bounded = closed->is_bottom;
+	set_exact(man, true);
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j <= (i | 1); j++) {
+			is_bounded |= (i != j) & (closed->m[hmat_pos(i, j)] != HMAT_INF);
+		}
+	}
+	free(tmp);
+	return is_bounded == 0;
+}
+
+static bool oct64_is_leq(ap_manager_t * man, oct64_t * a1, oct64_t * a2) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a1, &tmp);
+	bool result;
+	set_exact(man, true);
+	if (closed->is_bottom) {
+		result = true;
+	} else if (a2->is_bottom) {
+		result = false;
+	} else {
+		/* a2 need not be closed */
+		result = hmat_is_leq(closed->m, a2->m, oct64_dims(a1));
+	}
+	free(tmp);
+	return result;
+}
+
+static bool oct64_is_eq(ap_manager_t * man, oct64_t * a1, oct64_t * a2) {
+	oct64_t * tmp1;
+	oct64_t * tmp2;
+	oct64_t * closed1 = oct64_closed(a1, &tmp1);
+	oct64_t * closed2 = oct64_closed(a2, &tmp2);
+	bool result;
+	set_exact(man, true);
+	if (closed1->is_bottom || closed2->is_bottom) {
+		result = closed1->is_bottom == closed2->is_bottom;
+	} else {
+		result = hmat_is_eq(closed1->m, closed2->m, oct64_dims(a1));
+	}
+	free(tmp1);
+	free(tmp2);
+	return result;
+}
+
+static bool oct64_is_dimension_unconstrained(ap_manager_t * man, oct64_t * a,
+		ap_dim_t dim) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	size_t n = 2 * oct64_dims(a);
+	bool result = !closed->is_bottom;
+	set_exact(man, true);
+	for (size_t j = 0; result && (j < n); j++) {
+		if ((j / 2) != dim) {
+			result = (closed->m[hmat_pos2(2 * dim, j)] == HMAT_INF) &&
+					(closed->m[hmat_pos2(2 * dim + 1, j)] == HMAT_INF);
+		}
+	}
+	result = result &&
+			(closed->m[hmat_pos(2 * dim, 2 * dim + 1)] == HMAT_INF) &&
+			(closed->m[hmat_pos(2 * dim + 1, 2 * dim)] == HMAT_INF);
+	free(tmp);
+	return result;
+}
+
+static bool oct64_sat_interval(ap_manager_t * man, oct64_t * a, ap_dim_t dim,
+		ap_interval_t * interval) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	bool result = true;
+	set_exact(man, true);
+	if (!closed->is_bottom) {
+		int64_t lo, hi;
+		oct64_dim_bounds(closed, dim, &lo, &hi);
+		result = (lo >= bound_of_scalar(interval->inf, true)) &&
+				(hi <= bound_of_scalar(interval->sup, false));
+	}
+	free(tmp);
+	return result;
+}
+
+static bool oct64_sat_tcons(ap_manager_t * man, oct64_t * a,
+		ap_tcons0_t * cons) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	int64_t lo, hi;
+	bool result = true;
+	set_exact(man, false);
+	if (!closed->is_bottom && oct64_eval(closed, cons->texpr0, &lo, &hi)) {
+		result = native_sat_interval(cons->constyp, cons->scalar, lo, hi) ==
+				native_sat_true;
+	}
+	free(tmp);
+	return result;
+}
+
+static bool oct64_sat_lincons(ap_manager_t * man, oct64_t * a,
+		ap_lincons0_t * lincons) {
+	ap_tcons0_t cons = ap_tcons0_from_lincons0(lincons);
+	bool result = oct64_sat_tcons(man, a, &cons);
+	ap_tcons0_clear(&cons);
+	return result;
+}
+
+static ap_interval_t * interval_of_bounds(int64_t lo, int64_t hi) {
+	ap_interval_t * interval = ap_interval_alloc();
+	bound_to_scalar(interval->inf, lo);
+	bound_to_scalar(interval->sup, hi);
+	return interval;
+}
+
+static ap_interval_t * oct64_bound_dimension(ap_manager_t * man, oct64_t * a,
+		ap_dim_t dim) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	ap_interval_t * interval;
+	set_exact(man, true);
+	if (closed->is_bottom) {
+		interval = ap_interval_alloc();
+		ap_interval_set_bottom(interval);
+	} else {
+		int64_t lo, hi;
+		oct64_dim_bounds(closed, dim, &lo, &hi);
+		interval = interval_of_bounds(lo, hi);
+	}
+	free(tmp);
+	return interval;
+}
+
+static ap_interval_t * oct64_bound_texpr(ap_manager_t * man, oct64_t * a,
+		ap_texpr0_t * texpr) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	ap_interval_t * interval;
+	int64_t lo, hi;
+	set_exact(man, false);
+	if (closed->is_bottom || !oct64_eval(closed, texpr, &lo, &hi)) {
+		interval = ap_interval_alloc();
+		ap_interval_set_bottom(interval);
+	} else {
+		interval = interval_of_bounds(lo, hi);
+	}
+	free(tmp);
+	return interval;
+}
+
+static ap_interval_t * oct64_bound_linexpr(ap_manager_t * man, oct64_t * a,
+		ap_linexpr0_t * linexpr) {
+	ap_texpr0_t * texpr = ap_texpr0_from_linexpr0(linexpr);
+	ap_interval_t * interval = oct64_bound_texpr(man, a, texpr);
+	ap_texpr0_free(texpr);
+	return interval;
+}
+
+static ap_interval_t ** oct64_to_box(ap_manager_t * man, oct64_t * a) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	ap_interval_t ** box = ap_interval_array_alloc(oct64_dims(a));
+	set_exact(man, true);
+	for (size_t i = 0; i < oct64_dims(a); i++) {
+		if (closed->is_bottom) {
+			ap_interval_set_bottom(box[i]);
+		} else {
+			int64_t lo, hi;
+			oct64_dim_bounds(closed, i, &lo, &hi);
+			bound_to_scalar(box[i]->inf, lo);
+			bound_to_scalar(box[i]->sup, hi);
+		}
+	}
+	free(tmp);
+	return box;
+}
+
+/* V_j - V_i <= c, as c - V_j + V_i >= 0 */
+static ap_lincons0_t make_lincons(size_t i, size_t j, int64_t c) {
+	int sign_i = (i & 1) ? -1 : 1;
+	int sign_j = (j & 1) ? -1 : 1;
+	ap_linexpr0_t * linexpr;
+	if (j == (i ^ 1)) {
+		linexpr = ap_linexpr0_alloc(AP_LINEXPR_SPARSE, 1);
+		linexpr->p.linterm[0].dim = j / 2;
+		ap_coeff_set_scalar_int(&linexpr->p.linterm[0].coeff, -2 * sign_j);
+	} else {
+		/* j / 2 < i / 2, and the terms are sorted */
+		linexpr = ap_linexpr0_alloc(AP_LINEXPR_SPARSE, 2);
+		linexpr->p.linterm[0].dim = j / 2;
+		ap_coeff_set_scalar_int(&linexpr->p.linterm[0].coeff, -sign_j);
+		linexpr->p.linterm[1].dim = i / 2;
+		ap_coeff_set_scalar_int(&linexpr->p.linterm[1].coeff, sign_i);
+	}
+	ap_coeff_set_scalar_int(&linexpr->cst, (long)c);
+	return ap_lincons0_make(AP_CONS_SUPEQ, linexpr, 0);
+}
+
+static ap_lincons0_array_t oct64_to_lincons_array(ap_manager_t * man,
+		oct64_t * a) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	size_t n = 2 * oct64_dims(a);
+	size_t count = 0;
+	set_exact(man, true);
+	if (closed->is_bottom) {
+		ap_lincons0_array_t array = ap_lincons0_array_make(1);
+		array.p[0] = ap_lincons0_make_unsat();
+		free(tmp);
+		return array;
+	}
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j <= (i | 1); j++) {
+			count += (i != j) && (closed->m[hmat_pos(i, j)] != HMAT_INF);
+		}
+	}
+	ap_lincons0_array_t array = ap_lincons0_array_make(count);
+	count = 0;
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j <= (i | 1); j++) {
+			int64_t c = closed->m[hmat_pos(i, j)];
+			if ((i != j) && (c != HMAT_INF)) {
+				array.p[count++] = make_lincons(i, j, c);
+			}
+		}
+	}
+	free(tmp);
+	return array;
+}
+
+static ap_tcons0_array_t oct64_to_tcons_array(ap_manager_t * man,
+		oct64_t * a) {
+	ap_lincons0_array_t lincons = oct64_to_lincons_array(man, a);
+	ap_tcons0_array_t array = ap_tcons0_array_make(lincons.size);
+	for (size_t i = 0; i < lincons.size; i++) {
+		array.p[i] = ap_tcons0_from_lincons0(&lincons.p[i]);
+	}
+	ap_lincons0_array_clear(&lincons);
+	return array;
+}
+
+static ap_generator0_array_t oct64_to_generator_array(ap_manager_t * man,
+		oct64_t * a) {
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_TO_GENERATOR_ARRAY, "not implemented");
+	return ap_generator0_array_make(0);
+}
+
+/* Meet and join */
+
+static oct64_t * oct64_meet(ap_manager_t * man, bool destructive, oct64_t * a1,
+		oct64_t * a2) {
+	oct64_t * result = destructive ? a1 : oct64_copy_internal(a1);
+	set_exact(man, true);
+	if ((a1 == a2) || result->is_bottom) {
+		return result;
+	}
+	if (a2->is_bottom) {
+		oct64_set_bottom(result);
+		return result;
+	}
+	/* The only full closure of the common operations */
+	hmat_meet(result->m, a2->m, oct64_dims(result));
+	result->is_closed = false;
+	oct64_close(result);
+	return result;
+}
+
+static oct64_t * oct64_meet_array(ap_manager_t * man, oct64_t ** tab,
+		size_t size) {
+	oct64_t * result = oct64_copy_internal(tab[0]);
+	for (size_t i = 1; i < size; i++) {
+		result = oct64_meet(man, true, result, tab[i]);
+	}
+	set_exact(man, true);
+	return result;
+}
+
+static oct64_t * oct64_join(ap_manager_t * man, bool destructive, oct64_t * a1,
+		oct64_t * a2) {
+	oct64_t * tmp1;
+	oct64_t * tmp2;
+	oct64_t * closed1 = oct64_closed(a1, &tmp1);
+	oct64_t * closed2 = oct64_closed(a2, &tmp2);
+	oct64_t * result;
+	set_exact(man, false);
+	if (closed1->is_bottom) {
+		result = oct64_copy_internal(closed2);
+	} else {
+		result = oct64_copy_internal(closed1);
+		if (!closed2->is_bottom) {
+			/* The join of strongly closed matrices is strongly closed */
+			hmat_join(result->m, closed2->m, oct64_dims(result));
+		}
+	}
+	free(tmp1);
+	free(tmp2);
+	if (destructive) {
+		free(a1);
+	}
+	return result;
+}
+
+static oct64_t * oct64_join_array(ap_manager_t * man, oct64_t ** tab,
+		size_t size) {
+	oct64_t * result = oct64_copy_internal(tab[0]);
+	for (size_t i = 1; i < size; i++) {
+		result = oct64_join(man, true, result, tab[i]);
+	}
+	set_exact(man, false);
+	return result;
+}
+
+typedef struct {
+	oct64_t * a;
+	bool is_changed;
+} tighten_ctx_t;
+
+static void tighten_ctx_bounds(void * ctx, ap_dim_t dim, int64_t * lo,
+		int64_t * hi) {
+	oct64_dim_bounds(((tighten_ctx_t *)ctx)->a, dim, lo, hi);
+}
+
+static bool tighten_ctx_tighten(void * ctx, ap_dim_t dim, int64_t lo,
+		int64_t hi) {
+	tighten_ctx_t * tctx = ctx;
+	int sign = 1;
+	tctx->is_changed |= oct64_add_upper(tctx->a, 1, &dim, &sign, hi);
+	sign = -1;
+	tctx->is_changed |= oct64_add_upper(tctx->a, 1, &dim, &sign,
+			bound_neg(lo));
+	return !tctx->a->is_bottom;
+}
+
+/* Meet cons into tctx->a: +-x +-y >= c as an edge, anything else by its
+ * bounds. Returns false if it is unsatisfiable. */
+static bool meet_tcons(tighten_ctx_t * tctx, ap_tcons0_t * cons) {
+	oct64_t * a = tctx->a;
+	native_linexpr_t expr;
+	size_t count;
+	ap_dim_t dims[2];
+	int signs[2];
+	int64_t lo, hi;
+	native_linexpr_init(&expr);
+	bool is_sat = native_linearize(cons->texpr0, a->intdim,
+			tighten_ctx_bounds, tctx, &expr);
+	bool is_octagonal = is_sat && oct64_terms(&expr, &count, dims, signs) &&
+			(count > 0) && ((cons->constyp == AP_CONS_EQ) ||
+			(cons->constyp == AP_CONS_SUPEQ) || (cons->constyp == AP_CONS_SUP));
+	if (is_octagonal) {
+		/* expr >= 0 is -terms <= cst_hi */
+		int negated[2] = { -signs[0], -signs[1] };
+		int64_t c = expr.cst_hi;
+		bool is_int = true;
+		for (size_t k = 0; k < count; k++) {
+			is_int = is_int && (dims[k] < a->intdim);
+		}
+		if ((cons->constyp == AP_CONS_SUP) && is_int &&
+				(c != BOUND_POS_INF)) {
+			c--;
+		}
+		tctx->is_changed |= oct64_add_upper(a, count, dims, negated, c);
+		if (cons->constyp == AP_CONS_EQ) {
+			tctx->is_changed |= oct64_add_upper(a, count, dims, signs,
+					bound_neg(expr.cst_lo));
+		}
+		is_sat = !a->is_bottom;
+	} else if (is_sat) {
+		is_sat = native_propagate(&expr, cons->constyp, a->intdim,
+				tighten_ctx_bounds, tighten_ctx_tighten, tctx);
+	}
+	if (is_sat) {
+		oct64_linexpr_bounds(a, &expr, &lo, &hi);
+		is_sat = native_sat_interval(cons->constyp, cons->scalar, lo, hi) !=
+				native_sat_false;
+	}
+	native_linexpr_clear(&expr);
+	return is_sat;
+}
+
+static oct64_t * oct64_meet_tcons_array(ap_manager_t * man, bool destructive,
+		oct64_t * a, ap_tcons0_array_t * array) {
+	oct64_t * result = destructive ? a : oct64_copy_internal(a);
+	tighten_ctx_t tctx = { result, true };
+	set_exact(man, false);
+	oct64_close(result);
+	for (unsigned round = 0; (round < meet_rounds) && tctx.is_changed &&
+			!result->is_bottom; round++) {
+		tctx.is_changed = false;
+		for (size_t i = 0; i < array->size; i++) {
+			if (!meet_tcons(&tctx, &array->p[i])) {
+				oct64_set_bottom(result);
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+static oct64_t * oct64_meet_lincons_array(ap_manager_t * man, bool destructive,
+		oct64_t * a, ap_lincons0_array_t * array) {
+	ap_tcons0_array_t tcons = ap_tcons0_array_make(array->size);
+	for (size_t i = 0; i < array->size; i++) {
+		tcons.p[i] = ap_tcons0_from_lincons0(&array->p[i]);
+	}
+	oct64_t * result = oct64_meet_tcons_array(man, destructive, a, &tcons);
+	ap_tcons0_array_clear(&tcons);
+	return result;
+}
+
+static oct64_t * oct64_add_ray_array(ap_manager_t * man, bool destructive,
+		oct64_t * a, ap_generator0_array_t * array) {
+	oct64_t * result = oct64_top_internal(a->intdim, a->realdim);
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_ADD_RAY_ARRAY, "not implemented");
+	if (destructive) {
+		free(a);
+	}
+	return result;
+}
+
+/* Change and permutation of dimensions */
+
+/* The index of a matrix row once its variable is at map[dim] */
+static inline size_t map_index(const ap_dim_t * map, size_t index) {
+	return 2 * map[index / 2] + (index & 1);
+}
+
+static oct64_t * oct64_add_dimensions_internal(oct64_t * a,
+		ap_dimchange_t * dimchange, bool project) {
+	size_t n = oct64_dims(a);
+	size_t added = dimchange->intdim + dimchange->realdim;
+	oct64_t * result = oct64_top_internal(a->intdim + dimchange->intdim,
+			a->realdim + dimchange->realdim);
+	ap_dim_t * map = malloc((n + 1) * sizeof(*map));
+	size_t k = 0;
+	if (a->is_bottom) {
+		result->is_bottom = true;
+		free(map);
+		return result;
+	}
+	/* dimchange->dim[k] is the dimension of a the new one is inserted
+	 * before */
+	for (size_t i = 0; i < n; i++) {
+		while ((k < added) && (dimchange->dim[k] <= i)) {
+			k++;
+		}
+		map[i] = i + k;
+	}
+	for (size_t i = 0; i < 2 * n; i++) {
+		for (size_t j = 0; j <= (i | 1); j++) {
+			result->m[hmat_pos(map_index(map, i), map_index(map, j))] =
+					a->m[hmat_pos(i, j)];
+		}
+	}
+	free(map);
+	/* New unconstrained dimensions keep the matrix closed */
+	result->is_closed = a->is_closed;
+	if (project) {
+		for (k = 0; k < added; k++) {
+			size_t p = 2 * (dimchange->dim[k] + k);
+			if (result->is_closed) {
+				oct64_add_edge(result, p + 1, p, 0);
+				oct64_add_edge(result, p, p + 1, 0);
+			} else {
+				result->m[hmat_pos(p + 1, p)] = 0;
+				result->m[hmat_pos(p, p + 1)] = 0;
+			}
+		}
+	}
+	return result;
+}
+
+static oct64_t * oct64_remove_dimensions_internal(oct64_t * a,
+		ap_dimchange_t * dimchange) {
+	size_t n = oct64_dims(a);
+	size_t removed = dimchange->intdim + dimchange->realdim;
+	oct64_t * result = oct64_alloc(a->intdim - dimchange->intdim,
+			a->realdim - dimchange->realdim);
+	ap_dim_t * map = malloc((n + 1) * sizeof(*map));
+	bool * is_kept = malloc((n + 1) * sizeof(*is_kept));
+	size_t k = 0;
+	for (size_t i = 0; i < n; i++) {
+		is_kept[i] = !((k < removed) && (dimchange->dim[k] == i));
+		k += !is_kept[i];
+		map[i] = i - k;
+	}
+	/* Removing variables of a closed matrix keeps it closed */
+	result->is_bottom = a->is_bottom;
+	result->is_closed = a->is_closed;
+	for (size_t i = 0; i < 2 * n; i++) {
+		if (!is_kept[i / 2]) {
+			continue;
+		}
+		for (size_t j = 0; j <= (i | 1); j++) {
+			if (is_kept[j / 2]) {
+				result->m[hmat_pos(map_index(map, i), map_index(map, j))] =
+						a->m[hmat_pos(i, j)];
+			}
+		}
+	}
+	free(map);
+	free(is_kept);
+	return result;
+}
+
+static oct64_t * oct64_add_dimensions(ap_manager_t * man, bool destructive,
+		oct64_t * a, ap_dimchange_t * dimchange, bool project) {
+	oct64_t * result = oct64_add_dimensions_internal(a, dimchange, project);
+	set_exact(man, true);
+	if (destructive) {
+		free(a);
+	}
+	return result;
+}
+
+static oct64_t * oct64_remove_dimensions(ap_manager_t * man, bool destructive,
+		oct64_t * a, ap_dimchange_t * dimchange) {
+	oct64_t * result = oct64_remove_dimensions_internal(a, dimchange);
+	set_exact(man, true);
+	if (destructive) {
+		free(a);
+	}
+	return result;
+}
+
+static oct64_t * oct64_permute_dimensions(ap_manager_t * man,
+		bool destructive, oct64_t * a, ap_dimperm_t * perm) {
+	oct64_t * result = oct64_alloc(a->intdim, a->realdim);
+	size_t n = 2 * oct64_dims(a);
+	set_exact(man, true);
+	result->is_bottom = a->is_bottom;
+	result->is_closed = a->is_closed;
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j <= (i | 1); j++) {
+			result->m[hmat_pos2(map_index(perm->dim, i),
+					map_index(perm->dim, j))] = a->m[hmat_pos(i, j)];
+		}
+	}
+	if (destructive) {
+		free(a);
+	}
+	return result;
+}
+
+/* Assignments and substitutions */
+
+/* x = s * x + [lo, hi] in a closed a, which stays closed: V_2x and
+ * V_2x+1 are swapped if s is -1, then translated */
+static void oct64_translate(oct64_t * a, ap_dim_t dim, int sign, int64_t lo,
+		int64_t hi) {
+	size_t n = 2 * oct64_dims(a);
+	size_t p = 2 * dim;
+	size_t q = 2 * dim + 1;
+	/* Upper bounds of -[lo, hi] and [lo, hi] */
+	int64_t neg_lo = bound_neg(lo);
+	if (sign < 0) {
+		for (size_t j = 0; j < n; j++) {
+			if ((j != p) && (j != q)) {
+				int64_t tmp = a->m[hmat_pos2(p, j)];
+				a->m[hmat_pos2(p, j)] = a->m[hmat_pos2(q, j)];
+				a->m[hmat_pos2(q, j)] = tmp;
+			}
+		}
+		int64_t tmp = a->m[hmat_pos(p, q)];
+		a->m[hmat_pos(p, q)] = a->m[hmat_pos(q, p)];
+		a->m[hmat_pos(q, p)] = tmp;
+	}
+	for (size_t j = 0; j < n; j++) {
+		int64_t * vp = &a->m[hmat_pos2(p, j)];
+		int64_t * vq = &a->m[hmat_pos2(q, j)];
+		if ((j == p) || (j == q)) {
+			continue;
+		}
+		/* V_j - V_2x, and V_j - V_2x+1 */
+		if (*vp != HMAT_INF) {
+			*vp = (neg_lo == BOUND_POS_INF) ? HMAT_INF :
+					hmat_of_bound((bound_wide_t)*vp + neg_lo);
+		}
+		if (*vq != HMAT_INF) {
+			*vq = (hi == BOUND_POS_INF) ? HMAT_INF :
+					hmat_of_bound((bound_wide_t)*vq + hi);
+		}
+	}
+	int64_t * up = &a->m[hmat_pos(q, p)];
+	int64_t * down = &a->m[hmat_pos(p, q)];
+	if (*up != HMAT_INF) {
+		*up = (hi == BOUND_POS_INF) ? HMAT_INF :
+				hmat_of_bound((bound_wide_t)*up + 2 * (bound_wide_t)hi);
+	}
+	if (*down != HMAT_INF) {
+		*down = (neg_lo == BOUND_POS_INF) ? HMAT_INF :
+				hmat_of_bound((bound_wide_t)*down + 2 * (bound_wide_t)neg_lo);
+	}
+}
+
+/* x = texpr in a closed a. x = +-y + c keeps the relation between x and
+ * y, x = +-x + c is a translation, and anything else is bounded. */
+static void oct64_assign(oct64_t * a, ap_dim_t dim, ap_texpr0_t * texpr) {
+	native_linexpr_t expr;
+	size_t count;
+	ap_dim_t dims[2];
+	int signs[2];
+	native_linexpr_init(&expr);
+	bool is_nonempty = native_linearize(texpr, a->intdim, oct64_dim_bounds,
+			a, &expr);
+	bool is_unary = is_nonempty && oct64_terms(&expr, &count, dims, signs) &&
+			(count == 1);
+	if (!is_nonempty) {
+		oct64_set_bottom(a);
+	} else if (is_unary && (dims[0] == dim)) {
+		oct64_translate(a, dim, signs[0], expr.cst_lo, expr.cst_hi);
+	} else if (is_unary) {
+		/* x - s y <= cst_hi, and s y - x <= -cst_lo */
+		ap_dim_t pair[2] = { dim, dims[0] };
+		int pair_signs[2] = { 1, -signs[0] };
+		oct64_forget_dim(a, dim);
+		oct64_add_upper(a, 2, pair, pair_signs, expr.cst_hi);
+		pair_signs[0] = -1;
+		pair_signs[1] = signs[0];
+		oct64_add_upper(a, 2, pair, pair_signs, bound_neg(expr.cst_lo));
+	} else {
+		int64_t lo, hi;
+		int sign = 1;
+		oct64_linexpr_bounds(a, &expr, &lo, &hi);
+		oct64_forget_dim(a, dim);
+		oct64_add_upper(a, 1, &dim, &sign, hi);
+		sign = -1;
+		oct64_add_upper(a, 1, &dim, &sign, bound_neg(lo));
+	}
+	native_linexpr_clear(&expr);
+}
+
+static oct64_t * oct64_meet_dest(ap_manager_t * man, oct64_t * result,
+		oct64_t * dest) {
+	if (dest) {
+		bool is_exact = man->result.flag_exact;
+		result = oct64_meet(man, true, result, dest);
+		set_exact(man, is_exact);
+	}
+	return result;
+}
+
+static oct64_t * oct64_assign_texpr_array(ap_manager_t * man, bool destructive,
+		oct64_t * a, ap_dim_t * tdim, ap_texpr0_t ** texpr, size_t size,
+		oct64_t * dest) {
+	oct64_t * result = destructive ? a : oct64_copy_internal(a);
+	set_exact(man, false);
+	oct64_close(result);
+	if (result->is_bottom) {
+		return result;
+	}
+	if (size == 1) {
+		oct64_assign(result, tdim[0], texpr[0]);
+		return oct64_meet_dest(man, result, dest);
+	}
+	/* In parallel: every expression is assigned to a new dimension t_i
+	 * first, then x_i = t_i */
+	size_t n = oct64_dims(result);
+	ap_dimchange_t * dimchange = ap_dimchange_alloc(0, size);
+	for (size_t i = 0; i < size; i++) {
+		dimchange->dim[i] = n;
+	}
+	oct64_t * extended = oct64_add_dimensions_internal(result, dimchange,
+			false);
+	free(result);
+	for (size_t i = 0; i < size; i++) {
+		oct64_assign(extended, n + i, texpr[i]);
+	}
+	for (size_t i = 0; i < size; i++) {
+		oct64_forget_dim(extended, tdim[i]);
+	}
+	for (size_t i = 0; i < size; i++) {
+		ap_dim_t pair[2] = { tdim[i], n + i };
+		int signs[2] = { 1, -1 };
+		oct64_add_upper(extended, 2, pair, signs, 0);
+		signs[0] = -1;
+		signs[1] = 1;
+		oct64_add_upper(extended, 2, pair, signs, 0);
+	}
+	for (size_t i = 0; i < size; i++) {
+		dimchange->dim[i] = n + i;
+	}
+	result = oct64_remove_dimensions_internal(extended, dimchange);
+	free(extended);
+	ap_dimchange_free(dimchange);
+	return oct64_meet_dest(man, result, dest);
+}
+
+static oct64_t * oct64_assign_linexpr_array(ap_manager_t * man,
+		bool destructive, oct64_t * a, ap_dim_t * tdim,
+		ap_linexpr0_t ** linexpr, size_t size, oct64_t * dest) {
+	ap_texpr0_t ** texpr = malloc(size * sizeof(*texpr));
+	for (size_t i = 0; i < size; i++) {
+		texpr[i] = ap_texpr0_from_linexpr0(linexpr[i]);
+	}
+	oct64_t * result = oct64_assign_texpr_array(man, destructive, a, tdim,
+			texpr, size, dest);
+	for (size_t i = 0; i < size; i++) {
+		ap_texpr0_free(texpr[i]);
+	}
+	free(texpr);
+	return result;
+}
+
+/* The states whose image is in a agree with a on the other dimensions */
+static oct64_t * oct64_substitute(ap_manager_t * man, bool destructive,
+		oct64_t * a, ap_dim_t * tdim, size_t size, oct64_t * dest) {
+	oct64_t * result = destructive ? a : oct64_copy_internal(a);
+	set_exact(man, false);
+	oct64_close(result);
+	if (result->is_bottom) {
+		return result;
+	}
+	for (size_t i = 0; i < size; i++) {
+		oct64_forget_dim(result, tdim[i]);
+	}
+	return oct64_meet_dest(man, result, dest);
+}
+
+static oct64_t * oct64_substitute_linexpr_array(ap_manager_t * man,
+		bool destructive, oct64_t * a, ap_dim_t * tdim,
+		ap_linexpr0_t ** linexpr, size_t size, oct64_t * dest) {
+	return oct64_substitute(man, destructive, a, tdim, size, dest);
+}
+
+static oct64_t * oct64_substitute_texpr_array(ap_manager_t * man,
+		bool destructive, oct64_t * a, ap_dim_t * tdim,
+		ap_texpr0_t ** texpr, size_t size, oct64_t * dest) {
+	return oct64_substitute(man, destructive, a, tdim, size, dest);
+}
+
+/* Projections */
+
+static oct64_t * oct64_forget_array(ap_manager_t * man, bool destructive,
+		oct64_t * a, ap_dim_t * tdim, size_t size, bool project) {
+	oct64_t * result = destructive ? a : oct64_copy_internal(a);
+	set_exact(man, true);
+	oct64_close(result);
+	if (result->is_bottom) {
+		return result;
+	}
+	for (size_t i = 0; i < size; i++) {
+		oct64_forget_dim(result, tdim[i]);
+		if (project) {
+			oct64_add_edge(result, 2 * tdim[i] + 1, 2 * tdim[i], 0);
+			oct64_add_edge(result, 2 * tdim[i], 2 * tdim[i] + 1, 0);
+		}
+	}
+	return result;
+}
+
+/* Expansion and folding of dimensions */
+
+static bool is_in(ap_dim_t dim, const ap_dim_t * tdim, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		if (tdim[i] == dim) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static oct64_t * oct64_expand(ap_manager_t * man, bool destructive,
+		oct64_t * a, ap_dim_t dim, size_t n) {
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a, &tmp);
+	/* The copies are added after the dimensions of the same type */
+	bool is_int = dim < a->intdim;
+	size_t first = is_int ? a->intdim : oct64_dims(a);
+	ap_dimchange_t * dimchange = is_int ? ap_dimchange_alloc(n, 0) :
+			ap_dimchange_alloc(0, n);
+	for (size_t i = 0; i < n; i++) {
+		dimchange->dim[i] = first;
+	}
+	oct64_t * result = oct64_add_dimensions_internal(closed, dimchange, false);
+	ap_dimchange_free(dimchange);
+	free(tmp);
+	if (destructive) {
+		free(a);
+	}
+	set_exact(man, true);
+	if (result->is_bottom) {
+		return result;
+	}
+	/* dim keeps its index, as the copies are after it */
+	size_t size = 2 * oct64_dims(result);
+	for (size_t t = first; t < first + n; t++) {
+		for (size_t j = 0; j < size; j++) {
+			size_t var = j / 2;
+			if ((var == dim) || ((var >= first) && (var < first + n))) {
+				continue;
+			}
+			result->m[hmat_pos2(2 * t, j)] = result->m[hmat_pos2(2 * dim, j)];
+			result->m[hmat_pos2(2 * t + 1, j)] =
+					result->m[hmat_pos2(2 * dim + 1, j)];
+		}
+		result->m[hmat_pos(2 * t + 1, 2 * t)] =
+				result->m[hmat_pos(2 * dim + 1, 2 * dim)];
+		result->m[hmat_pos(2 * t, 2 * t + 1)] =
+				result->m[hmat_pos(2 * dim, 2 * dim + 1)];
+	}
+	result->is_closed = false;
+	oct64_close(result);
+	return result;
+}
+
+static oct64_t * oct64_fold(ap_manager_t * man, bool destructive, oct64_t * a,
+		ap_dim_t * tdim, size_t size) {
+	oct64_t * result = destructive ? a : oct64_copy_internal(a);
+	size_t n = 2 * oct64_dims(result);
+	size_t t0 = tdim[0];
+	oct64_close(result);
+	set_exact(man, false);
+	/* Into the first dimension, then the others are removed */
+	for (size_t i = 1; (i < size) && !result->is_bottom; i++) {
+		size_t t = tdim[i];
+		for (size_t j = 0; j < n; j++) {
+			if (is_in(j / 2, tdim, size)) {
+				continue;
+			}
+			for (size_t s = 0; s < 2; s++) {
+				int64_t * v0 = &result->m[hmat_pos2(2 * t0 + s, j)];
+				int64_t v = result->m[hmat_pos2(2 * t + s, j)];
+				*v0 = (v > *v0) ? v : *v0;
+			}
+		}
+		for (size_t s = 0; s < 2; s++) {
+			int64_t * v0 = &result->m[hmat_pos(2 * t0 + s, (2 * t0 + s) ^ 1)];
+			int64_t v = result->m[hmat_pos(2 * t + s, (2 * t + s) ^ 1)];
+			*v0 = (v > *v0) ? v : *v0;
+		}
+	}
+	size_t intdim = 0;
+	for (size_t i = 1; i < size; i++) {
+		intdim += tdim[i] < result->intdim;
+	}
+	ap_dimchange_t dimchange = {
+		.dim = tdim + 1,
+		.intdim = intdim,
+		.realdim = size - 1 - intdim
+	};
+	oct64_t * folded = oct64_remove_dimensions_internal(result, &dimchange);
+	free(result);
+	folded->is_closed = folded->is_bottom;
+	oct64_close(folded);
+	return folded;
+}
+
+/* Widening and closure */
+
+static oct64_t * oct64_widening(ap_manager_t * man, oct64_t * a1,
+		oct64_t * a2) {
+	set_exact(man, false);
+	if (a1->is_bottom) {
+		return oct64_copy_internal(a2);
+	}
+	/* a1 is not closed, or the widening may not terminate */
+	oct64_t * result = oct64_copy_internal(a1);
+	oct64_t * tmp;
+	oct64_t * closed = oct64_closed(a2, &tmp);
+	if (!closed->is_bottom) {
+		hmat_widen(result->m, closed->m, oct64_dims(result));
+		result->is_closed = false;
+	}
+	free(tmp);
+	return result;
+}
+
+static oct64_t * oct64_closure(ap_manager_t * man, bool destructive,
+		oct64_t * a) {
+	oct64_t * result = destructive ? a : oct64_copy_internal(a);
+	set_exact(man, true);
+	oct64_close(result);
+	return result;
+}
+
+ap_manager_t * oct64_manager_alloc(void) {
+	ap_manager_t * man = ap_manager_alloc("oct64", "1.0", 0, 0);
+	void ** funptr;
+	char * rounds_str = getenv("OCT64_MEET_ROUNDS");
+	if (!man) {
+		return 0;
+	}
+	if (rounds_str && (atoi(rounds_str) > 0)) {
+		meet_rounds = atoi(rounds_str);
+	}
+	funptr = man->funptr;
+	funptr[AP_FUNID_COPY] = &oct64_copy;
+	funptr[AP_FUNID_FREE] = &oct64_free;
+	funptr[AP_FUNID_ASIZE] = &oct64_size;
+	funptr[AP_FUNID_MINIMIZE] = &oct64_minimize;
+	funptr[AP_FUNID_CANONICALIZE] = &oct64_canonicalize;
+	funptr[AP_FUNID_HASH] = &oct64_hash;
+	funptr[AP_FUNID_APPROXIMATE] = &oct64_approximate;
+	funptr[AP_FUNID_FPRINT] = &oct64_fprint;
+	funptr[AP_FUNID_FPRINTDIFF] = &oct64_fprintdiff;
+	funptr[AP_FUNID_FDUMP] = &oct64_fdump;
+	funptr[AP_FUNID_SERIALIZE_RAW] = &oct64_serialize_raw;
+	funptr[AP_FUNID_DESERIALIZE_RAW] = &oct64_deserialize_raw;
+	funptr[AP_FUNID_BOTTOM] = &oct64_bottom;
+	funptr[AP_FUNID_TOP] = &oct64_top;
+	funptr[AP_FUNID_OF_BOX] = &oct64_of_box;
+	funptr[AP_FUNID_DIMENSION] = &oct64_dimension;
+	funptr[AP_FUNID_IS_BOTTOM] = &oct64_is_bottom;
+	funptr[AP_FUNID_IS_TOP] = &oct64_is_top;
+	funptr[AP_FUNID_IS_LEQ] = &oct64_is_leq;
+	funptr[AP_FUNID_IS_EQ] = &oct64_is_eq;
+	funptr[AP_FUNID_IS_DIMENSION_UNCONSTRAINED] =
+			&oct64_is_dimension_unconstrained;
+	funptr[AP_FUNID_SAT_INTERVAL] = &oct64_sat_interval;
+	funptr[AP_FUNID_SAT_LINCONS] = &oct64_sat_lincons;
+	funptr[AP_FUNID_SAT_TCONS] = &oct64_sat_tcons;
+	funptr[AP_FUNID_BOUND_DIMENSION] = &oct64_bound_dimension;
+	funptr[AP_FUNID_BOUND_LINEXPR] = &oct64_bound_linexpr;
+	funptr[AP_FUNID_BOUND_TEXPR] = &oct64_bound_texpr;
+	funptr[AP_FUNID_TO_BOX] = &oct64_to_box;
+	funptr[AP_FUNID_TO_LINCONS_ARRAY] = &oct64_to_lincons_array;
+	funptr[AP_FUNID_TO_TCONS_ARRAY] = &oct64_to_tcons_array;
+	funptr[AP_FUNID_TO_GENERATOR_ARRAY] = &oct64_to_generator_array;
+	funptr[AP_FUNID_MEET] = &oct64_meet;
+	funptr[AP_FUNID_MEET_ARRAY] = &oct64_meet_array;
+	funptr[AP_FUNID_MEET_LINCONS_ARRAY] = &oct64_meet_lincons_array;
+	funptr[AP_FUNID_MEET_TCONS_ARRAY] = &oct64_meet_tcons_array;
+	funptr[AP_FUNID_JOIN] = &oct64_join;
+	funptr[AP_FUNID_JOIN_ARRAY] = &oct64_join_array;
+	funptr[AP_FUNID_ADD_RAY_ARRAY] = &oct64_add_ray_array;
+	funptr[AP_FUNID_ASSIGN_LINEXPR_ARRAY] = &oct64_assign_linexpr_array;
+	funptr[AP_FUNID_SUBSTITUTE_LINEXPR_ARRAY] =
+			&oct64_substitute_linexpr_array;
+	funptr[AP_FUNID_ASSIGN_TEXPR_ARRAY] = &oct64_assign_texpr_array;
+	funptr[AP_FUNID_SUBSTITUTE_TEXPR_ARRAY] = &oct64_substitute_texpr_array;
+	funptr[AP_FUNID_ADD_DIMENSIONS] = &oct64_add_dimensions;
+	funptr[AP_FUNID_REMOVE_DIMENSIONS] = &oct64_remove_dimensions;
+	funptr[AP_FUNID_PERMUTE_DIMENSIONS] = &oct64_permute_dimensions;
+	funptr[AP_FUNID_FORGET_ARRAY] = &oct64_forget_array;
+	funptr[AP_FUNID_EXPAND] = &oct64_expand;
+	funptr[AP_FUNID_FOLD] = &oct64_fold;
+	funptr[AP_FUNID_WIDENING] = &oct64_widening;
+	funptr[AP_FUNID_CLOSURE] = &oct64_closure;
+	for (int exception = 0; exception < AP_EXC_SIZE; exception++) {
+		ap_manager_set_abort_if_exception(man, exception, false);
+	}
+	return man;
+}
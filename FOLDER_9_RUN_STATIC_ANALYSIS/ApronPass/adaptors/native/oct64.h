@@ -0,0 +1,26 @@
+#ifndef NATIVE_OCT64_H
+#define NATIVE_OCT64_H
+
+/* Native octagon domain. An apron manager whose abstract values are int64
+ * half-matrix DBMs (see hmat.h).
+ *
+ * Values are kept strongly closed: a meet with a constraint over at most
+ * two variables (+-x +-y <= c), and an assignment of such an expression to
+ * a single variable, are closed incrementally in O(n^2). Other
+ * constraints are propagated to the variables' bounds, as by the interval
+ * domain, and each new bound is closed incrementally. Only a meet of two
+ * octagons and the rare expand and fold need the O(n^3) closure. Widened
+ * values are left as they are, and closed by the next operation. */
+#include <ap_manager.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ap_manager_t * oct64_manager_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NATIVE_OCT64_H */
@@ -0,0 +1,1782 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ap_abstract0.h>
+#include <ap_generator0.h>
+
+#include "bound.h"
+#include "linexpr.h"
+#include "zone64.h"
+
+#define ZONE64_DEFAULT_MEET_ROUNDS 2
+
+/* dst - src <= w, with a finite w */
+typedef struct {
+	uint32_t src;
+	uint32_t dst;
+	int64_t w;
+} zone64_edge_t;
+
+typedef struct {
+	size_t size;
+	size_t capacity;
+	zone64_edge_t * edges;
+} edge_batch_t;
+
+typedef struct {
+	size_t intdim;
+	size_t realdim;
+	bool is_bottom;
+	/* Closed. Only widened values are not. */
+	bool is_closed;
+	/* Sorted by source, then destination. An edge may be no tighter than
+	 * the bounds imply, once they are tightened. */
+	size_t size;
+	zone64_edge_t * edges;
+	/* The lower bounds of the dimensions, then the upper bounds */
+	int64_t bounds[];
+} zone64_t;
+
+static unsigned meet_rounds = ZONE64_DEFAULT_MEET_ROUNDS;
+
+static inline size_t zone64_dims(const zone64_t * a) {
+	return a->intdim + a->realdim;
+}
+
+static inline int64_t * zone64_lo(zone64_t * a) {
+	return a->bounds;
+}
+
+static inline int64_t * zone64_hi(zone64_t * a) {
+	return a->bounds + zone64_dims(a);
+}
+
+static void set_exact(ap_manager_t * man, bool is_exact) {
+	man->result.flag_exact = is_exact;
+	man->result.flag_best = is_exact;
+}
+
+/* Edges */
+
+static inline uint64_t edge_key(uint32_t src, uint32_t dst) {
+	return ((uint64_t)src << 32) | dst;
+}
+
+static int edge_compare(const void * p1, const void * p2) {
+	const zone64_edge_t * e1 = p1;
+	const zone64_edge_t * e2 = p2;
+	uint64_t key1 = edge_key(e1->src, e1->dst);
+	uint64_t key2 = edge_key(e2->src, e2->dst);
+	return (key1 > key2) - (key1 < key2);
+}
+
+/* The index of the first edge from src to dst or after it */
+static size_t edge_lower_bound(const zone64_t * a, uint32_t src, uint32_t dst) {
+	uint64_t key = edge_key(src, dst);
+	size_t lo = 0;
+	size_t hi = a->size;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (edge_key(a->edges[mid].src, a->edges[mid].dst) < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static bool edge_find(const zone64_t * a, uint32_t src, uint32_t dst,
+		int64_t * w) {
+	size_t idx = edge_lower_bound(a, src, dst);
+	if ((idx < a->size) && (a->edges[idx].src == src) &&
+			(a->edges[idx].dst == dst)) {
+		*w = a->edges[idx].w;
+		return true;
+	}
+	return false;
+}
+
+static void batch_push(edge_batch_t * batch, uint32_t src, uint32_t dst,
+		int64_t w) {
+	if (batch->size == batch->capacity) {
+		batch->capacity = batch->capacity ? 2 * batch->capacity : 16;
+		batch->edges = realloc(batch->edges,
+				batch->capacity * sizeof(*batch->edges));
+	}
+	batch->edges[batch->size].src = src;
+	batch->edges[batch->size].dst = dst;
+	batch->edges[batch->size].w = w;
+	batch->size++;
+}
+
+/* Sort the batch, keeping the tightest of equal edges */
+static void batch_sort(edge_batch_t * batch) {
+	size_t k = 0;
+	if (batch->size == 0) {
+		return;
+	}
+	qsort(batch->edges, batch->size, sizeof(*batch->edges), edge_compare);
+	for (size_t idx = 1; idx < batch->size; idx++) {
+		zone64_edge_t * last = &batch->edges[k];
+		zone64_edge_t * e = &batch->edges[idx];
+		if ((e->src == last->src) && (e->dst == last->dst)) {
+			last->w = (e->w < last->w) ? e->w : last->w;
+		} else {
+			batch->edges[++k] = *e;
+		}
+	}
+	batch->size = k + 1;
+}
+
+/* Merge the sorted batch into the edges of a. Its weights replace those of
+ * the same edges. */
+static void zone64_merge_edges(zone64_t * a, edge_batch_t * batch) {
+	if (batch->size == 0) {
+		return;
+	}
+	zone64_edge_t * merged = malloc((a->size + batch->size) *
+			sizeof(*merged));
+	size_t i = 0;
+	size_t j = 0;
+	size_t k = 0;
+	while ((i < a->size) || (j < batch->size)) {
+		int compare = (i == a->size) ? 1 : (j == batch->size) ? -1 :
+				edge_compare(&a->edges[i], &batch->edges[j]);
+		if (compare < 0) {
+			merged[k++] = a->edges[i++];
+			continue;
+		}
+		if (compare == 0) {
+			i++;
+		}
+		merged[k++] = batch->edges[j++];
+	}
+	free(a->edges);
+	a->edges = merged;
+	a->size = k;
+}
+
+/* Kernels over the bounds, as in itv64. Branch-free, so that they are
+ * vectorized. */
+
+static void kernel_fill(int64_t * restrict lo, int64_t * restrict hi,
+		int64_t lo_value, int64_t hi_value, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		lo[i] = lo_value;
+		hi[i] = hi_value;
+	}
+}
+
+static void kernel_join(int64_t * restrict lo, int64_t * restrict hi,
+		const int64_t * restrict lo2, const int64_t * restrict hi2, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		lo[i] = (lo2[i] < lo[i]) ? lo2[i] : lo[i];
+		hi[i] = (hi2[i] > hi[i]) ? hi2[i] : hi[i];
+	}
+}
+
+static bool kernel_is_leq(const int64_t * restrict lo1, const int64_t * restrict hi1,
+		const int64_t * restrict lo2, const int64_t * restrict hi2, size_t n) {
+	int64_t is_outside = 0;
+	for (size_t i = 0; i < n; i++) {
+		is_outside |= (lo1[i] < lo2[i]) | (hi1[i] > hi2[i]);
+	}
+	return is_outside == 0;
+}
+
+static void kernel_widen(int64_t * restrict lo, int64_t * restrict hi,
+		const int64_t * restrict lo2, const int64_t * restrict hi2, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		lo[i] = (lo2[i] < lo[i]) ? BOUND_NEG_INF : lo[i];
+		hi[i] = (hi2[i] > hi[i]) ? BOUND_POS_INF : hi[i];
+	}
+}
+
+/* Memory */
+
+static zone64_t * zone64_alloc(size_t intdim, size_t realdim) {
+	size_t n = intdim + realdim;
+	zone64_t * a = malloc(sizeof(*a) + 2 * n * sizeof(a->bounds[0]));
+	a->intdim = intdim;
+	a->realdim = realdim;
+	a->is_bottom = false;
+	a->is_closed = true;
+	a->size = 0;
+	a->edges = 0;
+	return a;
+}
+
+static void zone64_free_internal(zone64_t * a) {
+	free(a->edges);
+	free(a);
+}
+
+static zone64_t * zone64_copy_internal(zone64_t * a) {
+	size_t size = sizeof(*a) + 2 * zone64_dims(a) * sizeof(a->bounds[0]);
+	zone64_t * result = malloc(size);
+	memcpy(result, a, size);
+	result->edges = 0;
+	if (a->size) {
+		result->edges = malloc(a->size * sizeof(*a->edges));
+		memcpy(result->edges, a->edges, a->size * sizeof(*a->edges));
+	}
+	return result;
+}
+
+static zone64_t * zone64_top_internal(size_t intdim, size_t realdim) {
+	zone64_t * a = zone64_alloc(intdim, realdim);
+	kernel_fill(zone64_lo(a), zone64_hi(a), BOUND_NEG_INF, BOUND_POS_INF,
+			zone64_dims(a));
+	return a;
+}
+
+static zone64_t * zone64_bottom_internal(size_t intdim, size_t realdim) {
+	zone64_t * a = zone64_top_internal(intdim, realdim);
+	a->is_bottom = true;
+	return a;
+}
+
+static void zone64_set_bottom(zone64_t * a) {
+	a->is_bottom = true;
+	a->is_closed = true;
+	free(a->edges);
+	a->edges = 0;
+	a->size = 0;
+	kernel_fill(zone64_lo(a), zone64_hi(a), BOUND_NEG_INF, BOUND_POS_INF,
+			zone64_dims(a));
+}
+
+/* Closure. a is closed if every path of edges from x to y is implied by
+ * the edge from x to y, or by the bounds of x and y; and the bounds of the
+ * ends of every edge imply each other through it. */
+
+/* The upper bound of dst - src: its edge, or the bounds */
+static int64_t zone64_dist(zone64_t * a, ap_dim_t src, ap_dim_t dst) {
+	int64_t w;
+	if (src == dst) {
+		return 0;
+	}
+	int64_t implied = bound_add_hi(zone64_hi(a)[dst],
+			bound_neg(zone64_lo(a)[src]));
+	if (edge_find(a, src, dst, &w) && (w < implied)) {
+		return w;
+	}
+	return implied;
+}
+
+/* The upper bound of dim is c, and of its successors through their
+ * edges. Returns true if the bound changed. */
+static bool zone64_add_hi(zone64_t * a, ap_dim_t dim, int64_t c) {
+	int64_t * lo = zone64_lo(a);
+	int64_t * hi = zone64_hi(a);
+	if (a->is_bottom || (c >= hi[dim])) {
+		return false;
+	}
+	hi[dim] = c;
+	if (c < lo[dim]) {
+		zone64_set_bottom(a);
+		return true;
+	}
+	size_t end = edge_lower_bound(a, dim + 1, 0);
+	for (size_t idx = edge_lower_bound(a, dim, 0); idx < end; idx++) {
+		zone64_edge_t * e = &a->edges[idx];
+		int64_t bound = bound_add_hi(c, e->w);
+		if (bound < hi[e->dst]) {
+			hi[e->dst] = bound;
+			if (bound < lo[e->dst]) {
+				zone64_set_bottom(a);
+				return true;
+			}
+		}
+	}
+	return true;
+}
+
+/* The lower bound of dim is c, and of its predecessors through their
+ * edges */
+static bool zone64_add_lo(zone64_t * a, ap_dim_t dim, int64_t c) {
+	int64_t * lo = zone64_lo(a);
+	int64_t * hi = zone64_hi(a);
+	if (a->is_bottom || (c <= lo[dim])) {
+		return false;
+	}
+	lo[dim] = c;
+	if (c > hi[dim]) {
+		zone64_set_bottom(a);
+		return true;
+	}
+	for (size_t idx = 0; idx < a->size; idx++) {
+		zone64_edge_t * e = &a->edges[idx];
+		if (e->dst != dim) {
+			continue;
+		}
+		int64_t bound = bound_lo((bound_wide_t)c - e->w);
+		if (bound > lo[e->src]) {
+			lo[e->src] = bound;
+			if (bound > hi[e->src]) {
+				zone64_set_bottom(a);
+				return true;
+			}
+		}
+	}
+	return true;
+}
+
+/* dst - src <= w, closed over the predecessors of src and the successors
+ * of dst only. Returns true if the bound changed. */
+static bool zone64_add_edge(zone64_t * a, ap_dim_t src, ap_dim_t dst,
+		int64_t w) {
+	int64_t * lo = zone64_lo(a);
+	int64_t * hi = zone64_hi(a);
+	if (a->is_bottom || (w == BOUND_POS_INF)) {
+		return false;
+	}
+	w = (w < BOUND_MIN) ? BOUND_MIN : w;
+	if (src == dst) {
+		if (w < 0) {
+			zone64_set_bottom(a);
+		}
+		return w < 0;
+	}
+	if (w >= zone64_dist(a, src, dst)) {
+		return false;
+	}
+	if (bound_add_hi(zone64_dist(a, dst, src), w) < 0) {
+		zone64_set_bottom(a);
+		return true;
+	}
+	/* The predecessors of src with it, and the successors of dst with it.
+	 * The paths through a bound are implied by the new bounds. */
+	edge_batch_t preds = { 0, 0, 0 };
+	edge_batch_t succs = { 0, 0, 0 };
+	batch_push(&preds, src, src, 0);
+	for (size_t idx = 0; idx < a->size; idx++) {
+		if (a->edges[idx].dst == src) {
+			batch_push(&preds, a->edges[idx].src, src, a->edges[idx].w);
+		}
+	}
+	batch_push(&succs, dst, dst, 0);
+	size_t end = edge_lower_bound(a, dst + 1, 0);
+	for (size_t idx = edge_lower_bound(a, dst, 0); idx < end; idx++) {
+		batch_push(&succs, dst, a->edges[idx].dst, a->edges[idx].w);
+	}
+	int64_t src_hi = hi[src];
+	int64_t dst_lo = lo[dst];
+	bool is_empty = false;
+	for (size_t k = 0; k < succs.size; k++) {
+		zone64_edge_t * e = &succs.edges[k];
+		if (src_hi != BOUND_POS_INF) {
+			int64_t bound = bound_hi((bound_wide_t)src_hi + w + e->w);
+			hi[e->dst] = (bound < hi[e->dst]) ? bound : hi[e->dst];
+		}
+		is_empty |= lo[e->dst] > hi[e->dst];
+	}
+	for (size_t k = 0; k < preds.size; k++) {
+		zone64_edge_t * e = &preds.edges[k];
+		if (dst_lo != BOUND_NEG_INF) {
+			int64_t bound = bound_lo((bound_wide_t)dst_lo - w - e->w);
+			lo[e->src] = (bound > lo[e->src]) ? bound : lo[e->src];
+		}
+		is_empty |= lo[e->src] > hi[e->src];
+	}
+	if (is_empty) {
+		free(preds.edges);
+		free(succs.edges);
+		zone64_set_bottom(a);
+		return true;
+	}
+	edge_batch_t batch = { 0, 0, 0 };
+	for (size_t i = 0; i < preds.size; i++) {
+		for (size_t j = 0; j < succs.size; j++) {
+			uint32_t from = preds.edges[i].src;
+			uint32_t to = succs.edges[j].dst;
+			if (from == to) {
+				continue;
+			}
+			int64_t c = bound_hi((bound_wide_t)preds.edges[i].w + w +
+					succs.edges[j].w);
+			if (c < zone64_dist(a, from, to)) {
+				batch_push(&batch, from, to, c);
+			}
+		}
+	}
+	batch_sort(&batch);
+	zone64_merge_edges(a, &batch);
+	free(batch.edges);
+	free(preds.edges);
+	free(succs.edges);
+	return true;
+}
+
+static void zone64_close(zone64_t * a) {
+	if (a->is_bottom || a->is_closed) {
+		return;
+	}
+	/* The bounds alone are closed, then the edges are added one by one */
+	zone64_edge_t * edges = a->edges;
+	size_t size = a->size;
+	a->edges = 0;
+	a->size = 0;
+	a->is_closed = true;
+	for (size_t i = 0; (i < zone64_dims(a)) && !a->is_bottom; i++) {
+		if (zone64_lo(a)[i] > zone64_hi(a)[i]) {
+			zone64_set_bottom(a);
+		}
+	}
+	for (size_t idx = 0; (idx < size) && !a->is_bottom; idx++) {
+		zone64_add_edge(a, edges[idx].src, edges[idx].dst, edges[idx].w);
+	}
+	free(edges);
+}
+
+/* a if it is closed, or else a closed copy of it, which is also set in
+ * *tmp to be freed */
+static zone64_t * zone64_closed(zone64_t * a, zone64_t ** tmp) {
+	*tmp = 0;
+	if (a->is_bottom || a->is_closed) {
+		return a;
+	}
+	*tmp = zone64_copy_internal(a);
+	zone64_close(*tmp);
+	return *tmp;
+}
+
+static void zone64_free_tmp(zone64_t * tmp) {
+	if (tmp) {
+		zone64_free_internal(tmp);
+	}
+}
+
+/* Whether the edge is tighter than the bounds of its ends imply */
+static bool zone64_is_edge_needed(zone64_t * a, zone64_edge_t * e) {
+	return e->w < bound_add_hi(zone64_hi(a)[e->dst],
+			bound_neg(zone64_lo(a)[e->src]));
+}
+
+/* Every constraint on dim is removed */
+static void zone64_forget_dim(zone64_t * a, ap_dim_t dim) {
+	size_t k = 0;
+	for (size_t idx = 0; idx < a->size; idx++) {
+		if ((a->edges[idx].src != dim) && (a->edges[idx].dst != dim)) {
+			a->edges[k++] = a->edges[idx];
+		}
+	}
+	a->size = k;
+	zone64_lo(a)[dim] = BOUND_NEG_INF;
+	zone64_hi(a)[dim] = BOUND_POS_INF;
+}
+
+static zone64_t * zone64_copy(ap_manager_t * man, zone64_t * a) {
+	set_exact(man, true);
+	return zone64_copy_internal(a);
+}
+
+static void zone64_free(ap_manager_t * man, zone64_t * a) {
+	zone64_free_internal(a);
+}
+
+static size_t zone64_size(ap_manager_t * man, zone64_t * a) {
+	return 2 * zone64_dims(a) + a->size;
+}
+
+/* Expressions */
+
+static void zone64_dim_bounds(void * ctx, ap_dim_t dim, int64_t * lo,
+		int64_t * hi) {
+	zone64_t * a = ctx;
+	*lo = zone64_lo(a)[dim];
+	*hi = zone64_hi(a)[dim];
+}
+
+/* Whether expr is x_p - x_q + cst */
+static bool zone64_difference(native_linexpr_t * expr, ap_dim_t * p,
+		ap_dim_t * q) {
+	bool has_p = false;
+	bool has_q = false;
+	for (size_t idx = 0; idx < expr->size; idx++) {
+		int64_t coeff = expr->coeffs[idx];
+		if (coeff == 0) {
+			continue;
+		}
+		if ((coeff == 1) && !has_p) {
+			*p = expr->dims[idx];
+			has_p = true;
+		} else if ((coeff == -1) && !has_q) {
+			*q = expr->dims[idx];
+			has_q = true;
+		} else {
+			return false;
+		}
+	}
+	return has_p && has_q;
+}
+
+/* Whether expr is x + cst */
+static bool zone64_translation(native_linexpr_t * expr, ap_dim_t * dim) {
+	bool has_dim = false;
+	for (size_t idx = 0; idx < expr->size; idx++) {
+		int64_t coeff = expr->coeffs[idx];
+		if (coeff == 0) {
+			continue;
+		}
+		if ((coeff != 1) || has_dim) {
+			return false;
+		}
+		*dim = expr->dims[idx];
+		has_dim = true;
+	}
+	return has_dim;
+}
+
+/* The interval of expr in a closed a. x - y is bounded by its edge. */
+static void zone64_linexpr_bounds(zone64_t * a, native_linexpr_t * expr,
+		int64_t * lo, int64_t * hi) {
+	ap_dim_t p, q;
+	if (!zone64_difference(expr, &p, &q)) {
+		native_linexpr_bounds(expr, zone64_dim_bounds, a, lo, hi);
+		return;
+	}
+	*hi = bound_add_hi(zone64_dist(a, q, p), expr->cst_hi);
+	*lo = bound_add_lo(bound_neg(zone64_dist(a, p, q)), expr->cst_lo);
+}
+
+/* The interval of texpr in a closed a. Returns false if it is empty. */
+static bool zone64_eval(zone64_t * a, ap_texpr0_t * texpr, int64_t * lo,
+		int64_t * hi) {
+	native_linexpr_t expr;
+	native_linexpr_init(&expr);
+	bool is_nonempty = native_linearize(texpr, a->intdim, zone64_dim_bounds,
+			a, &expr);
+	if (is_nonempty) {
+		zone64_linexpr_bounds(a, &expr, lo, hi);
+		is_nonempty = *lo <= *hi;
+	}
+	native_linexpr_clear(&expr);
+	return is_nonempty;
+}
+
+/* Control of internal representation */
+
+static void zone64_minimize(ap_manager_t * man, zone64_t * a) {
+	set_exact(man, true);
+	zone64_close(a);
+}
+
+static void zone64_canonicalize(ap_manager_t * man, zone64_t * a) {
+	set_exact(man, true);
+	zone64_close(a);
+}
+
+static int zone64_hash(ap_manager_t * man, zone64_t * a) {
+	uint64_t hash = 14695981039346656037ULL;
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	bool is_bottom = closed->is_bottom;
+	if (!is_bottom) {
+		for (size_t i = 0; i < 2 * zone64_dims(a); i++) {
+			hash = (hash ^ (uint64_t)closed->bounds[i]) * 1099511628211ULL;
+		}
+		for (size_t idx = 0; idx < closed->size; idx++) {
+			zone64_edge_t * e = &closed->edges[idx];
+			if (zone64_is_edge_needed(closed, e)) {
+				hash = (hash ^ edge_key(e->src, e->dst)) * 1099511628211ULL;
+				hash = (hash ^ (uint64_t)e->w) * 1099511628211ULL;
+			}
+		}
+	}
+	zone64_free_tmp(tmp);
+	return is_bottom ? 0 : (int)(hash ^ (hash >> 32));
+}
+
+static void zone64_approximate(ap_manager_t * man, zone64_t * a,
+		int algorithm) {
+	set_exact(man, true);
+}
+
+/* Printing and serialization */
+
+static void fprint_bound(FILE * stream, int64_t b) {
+	if (b == BOUND_NEG_INF) {
+		fprintf(stream, "-oo");
+	} else if (b == BOUND_POS_INF) {
+		fprintf(stream, "+oo");
+	} else {
+		fprintf(stream, "%" PRId64, b);
+	}
+}
+
+static void fprint_name(FILE * stream, size_t dim, char ** name_of_dim) {
+	if (name_of_dim) {
+		fprintf(stream, "%s", name_of_dim[dim]);
+	} else {
+		fprintf(stream, "x%zu", dim);
+	}
+}
+
+static void fprint_dim(FILE * stream, zone64_t * a, size_t dim,
+		char ** name_of_dim) {
+	fprint_name(stream, dim, name_of_dim);
+	fprintf(stream, " in [");
+	fprint_bound(stream, zone64_lo(a)[dim]);
+	fprintf(stream, ", ");
+	fprint_bound(stream, zone64_hi(a)[dim]);
+	fprintf(stream, "]\n");
+}
+
+static void fprint_edge(FILE * stream, zone64_edge_t * e,
+		char ** name_of_dim) {
+	fprint_name(stream, e->dst, name_of_dim);
+	fprintf(stream, " - ");
+	fprint_name(stream, e->src, name_of_dim);
+	fprintf(stream, " <= %" PRId64 "\n", e->w);
+}
+
+static void zone64_fprint(FILE * stream, ap_manager_t * man, zone64_t * a,
+		char ** name_of_dim) {
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	bool is_top = true;
+	if (closed->is_bottom) {
+		fprintf(stream, "bottom\n");
+		zone64_free_tmp(tmp);
+		return;
+	}
+	for (size_t i = 0; i < zone64_dims(a); i++) {
+		if ((zone64_lo(closed)[i] != BOUND_NEG_INF) ||
+				(zone64_hi(closed)[i] != BOUND_POS_INF)) {
+			fprint_dim(stream, closed, i, name_of_dim);
+			is_top = false;
+		}
+	}
+	for (size_t idx = 0; idx < closed->size; idx++) {
+		if (zone64_is_edge_needed(closed, &closed->edges[idx])) {
+			fprint_edge(stream, &closed->edges[idx], name_of_dim);
+			is_top = false;
+		}
+	}
+	if (is_top) {
+		fprintf(stream, "top\n");
+	}
+	zone64_free_tmp(tmp);
+}
+
+static void zone64_fprintdiff(FILE * stream, ap_manager_t * man, zone64_t * a1,
+		zone64_t * a2, char ** name_of_dim) {
+	zone64_t * tmp1;
+	zone64_t * tmp2;
+	zone64_t * closed1 = zone64_closed(a1, &tmp1);
+	zone64_t * closed2 = zone64_closed(a2, &tmp2);
+	if (closed1->is_bottom || closed2->is_bottom) {
+		fprintf(stream, "%s -> %s\n", closed1->is_bottom ? "bottom" : "value",
+				closed2->is_bottom ? "bottom" : "value");
+	} else {
+		for (size_t i = 0; i < zone64_dims(a1); i++) {
+			if ((zone64_lo(closed1)[i] != zone64_lo(closed2)[i]) ||
+					(zone64_hi(closed1)[i] != zone64_hi(closed2)[i])) {
+				fprint_dim(stream, closed2, i, name_of_dim);
+			}
+		}
+		for (size_t idx = 0; idx < closed2->size; idx++) {
+			zone64_edge_t * e = &closed2->edges[idx];
+			if (zone64_is_edge_needed(closed2, e) &&
+					(zone64_dist(closed1, e->src, e->dst) != e->w)) {
+				fprint_edge(stream, e, name_of_dim);
+			}
+		}
+	}
+	zone64_free_tmp(tmp1);
+	zone64_free_tmp(tmp2);
+}
+
+static void zone64_fdump(FILE * stream, ap_manager_t * man, zone64_t * a) {
+	fprintf(stream, "zone64 intdim=%zu realdim=%zu edges=%zu%s%s\n",
+			a->intdim, a->realdim, a->size, a->is_bottom ? " bottom" : "",
+			a->is_closed ? "" : " unclosed");
+	for (size_t i = 0; i < zone64_dims(a); i++) {
+		fprint_dim(stream, a, i, 0);
+	}
+	for (size_t idx = 0; idx < a->size; idx++) {
+		fprint_edge(stream, &a->edges[idx], 0);
+	}
+}
+
+static ap_membuf_t zone64_serialize_raw(ap_manager_t * man, zone64_t * a) {
+	ap_membuf_t membuf = { 0, 0 };
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_SERIALIZE_RAW, "not implemented");
+	return membuf;
+}
+
+static zone64_t * zone64_deserialize_raw(ap_manager_t * man, void * ptr,
+		size_t * size) {
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_DESERIALIZE_RAW, "not implemented");
+	return 0;
+}
+
+/* Constructors */
+
+static zone64_t * zone64_bottom(ap_manager_t * man, size_t intdim,
+		size_t realdim) {
+	set_exact(man, true);
+	return zone64_bottom_internal(intdim, realdim);
+}
+
+static zone64_t * zone64_top(ap_manager_t * man, size_t intdim,
+		size_t realdim) {
+	set_exact(man, true);
+	return zone64_top_internal(intdim, realdim);
+}
+
+static zone64_t * zone64_of_box(ap_manager_t * man, size_t intdim,
+		size_t realdim, ap_interval_t ** tinterval) {
+	zone64_t * a = zone64_alloc(intdim, realdim);
+	int64_t * lo = zone64_lo(a);
+	int64_t * hi = zone64_hi(a);
+	set_exact(man, true);
+	for (size_t i = 0; i < zone64_dims(a); i++) {
+		/* Integer dimensions are rounded inwards */
+		bool is_int = i < intdim;
+		if (ap_interval_is_bottom(tinterval[i])) {
+			zone64_set_bottom(a);
+			return a;
+		}
+		lo[i] = bound_of_scalar(tinterval[i]->inf, is_int);
+		hi[i] = bound_of_scalar(tinterval[i]->sup, !is_int);
+		if (lo[i] > hi[i]) {
+			zone64_set_bottom(a);
+			return a;
+		}
+	}
+	return a;
+}
+
+/* Accessors and tests */
+
+static ap_dimension_t zone64_dimension(ap_manager_t * man, zone64_t * a) {
+	ap_dimension_t dimension = { a->intdim, a->realdim };
+	return dimension;
+}
+
+static bool zone64_is_bottom(ap_manager_t * man, zone64_t * a) {
+	zone64_t * tmp;
+	bool result = zone64_closed(a, &tmp)->is_bottom;
+	set_exact(man, true);
+	zone64_free_tmp(tmp);
+	return result;
+}
+
+static bool zone64_is_top(ap_manager_t * man, zone64_t * a) {
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	bool result = !closed->is_bottom;
+	set_exact(man, true);
+	for (size_t i = 0; result && (i < zone64_dims(a)); i++) {
+		result = (zone64_lo(closed)[i] == BOUND_NEG_INF) &&
+				(zone64_hi(closed)[i] == BOUND_POS_INF);
+	}
+	/* With no bounds, every edge is needed */
+	result = result && (closed->size == 0);
+	zone64_free_tmp(tmp);
+	return result;
+}
+
+/* Whether a closed a1 is in a2 */
+static bool zone64_is_leq_closed(zone64_t * a1, zone64_t * a2) {
+	if (a1->is_bottom) {
+		return true;
+	}
+	if (a2->is_bottom) {
+		return false;
+	}
+	if (!kernel_is_leq(zone64_lo(a1), zone64_hi(a1), zone64_lo(a2),
+			zone64_hi(a2), zone64_dims(a1))) {
+		return false;
+	}
+	for (size_t idx = 0; idx < a2->size; idx++) {
+		zone64_edge_t * e = &a2->edges[idx];
+		if (zone64_dist(a1, e->src, e->dst) > e->w) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool zone64_is_leq(ap_manager_t * man, zone64_t * a1, zone64_t * a2) {
+	zone64_t * tmp;
+	/* a2 need not be closed */
+	bool result = zone64_is_leq_closed(zone64_closed(a1, &tmp), a2);
+	set_exact(man, true);
+	zone64_free_tmp(tmp);
+	return result;
+}
+
+static bool zone64_is_eq(ap_manager_t * man, zone64_t * a1, zone64_t * a2) {
+	zone64_t * tmp1;
+	zone64_t * tmp2;
+	zone64_t * closed1 = zone64_closed(a1, &tmp1);
+	zone64_t * closed2 = zone64_closed(a2, &tmp2);
+	bool result = zone64_is_leq_closed(closed1, closed2) &&
+			zone64_is_leq_closed(closed2, closed1);
+	set_exact(man, true);
+	zone64_free_tmp(tmp1);
+	zone64_free_tmp(tmp2);
+	return result;
+}
+
+static bool zone64_is_dimension_unconstrained(ap_manager_t * man,
+		zone64_t * a, ap_dim_t dim) {
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	bool result = !closed->is_bottom &&
+			(zone64_lo(closed)[dim] == BOUND_NEG_INF) &&
+			(zone64_hi(closed)[dim] == BOUND_POS_INF);
+	set_exact(man, true);
+	for (size_t idx = 0; result && (idx < closed->size); idx++) {
+		result = (closed->edges[idx].src != dim) &&
+				(closed->edges[idx].dst != dim);
+	}
+	zone64_free_tmp(tmp);
+	return result;
+}
+
+static bool zone64_sat_interval(ap_manager_t * man, zone64_t * a,
+		ap_dim_t dim, ap_interval_t * interval) {
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	bool result = true;
+	set_exact(man, true);
+	if (!closed->is_bottom) {
+		/* Within the integers inside the interval */
+		result = (zone64_lo(closed)[dim] >=
+				bound_of_scalar(interval->inf, true)) &&
+			(zone64_hi(closed)[dim] <= bound_of_scalar(interval->sup, false));
+	}
+	zone64_free_tmp(tmp);
+	return result;
+}
+
+static bool zone64_sat_tcons(ap_manager_t * man, zone64_t * a,
+		ap_tcons0_t * cons) {
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	int64_t lo, hi;
+	bool result = true;
+	set_exact(man, false);
+	if (!closed->is_bottom && zone64_eval(closed, cons->texpr0, &lo, &hi)) {
+		result = native_sat_interval(cons->constyp, cons->scalar, lo, hi) ==
+				native_sat_true;
+	}
+	zone64_free_tmp(tmp);
+	return result;
+}
+
+static bool zone64_sat_lincons(ap_manager_t * man, zone64_t * a,
+		ap_lincons0_t * lincons) {
+	ap_tcons0_t cons = ap_tcons0_from_lincons0(lincons);
+	bool result = zone64_sat_tcons(man, a, &cons);
+	ap_tcons0_clear(&cons);
+	return result;
+}
+
+static ap_interval_t * interval_of_bounds(int64_t lo, int64_t hi) {
+	ap_interval_t * interval = ap_interval_alloc();
+	bound_to_scalar(interval->inf, lo);
+	bound_to_scalar(interval->sup, hi);
+	return interval;
+}
+
+static ap_interval_t * zone64_bound_dimension(ap_manager_t * man,
+		zone64_t * a, ap_dim_t dim) {
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	ap_interval_t * interval;
+	set_exact(man, true);
+	if (closed->is_bottom) {
+		interval = ap_interval_alloc();
+		ap_interval_set_bottom(interval);
+	} else {
+		interval = interval_of_bounds(zone64_lo(closed)[dim],
+				zone64_hi(closed)[dim]);
+	}
+	zone64_free_tmp(tmp);
+	return interval;
+}
+
+static ap_interval_t * zone64_bound_texpr(ap_manager_t * man, zone64_t * a,
+		ap_texpr0_t * texpr) {
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	ap_interval_t * interval;
+	int64_t lo, hi;
+	set_exact(man, false);
+	if (closed->is_bottom || !zone64_eval(closed, texpr, &lo, &hi)) {
+		interval = ap_interval_alloc();
+		ap_interval_set_bottom(interval);
+	} else {
+		interval = interval_of_bounds(lo, hi);
+	}
+	zone64_free_tmp(tmp);
+	return interval;
+}
+
+static ap_interval_t * zone64_bound_linexpr(ap_manager_t * man, zone64_t * a,
+		ap_linexpr0_t * linexpr) {
+	ap_texpr0_t * texpr = ap_texpr0_from_linexpr0(linexpr);
+	ap_interval_t * interval = zone64_bound_texpr(man, a, texpr);
+	ap_texpr0_free(texpr);
+	return interval;
+}
+
+static ap_interval_t ** zone64_to_box(ap_manager_t * man, zone64_t * a) {
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	ap_interval_t ** box = ap_interval_array_alloc(zone64_dims(a));
+	set_exact(man, true);
+	for (size_t i = 0; i < zone64_dims(a); i++) {
+		if (closed->is_bottom) {
+			ap_interval_set_bottom(box[i]);
+		} else {
+			bound_to_scalar(box[i]->inf, zone64_lo(closed)[i]);
+			bound_to_scalar(box[i]->sup, zone64_hi(closed)[i]);
+		}
+	}
+	zone64_free_tmp(tmp);
+	return box;
+}
+
+static ap_lincons0_t make_lincons_bound(ap_constyp_t constyp, ap_dim_t dim,
+		long coeff, long cst) {
+	ap_linexpr0_t * linexpr = ap_linexpr0_alloc(AP_LINEXPR_SPARSE, 1);
+	linexpr->p.linterm[0].dim = dim;
+	ap_coeff_set_scalar_int(&linexpr->p.linterm[0].coeff, coeff);
+	ap_coeff_set_scalar_int(&linexpr->cst, cst);
+	return ap_lincons0_make(constyp, linexpr, 0);
+}
+
+/* dst - src <= w, as src - dst + w >= 0 */
+static ap_lincons0_t make_lincons_edge(zone64_edge_t * e) {
+	ap_linexpr0_t * linexpr = ap_linexpr0_alloc(AP_LINEXPR_SPARSE, 2);
+	bool is_src_first = e->src < e->dst;
+	linexpr->p.linterm[0].dim = is_src_first ? e->src : e->dst;
+	ap_coeff_set_scalar_int(&linexpr->p.linterm[0].coeff,
+			is_src_first ? 1 : -1);
+	linexpr->p.linterm[1].dim = is_src_first ? e->dst : e->src;
+	ap_coeff_set_scalar_int(&linexpr->p.linterm[1].coeff,
+			is_src_first ? -1 : 1);
+	ap_coeff_set_scalar_int(&linexpr->cst, (long)e->w);
+	return ap_lincons0_make(AP_CONS_SUPEQ, linexpr, 0);
+}
+
+static ap_lincons0_array_t zone64_to_lincons_array(ap_manager_t * man,
+		zone64_t * a) {
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	int64_t * lo = zone64_lo(closed);
+	int64_t * hi = zone64_hi(closed);
+	size_t count = 0;
+	set_exact(man, true);
+	if (closed->is_bottom) {
+		ap_lincons0_array_t array = ap_lincons0_array_make(1);
+		array.p[0] = ap_lincons0_make_unsat();
+		zone64_free_tmp(tmp);
+		return array;
+	}
+	for (size_t i = 0; i < zone64_dims(a); i++) {
+		count += (lo[i] != BOUND_NEG_INF) + (hi[i] != BOUND_POS_INF);
+	}
+	for (size_t idx = 0; idx < closed->size; idx++) {
+		count += zone64_is_edge_needed(closed, &closed->edges[idx]);
+	}
+	ap_lincons0_array_t array = ap_lincons0_array_make(count);
+	count = 0;
+	for (size_t i = 0; i < zone64_dims(a); i++) {
+		if (lo[i] != BOUND_NEG_INF) {
+			array.p[count++] = make_lincons_bound(AP_CONS_SUPEQ, i, 1, -lo[i]);
+		}
+		if (hi[i] != BOUND_POS_INF) {
+			array.p[count++] = make_lincons_bound(AP_CONS_SUPEQ, i, -1, hi[i]);
+		}
+	}
+	for (size_t idx = 0; idx < closed->size; idx++) {
+		if (zone64_is_edge_needed(closed, &closed->edges[idx])) {
+			array.p[count++] = make_lincons_edge(&closed->edges[idx]);
+		}
+	}
+	zone64_free_tmp(tmp);
+	return array;
+}
+
+static ap_tcons0_array_t zone64_to_tcons_array(ap_manager_t * man,
+		zone64_t * a) {
+	ap_lincons0_array_t lincons = zone64_to_lincons_array(man, a);
+	ap_tcons0_array_t array = ap_tcons0_array_make(lincons.size);
+	for (size_t i = 0; i < lincons.size; i++) {
+		array.p[i] = ap_tcons0_from_lincons0(&lincons.p[i]);
+	}
+	ap_lincons0_array_clear(&lincons);
+	return array;
+}
+
+static ap_generator0_array_t zone64_to_generator_array(ap_manager_t * man,
+		zone64_t * a) {
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_TO_GENERATOR_ARRAY, "not implemented");
+	return ap_generator0_array_make(0);
+}
+
+/* Meet and join */
+
+static zone64_t * zone64_meet(ap_manager_t * man, bool destructive,
+		zone64_t * a1, zone64_t * a2) {
+	zone64_t * result = destructive ? a1 : zone64_copy_internal(a1);
+	set_exact(man, true);
+	zone64_close(result);
+	if ((a1 == a2) || result->is_bottom) {
+		return result;
+	}
+	if (a2->is_bottom) {
+		zone64_set_bottom(result);
+		return result;
+	}
+	for (size_t i = 0; i < zone64_dims(a2); i++) {
+		zone64_add_lo(result, i, zone64_lo(a2)[i]);
+		zone64_add_hi(result, i, zone64_hi(a2)[i]);
+	}
+	for (size_t idx = 0; idx < a2->size; idx++) {
+		zone64_edge_t * e = &a2->edges[idx];
+		zone64_add_edge(result, e->src, e->dst, e->w);
+	}
+	return result;
+}
+
+static zone64_t * zone64_meet_array(ap_manager_t * man, zone64_t ** tab,
+		size_t size) {
+	zone64_t * result = zone64_copy_internal(tab[0]);
+	for (size_t i = 1; i < size; i++) {
+		result = zone64_meet(man, true, result, tab[i]);
+	}
+	set_exact(man, true);
+	return result;
+}
+
+/* The join of closed a1 and a2. Every difference is the larger of the two,
+ * and kept where the joined bounds do not imply it. */
+static zone64_t * zone64_join_closed(zone64_t * a1, zone64_t * a2) {
+	size_t n = zone64_dims(a1);
+	zone64_t * result = zone64_alloc(a1->intdim, a1->realdim);
+	int64_t * lo1 = zone64_lo(a1);
+	int64_t * hi1 = zone64_hi(a1);
+	int64_t * lo2 = zone64_lo(a2);
+	int64_t * hi2 = zone64_hi(a2);
+	int64_t * lo = zone64_lo(result);
+	int64_t * hi = zone64_hi(result);
+	edge_batch_t edges = { 0, 0, 0 };
+	edge_batch_t implied = { 0, 0, 0 };
+	memcpy(result->bounds, a1->bounds, 2 * n * sizeof(a1->bounds[0]));
+	kernel_join(lo, hi, lo2, hi2, n);
+	/* The edges of either, in order */
+	size_t i = 0;
+	size_t j = 0;
+	while ((i < a1->size) || (j < a2->size)) {
+		int compare = (i == a1->size) ? 1 : (j == a2->size) ? -1 :
+				edge_compare(&a1->edges[i], &a2->edges[j]);
+		zone64_edge_t * e = (compare <= 0) ? &a1->edges[i] : &a2->edges[j];
+		int64_t w1 = zone64_dist(a1, e->src, e->dst);
+		int64_t w2 = zone64_dist(a2, e->src, e->dst);
+		int64_t w = (w1 > w2) ? w1 : w2;
+		if (w < bound_add_hi(hi[e->dst], bound_neg(lo[e->src]))) {
+			batch_push(&edges, e->src, e->dst, w);
+		}
+		i += (compare <= 0);
+		j += (compare >= 0);
+	}
+	/* The differences both imply by their bounds alone, which the joined
+	 * bounds do not: one of the bounds differs between a1 and a2 */
+	for (size_t src = 0; src < n; src++) {
+		if ((lo1[src] == BOUND_NEG_INF) || (lo2[src] == BOUND_NEG_INF)) {
+			continue;
+		}
+		bool is_src_changed = lo1[src] != lo2[src];
+		for (size_t dst = 0; dst < n; dst++) {
+			int64_t w1, w2, w;
+			if ((src == dst) || (hi1[dst] == BOUND_POS_INF) ||
+					(hi2[dst] == BOUND_POS_INF) ||
+					(!is_src_changed && (hi1[dst] == hi2[dst])) ||
+					edge_find(a1, src, dst, &w) || edge_find(a2, src, dst, &w)) {
+				continue;
+			}
+			w1 = bound_add_hi(hi1[dst], bound_neg(lo1[src]));
+			w2 = bound_add_hi(hi2[dst], bound_neg(lo2[src]));
+			w = (w1 > w2) ? w1 : w2;
+			if (w < bound_add_hi(hi[dst], bound_neg(lo[src]))) {
+				batch_push(&implied, src, dst, w);
+			}
+		}
+	}
+	result->edges = edges.edges;
+	result->size = edges.size;
+	zone64_merge_edges(result, &implied);
+	free(implied.edges);
+	return result;
+}
+
+static zone64_t * zone64_join(ap_manager_t * man, bool destructive,
+		zone64_t * a1, zone64_t * a2) {
+	zone64_t * tmp1;
+	zone64_t * tmp2;
+	zone64_t * closed1 = zone64_closed(a1, &tmp1);
+	zone64_t * closed2 = zone64_closed(a2, &tmp2);
+	zone64_t * result;
+	set_exact(man, false);
+	if (closed1->is_bottom) {
+		result = zone64_copy_internal(closed2);
+	} else if (closed2->is_bottom) {
+		result = zone64_copy_internal(closed1);
+	} else {
+		result = zone64_join_closed(closed1, closed2);
+	}
+	zone64_free_tmp(tmp1);
+	zone64_free_tmp(tmp2);
+	if (destructive) {
+		zone64_free_internal(a1);
+	}
+	return result;
+}
+
+static zone64_t * zone64_join_array(ap_manager_t * man, zone64_t ** tab,
+		size_t size) {
+	zone64_t * result = zone64_copy_internal(tab[0]);
+	for (size_t i = 1; i < size; i++) {
+		result = zone64_join(man, true, result, tab[i]);
+	}
+	set_exact(man, false);
+	return result;
+}
+
+typedef struct {
+	zone64_t * a;
+	bool is_changed;
+} tighten_ctx_t;
+
+static void tighten_ctx_bounds(void * ctx, ap_dim_t dim, int64_t * lo,
+		int64_t * hi) {
+	zone64_dim_bounds(((tighten_ctx_t *)ctx)->a, dim, lo, hi);
+}
+
+static bool tighten_ctx_tighten(void * ctx, ap_dim_t dim, int64_t lo,
+		int64_t hi) {
+	tighten_ctx_t * tctx = ctx;
+	tctx->is_changed |= zone64_add_lo(tctx->a, dim, lo);
+	tctx->is_changed |= zone64_add_hi(tctx->a, dim, hi);
+	return !tctx->a->is_bottom;
+}
+
+/* Meet cons into tctx->a: x - y >= c as an edge, anything else by its
+ * bounds. Returns false if it is unsatisfiable. */
+static bool meet_tcons(tighten_ctx_t * tctx, ap_tcons0_t * cons) {
+	zone64_t * a = tctx->a;
+	native_linexpr_t expr;
+	ap_dim_t p, q;
+	int64_t lo, hi;
+	native_linexpr_init(&expr);
+	bool is_sat = native_linearize(cons->texpr0, a->intdim,
+			tighten_ctx_bounds, tctx, &expr);
+	bool is_difference = is_sat && zone64_difference(&expr, &p, &q) &&
+			((cons->constyp == AP_CONS_EQ) ||
+			(cons->constyp == AP_CONS_SUPEQ) || (cons->constyp == AP_CONS_SUP));
+	if (is_difference) {
+		/* x_p - x_q + cst >= 0 is x_q - x_p <= cst_hi */
+		int64_t c = expr.cst_hi;
+		if ((cons->constyp == AP_CONS_SUP) && (p < a->intdim) &&
+				(q < a->intdim) && (c != BOUND_POS_INF)) {
+			c--;
+		}
+		tctx->is_changed |= zone64_add_edge(a, p, q, c);
+		if (cons->constyp == AP_CONS_EQ) {
+			tctx->is_changed |= zone64_add_edge(a, q, p,
+					bound_neg(expr.cst_lo));
+		}
+		is_sat = !a->is_bottom;
+	} else if (is_sat) {
+		is_sat = native_propagate(&expr, cons->constyp, a->intdim,
+				tighten_ctx_bounds, tighten_ctx_tighten, tctx);
+	}
+	if (is_sat) {
+		zone64_linexpr_bounds(a, &expr, &lo, &hi);
+		is_sat = native_sat_interval(cons->constyp, cons->scalar, lo, hi) !=
+				native_sat_false;
+	}
+	native_linexpr_clear(&expr);
+	return is_sat;
+}
+
+static zone64_t * zone64_meet_tcons_array(ap_manager_t * man,
+		bool destructive, zone64_t * a, ap_tcons0_array_t * array) {
+	zone64_t * result = destructive ? a : zone64_copy_internal(a);
+	tighten_ctx_t tctx = { result, true };
+	set_exact(man, false);
+	zone64_close(result);
+	for (unsigned round = 0; (round < meet_rounds) && tctx.is_changed &&
+			!result->is_bottom; round++) {
+		tctx.is_changed = false;
+		for (size_t i = 0; i < array->size; i++) {
+			if (!meet_tcons(&tctx, &array->p[i])) {
+				zone64_set_bottom(result);
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+static zone64_t * zone64_meet_lincons_array(ap_manager_t * man,
+		bool destructive, zone64_t * a, ap_lincons0_array_t * array) {
+	ap_tcons0_array_t tcons = ap_tcons0_array_make(array->size);
+	for (size_t i = 0; i < array->size; i++) {
+		tcons.p[i] = ap_tcons0_from_lincons0(&array->p[i]);
+	}
+	zone64_t * result = zone64_meet_tcons_array(man, destructive, a, &tcons);
+	ap_tcons0_array_clear(&tcons);
+	return result;
+}
+
+static zone64_t * zone64_add_ray_array(ap_manager_t * man, bool destructive,
+		zone64_t * a, ap_generator0_array_t * array) {
+	zone64_t * result = zone64_top_internal(a->intdim, a->realdim);
+	ap_manager_raise_exception(man, AP_EXC_NOT_IMPLEMENTED,
+			AP_FUNID_ADD_RAY_ARRAY, "not implemented");
+	if (destructive) {
+		zone64_free_internal(a);
+	}
+	return result;
+}
+
+/* Change and permutation of dimensions */
+
+static zone64_t * zone64_add_dimensions_internal(zone64_t * a,
+		ap_dimchange_t * dimchange, bool project) {
+	size_t n = zone64_dims(a);
+	size_t added = dimchange->intdim + dimchange->realdim;
+	zone64_t * result = zone64_alloc(a->intdim + dimchange->intdim,
+			a->realdim + dimchange->realdim);
+	int64_t * lo = zone64_lo(result);
+	int64_t * hi = zone64_hi(result);
+	ap_dim_t * map = malloc((n + 1) * sizeof(*map));
+	size_t k = 0;
+	size_t j = 0;
+	result->is_bottom = a->is_bottom;
+	/* New unconstrained dimensions keep the value closed */
+	result->is_closed = a->is_closed;
+	/* dimchange->dim[k] is the dimension of a the new one is inserted
+	 * before */
+	for (size_t i = 0; i <= n; i++) {
+		while ((k < added) && (dimchange->dim[k] == i)) {
+			lo[j] = (project && !a->is_bottom) ? 0 : BOUND_NEG_INF;
+			hi[j] = (project && !a->is_bottom) ? 0 : BOUND_POS_INF;
+			j++;
+			k++;
+		}
+		if (i < n) {
+			lo[j] = zone64_lo(a)[i];
+			hi[j] = zone64_hi(a)[i];
+			map[i] = j;
+			j++;
+		}
+	}
+	/* The map is monotone, so the edges stay sorted */
+	if (a->size) {
+		result->edges = malloc(a->size * sizeof(*a->edges));
+		result->size = a->size;
+		for (size_t idx = 0; idx < a->size; idx++) {
+			result->edges[idx].src = map[a->edges[idx].src];
+			result->edges[idx].dst = map[a->edges[idx].dst];
+			result->edges[idx].w = a->edges[idx].w;
+		}
+	}
+	free(map);
+	return result;
+}
+
+static zone64_t * zone64_remove_dimensions_internal(zone64_t * a,
+		ap_dimchange_t * dimchange) {
+	size_t n = zone64_dims(a);
+	size_t removed = dimchange->intdim + dimchange->realdim;
+	zone64_t * result = zone64_alloc(a->intdim - dimchange->intdim,
+			a->realdim - dimchange->realdim);
+	int64_t * lo = zone64_lo(result);
+	int64_t * hi = zone64_hi(result);
+	ap_dim_t * map = malloc((n + 1) * sizeof(*map));
+	bool * is_kept = malloc((n + 1) * sizeof(*is_kept));
+	size_t k = 0;
+	size_t j = 0;
+	result->is_bottom = a->is_bottom;
+	/* Removing dimensions of a closed value keeps it closed */
+	result->is_closed = a->is_closed;
+	for (size_t i = 0; i < n; i++) {
+		is_kept[i] = !((k < removed) && (dimchange->dim[k] == i));
+		if (!is_kept[i]) {
+			k++;
+			continue;
+		}
+		lo[j] = zone64_lo(a)[i];
+		hi[j] = zone64_hi(a)[i];
+		map[i] = j++;
+	}
+	if (a->size) {
+		result->edges = malloc(a->size * sizeof(*a->edges));
+		for (size_t idx = 0; idx < a->size; idx++) {
+			zone64_edge_t * e = &a->edges[idx];
+			if (is_kept[e->src] && is_kept[e->dst]) {
+				result->edges[result->size].src = map[e->src];
+				result->edges[result->size].dst = map[e->dst];
+				result->edges[result->size].w = e->w;
+				result->size++;
+			}
+		}
+	}
+	free(map);
+	free(is_kept);
+	return result;
+}
+
+static zone64_t * zone64_add_dimensions(ap_manager_t * man, bool destructive,
+		zone64_t * a, ap_dimchange_t * dimchange, bool project) {
+	zone64_t * result = zone64_add_dimensions_internal(a, dimchange, project);
+	set_exact(man, true);
+	if (destructive) {
+		zone64_free_internal(a);
+	}
+	return result;
+}
+
+static zone64_t * zone64_remove_dimensions(ap_manager_t * man,
+		bool destructive, zone64_t * a, ap_dimchange_t * dimchange) {
+	zone64_t * result = zone64_remove_dimensions_internal(a, dimchange);
+	set_exact(man, true);
+	if (destructive) {
+		zone64_free_internal(a);
+	}
+	return result;
+}
+
+static zone64_t * zone64_permute_dimensions(ap_manager_t * man,
+		bool destructive, zone64_t * a, ap_dimperm_t * perm) {
+	zone64_t * result = zone64_copy_internal(a);
+	set_exact(man, true);
+	for (size_t i = 0; i < zone64_dims(a); i++) {
+		zone64_lo(result)[perm->dim[i]] = zone64_lo(a)[i];
+		zone64_hi(result)[perm->dim[i]] = zone64_hi(a)[i];
+	}
+	for (size_t idx = 0; idx < result->size; idx++) {
+		result->edges[idx].src = perm->dim[result->edges[idx].src];
+		result->edges[idx].dst = perm->dim[result->edges[idx].dst];
+	}
+	if (result->size) {
+		qsort(result->edges, result->size, sizeof(*result->edges),
+				edge_compare);
+	}
+	if (destructive) {
+		zone64_free_internal(a);
+	}
+	return result;
+}
+
+/* Assignments and substitutions */
+
+/* x = x + [lo, hi] in a closed a, which stays closed */
+static void zone64_translate(zone64_t * a, ap_dim_t dim, int64_t lo,
+		int64_t hi) {
+	int64_t neg_lo = bound_neg(lo);
+	size_t k = 0;
+	zone64_lo(a)[dim] = bound_add_lo(zone64_lo(a)[dim], lo);
+	zone64_hi(a)[dim] = bound_add_hi(zone64_hi(a)[dim], hi);
+	for (size_t idx = 0; idx < a->size; idx++) {
+		zone64_edge_t e = a->edges[idx];
+		if (e.src == dim) {
+			e.w = bound_add_hi(e.w, neg_lo);
+		} else if (e.dst == dim) {
+			e.w = bound_add_hi(e.w, hi);
+		}
+		if (e.w != BOUND_POS_INF) {
+			a->edges[k++] = e;
+		}
+	}
+	a->size = k;
+}
+
+/* x = texpr in a closed a. x = y + c keeps the difference of x and y,
+ * x = x + c is a translation, and anything else is bounded. */
+static void zone64_assign(zone64_t * a, ap_dim_t dim, ap_texpr0_t * texpr) {
+	native_linexpr_t expr;
+	ap_dim_t var;
+	native_linexpr_init(&expr);
+	bool is_nonempty = native_linearize(texpr, a->intdim, zone64_dim_bounds,
+			a, &expr);
+	bool is_translation = is_nonempty && zone64_translation(&expr, &var);
+	if (!is_nonempty) {
+		zone64_set_bottom(a);
+	} else if (is_translation && (var == dim)) {
+		zone64_translate(a, dim, expr.cst_lo, expr.cst_hi);
+	} else if (is_translation) {
+		zone64_forget_dim(a, dim);
+		zone64_add_edge(a, var, dim, expr.cst_hi);
+		zone64_add_edge(a, dim, var, bound_neg(expr.cst_lo));
+	} else {
+		int64_t lo, hi;
+		zone64_linexpr_bounds(a, &expr, &lo, &hi);
+		zone64_forget_dim(a, dim);
+		zone64_add_lo(a, dim, lo);
+		zone64_add_hi(a, dim, hi);
+	}
+	native_linexpr_clear(&expr);
+}
+
+static zone64_t * zone64_meet_dest(ap_manager_t * man, zone64_t * result,
+		zone64_t * dest) {
+	if (dest) {
+		bool is_exact = man->result.flag_exact;
+		result = zone64_meet(man, true, result, dest);
+		set_exact(man, is_exact);
+	}
+	return result;
+}
+
+static zone64_t * zone64_assign_texpr_array(ap_manager_t * man,
+		bool destructive, zone64_t * a, ap_dim_t * tdim,
+		ap_texpr0_t ** texpr, size_t size, zone64_t * dest) {
+	zone64_t * result = destructive ? a : zone64_copy_internal(a);
+	set_exact(man, false);
+	zone64_close(result);
+	if (result->is_bottom) {
+		return result;
+	}
+	if (size == 1) {
+		zone64_assign(result, tdim[0], texpr[0]);
+		return zone64_meet_dest(man, result, dest);
+	}
+	/* In parallel: every expression is assigned to a new dimension t_i
+	 * first, then x_i = t_i */
+	size_t n = zone64_dims(result);
+	ap_dimchange_t * dimchange = ap_dimchange_alloc(0, size);
+	for (size_t i = 0; i < size; i++) {
+		dimchange->dim[i] = n;
+	}
+	zone64_t * extended = zone64_add_dimensions_internal(result, dimchange,
+			false);
+	zone64_free_internal(result);
+	for (size_t i = 0; i < size; i++) {
+		zone64_assign(extended, n + i, texpr[i]);
+	}
+	for (size_t i = 0; i < size; i++) {
+		zone64_forget_dim(extended, tdim[i]);
+	}
+	for (size_t i = 0; i < size; i++) {
+		zone64_add_edge(extended, n + i, tdim[i], 0);
+		zone64_add_edge(extended, tdim[i], n + i, 0);
+	}
+	for (size_t i = 0; i < size; i++) {
+		dimchange->dim[i] = n + i;
+	}
+	result = zone64_remove_dimensions_internal(extended, dimchange);
+	zone64_free_internal(extended);
+	ap_dimchange_free(dimchange);
+	return zone64_meet_dest(man, result, dest);
+}
+
+static zone64_t * zone64_assign_linexpr_array(ap_manager_t * man,
+		bool destructive, zone64_t * a, ap_dim_t * tdim,
+		ap_linexpr0_t ** linexpr, size_t size, zone64_t * dest) {
+	ap_texpr0_t ** texpr = malloc(size * sizeof(*texpr));
+	for (size_t i = 0; i < size; i++) {
+		texpr[i] = ap_texpr0_from_linexpr0(linexpr[i]);
+	}
+	zone64_t * result = zone64_assign_texpr_array(man, destructive, a, tdim,
+			texpr, size, dest);
+	for (size_t i = 0; i < size; i++) {
+		ap_texpr0_free(texpr[i]);
+	}
+	free(texpr);
+	return result;
+}
+
+/* The states whose image is in a agree with a on the other dimensions */
+static zone64_t * zone64_substitute(ap_manager_t * man, bool destructive,
+		zone64_t * a, ap_dim_t * tdim, size_t size, zone64_t * dest) {
+	zone64_t * result = destructive ? a : zone64_copy_internal(a);
+	set_exact(man, false);
+	zone64_close(result);
+	if (result->is_bottom) {
+		return result;
+	}
+	for (size_t i = 0; i < size; i++) {
+		zone64_forget_dim(result, tdim[i]);
+	}
+	return zone64_meet_dest(man, result, dest);
+}
+
+static zone64_t * zone64_substitute_linexpr_array(ap_manager_t * man,
+		bool destructive, zone64_t * a, ap_dim_t * tdim,
+		ap_linexpr0_t ** linexpr, size_t size, zone64_t * dest) {
+	return zone64_substitute(man, destructive, a, tdim, size, dest);
+}
+
+static zone64_t * zone64_substitute_texpr_array(ap_manager_t * man,
+		bool destructive, zone64_t * a, ap_dim_t * tdim,
+		ap_texpr0_t ** texpr, size_t size, zone64_t * dest) {
+	return zone64_substitute(man, destructive, a, tdim, size, dest);
+}
+
+/* Projections */
+
+static zone64_t * zone64_forget_array(ap_manager_t * man, bool destructive,
+		zone64_t * a, ap_dim_t * tdim, size_t size, bool project) {
+	zone64_t * result = destructive ? a : zone64_copy_internal(a);
+	set_exact(man, true);
+	zone64_close(result);
+	if (result->is_bottom) {
+		return result;
+	}
+	for (size_t i = 0; i < size; i++) {
+		zone64_forget_dim(result, tdim[i]);
+		if (project) {
+			zone64_lo(result)[tdim[i]] = 0;
+			zone64_hi(result)[tdim[i]] = 0;
+		}
+	}
+	return result;
+}
+
+/* Expansion and folding of dimensions */
+
+static bool is_in(ap_dim_t dim, const ap_dim_t * tdim, size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		if (tdim[i] == dim) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static zone64_t * zone64_expand(ap_manager_t * man, bool destructive,
+		zone64_t * a, ap_dim_t dim, size_t n) {
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a, &tmp);
+	/* The copies are added after the dimensions of the same type */
+	bool is_int = dim < a->intdim;
+	size_t first = is_int ? a->intdim : zone64_dims(a);
+	ap_dimchange_t * dimchange = is_int ? ap_dimchange_alloc(n, 0) :
+			ap_dimchange_alloc(0, n);
+	for (size_t i = 0; i < n; i++) {
+		dimchange->dim[i] = first;
+	}
+	zone64_t * result = zone64_add_dimensions_internal(closed, dimchange,
+			false);
+	ap_dimchange_free(dimchange);
+	zone64_free_tmp(tmp);
+	if (destructive) {
+		zone64_free_internal(a);
+	}
+	set_exact(man, true);
+	if (result->is_bottom) {
+		return result;
+	}
+	/* dim keeps its index, as the copies are after it */
+	edge_batch_t batch = { 0, 0, 0 };
+	for (size_t t = first; t < first + n; t++) {
+		zone64_lo(result)[t] = zone64_lo(result)[dim];
+		zone64_hi(result)[t] = zone64_hi(result)[dim];
+		for (size_t idx = 0; idx < result->size; idx++) {
+			zone64_edge_t * e = &result->edges[idx];
+			if (e->src == dim) {
+				batch_push(&batch, t, e->dst, e->w);
+			} else if (e->dst == dim) {
+				batch_push(&batch, e->src, t, e->w);
+			}
+		}
+	}
+	batch_sort(&batch);
+	zone64_merge_edges(result, &batch);
+	free(batch.edges);
+	/* Through dim and a copy, the copies are related */
+	result->is_closed = false;
+	zone64_close(result);
+	return result;
+}
+
+static zone64_t * zone64_fold(ap_manager_t * man, bool destructive,
+		zone64_t * a, ap_dim_t * tdim, size_t size) {
+	zone64_t * result = destructive ? a : zone64_copy_internal(a);
+	ap_dim_t t0 = tdim[0];
+	edge_batch_t batch = { 0, 0, 0 };
+	set_exact(man, false);
+	zone64_close(result);
+	/* The differences of the first dimension to the others are the
+	 * largest of every folded dimension's */
+	for (size_t idx = 0; (idx < result->size) && !result->is_bottom; idx++) {
+		zone64_edge_t * e = &result->edges[idx];
+		bool is_src = is_in(e->src, tdim, size);
+		bool is_dst = is_in(e->dst, tdim, size);
+		if (is_src == is_dst) {
+			continue;
+		}
+		int64_t w = BOUND_NEG_INF;
+		for (size_t i = 0; i < size; i++) {
+			int64_t wi = is_src ? zone64_dist(result, tdim[i], e->dst) :
+					zone64_dist(result, e->src, tdim[i]);
+			w = (wi > w) ? wi : w;
+		}
+		if (w != BOUND_POS_INF) {
+			batch_push(&batch, is_src ? t0 : e->src, is_src ? e->dst : t0, w);
+		}
+	}
+	for (size_t i = 1; i < size; i++) {
+		int64_t * lo = zone64_lo(result);
+		int64_t * hi = zone64_hi(result);
+		lo[t0] = (lo[tdim[i]] < lo[t0]) ? lo[tdim[i]] : lo[t0];
+		hi[t0] = (hi[tdim[i]] > hi[t0]) ? hi[tdim[i]] : hi[t0];
+	}
+	/* The largest of equal edges is the one to keep */
+	for (size_t idx = 0; idx < batch.size; idx++) {
+		batch.edges[idx].w = -batch.edges[idx].w;
+	}
+	batch_sort(&batch);
+	for (size_t idx = 0; idx < batch.size; idx++) {
+		batch.edges[idx].w = -batch.edges[idx].w;
+	}
+	if (!result->is_bottom) {
+		size_t k = 0;
+		for (size_t idx = 0; idx < result->size; idx++) {
+			zone64_edge_t * e = &result->edges[idx];
+			if ((e->src != t0) && (e->dst != t0)) {
+				result->edges[k++] = *e;
+			}
+		}
+		result->size = k;
+		zone64_merge_edges(result, &batch);
+	}
+	free(batch.edges);
+	size_t intdim = 0;
+	for (size_t i = 1; i < size; i++) {
+		intdim += tdim[i] < result->intdim;
+	}
+	ap_dimchange_t dimchange = {
+		.dim = tdim + 1,
+		.intdim = intdim,
+		.realdim = size - 1 - intdim
+	};
+	zone64_t * folded = zone64_remove_dimensions_internal(result, &dimchange);
+	zone64_free_internal(result);
+	folded->is_closed = folded->is_bottom;
+	zone64_close(folded);
+	return folded;
+}
+
+/* Widening and closure */
+
+static zone64_t * zone64_widening(ap_manager_t * man, zone64_t * a1,
+		zone64_t * a2) {
+	set_exact(man, false);
+	if (a1->is_bottom) {
+		return zone64_copy_internal(a2);
+	}
+	/* a1 is not closed, or the widening may not terminate */
+	zone64_t * result = zone64_copy_internal(a1);
+	zone64_t * tmp;
+	zone64_t * closed = zone64_closed(a2, &tmp);
+	if (!closed->is_bottom) {
+		size_t k = 0;
+		for (size_t idx = 0; idx < result->size; idx++) {
+			zone64_edge_t * e = &result->edges[idx];
+			if (zone64_dist(closed, e->src, e->dst) <= e->w) {
+				result->edges[k++] = *e;
+			}
+		}
+		result->size = k;
+		kernel_widen(zone64_lo(result), zone64_hi(result), zone64_lo(closed),
+				zone64_hi(closed), zone64_dims(result));
+		result->is_closed = false;
+	}
+	zone64_free_tmp(tmp);
+	return result;
+}
+
+static zone64_t * zone64_closure(ap_manager_t * man, bool destructive,
+		zone64_t * a) {
+	zone64_t * result = destructive ? a : zone64_copy_internal(a);
+	set_exact(man, true);
+	zone64_close(result);
+	return result;
+}
+
+ap_manager_t * zone64_manager_alloc(void) {
+	ap_manager_t * man = ap_manager_alloc("zone64", "1.0", 0, 0);
+	void ** funptr;
+	char * rounds_str = getenv("ZONE64_MEET_ROUNDS");
+	if (!man) {
+		return 0;
+	}
+	if (rounds_str && (atoi(rounds_str) > 0)) {
+		meet_rounds = atoi(rounds_str);
+	}
+	funptr = man->funptr;
+	funptr[AP_FUNID_COPY] = &zone64_copy;
+	funptr[AP_FUNID_FREE] = &zone64_free;
+	funptr[AP_FUNID_ASIZE] = &zone64_size;
+	funptr[AP_FUNID_MINIMIZE] = &zone64_minimize;
+	funptr[AP_FUNID_CANONICALIZE] = &zone64_canonicalize;
+	funptr[AP_FUNID_HASH] = &zone64_hash;
+	funptr[AP_FUNID_APPROXIMATE] = &zone64_approximate;
+	funptr[AP_FUNID_FPRINT] = &zone64_fprint;
+	funptr[AP_FUNID_FPRINTDIFF] = &zone64_fprintdiff;
+	funptr[AP_FUNID_FDUMP] = &zone64_fdump;
+	funptr[AP_FUNID_SERIALIZE_RAW] = &zone64_serialize_raw;
+	funptr[AP_FUNID_DESERIALIZE_RAW] = &zone64_deserialize_raw;
+	funptr[AP_FUNID_BOTTOM] = &zone64_bottom;
+	funptr[AP_FUNID_TOP] = &zone64_top;
+	funptr[AP_FUNID_OF_BOX] = &zone64_of_box;
+	funptr[AP_FUNID_DIMENSION] = &zone64_dimension;
+	funptr[AP_FUNID_IS_BOTTOM] = &zone64_is_bottom;
+	funptr[AP_FUNID_IS_TOP] = &zone64_is_top;
+	funptr[AP_FUNID_IS_LEQ] = &zone64_is_leq;
+	funptr[AP_FUNID_IS_EQ] = &zone64_is_eq;
+	funptr[AP_FUNID_IS_DIMENSION_UNCONSTRAINED] =
+			&zone64_is_dimension_unconstrained;
+	funptr[AP_FUNID_SAT_INTERVAL] = &zone64_sat_interval;
+	funptr[AP_FUNID_SAT_LINCONS] = &zone64_sat_lincons;
+	funptr[AP_FUNID_SAT_TCONS] = &zone64_sat_tcons;
+	funptr[AP_FUNID_BOUND_DIMENSION] = &zone64_bound_dimension;
+	funptr[AP_FUNID_BOUND_LINEXPR] = &zone64_bound_linexpr;
+	funptr[AP_FUNID_BOUND_TEXPR] = &zone64_bound_texpr;
+	funptr[AP_FUNID_TO_BOX] = &zone64_to_box;
+	funptr[AP_FUNID_TO_LINCONS_ARRAY] = &zone64_to_lincons_array;
+	funptr[AP_FUNID_TO_TCONS_ARRAY] = &zone64_to_tcons_array;
+	funptr[AP_FUNID_TO_GENERATOR_ARRAY] = &zone64_to_generator_array;
+	funptr[AP_FUNID_MEET] = &zone64_meet;
+	funptr[AP_FUNID_MEET_ARRAY] = &zone64_meet_array;
+	funptr[AP_FUNID_MEET_LINCONS_ARRAY] = &zone64_meet_lincons_array;
+	funptr[AP_FUNID_MEET_TCONS_ARRAY] = &zone64_meet_tcons_array;
+	funptr[AP_FUNID_JOIN] = &zone64_join;
+	funptr[AP_FUNID_JOIN_ARRAY] = &zone64_join_array;
+	funptr[AP_FUNID_ADD_RAY_ARRAY] = &zone64_add_ray_array;
+	funptr[AP_FUNID_ASSIGN_LINEXPR_ARRAY] = &zone64_assign_linexpr_array;
+	funptr[AP_FUNID_SUBSTITUTE_LINEXPR_ARRAY] =
+			&zone64_substitute_linexpr_array;
+	funptr[AP_FUNID_ASSIGN_TEXPR_ARRAY] = &zone64_assign_texpr_array;
+	funptr[AP_FUNID_SUBSTITUTE_TEXPR_ARRAY] = &zone64_substitute_texpr_array;
+	funptr[AP_FUNID_ADD_DIMENSIONS] = &zone64_add_dimensions;
+	funptr[AP_FUNID_REMOVE_DIMENSIONS] = &zone64_remove_dimensions;
+	funptr[AP_FUNID_PERMUTE_DIMENSIONS] = &zone64_permute_dimensions;
+	funptr[AP_FUNID_FORGET_ARRAY] = &zone64_forget_array;
+	funptr[AP_FUNID_EXPAND] = &zone64_expand;
+	funptr[AP_FUNID_FOLD] = &zone64_fold;
+	funptr[AP_FUNID_WIDENING] = &zone64_widening;
+	funptr[AP_FUNID_CLOSURE] = &zone64_closure;
+	for (int exception = 0; exception < AP_EXC_SIZE; exception++) {
+		ap_manager_set_abort_if_exception(man, exception, false);
+	}
+	return man;
+}
@@ -0,0 +1,27 @@
+#ifndef NATIVE_ZONE64_H
+#define NATIVE_ZONE64_H
+
+/* Native sparse zone domain. An apron manager whose abstract values are
+ * difference-bound matrices (x - y <= c) with int64 bounds, in split
+ * normal form: the bounds of every variable are kept in flat arrays, as by
+ * itv64, and only the differences tighter than those bounds imply are kept
+ * as edges, in a sorted sparse array.
+ *
+ * Values are kept closed. A new difference or bound is closed
+ * incrementally, over the predecessors and successors of its edge only,
+ * so the cost follows the number of edges rather than the square of the
+ * number of variables. x = y + c keeps the difference, x = x + c is a
+ * translation, and any other expression is bounded. */
+#include <ap_manager.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ap_manager_t * zone64_manager_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NATIVE_ZONE64_H */
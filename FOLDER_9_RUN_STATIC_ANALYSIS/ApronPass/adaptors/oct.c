@@ -1,8 +1,11 @@
 
 #include <Adaptor.h>
+#include <ApronProfile.h>
 #include <oct.h>
 
 ap_manager_t * create_manager() {
-	return oct_manager_alloc();
+	ap_manager_t * result = oct_manager_alloc();
+	ap_profile_wrap(result);
+	return result;
 }
 
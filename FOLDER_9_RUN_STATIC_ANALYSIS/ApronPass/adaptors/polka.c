@@ -1,8 +1,11 @@
 
 #include <Adaptor.h>
+#include <ApronProfile.h>
 #include <pk.h>
 
 ap_manager_t * create_manager() {
-	return pk_manager_alloc(true);
+	ap_manager_t * result = pk_manager_alloc(true);
+	ap_profile_wrap(result);
+	return result;
 }
 
@@ -0,0 +1,390 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <gmp.h>
+
+#include <ap_abstract0.h>
+#include <ApronProfile.h>
+
+#define HISTOGRAM_SIZE 64
+
+typedef enum {
+	profile_op_copy,
+	profile_op_is_leq,
+	profile_op_is_eq,
+	profile_op_sat_tcons,
+	profile_op_to_tcons_array,
+	profile_op_meet,
+	profile_op_join,
+	profile_op_join_array,
+	profile_op_meet_tcons_array,
+	profile_op_assign_texpr_array,
+	profile_op_add_dimensions,
+	profile_op_remove_dimensions,
+	profile_op_permute_dimensions,
+	profile_op_forget_array,
+	profile_op_widening,
+	profile_op_count
+} profile_op_e;
+
+static const char * profile_op_names[profile_op_count] = {
+	"copy",
+	"is_leq",
+	"is_eq",
+	"sat_tcons",
+	"to_tcons_array",
+	"meet",
+	"join",
+	"join_array",
+	"meet_tcons_array",
+	"assign_texpr_array",
+	"add_dimensions",
+	"remove_dimensions",
+	"permute_dimensions",
+	"forget_array",
+	"widening",
+};
+
+struct profile_stats {
+	unsigned long calls;
+	unsigned long nanoseconds;
+	unsigned long max_nanoseconds;
+	unsigned long dimensions;
+	unsigned long max_dimensions;
+	unsigned long gmp_allocations;
+	unsigned long gmp_bytes;
+	/* histogram[i] counts calls of [2^i, 2^(i+1)) ns */
+	unsigned long histogram[HISTOGRAM_SIZE];
+};
+
+struct profile_call {
+	struct timespec start;
+	int previous_op;
+};
+
+/* One domain per process: the originals are shared by all its managers */
+static void * original[AP_FUNID_SIZE];
+static const char * library;
+static struct profile_stats stats[profile_op_count];
+static pthread_once_t install_once = PTHREAD_ONCE_INIT;
+/* The manager being wrapped, for install. pthread_once runs it in this thread. */
+static __thread ap_manager_t * installing_manager;
+
+/* The outermost operation of this thread, or -1 */
+static __thread int current_op = -1;
+
+static void * (*gmp_alloc)(size_t);
+static void * (*gmp_realloc)(void *, size_t, size_t);
+static void (*gmp_free)(void *, size_t);
+
+static void atomic_add(unsigned long * counter, unsigned long value) {
+	__atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static void atomic_max(unsigned long * counter, unsigned long value) {
+	unsigned long prev = __atomic_load_n(counter, __ATOMIC_RELAXED);
+	while ((prev < value) && !__atomic_compare_exchange_n(counter, &prev,
+			value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+}
+
+static void count_gmp_allocation(size_t size) {
+	if (current_op < 0) {
+		return;
+	}
+	atomic_add(&stats[current_op].gmp_allocations, 1);
+	atomic_add(&stats[current_op].gmp_bytes, size);
+}
+
+static void * profile_gmp_alloc(size_t size) {
+	count_gmp_allocation(size);
+	return gmp_alloc(size);
+}
+
+static void * profile_gmp_realloc(void * ptr, size_t old_size, size_t new_size) {
+	if (new_size > old_size) {
+		count_gmp_allocation(new_size - old_size);
+	}
+	return gmp_realloc(ptr, old_size, new_size);
+}
+
+static void profile_gmp_free(void * ptr, size_t size) {
+	gmp_free(ptr, size);
+}
+
+static unsigned long dimensions(ap_manager_t * man, void * value) {
+	ap_dimension_t (*dimension)(ap_manager_t *, void *) =
+			original[AP_FUNID_DIMENSION];
+	ap_dimension_t dim = dimension(man, value);
+	return dim.intdim + dim.realdim;
+}
+
+static void profile_begin(struct profile_call * call, profile_op_e op,
+		ap_manager_t * man, void * value) {
+	call->previous_op = current_op;
+	if (current_op >= 0) {
+		/* Nested. Attributed to the outer operation. */
+		return;
+	}
+	if (value) {
+		unsigned long dims = dimensions(man, value);
+		atomic_add(&stats[op].dimensions, dims);
+		atomic_max(&stats[op].max_dimensions, dims);
+	}
+	current_op = op;
+	clock_gettime(CLOCK_MONOTONIC, &call->start);
+}
+
+static void profile_end(struct profile_call * call, profile_op_e op) {
+	struct timespec end;
+	unsigned long elapsed;
+	int bucket = 0;
+	if (call->previous_op >= 0) {
+		return;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	current_op = -1;
+	elapsed = (end.tv_sec - call->start.tv_sec) * 1000000000UL +
+			end.tv_nsec - call->start.tv_nsec;
+	while ((bucket < HISTOGRAM_SIZE - 1) && (elapsed >> (bucket + 1))) {
+		++bucket;
+	}
+	atomic_add(&stats[op].calls, 1);
+	atomic_add(&stats[op].nanoseconds, elapsed);
+	atomic_max(&stats[op].max_nanoseconds, elapsed);
+	atomic_add(&stats[op].histogram[bucket], 1);
+}
+
+/* Call the original of funid, cast to the function pointer type fn_t */
+#define PROFILE(op, funid, type, fn_t, value, args) \
+	struct profile_call call; \
+	type result; \
+	profile_begin(&call, op, man, value); \
+	result = ((fn_t)original[funid]) args; \
+	profile_end(&call, op); \
+	return result;
+
+typedef void * (*copy_t)(ap_manager_t *, void *);
+typedef bool (*compare_t)(ap_manager_t *, void *, void *);
+typedef bool (*sat_tcons_t)(ap_manager_t *, void *, ap_tcons0_t *);
+typedef ap_tcons0_array_t (*to_tcons_array_t)(ap_manager_t *, void *);
+typedef void * (*binop_t)(ap_manager_t *, bool, void *, void *);
+typedef void * (*join_array_t)(ap_manager_t *, void **, size_t);
+typedef void * (*meet_tcons_array_t)(ap_manager_t *, bool, void *,
+		ap_tcons0_array_t *);
+typedef void * (*assign_texpr_array_t)(ap_manager_t *, bool, void *,
+		ap_dim_t *, ap_texpr0_t **, size_t, void *);
+typedef void * (*add_dimensions_t)(ap_manager_t *, bool, void *,
+		ap_dimchange_t *, bool);
+typedef void * (*remove_dimensions_t)(ap_manager_t *, bool, void *,
+		ap_dimchange_t *);
+typedef void * (*permute_dimensions_t)(ap_manager_t *, bool, void *,
+		ap_dimperm_t *);
+typedef void * (*forget_array_t)(ap_manager_t *, bool, void *, ap_dim_t *,
+		size_t, bool);
+typedef void * (*widening_t)(ap_manager_t *, void *, void *);
+
+static void * profile_copy(ap_manager_t * man, void * a) {
+	PROFILE(profile_op_copy, AP_FUNID_COPY, void *, copy_t, a, (man, a))
+}
+
+static bool profile_is_leq(ap_manager_t * man, void * a1, void * a2) {
+	PROFILE(profile_op_is_leq, AP_FUNID_IS_LEQ, bool, compare_t, a1,
+			(man, a1, a2))
+}
+
+static bool profile_is_eq(ap_manager_t * man, void * a1, void * a2) {
+	PROFILE(profile_op_is_eq, AP_FUNID_IS_EQ, bool, compare_t, a1,
+			(man, a1, a2))
+}
+
+static bool profile_sat_tcons(ap_manager_t * man, void * a, ap_tcons0_t * cons) {
+	PROFILE(profile_op_sat_tcons, AP_FUNID_SAT_TCONS, bool, sat_tcons_t, a,
+			(man, a, cons))
+}
+
+static ap_tcons0_array_t profile_to_tcons_array(ap_manager_t * man, void * a) {
+	PROFILE(profile_op_to_tcons_array, AP_FUNID_TO_TCONS_ARRAY,
+			ap_tcons0_array_t, to_tcons_array_t, a, (man, a))
+}
+
+static void * profile_meet(ap_manager_t * man, bool destructive,
+		void * a1, void * a2) {
+	PROFILE(profile_op_meet, AP_FUNID_MEET, void *, binop_t, a1,
+			(man, destructive, a1, a2))
+}
+
+static void * profile_join(ap_manager_t * man, bool destructive,
+		void * a1, void * a2) {
+	PROFILE(profile_op_join, AP_FUNID_JOIN, void *, binop_t, a1,
+			(man, destructive, a1, a2))
+}
+
+static void * profile_join_array(ap_manager_t * man, void ** tab, size_t size) {
+	PROFILE(profile_op_join_array, AP_FUNID_JOIN_ARRAY, void *, join_array_t,
+			size ? tab[0] : NULL, (man, tab, size))
+}
+
+static void * profile_meet_tcons_array(ap_manager_t * man, bool destructive,
+		void * a, ap_tcons0_array_t * array) {
+	PROFILE(profile_op_meet_tcons_array, AP_FUNID_MEET_TCONS_ARRAY, void *,
+			meet_tcons_array_t, a, (man, destructive, a, array))
+}
+
+static void * profile_assign_texpr_array(ap_manager_t * man, bool destructive,
+		void * a, ap_dim_t * tdim, ap_texpr0_t ** texpr, size_t size,
+		void * dest) {
+	PROFILE(profile_op_assign_texpr_array, AP_FUNID_ASSIGN_TEXPR_ARRAY, void *,
+			assign_texpr_array_t, a,
+			(man, destructive, a, tdim, texpr, size, dest))
+}
+
+static void * profile_add_dimensions(ap_manager_t * man, bool destructive,
+		void * a, ap_dimchange_t * dimchange, bool project) {
+	PROFILE(profile_op_add_dimensions, AP_FUNID_ADD_DIMENSIONS, void *,
+			add_dimensions_t, a, (man, destructive, a, dimchange, project))
+}
+
+static void * profile_remove_dimensions(ap_manager_t * man, bool destructive,
+		void * a, ap_dimchange_t * dimchange) {
+	PROFILE(profile_op_remove_dimensions, AP_FUNID_REMOVE_DIMENSIONS, void *,
+			remove_dimensions_t, a, (man, destructive, a, dimchange))
+}
+
+static void * profile_permute_dimensions(ap_manager_t * man, bool destructive,
+		void * a, ap_dimperm_t * perm) {
+	PROFILE(profile_op_permute_dimensions, AP_FUNID_PERMUTE_DIMENSIONS, void *,
+			permute_dimensions_t, a, (man, destructive, a, perm))
+}
+
+static void * profile_forget_array(ap_manager_t * man, bool destructive,
+		void * a, ap_dim_t * tdim, size_t size, bool project) {
+	PROFILE(profile_op_forget_array, AP_FUNID_FORGET_ARRAY, void *,
+			forget_array_t, a, (man, destructive, a, tdim, size, project))
+}
+
+static void * profile_widening(ap_manager_t * man, void * a1, void * a2) {
+	PROFILE(profile_op_widening, AP_FUNID_WIDENING, void *, widening_t, a1,
+			(man, a1, a2))
+}
+
+static const struct {
+	ap_funid_t funid;
+	void * wrapper;
+} wrappers[] = {
+	{ AP_FUNID_COPY, profile_copy },
+	{ AP_FUNID_IS_LEQ, profile_is_leq },
+	{ AP_FUNID_IS_EQ, profile_is_eq },
+	{ AP_FUNID_SAT_TCONS, profile_sat_tcons },
+	{ AP_FUNID_TO_TCONS_ARRAY, profile_to_tcons_array },
+	{ AP_FUNID_MEET, profile_meet },
+	{ AP_FUNID_JOIN, profile_join },
+	{ AP_FUNID_JOIN_ARRAY, profile_join_array },
+	{ AP_FUNID_MEET_TCONS_ARRAY, profile_meet_tcons_array },
+	{ AP_FUNID_ASSIGN_TEXPR_ARRAY, profile_assign_texpr_array },
+	{ AP_FUNID_ADD_DIMENSIONS, profile_add_dimensions },
+	{ AP_FUNID_REMOVE_DIMENSIONS, profile_remove_dimensions },
+	{ AP_FUNID_PERMUTE_DIMENSIONS, profile_permute_dimensions },
+	{ AP_FUNID_FORGET_ARRAY, profile_forget_array },
+	{ AP_FUNID_WIDENING, profile_widening },
+};
+
+/* Upper bound of the bucket holding the given fraction of the calls */
+static unsigned long percentile(const struct profile_stats * op_stats,
+		double fraction) {
+	unsigned long target = op_stats->calls * fraction;
+	unsigned long seen = 0;
+	int bucket;
+	for (bucket = 0; bucket < HISTOGRAM_SIZE; bucket++) {
+		seen += op_stats->histogram[bucket];
+		if (seen > target) {
+			break;
+		}
+	}
+	return 2UL << bucket;
+}
+
+void ap_profile_report(FILE * stream) {
+	int op;
+	int bucket;
+	fprintf(stream, "Apron profile: %s\n", library ? library : "?");
+	fprintf(stream, "%-20s %10s %12s %10s %10s %10s %10s %10s %10s %12s %12s\n",
+			"op", "calls", "total(ms)", "mean(us)", "p50(us)", "p99(us)",
+			"max(us)", "dims", "maxdims", "gmp_allocs", "gmp_bytes");
+	for (op = 0; op < profile_op_count; op++) {
+		const struct profile_stats * op_stats = &stats[op];
+		if (!op_stats->calls) {
+			continue;
+		}
+		fprintf(stream, "%-20s %10lu %12.3f %10.2f %10.2f %10.2f %10.2f "
+				"%10.1f %10lu %12lu %12lu\n",
+				profile_op_names[op], op_stats->calls,
+				op_stats->nanoseconds / 1e6,
+				op_stats->nanoseconds / 1e3 / op_stats->calls,
+				percentile(op_stats, 0.5) / 1e3,
+				percentile(op_stats, 0.99) / 1e3,
+				op_stats->max_nanoseconds / 1e3,
+				(double)op_stats->dimensions / op_stats->calls,
+				op_stats->max_dimensions,
+				op_stats->gmp_allocations, op_stats->gmp_bytes);
+	}
+	fprintf(stream, "\nLatency histograms (calls per [2^i, 2^(i+1)) ns):\n");
+	for (op = 0; op < profile_op_count; op++) {
+		const struct profile_stats * op_stats = &stats[op];
+		if (!op_stats->calls) {
+			continue;
+		}
+		fprintf(stream, "%-20s", profile_op_names[op]);
+		for (bucket = 0; bucket < HISTOGRAM_SIZE; bucket++) {
+			if (op_stats->histogram[bucket]) {
+				fprintf(stream, " 2^%d:%lu", bucket,
+						op_stats->histogram[bucket]);
+			}
+		}
+		fprintf(stream, "\n");
+	}
+}
+
+static void report_at_exit(void) {
+	const char * path = getenv("APRON_PROFILE");
+	FILE * stream = stderr;
+	if (path && strcmp(path, "1") && strcmp(path, "stderr")) {
+		stream = fopen(path, "a");
+		if (!stream) {
+			perror(path);
+			return;
+		}
+	}
+	ap_profile_report(stream);
+	if (stream != stderr) {
+		fclose(stream);
+	}
+}
+
+static void install(void) {
+	ap_manager_t * manager = installing_manager;
+	library = manager->library;
+	memcpy(original, manager->funptr, sizeof(original));
+	mp_get_memory_functions(&gmp_alloc, &gmp_realloc, &gmp_free);
+	mp_set_memory_functions(profile_gmp_alloc, profile_gmp_realloc,
+			profile_gmp_free);
+	atexit(report_at_exit);
+}
+
+void ap_profile_wrap(ap_manager_t * manager) {
+	size_t idx;
+	if (!getenv("APRON_PROFILE")) {
+		return;
+	}
+	/* Managers may be created on several threads (-contract-jobs) */
+	installing_manager = manager;
+	pthread_once(&install_once, install);
+	installing_manager = NULL;
+	for (idx = 0; idx < sizeof(wrappers) / sizeof(wrappers[0]); idx++) {
+		if (manager->funptr[wrappers[idx].funid]) {
+			manager->funptr[wrappers[idx].funid] = wrappers[idx].wrapper;
+		}
+	}
+}
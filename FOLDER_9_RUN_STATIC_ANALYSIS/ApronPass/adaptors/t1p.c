@@ -1,8 +1,11 @@
 
 #include <Adaptor.h>
+#include <ApronProfile.h>
 #include <t1p.h>
 
 ap_manager_t * create_manager() {
-	return t1p_manager_alloc();
+	ap_manager_t * result = t1p_manager_alloc();
+	ap_profile_wrap(result);
+	return result;
 }
 
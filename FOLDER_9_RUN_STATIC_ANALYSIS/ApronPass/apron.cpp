@@ -6,6 +6,7 @@
 /************************/
 #include <list>
 #include <set>
+#include <vector>
 #include <map>
 #include <string>
 #include <iostream>
@@ -26,6 +27,7 @@
 //#include <llvm/IR/DebugLoc.h>
 #include <llvm/DebugInfo.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/Support/CallSite.h>
 #include "llvm/Analysis/CallGraphSCCPass.h"
 
 /**************************/
@@ -50,6 +52,9 @@
 #include <Function.h>
 #include <Contract.h>
 #include <ChaoticExecution.h>
+#include <Budget.h>
+#include <ResultsStore.h>
+#include <FixpointProfiler.h>
 
 bool Debug;
 llvm::cl::opt<bool, true> DebugOpt ("d", llvm::cl::desc("Enable additional debug output"), llvm::cl::location(Debug));
@@ -66,10 +71,105 @@ llvm::cl::opt<unsigned, true> WideningThresholdOpt ("widening-threshold",
 		llvm::cl::location(WideningThreshold),
 		llvm::cl::init(11));
 
+bool WideningThresholds;
+llvm::cl::opt<bool, true> WideningThresholdsOpt ("widening-thresholds",
+		llvm::cl::location(WideningThresholds),
+		llvm::cl::init(false),
+		llvm::cl::desc("Widen up to the constants each function compares against or passes as sizes. (false)"));
+
 llvm::cl::opt<std::string> SingleFunction("run-on-single-function",
 		llvm::cl::init(""),
 		llvm::cl::desc("Run on the specified function. '' for all (default)"));
 
+unsigned FunctionTimeBudget;
+llvm::cl::opt<unsigned, true> FunctionTimeBudgetOpt ("function-time-budget",
+		llvm::cl::location(FunctionTimeBudget),
+		llvm::cl::init(0),
+		llvm::cl::desc("Seconds to analyse a function before degrading. 0 to disable. (0)"));
+
+unsigned FunctionMemoryBudget;
+llvm::cl::opt<unsigned, true> FunctionMemoryBudgetOpt ("function-memory-budget",
+		llvm::cl::location(FunctionMemoryBudget),
+		llvm::cl::init(0),
+		llvm::cl::desc("Memory growth (MB) allowed per function before degrading. 0 to disable. (0)"));
+
+unsigned ApronOperationTimeout;
+llvm::cl::opt<unsigned, true> ApronOperationTimeoutOpt ("apron-timeout",
+		llvm::cl::location(ApronOperationTimeout),
+		llvm::cl::init(0),
+		llvm::cl::desc("Timeout of a single apron operation, passed to the domain. 0 to disable. (0)"));
+
+unsigned ApronMaxObjectSize;
+llvm::cl::opt<unsigned, true> ApronMaxObjectSizeOpt ("apron-max-object-size",
+		llvm::cl::location(ApronMaxObjectSize),
+		llvm::cl::init(0),
+		llvm::cl::desc("Maximum size of an apron object, passed to the domain. 0 to disable. (0)"));
+
+bool BatchTransfer;
+llvm::cl::opt<bool, true> BatchTransferOpt ("batch-transfer",
+		llvm::cl::location(BatchTransfer),
+		llvm::cl::init(false),
+		llvm::cl::desc("Apply runs of numeric assignments in a block, and the PHIs and guard of an edge, in batches. (false)"));
+
+bool MemoizeTransfer;
+llvm::cl::opt<bool, true> MemoizeTransferOpt ("memoize-transfer",
+		llvm::cl::location(MemoizeTransfer),
+		llvm::cl::init(false),
+		llvm::cl::desc("Reuse block and edge transfer results for input states seen before. (false)"));
+
+bool LazyOffsets;
+llvm::cl::opt<bool, true> LazyOffsetsOpt ("lazy-offsets",
+		llvm::cl::location(LazyOffsets),
+		llvm::cl::init(false),
+		llvm::cl::desc("Keep a derived pointer's offsets relative to its base, and create offset(pointer,buffer) only when used by a memory operation or a comparison. (false)"));
+
+unsigned ContractJobs;
+llvm::cl::opt<unsigned, true> ContractJobsOpt ("contract-jobs",
+		llvm::cl::location(ContractJobs),
+		llvm::cl::init(1),
+		llvm::cl::desc("Threads used to compute the contract's constraints. The domain must be thread safe. (1)"));
+
+std::string OutputDir;
+llvm::cl::opt<std::string, true> OutputDirOpt ("output-dir",
+		llvm::cl::location(OutputDir),
+		llvm::cl::init("/tmp/llvm_apron_pass"),
+		llvm::cl::desc("Directory of the output files. (/tmp/llvm_apron_pass)"));
+
+std::string ResultsFile;
+llvm::cl::opt<std::string, true> ResultsFileOpt ("results-file",
+		llvm::cl::location(ResultsFile),
+		llvm::cl::init("results.jsonl"),
+		llvm::cl::desc("File, relative to -output-dir, to append a JSON line per function to. '' to disable. (results.jsonl)"));
+
+bool ProfileFixpoint;
+llvm::cl::opt<bool, true> ProfileFixpointOpt ("profile-fixpoint",
+		llvm::cl::location(ProfileFixpoint),
+		llvm::cl::init(false),
+		llvm::cl::desc("Write a trace and a summary of the cost of each block and instruction kind to -output-dir. (false)"));
+
+state_storage_e StateStorage;
+llvm::cl::opt<state_storage_e, true> StateStorageOpt ("state-storage",
+		llvm::cl::location(StateStorage),
+		llvm::cl::init(state_storage_all),
+		llvm::cl::desc("Which block states to keep during the analysis. (all)"),
+		llvm::cl::values(
+			clEnumValN(state_storage_all, "all", "Keep every block's state"),
+			clEnumValN(state_storage_cutpoints, "cutpoints",
+					"Keep states of entry, merge and loop head blocks, and recompute others when queried"),
+			clEnumValEnd));
+
+std::string ClosureRoot;
+llvm::cl::opt<std::string, true> ClosureRootOpt ("closure-root",
+		llvm::cl::location(ClosureRoot),
+		llvm::cl::init(""),
+		llvm::cl::desc("Run on the specified function and its transitive callees. '' to disable (default)"));
+
+std::string UserMemoryModelsFile;
+llvm::cl::opt<std::string, true> UserMemoryModelsFileOpt ("user-memory-models",
+		llvm::cl::location(UserMemoryModelsFile),
+		llvm::cl::init(""),
+		llvm::cl::desc("File with additional models of kernel user memory functions. '' for none (default)"));
+
 /**************************/
 /* NAMESPACE :: anonymous */
 /**************************/
@@ -134,21 +234,123 @@ namespace
 		return false;
 	}
 
+	/*
+	 * If the module is loaded lazily (e.g. by apron-driver), function
+	 * bodies are read when a function is reached, and released after it
+	 * is analysed. Otherwise, these do nothing.
+	 */
+	static bool materialize(llvm::Function & F, bool & isMaterialized) {
+		isMaterialized = false;
+		if (!F.isMaterializable()) {
+			return true;
+		}
+		std::string error;
+		if (F.Materialize(&error)) {
+			llvm::errs() << "Error: " << F.getName() << ": " << error << "\n";
+			return false;
+		}
+		isMaterialized = true;
+		return true;
+	}
+
+	static void release(llvm::Function & F) {
+		ValueFactory::getInstance()->releaseFunction(&F);
+		BasicBlockManager::getInstance().releaseFunction(&F);
+		FunctionManager::getInstance().getFunction(&F)->releaseBody();
+		F.Dematerialize();
+	}
+
 	virtual bool runOnAlias(llvm::GlobalAlias & A) {
 		llvm::errs() << "runOnAlias: Enter: " << A.getName() << "\n";
+		llvm::Function * F = llvm::cast<llvm::Function>(A.getAliasedGlobal());
+		bool isMaterialized;
+		if (!materialize(*F, isMaterialized)) {
+			return false;
+		}
 		FunctionManager & functionManager = FunctionManager::getInstance();
 		Function * function = functionManager.getFunction(&A);
-		return runOnFunction(function);
+		bool result = runOnFunction(function);
+		if (isMaterialized) {
+			release(*F);
+		}
+		return result;
 	}
 
 	virtual bool runOnFunction(llvm::Function & F) {
 		llvm::errs() << "runOnFunction: Enter: " << F.getName() << "\n";
-		if (F.isDeclaration()) {
+		bool isMaterialized;
+		if (!materialize(F, isMaterialized) || F.isDeclaration()) {
 			return false;
 		}
 		FunctionManager & functionManager = FunctionManager::getInstance();
 		Function * function = functionManager.getFunction(&F);
-		return runOnFunction(function);
+		bool result = runOnFunction(function);
+		if (isMaterialized) {
+			release(F);
+		}
+		return result;
+	}
+
+	static llvm::Function * getFunction(llvm::Value * value) {
+		value = value->stripPointerCasts();
+		llvm::GlobalAlias * alias = llvm::dyn_cast<llvm::GlobalAlias>(value);
+		if (alias) {
+			value = alias->getAliasedGlobal();
+		}
+		return llvm::dyn_cast<llvm::Function>(value);
+	}
+
+	// Direct callees of F, which must be materialized
+	static std::vector<llvm::Function *> getCallees(llvm::Function & F) {
+		std::vector<llvm::Function *> result;
+		for (llvm::BasicBlock & basicBlock : F) {
+			for (llvm::Instruction & instruction : basicBlock) {
+				llvm::CallSite callSite(&instruction);
+				if (!callSite) {
+					continue;
+				}
+				llvm::Function * callee = getFunction(callSite.getCalledValue());
+				if (callee) {
+					result.push_back(callee);
+				}
+			}
+		}
+		return result;
+	}
+
+	// Analyse the call closure of root. With a lazily loaded module, only
+	// the bodies in the closure are read, and one at a time.
+	virtual bool runOnClosure(llvm::Module & module, const std::string & root) {
+		llvm::GlobalValue * gv = module.getNamedValue(root);
+		llvm::Function * rootFunction = gv ? getFunction(gv) : 0;
+		if (!rootFunction) {
+			llvm::errs() << "Error: " << root << " not found\n";
+			return false;
+		}
+		std::set<llvm::Function *> seen;
+		std::list<llvm::Function *> worklist;
+		seen.insert(rootFunction);
+		worklist.push_back(rootFunction);
+		FunctionManager & functionManager = FunctionManager::getInstance();
+		while (!worklist.empty()) {
+			llvm::Function * F = worklist.front();
+			worklist.pop_front();
+			bool isMaterialized;
+			if (!materialize(*F, isMaterialized) || F->isDeclaration()) {
+				continue;
+			}
+			for (llvm::Function * callee : getCallees(*F)) {
+				if (seen.insert(callee).second) {
+					worklist.push_back(callee);
+				}
+			}
+			llvm::errs() << "runOnClosure: Enter: " << F->getName() << "\n";
+			runOnFunction(functionManager.getFunction(F));
+			if (isMaterialized) {
+				release(*F);
+			}
+		}
+		return false;
 	}
 
 	virtual bool runOnFunction(Function * function) {
@@ -157,11 +359,25 @@ namespace
 			llvm::errs() << "Apron: Function: " << function->getName() << "\n";
 		}
 		// Analyze
-		ValueFactory * factory = ValueFactory::getInstance();
+		function->getSymbolTable().makeCurrent();
+		AnalysisBudget & budget = AnalysisBudget::getInstance();
+		budget.start();
 		auto deleteCreatedLLVMValues = callOnScopeEnd(ValueFactory::deleteCreatedInstances);
 		CallGraph funcCallGraph(function);
 		ChaoticExecution chaoticExecution(funcCallGraph);
+		FixpointProfiler & profiler = FixpointProfiler::getInstance();
+		if (ProfileFixpoint) {
+			profiler.start();
+		}
 		chaoticExecution.execute();
+		if (ProfileFixpoint) {
+			profiler.write(function->getName());
+		}
+		if (budget.isDegraded()) {
+			llvm::errs() << "Warning: " << function->getName() <<
+					": Result is degraded (" << budget.getDegradedReason() <<
+					") after " << budget.getElapsedSeconds() << "s\n";
+		}
 		// Print
 		if (Debug) {
 			chaoticExecution.print();
@@ -179,30 +395,63 @@ namespace
 			ApronAbstractState successState = function->getSuccessState();
 			llvm::errs() << "Success state: " << &successState << "\n";
 		}
+		FunctionResult result;
+		result.function = function->getName();
+		result.domain = apron_manager->library;
+		result.isDegraded = budget.isDegraded();
+		result.degradedReason = budget.getDegradedReason();
+		result.analysisSeconds = budget.getElapsedSeconds();
+		result.blockUpdates = chaoticExecution.getUpdateCount();
+		result.joins = chaoticExecution.getJoinCount();
+		result.widenings = chaoticExecution.getWidenCount();
+		writeResults(function, result);
+		result.totalSeconds = budget.getElapsedSeconds();
+		ResultsStore::getInstance().append(result);
+		return false;
+	}
+
+	static std::string intervalString(ap_interval_t * interval) {
+		std::string result;
+		if (!ap_interval_is_top(interval)) {
+			llvm::raw_string_ostream builder(result);
+			builder << *interval;
+		}
+		ap_interval_free(interval);
+		return result;
+	}
+
+	void writeResults(Function * function, FunctionResult & result) {
+		ValueFactory * factory = ValueFactory::getInstance();
 		llvm::ReturnInst * returnInst = function->getReturnInstruction();
 		if (!returnInst) {
-			return false;
+			return;
+		}
+		BasicBlock * last = function->getReturnBasicBlock();
+		for (const std::string & userPointer : function->getUserPointers()) {
+			BufferResult buffer;
+			buffer.name = userPointer;
+			buffer.lastRead = intervalString(last->getVariableInterval(
+					AbstractState::generateLastName(userPointer,
+							user_pointer_operation_read)));
+			buffer.lastWrite = intervalString(last->getVariableInterval(
+					AbstractState::generateLastName(userPointer,
+							user_pointer_operation_write)));
+			buffer.size = intervalString(last->getVariableInterval(
+					AbstractState::generateSizeName(userPointer)));
+			result.buffers.push_back(buffer);
 		}
 		// get temporary
 		llvm::Value * llvmValue = returnInst->getReturnValue();
 		if (!llvmValue) {
-			return false;
+			return;
 		}
 		Value * val = factory->getValue(llvmValue);
 		if (!val) {
-			return false;
+			return;
 		}
 		// get temporary's abstract value
-		llvm::BasicBlock * llvmlast = returnInst->getParent();
-		BasicBlock * last = BasicBlockManager::getInstance().getBasicBlock(
-				llvmlast);
 		ap_interval_t * interval = last->getVariableInterval(val);
-		/*********************************************/
-		/* OREN ISH SHALOM: Print the way I like it! */
-		/*********************************************/
-		std::string abs_path_filename;
-		llvm::raw_string_ostream abs_path_filename_builder(abs_path_filename);
-		abs_path_filename_builder << "/tmp/llvm_apron_pass/" << function->getName() << ".txt";
+		ResultsStore & store = ResultsStore::getInstance();
 
 		/*********************************************************/
 		/* OREN ISH SHALOM: Write in the human readable format:  */
@@ -212,21 +461,32 @@ namespace
 		/* MY_FUNCTION_NAME = [17 +00]                           */
 		/*                                                       */
 		/*********************************************************/
-		std::string EC;
-		llvm::raw_fd_ostream fl(abs_path_filename_builder.str().c_str(), EC);
+		std::string intervalText;
+		llvm::raw_string_ostream fl(intervalText);
 		fl << function->getName() << " = [ " << *interval->inf << " " << *interval->sup << " ]\n";
-		fl.close();
-
-		std::string contract_path_filename;
-		llvm::raw_string_ostream contract_path_filename_builder(contract_path_filename);
-		contract_path_filename_builder << "/tmp/llvm_apron_pass/" << function->getName() << ".contract.c";
-		llvm::raw_fd_ostream fl2(contract_path_filename_builder.str().c_str(), EC);
-		fl2 << contract(function);
-		fl2.close();
-		return false;
+		store.writeFile(function->getName() + ".txt", fl.str());
+
+		result.hasReturnInterval = true;
+		llvm::raw_string_ostream inf(result.returnInf);
+		inf << *interval->inf;
+		inf.flush();
+		llvm::raw_string_ostream sup(result.returnSup);
+		sup << *interval->sup;
+		sup.flush();
+		ap_interval_free(interval);
+
+		std::string contractText;
+		llvm::raw_string_ostream fl2(contractText);
+		printContract(fl2, function, &result.contract);
+		result.hasContract = true;
+		store.writeFile(function->getName() + ".contract.c", fl2.str());
 	}
 
 	virtual bool runOnModule(llvm::Module & module) {
+		AnalysisBudget::configureManager(apron_manager);
+		if (!ClosureRoot.empty()) {
+			return runOnClosure(module, ClosureRoot);
+		}
 		if (!SingleFunction.empty()) {
 			llvm::GlobalValue * gv = module.getNamedValue(SingleFunction);
 			if (!gv) {
@@ -0,0 +1,319 @@
+/*
+ * Microbenchmarks of the abstract state wrappers.
+ *
+ * Every operation is run on generated states of a controlled size (number
+ * of variables, constraints and user buffers) and reported as ns/op,
+ * allocations/op and allocated bytes/op. The ap_* rows run the bare apron
+ * operation on the same inputs, so the difference to the wrapper row is the
+ * wrapper's overhead (copies, environment changes, change detection).
+ *
+ * Built once per adaptor (see bench/Makefile). Output is tab separated, one
+ * row per operation, with a header line unless -no-header is given.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <ap_abstract1.h>
+#include <ap_global1.h>
+
+#include <AbstractState.h>
+#include <Budget.h>
+#include <SymbolTable.h>
+
+static llvm::cl::opt<unsigned> Vars("vars",
+		llvm::cl::init(16),
+		llvm::cl::desc("Number of variables in the generated states. (16)"));
+
+static llvm::cl::opt<unsigned> Constraints("constraints",
+		llvm::cl::init(16),
+		llvm::cl::desc("Number of constraints in the generated states. (16)"));
+
+static llvm::cl::opt<unsigned> Buffers("buffers",
+		llvm::cl::init(2),
+		llvm::cl::desc("Number of user buffers in the generated states. (2)"));
+
+static llvm::cl::opt<unsigned> JoinArity("join-arity",
+		llvm::cl::init(4),
+		llvm::cl::desc("Number of states joined at once by join(vector). (4)"));
+
+static llvm::cl::opt<unsigned> MinIterations("iterations",
+		llvm::cl::init(10),
+		llvm::cl::desc("Minimum number of runs of each operation. (10)"));
+
+static llvm::cl::opt<unsigned> MinTime("min-time",
+		llvm::cl::init(200),
+		llvm::cl::desc("Minimum time (ms) to run each operation for. (200)"));
+
+static llvm::cl::opt<unsigned> Seed("seed",
+		llvm::cl::init(1),
+		llvm::cl::desc("Seed of the state generator. (1)"));
+
+static llvm::cl::opt<bool> NoHeader("no-header",
+		llvm::cl::desc("Do not print the header line"));
+
+/*
+ * Allocation counting. The executable's malloc interposes the one in libc
+ * for apron and libstdc++ as well. glibc only.
+ */
+extern "C" {
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t nmemb, size_t size);
+void * __libc_realloc(void * ptr, size_t size);
+void __libc_free(void * ptr);
+}
+
+static bool isCounting = false;
+static unsigned long allocationCount = 0;
+static unsigned long allocationBytes = 0;
+
+extern "C" void * malloc(size_t size) {
+	if (isCounting) {
+		++allocationCount;
+		allocationBytes += size;
+	}
+	return __libc_malloc(size);
+}
+
+extern "C" void * calloc(size_t nmemb, size_t size) {
+	if (isCounting) {
+		++allocationCount;
+		allocationBytes += nmemb * size;
+	}
+	return __libc_calloc(nmemb, size);
+}
+
+extern "C" void * realloc(void * ptr, size_t size) {
+	if (isCounting) {
+		++allocationCount;
+		allocationBytes += size;
+	}
+	return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void * ptr) {
+	__libc_free(ptr);
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Run op until both -iterations and -min-time are reached. setUp and
+ * tearDown run around every op, and are neither timed nor counted.
+ */
+template <class SetUp, class Op, class TearDown>
+static void measure(const char * name, SetUp setUp, Op op, TearDown tearDown) {
+	double elapsed = 0;
+	unsigned long allocations = 0;
+	unsigned long bytes = 0;
+	unsigned iterations = 0;
+	while ((iterations < MinIterations) || (elapsed < MinTime * 1e6)) {
+		setUp();
+		allocationCount = 0;
+		allocationBytes = 0;
+		isCounting = true;
+		double start = now();
+		op();
+		elapsed += now() - start;
+		isCounting = false;
+		allocations += allocationCount;
+		bytes += allocationBytes;
+		tearDown();
+		++iterations;
+	}
+	llvm::outs() << apron_manager->library << "\t" << name << "\t" <<
+			Vars << "\t" << Constraints << "\t" << Buffers << "\t" <<
+			iterations << "\t" << (unsigned long)(elapsed / iterations) << "\t" <<
+			allocations / iterations << "\t" << bytes / iterations << "\n";
+}
+
+template <class Op>
+static void measure(const char * name, Op op) {
+	measure(name, []{}, op, []{});
+}
+
+template <class Op, class TearDown>
+static void measure(const char * name, Op op, TearDown tearDown) {
+	measure(name, []{}, op, tearDown);
+}
+
+static const std::string & varName(unsigned idx) {
+	char name[16];
+	snprintf(name, sizeof(name), "v%u", idx);
+	return SymbolTable::getCurrent().getName(
+			SymbolTable::getCurrent().intern(name));
+}
+
+static const std::string & bufferName(unsigned idx) {
+	char name[16];
+	snprintf(name, sizeof(name), "buf%u", idx);
+	return SymbolTable::getCurrent().getName(
+			SymbolTable::getCurrent().intern(name));
+}
+
+static const std::string & pointerName(unsigned idx) {
+	char name[16];
+	snprintf(name, sizeof(name), "p%u", idx);
+	return SymbolTable::getCurrent().getName(
+			SymbolTable::getCurrent().intern(name));
+}
+
+// c - (+-vi +-vj) >= 0, i.e. octagonal constraints
+static ap_tcons1_t makeConstraint(ApronAbstractState & state) {
+	unsigned i = rand() % Vars;
+	unsigned j = rand() % Vars;
+	ap_texpr1_t * sum = ap_texpr1_binop(AP_TEXPR_MUL,
+			state.asTexpr((int64_t)((rand() % 2) ? 1 : -1)),
+			state.asTexpr(varName(i)), AP_RTYPE_INT, AP_RDIR_ZERO);
+	if (i != j) {
+		ap_texpr1_t * term = ap_texpr1_binop(AP_TEXPR_MUL,
+				state.asTexpr((int64_t)((rand() % 2) ? 1 : -1)),
+				state.asTexpr(varName(j)), AP_RTYPE_INT, AP_RDIR_ZERO);
+		sum = ap_texpr1_binop(AP_TEXPR_ADD, sum, term,
+				AP_RTYPE_INT, AP_RDIR_ZERO);
+	}
+	ap_texpr1_t * expr = ap_texpr1_binop(AP_TEXPR_SUB,
+			state.asTexpr((int64_t)(rand() % 100)), sum,
+			AP_RTYPE_INT, AP_RDIR_ZERO);
+	return ap_tcons1_make(AP_CONS_SUPEQ, expr, ApronAbstractState::zero());
+}
+
+// All generated states share the environment: v0..vN, in this order
+static ApronAbstractState makeApronState() {
+	ApronAbstractState state = ApronAbstractState::top();
+	for (unsigned idx = 0; idx < Vars; idx++) {
+		state.extend(varName(idx));
+	}
+	state.start_meet_aggregate();
+	for (unsigned idx = 0; idx < Constraints; idx++) {
+		ap_tcons1_t cons = makeConstraint(state);
+		state.meet(cons);
+	}
+	state.finish_meet_aggregate();
+	return state;
+}
+
+// Buffers buf0..bufN, and pointers p0..pN. pI may point to bufI and bufI+1.
+static AbstractState makeState(const std::vector<std::string> & userBuffers) {
+	AbstractState state(userBuffers);
+	state.m_apronAbstractState.meet(makeApronState());
+	for (unsigned idx = 0; idx < Buffers; idx++) {
+		MPTItemAbstractState & pt = state.m_mayPointsTo.extend(pointerName(idx));
+		pt.insert(userBuffers[idx]);
+		state.m_apronAbstractState.extend(AbstractState::generateOffsetName(
+				pointerName(idx), userBuffers[idx]));
+		if (idx + 1 < Buffers) {
+			pt.insert(userBuffers[idx + 1]);
+			state.m_apronAbstractState.extend(AbstractState::generateOffsetName(
+					pointerName(idx), userBuffers[idx + 1]));
+		}
+	}
+	return state;
+}
+
+int main(int argc, char ** argv) {
+	llvm::cl::ParseCommandLineOptions(argc, argv,
+			"Microbenchmarks of the abstract state wrappers\n");
+	if (Vars == 0) {
+		llvm::errs() << "Error: -vars must be positive\n";
+		return 1;
+	}
+	srand(Seed);
+	AnalysisBudget::configureManager(apron_manager);
+	AnalysisBudget::getInstance().start();
+	ap_manager_t * manager = apron_manager;
+
+	if (!NoHeader) {
+		llvm::outs() << "domain\top\tvars\tconstraints\tbuffers\t"
+				"iterations\tns/op\tallocs/op\tbytes/op\n";
+	}
+
+	ApronAbstractState a = makeApronState();
+	ApronAbstractState b = makeApronState();
+	std::vector<ApronAbstractState> others;
+	for (unsigned idx = 0; idx < JoinArity; idx++) {
+		others.push_back(makeApronState());
+	}
+	const std::string & fresh = SymbolTable::getCurrent().getName(
+			SymbolTable::getCurrent().intern("fresh"));
+	const std::string & renamed = SymbolTable::getCurrent().getName(
+			SymbolTable::getCurrent().intern("renamed"));
+	ApronAbstractState * work = 0;
+	auto copyA = [&]{ work = new ApronAbstractState(a); };
+	auto release = [&]{ delete work; work = 0; };
+	ap_abstract1_t result;
+	auto clearResult = [&]{ ap_abstract1_clear(manager, &result); };
+
+	// Bare apron, for reference
+	measure("ap_copy", [&]{ result = ap_abstract1_copy(manager, &a.m_abstract1); },
+			clearResult);
+	measure("ap_join", [&]{
+		result = ap_abstract1_join(manager, false, &a.m_abstract1, &b.m_abstract1);
+	}, clearResult);
+	measure("ap_meet", [&]{
+		result = ap_abstract1_meet(manager, false, &a.m_abstract1, &b.m_abstract1);
+	}, clearResult);
+	ap_abstract1_t ab = ap_abstract1_join(manager, false, &a.m_abstract1, &b.m_abstract1);
+	// Owns ab
+	ApronAbstractState abState(ab);
+	measure("ap_widening", [&]{
+		result = ap_abstract1_widening(manager, &a.m_abstract1, &ab);
+	}, clearResult);
+	measure("ap_is_eq", [&]{ ap_abstract1_is_eq(manager, &a.m_abstract1, &b.m_abstract1); });
+	measure("ap_is_leq", [&]{ ap_abstract1_is_leq(manager, &a.m_abstract1, &b.m_abstract1); });
+
+	// Wrappers
+	measure("copy", copyA, []{}, release);
+	measure("join", copyA, [&]{ work->join(b); }, release);
+	measure("join(vector)", copyA, [&]{ work->join(others); }, release);
+	measure("widen", copyA, [&]{ work->widen(abState); }, release);
+	measure("meet", copyA, [&]{ work->meet(b); }, release);
+	ap_texpr1_t * value = 0;
+	measure("assign", [&]{
+		copyA();
+		value = ap_texpr1_binop(AP_TEXPR_ADD, work->asTexpr(varName(0)),
+				work->asTexpr((int64_t)1), AP_RTYPE_INT, AP_RDIR_ZERO);
+	}, [&]{ work->assign(varName(Vars - 1), value); }, [&]{
+		ap_texpr1_free(value);
+		release();
+	});
+	measure("extend", copyA, [&]{ work->extend(fresh); }, release);
+	measure("forget", copyA, [&]{ work->forget(varName(0)); }, release);
+	measure("rename", copyA, [&]{ work->rename(varName(0), renamed); }, release);
+	measure("operator==", [&]{ (void)(a == b); });
+	measure("operator<=", [&]{ (void)(a <= b); });
+
+	std::vector<std::string> userBuffers;
+	for (unsigned idx = 0; idx < Buffers; idx++) {
+		userBuffers.push_back(bufferName(idx));
+	}
+	if (!userBuffers.empty()) {
+		AbstractState state = makeState(userBuffers);
+		AbstractState * workState = 0;
+		auto copyState = [&]{ workState = new AbstractState(state); };
+		auto releaseState = [&]{ delete workState; workState = 0; };
+		measure("reduce", copyState, [&]{ workState->reduce(userBuffers); },
+				releaseState);
+		MemoryAccessAbstractValue * maav = 0;
+		measure("updateByMemoryOperation", [&]{
+			copyState();
+			maav = new MemoryAccessAbstractValue("", pointerName(0),
+					userBuffers[0],
+					workState->m_apronAbstractState.asTexpr(varName(0)),
+					user_pointer_operation_read);
+		}, [&]{ workState->updateByMemoryOperation(*maav); }, [&]{
+			delete maav;
+			releaseState();
+		});
+	}
+	return 0;
+}
@@ -0,0 +1,107 @@
+#!/bin/bash
+#
+# Analyse every <syscall>.bc of a corpus (e.g. ALL_SYSCALLS) with each
+# domain, and compare the analysis time of sys_<syscall> to the first
+# domain's. Each domain writes the results.jsonl of its own output
+# directory, from which analysis_seconds is read.
+#
+# Usage: corpus.sh <corpus directory> <domain>...
+#   e.g. corpus.sh ALL_SYSCALLS box itv64
+# Environment:
+#   APRON_INSTALL  Where the apron domain libraries are. (/usr/local)
+#   OUTPUT_DIR     Where the output directories are made. (/tmp/llvm_apron_pass/corpus)
+#   PASS_ARGS      Further pass options. (-update-count-max=1000)
+#   TIMEOUT        Seconds per syscall and domain. (600)
+
+if [ $# -lt 2 ]; then
+	echo "Usage: $0 <corpus directory> <domain>..." >&2
+	exit 1
+fi
+
+PASS_DIR=$(cd "$(dirname "$0")/.." && pwd)
+CORPUS=$1
+shift
+DOMAINS="$@"
+APRON_INSTALL=${APRON_INSTALL:-/usr/local}
+OUTPUT_DIR=${OUTPUT_DIR:-/tmp/llvm_apron_pass/corpus}
+PASS_ARGS=${PASS_ARGS:--update-count-max=1000}
+TIMEOUT=${TIMEOUT:-600}
+
+# The seconds sys_$2 took in domain $1, or "-" if it did not finish
+analysis_seconds() {
+	grep "\"function\":\"sys_$2\"" "$OUTPUT_DIR/$1/results.jsonl" 2>/dev/null |
+		tail -n 1 |
+		sed -n 's/.*"analysis_seconds":\([-0-9.e]*\).*/\1/p' |
+		grep . || echo -
+}
+
+for domain in $DOMAINS; do
+	# Native domains have no apron library
+	DOMAIN_LOAD=
+	if [ -f "$APRON_INSTALL/lib/lib${domain}_debug.so" ]; then
+		DOMAIN_LOAD="-load $APRON_INSTALL/lib/lib${domain}_debug.so"
+	fi
+	rm -rf "$OUTPUT_DIR/$domain"
+	mkdir -p "$OUTPUT_DIR/$domain"
+	for bc in "$CORPUS"/*.bc; do
+		syscall=$(basename "$bc" .bc)
+		timeout "$TIMEOUT" "$PASS_DIR/tools/apron-driver" \
+			$DOMAIN_LOAD \
+			-load "$APRON_INSTALL/lib/libapron_debug.so" \
+			-load "$PASS_DIR/adaptors/lib${domain}_adaptor.so" \
+			-load "$PASS_DIR/libapronpass.so" \
+			-output-dir="$OUTPUT_DIR/$domain" \
+			-run-on-single-function="sys_$syscall" \
+			$PASS_ARGS "$bc" > "$OUTPUT_DIR/$domain/$syscall.log" 2>&1
+	done
+done
+
+# One row per syscall, then the totals over the syscalls every domain
+# finished
+BASELINE=${DOMAINS%% *}
+printf "syscall"
+for domain in $DOMAINS; do
+	printf "\t%s" "$domain"
+done
+for domain in $DOMAINS; do
+	[ "$domain" = "$BASELINE" ] || printf "\tspeedup(%s)" "$domain"
+done
+printf "\n"
+for bc in "$CORPUS"/*.bc; do
+	syscall=$(basename "$bc" .bc)
+	printf "%s" "$syscall"
+	for domain in $DOMAINS; do
+		printf "\t%s" "$(analysis_seconds "$domain" "$syscall")"
+	done
+	printf "\n"
+done | awk -F'\t' -v domains="$DOMAINS" '
+	BEGIN { count = split(domains, names, " ") }
+	{
+		line = $0
+		finished = 1
+		for (i = 2; i <= count + 1; i++) {
+			if ($i == "-") {
+				finished = 0
+			}
+		}
+		for (i = 3; i <= count + 1; i++) {
+			line = line "\t" ((finished && $i > 0) ? sprintf("%.2f", $2 / $i) : "-")
+		}
+		print line
+		if (finished) {
+			rows++
+			for (i = 2; i <= count + 1; i++) {
+				total[i] += $i
+			}
+		}
+	}
+	END {
+		line = "total(" rows + 0 ")"
+		for (i = 2; i <= count + 1; i++) {
+			line = line "\t" total[i]
+		}
+		for (i = 3; i <= count + 1; i++) {
+			line = line "\t" ((total[i] > 0) ? sprintf("%.2f", total[2] / total[i]) : "-")
+		}
+		print line
+	}'
@@ -0,0 +1,109 @@
+#!/bin/bash
+#
+# Sweep each parameter of synthetic-ir-generator alone, from the
+# generator's defaults, and analyse every generated module with each
+# domain. Writes the wall time and the maximum resident memory of every
+# run to $OUTPUT_DIR/sweep.tsv, and, if gnuplot is installed, plots both
+# against each parameter to $OUTPUT_DIR/<parameter>.png, one line per
+# domain. A curve that bends up is super-linear in that parameter.
+#
+# Usage: sweep.sh <domain>...
+#   e.g. sweep.sh box itv64 oct64
+# Environment:
+#   APRON_INSTALL   Where the apron domain libraries are. (/usr/local)
+#   OUTPUT_DIR      Where the modules, logs and results go. (/tmp/llvm_apron_pass/sweep)
+#   SWEEP           The parameters and their values, as <parameter>=<value>,...
+#   GENERATOR_ARGS  Further generator options, the base of every sweep.
+#   PASS_ARGS       Further pass options. (-update-count-max=1000)
+#   TIMEOUT         Seconds per module and domain. (600)
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 <domain>..." >&2
+	exit 1
+fi
+
+PASS_DIR=$(cd "$(dirname "$0")/.." && pwd)
+DOMAINS="$@"
+APRON_INSTALL=${APRON_INSTALL:-/usr/local}
+OUTPUT_DIR=${OUTPUT_DIR:-/tmp/llvm_apron_pass/sweep}
+SWEEP=${SWEEP:-"blocks=4,8,16,32,64,128 loop-depth=0,1,2,3,4 user-buffers=1,2,4,8,16 gep-chain=1,2,4,8,16 user-calls=0,2,4,8,16,32 select-density=0,0.5,1,2,4 switch-width=0,4,16,64"}
+GENERATOR_ARGS=${GENERATOR_ARGS:-}
+PASS_ARGS=${PASS_ARGS:--update-count-max=1000}
+TIMEOUT=${TIMEOUT:-600}
+
+rm -rf "$OUTPUT_DIR"
+mkdir -p "$OUTPUT_DIR/modules" "$OUTPUT_DIR/logs" "$OUTPUT_DIR/data"
+RESULTS="$OUTPUT_DIR/sweep.tsv"
+printf "parameter\tvalue\tdomain\tseconds\tmax_rss_kb\tstatus\n" > "$RESULTS"
+
+for sweep in $SWEEP; do
+	parameter=${sweep%%=*}
+	for value in $(echo "${sweep#*=}" | tr , ' '); do
+		module="$OUTPUT_DIR/modules/$parameter-$value.bc"
+		if ! "$PASS_DIR/tools/synthetic-ir-generator" $GENERATOR_ARGS \
+				-$parameter=$value -o "$module"; then
+			echo "$parameter=$value: cannot generate" >&2
+			continue
+		fi
+		for domain in $DOMAINS; do
+			# Native domains have no apron library
+			DOMAIN_LOAD=
+			if [ -f "$APRON_INSTALL/lib/lib${domain}_debug.so" ]; then
+				DOMAIN_LOAD="-load $APRON_INSTALL/lib/lib${domain}_debug.so"
+			fi
+			log="$OUTPUT_DIR/logs/$parameter-$value.$domain"
+			/usr/bin/time -f "%e %M" -o "$log.time" \
+				timeout "$TIMEOUT" "$PASS_DIR/tools/apron-driver" \
+				$DOMAIN_LOAD \
+				-load "$APRON_INSTALL/lib/libapron_debug.so" \
+				-load "$PASS_DIR/adaptors/lib${domain}_adaptor.so" \
+				-load "$PASS_DIR/libapronpass.so" \
+				-output-dir="$OUTPUT_DIR/logs" \
+				-run-on-single-function=sys_synthetic \
+				$PASS_ARGS "$module" > "$log.log" 2>&1
+			case $? in
+				0) status=ok ;;
+				124) status=timeout ;;
+				*) status=failed ;;
+			esac
+			read seconds rss < <(tail -n 1 "$log.time")
+			printf "%s\t%s\t%s\t%s\t%s\t%s\n" "$parameter" "$value" \
+				"$domain" "$seconds" "$rss" "$status" >> "$RESULTS"
+			if [ $status = ok ]; then
+				printf "%s\t%s\t%s\n" "$value" "$seconds" "$rss" \
+					>> "$OUTPUT_DIR/data/$parameter.$domain"
+			fi
+		done
+	done
+done
+
+cat "$RESULTS"
+
+if ! command -v gnuplot > /dev/null; then
+	echo "gnuplot not found: not plotting" >&2
+	exit 0
+fi
+for sweep in $SWEEP; do
+	parameter=${sweep%%=*}
+	time_plots=
+	rss_plots=
+	for domain in $DOMAINS; do
+		data="$OUTPUT_DIR/data/$parameter.$domain"
+		[ -f "$data" ] || continue
+		time_plots="$time_plots${time_plots:+, }'$data' using 1:2 with linespoints title '$domain'"
+		rss_plots="$rss_plots${rss_plots:+, }'$data' using 1:(\$3/1024) with linespoints title '$domain'"
+	done
+	[ -n "$time_plots" ] || continue
+	gnuplot <<-EOF
+		set terminal png size 1200,500
+		set output '$OUTPUT_DIR/$parameter.png'
+		set multiplot layout 1,2 title '$parameter'
+		set xlabel '$parameter'
+		set key top left
+		set ylabel 'seconds'
+		plot $time_plots
+		set ylabel 'max RSS (MB)'
+		plot $rss_plots
+		unset multiplot
+	EOF
+done
@@ -11,6 +11,7 @@
 #include <AbstractStates/ApronAbstractState.h>
 #include <AbstractStates/MPTAbstractState.h>
 #include <APStream.h>
+#include <SymbolTable.h>
 
 typedef enum {
 	user_pointer_operation_read,
@@ -88,6 +89,16 @@ struct CopyMsghdrFromUserCall {
 	}
 };
 
+// dest = src, for pointers. buffers is what src may point to, or NULL if top.
+struct PointerAssignment {
+	std::string dest;
+	std::string src;
+	const MPTItemAbstractState * buffers;
+	PointerAssignment(const std::string & dest, const std::string & src,
+			const MPTItemAbstractState * buffers) :
+			dest(dest), src(src), buffers(buffers) {}
+};
+
 /**
  * An abstract state of a basic block. Contains:
  * May alias information
@@ -117,7 +128,7 @@ protected:
 	/*************************************************/
 public:
 	AbstractState();
-	AbstractState(std::vector<std::string> & userPointers);
+	AbstractState(const std::vector<std::string> & userPointers);
 
 	// May points to analysis
 	MPTAbstractState m_mayPointsTo;
@@ -127,12 +138,22 @@ public:
 	std::vector<MemoryAccessAbstractValue> memoryAccessAbstractValues;
 	memory_operation_state_e m_mos = memory_operation_state_bottom;
 	bool m_isHasMemoryOperation = false;
+	// With -lazy-offsets, the pointers whose offsets are kept only as
+	// offset(pointer,base), by pointer. offset(pointer,buffer) is then
+	// offset(pointer,base) + offset(base,buffer). A base is never in the map.
+	std::map<SymbolId, SymbolId> m_offsetBases;
 	static const std::string & generateOffsetName(
 			const std::string & valueName, const std::string & bufname);
 	static const std::string & generateLastName(
 			const std::string & bufname, user_pointer_operation_e op);
 	static const std::string & generateSizeName(
 			const std::string & bufname);
+	// The same, by id, without interning the names again
+	static const std::string & generateOffsetName(SymbolId pointer,
+			SymbolId buffer);
+	static const std::string & generateLastName(SymbolId buffer,
+			user_pointer_operation_e op);
+	static const std::string & generateSizeName(SymbolId buffer);
 
 	std::vector<ImportIovecCall> m_importedIovecCalls;
 	std::vector<CopyMsghdrFromUserCall> m_copyMsghdrFromUserCalls;
@@ -142,10 +163,21 @@ public:
 	// General commands
 	virtual bool join(AbstractState &);
 	bool joinMemoryOperationState(const memory_operation_state_e & other);
-	virtual bool widen(AbstractState &);
+	virtual bool widen(AbstractState &,
+			const std::vector<int64_t> & thresholds = std::vector<int64_t>());
 	virtual bool meet(AbstractState &);
-	virtual bool reduce(std::vector<std::string> & userBuffers);
-	virtual void assignPtrToPtr(const std::string & dest, const std::string & src);
+	virtual bool reduce(const std::vector<std::string> & userBuffers);
+	// dest = src + delta. Takes delta, which may be NULL for 0.
+	virtual void assignPtrToPtr(const std::string & dest, const std::string & src,
+			ap_texpr1_t * delta = NULL);
+	// The same, with delta 0, for all assignments in parallel, e.g. PHIs
+	virtual void assignPtrsToPtrs(
+			const std::vector<PointerAssignment> & assignments);
+	// Create offset(pointer,buffer) for every buffer pointer may point to
+	virtual void materializeOffsets(const std::string & pointer);
+	// Likewise, for every pointer whose offsets are relative to base
+	virtual void materializeDerivedOffsets(SymbolId base);
+	virtual bool unifyOffsetBases(AbstractState & other);
 	virtual void updateByMemoryOperation(MemoryAccessAbstractValue & maav);
 	// TODO(oanson) The following functions are missing
 	//virtual bool meet(AbstractState &);
@@ -154,6 +186,9 @@ public:
 	//virtual bool isBottom();
 	virtual bool operator==(const AbstractState &) const;
 	virtual bool operator!=(const AbstractState &) const;
+	// Fingerprint and exact comparison of everything a transfer reads
+	virtual size_t hash() const;
+	virtual bool isIdentical(const AbstractState &) const;
 
 	virtual void makeTop();
 	virtual void makeBottom();
@@ -162,9 +197,13 @@ public:
 template <class stream>
 inline stream & operator<<(stream & s, AbstractState & as) {
 	s << "{'mpt':{";
-	for (auto & mpt : as.m_mayPointsTo.m_mayPointsTo) {
-		s << "'" << mpt.first << "':[";
-		for (auto & userPtr : mpt.second) {
+	for (unsigned idx = 0; idx < as.m_mayPointsTo.size(); idx++) {
+		const MPTItemAbstractState * mpt = as.m_mayPointsTo.find(idx);
+		if (!mpt) {
+			continue;
+		}
+		s << "'" << as.m_mayPointsTo.getPointerName(idx) << "':[";
+		for (auto & userPtr : *mpt) {
 			s << "'" << userPtr << "',";
 		}
 		s << "],";
@@ -14,8 +14,19 @@ protected:
 	ApronAbstractState();
 	bool m_isMeetAggregate = false;
 	std::vector<ap_tcons1_t> m_meetAggregates;
+	bool m_isAssignAggregate = false;
+	std::vector<std::string> m_assignAggregateVars;
+	std::vector<ap_texpr1_t *> m_assignAggregateValues;
 	int joinCount = 0;
 
+	virtual bool isAssignAggregateDependent(const std::string & var,
+			ap_texpr1_t * value) const;
+	virtual void flush_assign_aggregate();
+	// Applies the pending meets, before anything they don't commute with
+	virtual void flush_meet_aggregate();
+	// Drops the pending assignments and meets, e.g. for a new value
+	virtual void clear_aggregates();
+
 public:
 // XXX(oanson) The functions in this public block should be made protected once possible
 	virtual ap_environment_t * getEnvironment() const;
@@ -39,8 +50,14 @@ public:
 	virtual bool join(const ApronAbstractState & other);
 	virtual bool join(const std::vector<ApronAbstractState> & others);
 	virtual bool widen(const ApronAbstractState & other);
+	// Keeps x <= c and x >= c, for every variable x and threshold c, where
+	// other satisfies them
+	virtual bool widen(const ApronAbstractState & other,
+			const std::vector<int64_t> & thresholds);
 	virtual bool meet(const ApronAbstractState & other);
 	virtual void assign(const std::string & var, ap_texpr1_t * value);
+	virtual void assign(const std::vector<std::string> & vars,
+			const std::vector<ap_texpr1_t *> & values);
 	virtual void extend(const std::string & var, bool isBottom=false);
 	virtual void forget(const std::string & var, bool isBottom=false);
 	virtual void minimize(const std::string & var);
@@ -49,6 +66,8 @@ public:
 	virtual void start_meet_aggregate();
 	virtual void meet(ap_tcons1_t & cons);
 	virtual void finish_meet_aggregate();
+	virtual void start_assign_aggregate();
+	virtual void finish_assign_aggregate();
 	virtual void makeTop();
 	virtual void makeBottom();
 	virtual void rename(const std::string & orig, const std::string & new_);
@@ -68,6 +87,8 @@ public:
 	virtual ap_texpr1_t * asTexpr(int64_t value);
 	virtual ap_texpr1_t * asTexpr(double value);
 	virtual bool isConstrained(const std::string & var) const;
+	// Equal states of the same representation have equal hashes
+	virtual size_t hash() const;
 
 	class Variables {
 		ap_environment_t * env;
@@ -1,29 +1,56 @@
 #ifndef MPT_ABSTRACT_STATE_H
 #define MPT_ABSTRACT_STATE_H
 
-#include <map>
-#include <set>
+#include <bitset>
 #include <string>
 #include <vector>
 
+// Buffer indices are allocated per function by the SymbolTable. The first
+// three are fixed.
+#define MPT_MAX_BUFFERS 64
+#define MPT_BUFFER_NULL 0
+#define MPT_BUFFER_KERNEL 1
+#define MPT_BUFFER_USER 2
+
+typedef std::bitset<MPT_MAX_BUFFERS> MPTBufferSet;
+
 class MPTItemAbstractState {
-	std::set<std::string> m_buffers;
+	MPTBufferSet m_buffers;
 	bool m_isWritable;
 public:
+	// Iterates the names of the buffers in the set
+	class const_iterator {
+		const MPTBufferSet * m_buffers;
+		unsigned m_index;
+		void skip();
+	public:
+		const_iterator(const MPTBufferSet * buffers, unsigned index);
+		const std::string & operator*() const;
+		unsigned index() const { return m_index; }
+		const_iterator & operator++();
+		bool operator!=(const const_iterator & other) const {
+			return m_index != other.m_index;
+		}
+	};
+
 	MPTItemAbstractState();
-	MPTItemAbstractState(const std::set<std::string> & buffers, bool isWritable=true);
-	const std::set<std::string> & getBuffers() const;
-	void insert(std::string buffer);
-	void erase(std::string buffer);
+	explicit MPTItemAbstractState(unsigned buffer, bool isWritable=true);
+	MPTItemAbstractState(const MPTBufferSet & buffers, bool isWritable=true);
+	const MPTBufferSet & getBuffers() const;
+	void insert(unsigned buffer);
+	void insert(const std::string & buffer);
+	void erase(unsigned buffer);
+	void erase(const std::string & buffer);
 	void clear();
-	std::set<std::string>::const_iterator begin() const;
-	std::set<std::string>::const_iterator end() const;
+	const_iterator begin() const;
+	const_iterator end() const;
 	bool join(const MPTItemAbstractState & other);
 	bool meet(const MPTItemAbstractState & other);
 	bool isProvablyNull() const;
 	bool isProvablyKernel() const;
 	bool empty() const;
 	bool isWritable() const;
+	bool contains(unsigned buffer) const;
 	bool contains(const std::string & name) const;
 	bool operator==(const MPTItemAbstractState & other) const;
 	bool operator!=(const MPTItemAbstractState & other) const;
@@ -76,9 +103,12 @@ public:
 	/*                                                                 */
 	/*******************************************************************/
 class MPTAbstractState {
+protected:
+	// Indexed by the pointer index of the SymbolTable. A pointer that is
+	// not present is top.
+	std::vector<MPTItemAbstractState> m_items;
+	std::vector<bool> m_isPresent;
 public:
-	std::map<std::string, MPTItemAbstractState > m_mayPointsTo;
-
 	MPTAbstractState();
 	MPTAbstractState(std::vector<std::string> buffers);
 
@@ -87,7 +117,13 @@ public:
 	void forget(const std::string & pointer);
 	void clear();
 
+	unsigned size() const;
+	const std::string & getPointerName(unsigned index) const;
+	MPTItemAbstractState * find(unsigned index);
+	const MPTItemAbstractState * find(unsigned index) const;
 	MPTItemAbstractState * find(const std::string& name);
+	MPTItemAbstractState * findSymbol(unsigned symbolId);
+	// May move the items. Pointers returned by find are invalidated.
 	MPTItemAbstractState & extend(const std::string& name);
 
 	bool operator==(const MPTAbstractState& other) const;
@@ -0,0 +1,21 @@
+#ifndef AP_PROFILE_H
+#define AP_PROFILE_H
+
+/* Profiling of the apron primitives. If the environment variable
+ * APRON_PROFILE is set, ap_profile_wrap replaces the manager's function
+ * table entries of the operations the pass uses with wrappers recording
+ * per operation:
+ *  - A log2 histogram of the latency
+ *  - The input dimensions (intdim + realdim)
+ *  - The bytes and count of GMP allocations
+ * The report is written at exit to the file named by APRON_PROFILE, or to
+ * stderr if it is "1" or "stderr". Each adaptor's create_manager() calls
+ * ap_profile_wrap. Otherwise, nothing is changed. */
+#include <stdio.h>
+
+#include <ap_manager.h>
+
+void ap_profile_wrap(ap_manager_t * manager);
+void ap_profile_report(FILE * stream);
+
+#endif /* AP_PROFILE_H */
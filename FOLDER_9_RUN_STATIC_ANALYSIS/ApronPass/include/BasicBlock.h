@@ -12,6 +12,7 @@
 #include <ap_texpr1.h>
 
 #include <AbstractState.h>
+#include <TransferCache.h>
 
 class Value;
 
@@ -19,6 +20,14 @@ class BasicBlock;
 
 class Function;
 
+typedef enum {
+	// Keep the state of every block
+	state_storage_all,
+	// Keep states only at cut points (see BasicBlock::isCutPoint) and at
+	// queried blocks. Others are replayed from their predecessor.
+	state_storage_cutpoints
+} state_storage_e;
+
 class BasicBlockManager {
 protected:
 	static BasicBlockManager instance;
@@ -28,6 +37,17 @@ protected:
 public:
 	static BasicBlockManager & getInstance();
 	BasicBlock * getBasicBlock(llvm::BasicBlock * basicBlock);
+	// Delete the blocks of the function, before its body is released
+	void releaseFunction(llvm::Function * function);
+};
+
+struct BlockTransferResult {
+	AbstractState state;
+	// The projected state joined into the function's success state, if any
+	bool isHasMemOpsState;
+	ApronAbstractState memOpsState;
+	BlockTransferResult() : isHasMemOpsState(false),
+			memOpsState(ApronAbstractState::bottom()) {}
 };
 
 class BasicBlock {
@@ -38,15 +58,29 @@ protected:
 	llvm::BasicBlock * m_basicBlock;
 	std::string m_name;
 	AbstractState m_abstractState;
+	// m_abstractState was dropped. See releaseAbstractState
+	bool m_isReleased;
+	memory_operation_state_e m_releasedMos;
+	TransferCache<BlockTransferResult> m_blockCache;
+	std::map<BasicBlock *, TransferCache<AbstractState> > m_edgeCaches;
 
 	BasicBlock(llvm::BasicBlock * basicBlock);
 	virtual void initialiseBlockName();
+	// If memOpsState is given, it is set to the projected memory operation
+	// state, if one was recorded. A replay (see recomputeAbstractState)
+	// neither records it nor profiles.
+	virtual bool transfer(AbstractState & state,
+			ApronAbstractState * memOpsState = 0, bool isReplay = false);
 
 	virtual void processInstruction(AbstractState & state,
-			llvm::Instruction & inst);
+			llvm::Instruction & inst, bool isProfiled = true);
+	// Applies the batched assignments. Profiled as the "flush" kind.
+	virtual void flushAssignments(AbstractState & state, bool isProfiled);
 
 	virtual void updateAbstract1MetWithIncomingPhis(BasicBlock & basicBlock, AbstractState & state);
 	virtual void updateAbstractStateMetWithIncomingPhis(BasicBlock & basicBlock, AbstractState & state);
+	virtual void assignIncomingPhis(BasicBlock & predecessor, AbstractState & state);
+	virtual void recomputeAbstractState();
 public:
 	unsigned updateCount;
 	unsigned joinCount;
@@ -78,6 +112,13 @@ public:
 	virtual void extendTconsEnvironment(ap_tcons1_t * tcons);
 
 	virtual AbstractState & getAbstractState();
+	// The state as stored, for the fixpoint. A released state is bottom.
+	virtual AbstractState & getStoredAbstractState();
+	virtual memory_operation_state_e getMemoryOperationState();
+	// True if the block's state is needed to compute a fixpoint, i.e. it
+	// is the entry, a merge point, or a loop head
+	virtual bool isCutPoint();
+	virtual void releaseAbstractState();
 	virtual Function * getFunction();
 };
 
@@ -0,0 +1,45 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <string>
+#include <time.h>
+
+#include <ap_manager.h>
+
+/**
+ * Resource budget of the analysis of a single function.
+ *
+ * Tracks the wall-clock time and the resident memory growth since the
+ * analysis of the current function started. Once the budget is exhausted
+ * the analysis degrades (e.g. widens on every join) instead of running
+ * away, and the result is flagged as degraded. Apron exceptions which are
+ * not aborting (timeout, out-of-space) also degrade the result: apron
+ * returns a sound over-approximation (usually top) in that case.
+ */
+class AnalysisBudget {
+protected:
+	static AnalysisBudget instance;
+	struct timespec m_start;
+	size_t m_startRSS;
+	size_t m_lastRSS;
+	unsigned m_checkCount;
+	bool m_isDegraded;
+	std::string m_degradedReason;
+
+	AnalysisBudget();
+	static size_t getResidentSetSize();
+public:
+	static AnalysisBudget & getInstance();
+	static void configureManager(ap_manager_t * manager);
+
+	void start();
+	double getElapsedSeconds() const;
+	size_t getMemoryGrowth() const;
+	bool isExhausted();
+	bool checkApronException(ap_manager_t * manager, const char * operation);
+	void degrade(const std::string & reason);
+	bool isDegraded() const;
+	const std::string & getDegradedReason() const;
+};
+
+#endif // BUDGET_H
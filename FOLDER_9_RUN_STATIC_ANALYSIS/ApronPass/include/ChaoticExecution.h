@@ -16,6 +16,9 @@ private:
 	CallGraph & callGraph;
 	std::set<BasicBlock *> seen;
 	std::map<BasicBlock *, int> m_joinCount;
+	unsigned m_updateCount;
+	unsigned m_joinTotal;
+	unsigned m_widenTotal;
 
 	bool isSeen(BasicBlock * block);
 	void see(BasicBlock * block);
@@ -27,6 +30,10 @@ public:
 
 	virtual void execute();
 	virtual void print();
+	// Number of block updates, joins and widenings in execute()
+	unsigned getUpdateCount() const;
+	unsigned getJoinCount() const;
+	unsigned getWidenCount() const;
 };
 
 
@@ -1,8 +1,15 @@
 #ifndef CONTRACT_H
 #define CONTRACT_H
 
+#include <sstream>
+
 #include <AbstractState.h>
+#include <Budget.h>
+#include <ContractSynthesis.h>
 #include <Function.h>
+#include <ResultsStore.h>
+
+extern unsigned ContractJobs;
 
 #define StreamHelper(C, I) \
 template <class T>\
@@ -99,19 +106,15 @@ inline stream & operator<<(stream & s, Havoc<T> h) {
 
 template <class stream>
 inline stream & operator<<(stream & s,
-		Precondition<std::pair<const std::string, ApronAbstractState> > p) {
-	const std::pair<std::string, ApronAbstractState> & pair = *p.t;
+		Precondition<std::pair<const std::string, ap_tcons1_array_t *> > p) {
+	const std::pair<const std::string, ap_tcons1_array_t *> & pair = *p.t;
 	const std::string & name = pair.first;
-	const ApronAbstractState & state = pair.second;
 	// call SE_SAT
-	ap_tcons1_array_t array = ap_abstract1_to_tcons_array(
-			apron_manager, (ap_abstract1_t*)&state.m_abstract1);
-	s << depth << "if(SE_SAT(" << Conjunction(&array) << ")) {\n";
+	s << depth << "if(SE_SAT(" << Conjunction(pair.second) << ")) {\n";
 	++depth;
 	s << depth << "warn(\"Invalid pointer " << name << "\");\n";
 	--depth;
 	s << depth << "}\n";
-	ap_tcons1_array_clear(&array);
 	return s;
 }
 
@@ -199,15 +202,34 @@ inline stream & operator<<(stream & s, Conjunction contract) {
 	return s;
 }
 
+inline std::vector<std::string> constraintStrings(ap_tcons1_array_t * array) {
+	std::vector<std::string> result;
+	size_t size = ap_tcons1_array_size(array);
+	for (size_t idx = 0; idx < size; idx++) {
+		ap_tcons1_t tcons = ap_tcons1_array_get(array, idx);
+		std::ostringstream oss;
+		oss << tcons;
+		result.push_back(oss.str());
+	}
+	return result;
+}
+
+/**
+ * Print the contract of function. If result is given, the contract's
+ * constraints are also stored there.
+ */
 template <class stream>
-inline stream & operator<<(stream & s, Contract<Function> contract) {
-	Function * function = (Function*)contract.t;
+inline stream & printContract(stream & s, Function * function, ContractResult * result) {
 	// Preamble
 	s << "#include \"contracts.h\"\n";
 	s << function->getSignature() << " {\n";
 	++depth;
+	AnalysisBudget & budget = AnalysisBudget::getInstance();
+	if (budget.isDegraded()) {
+		s << depth << "// DEGRADED: " << budget.getDegradedReason() << "\n";
+	}
 	s << depth << "// Preamble\n";
-	std::vector<std::string> userPointers = function->getUserPointers();
+	const std::vector<std::string> & userPointers = function->getUserPointers();
 	std::map<std::string, ApronAbstractState> errorStates = function->getErrorStates();
 	ApronAbstractState successState = function->getSuccessState();
 
@@ -216,7 +238,7 @@ inline stream & operator<<(stream & s, Contract<Function> contract) {
 	const std::vector<ImportIovecCall> & importIovecCalls = function->getImportIovecCalls();
 	const std::vector<CopyMsghdrFromUserCall> & copyMsghdrFromUserCalls =
 			function->getCopyMsghdrFromUserCalls();
-	for (std::string & userPointer : userPointers) {
+	for (const std::string & userPointer : userPointers) {
 		s << preamble(&userPointer);
 	}
 	for (const ImportIovecCall & call : importIovecCalls) {
@@ -225,6 +247,26 @@ inline stream & operator<<(stream & s, Contract<Function> contract) {
 	for (const CopyMsghdrFromUserCall & call : copyMsghdrFromUserCalls) {
 		s << preamble(&call);
 	}
+	// Project all states on the in/out variables at once
+	ContractSynthesis synthesis(function);
+	std::vector<unsigned> errorJobs;
+	for (auto & errorStatePair : errorStates) {
+		errorJobs.push_back(synthesis.add(errorStatePair.second));
+	}
+	unsigned successJob = synthesis.add(successState);
+	unsigned returnJob = synthesis.add(apronAbstractState);
+	synthesis.run(ContractJobs);
+	if (result) {
+		unsigned errorIdx = 0;
+		for (auto & errorStatePair : errorStates) {
+			result->errorStates[errorStatePair.first] = constraintStrings(
+					synthesis.getConstraints(errorJobs[errorIdx++]));
+		}
+		result->successState = constraintStrings(
+				synthesis.getConstraints(successJob));
+		result->returnState = constraintStrings(
+				synthesis.getConstraints(returnJob));
+	}
 	const std::string & returnValueName = function->getReturnValueName();
 	std::string renamedRetValName = apronAbstractState.renameVarForC(returnValueName);
 	s << depth << "bool b;\n";
@@ -251,14 +293,12 @@ inline stream & operator<<(stream & s, Contract<Function> contract) {
 	// Preconditions
 	// Standard variables
 	s << depth << "// Preconditions\n";
-	ap_manager_t * manager = apron_manager;
+	unsigned errorIdx = 0;
 	for (auto & errorStatePair : errorStates) {
 		s << depth << "// Error state for " << errorStatePair.first << ":\n";
-		ApronAbstractState minimizedErrorState =
-				function->minimize(errorStatePair.second);
-		minimizedErrorState.renameVarsForC();
-		std::pair<const std::string, ApronAbstractState> pair = 
-				std::make_pair(errorStatePair.first, minimizedErrorState);
+		std::pair<const std::string, ap_tcons1_array_t *> pair =
+				std::make_pair(errorStatePair.first,
+						synthesis.getConstraints(errorJobs[errorIdx++]));
 		s << precondition(&pair);
 	}
 	for (const ImportIovecCall & call : importIovecCalls) {
@@ -272,16 +312,13 @@ inline stream & operator<<(stream & s, Contract<Function> contract) {
 	// 	For each buf : user buffer
 	// 		HAVOC(buf, last(buf,write))
 	s << depth << "// Modifications\n";
-	ApronAbstractState minimizedSuccessState = function->minimize(successState);
-	auto renames = minimizedSuccessState.renameVarsForC();
-	ap_tcons1_array_t minimized_array = ap_abstract1_to_tcons_array(
-				apron_manager, &minimizedSuccessState.m_abstract1);
-	s << depth << "if " << Conjunction(&minimized_array) << "{\n";
-	ap_tcons1_array_clear(&minimized_array);
+	const std::map<std::string, std::string> & renames =
+			synthesis.getRenames(successJob);
+	s << depth << "if " << Conjunction(synthesis.getConstraints(successJob)) << "{\n";
 	++depth;
-	for (std::string & userPointer : userPointers) {
+	for (const std::string & userPointer : userPointers) {
 		auto it = renames.find(userPointer);
-		std::string * renamedVar = 0;
+		const std::string * renamedVar = 0;
 		if (it == renames.end()) {
 			renamedVar = &userPointer;
 		} else {
@@ -300,17 +337,12 @@ inline stream & operator<<(stream & s, Contract<Function> contract) {
 	s << depth << "}\n";
 	// Postconditions
 	s << "\t// Postconditions\n";
-	ApronAbstractState minimizedReturnState = function->minimize(apronAbstractState);
-	minimizedReturnState.renameVarsForC();
-	ap_abstract1_t retvalAbstract1 = minimizedReturnState.m_abstract1;
-	ap_tcons1_array_t array = ap_abstract1_to_tcons_array(manager, &retvalAbstract1);
 	s << depth << "HAVOC(b);\n";
-	s << depth << "if " << Conjunction("b", &array) << " {\n";
+	s << depth << "if " << Conjunction("b", synthesis.getConstraints(returnJob)) << " {\n";
 	++depth;
 	s << depth << "return " << renamedRetValName << ";\n";
 	--depth;
 	s << depth << "}\n";
-	ap_tcons1_array_clear(&array);
 
 	// Postamble
 	s << depth << "assume(0);\n";
@@ -340,4 +372,9 @@ inline stream & operator<<(stream & s, Contract<Function> contract) {
 	return s;
 }
 
+template <class stream>
+inline stream & operator<<(stream & s, Contract<Function> contract) {
+	return printContract(s, (Function*)contract.t, 0);
+}
+
 #endif // CONTRACT_H
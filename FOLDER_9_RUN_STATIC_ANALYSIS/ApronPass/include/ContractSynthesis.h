@@ -0,0 +1,55 @@
+#ifndef CONTRACT_SYNTHESIS_H
+#define CONTRACT_SYNTHESIS_H
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ap_abstract1.h>
+#include <ap_manager.h>
+#include <ap_tcons1.h>
+
+class ApronAbstractState;
+class Function;
+
+/**
+ * Computes the constraints printed in a contract: each state is projected
+ * on the function's in/out variables (Function::minimize, when added),
+ * renamed for C, and converted to constraints without redundant ones (those
+ * implied by the rest).
+ *
+ * The conversions are independent, and are run on -contract-jobs threads.
+ * Each thread uses its own apron manager, as managers are not thread safe,
+ * and each job its own environment, as their reference counts are not atomic.
+ * The managers are created and freed on the calling thread.
+ */
+class ContractSynthesis {
+protected:
+	struct Job {
+		// Freed by project, with the manager that ran it
+		ap_abstract1_t input;
+		std::map<std::string, std::string> renames;
+		ap_tcons1_array_t constraints;
+		std::map<std::string, std::string> appliedRenames;
+	};
+	Function * m_function;
+	std::vector<Job> m_jobs;
+	bool m_isDone;
+
+	static void project(ap_manager_t * manager, Job & job);
+	static ap_tcons1_array_t removeRedundant(ap_manager_t * manager,
+			ap_tcons1_array_t & array);
+	static void runJobs(std::vector<Job> * jobs,
+			std::atomic<unsigned> * next, ap_manager_t * manager);
+public:
+	ContractSynthesis(Function * function);
+	~ContractSynthesis();
+	unsigned add(ApronAbstractState & state);
+	void run(unsigned threads);
+	ap_tcons1_array_t * getConstraints(unsigned job);
+	// Renames applied to the variables left in the projection
+	const std::map<std::string, std::string> & getRenames(unsigned job);
+};
+
+#endif // CONTRACT_SYNTHESIS_H
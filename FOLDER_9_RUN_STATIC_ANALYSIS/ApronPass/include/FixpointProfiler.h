@@ -0,0 +1,80 @@
+#ifndef FIXPOINT_PROFILER_H
+#define FIXPOINT_PROFILER_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class BasicBlock;
+
+/**
+ * Cost of the fixpoint computation of a single function, enabled with
+ * -profile-fixpoint. Records per block the updates, joins, widenings, the
+ * time spent in them and the environment size after each update, and per
+ * instruction kind (InstructionValue::getKindName) the calls and time.
+ *
+ * write() stores, next to the contract:
+ *   <fn>.trace.json  - Chrome trace (chrome://tracing, Perfetto)
+ *   <fn>.folded      - Folded stacks for flamegraph.pl
+ *   <fn>.profile.txt - Summary tables, most expensive first
+ * Times are in nanoseconds unless stated otherwise.
+ */
+class FixpointProfiler {
+protected:
+	struct BlockProfile {
+		std::string name;
+		unsigned updates;
+		unsigned joins;
+		unsigned widenings;
+		double updateTime;
+		double joinTime;
+		unsigned maxEnvSize;
+		unsigned lastEnvSize;
+		BlockProfile() : updates(0), joins(0), widenings(0), updateTime(0),
+				joinTime(0), maxEnvSize(0), lastEnvSize(0) {}
+	};
+	struct KindProfile {
+		unsigned calls;
+		double time;
+		KindProfile() : calls(0), time(0) {}
+	};
+	struct TraceEvent {
+		// 'X' complete event, or 'C' counter
+		char phase;
+		const char * category;
+		std::string name;
+		double start;
+		double duration;
+		unsigned value;
+	};
+	static FixpointProfiler instance;
+	double m_start;
+	std::map<BasicBlock *, BlockProfile> m_blocks;
+	std::map<std::string, KindProfile> m_kinds;
+	// Self time of instructions, by (block, kind)
+	std::map<std::pair<std::string, std::string>, double> m_folded;
+	std::vector<TraceEvent> m_events;
+
+	FixpointProfiler();
+	BlockProfile & getBlockProfile(BasicBlock * block);
+	void addEvent(char phase, const char * category, const std::string & name,
+			double start, double end, unsigned value = 0);
+	std::string getTrace() const;
+	std::string getFolded(const std::string & function) const;
+	std::string getSummary(const std::string & function) const;
+public:
+	static FixpointProfiler & getInstance();
+	static bool isEnabled();
+	static double now();
+
+	void start();
+	void recordUpdate(BasicBlock * block, double start, double end,
+			unsigned envSize);
+	void recordJoin(BasicBlock * dest, bool isWiden, double start, double end);
+	void recordInstruction(BasicBlock * block, const char * kind,
+			double start, double end);
+	void write(const std::string & function);
+};
+
+#endif // FIXPOINT_PROFILER_H
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <unordered_set>
 #include <vector>
 
 #include <ap_abstract1.h>
@@ -12,6 +13,7 @@
 #include <APStream.h>
 #include <AbstractState.h>
 #include <BasicBlock.h>
+#include <SymbolTable.h>
 #include <Value.h>
 
 namespace llvm {
@@ -21,21 +23,57 @@ namespace llvm {
 
 class BasicBlock;
 
+typedef enum {
+	var_in_out_unknown = 0,
+	var_in_out_no,
+	var_in_out_yes
+} var_in_out_e;
+
+/**
+ * Facts about a function that do not change during the analysis. Built
+ * once, the first time any of them is needed.
+ */
+struct FunctionInfo {
+	llvm::ReturnInst * returnInstruction;
+	BasicBlock * returnBasicBlock;
+	// The LLVM name of the returned value, if any
+	std::string returnValueName;
+	SymbolId returnValueId;
+	std::unordered_set<SymbolId> argumentIds;
+	std::vector<std::string> userPointers;
+	// isVarInOut, by SymbolId. Filled on demand.
+	std::vector<char> varInOut;
+	// The constants compared against (icmp, switch) and passed as the size
+	// of a user memory operation, sorted and unique. Widening thresholds.
+	// Collected on first use, with -widening-thresholds only.
+	bool isWideningThresholdsCollected;
+	std::vector<int64_t> wideningThresholds;
+};
+
 class Function {
 protected:
 	llvm::Function * m_function;
 	std::string m_name;
+	SymbolTable m_symbolTable;
+	bool m_isInfoBuilt;
+	FunctionInfo m_info;
+	// Join of the memory operation states, projected on the in/out variables
+	ApronAbstractState m_successState;
+
+	FunctionInfo & getInfo();
+	bool classifyVarInOut(const char * varname);
+	bool classifyVarInOut(SymbolId var);
 
 	void pushBackIfConstrainsUserPointers(
 			std::map<std::string, ApronAbstractState> & result,
 			AbstractState & state,
-			std::vector<std::string> & userBuffers);
+			const std::vector<std::string> & userBuffers);
 public:
 	Function(llvm::Function * function);
 	bool isUserPointer(std::string & ptrname);
-	std::vector<std::string> getUserPointers();
+	bool isUserPointer(SymbolId ptr);
+	const std::vector<std::string> & getUserPointers();
 	std::vector<std::string> getConstrainedUserPointers(AbstractState & state);
-	std::map<BasicBlock *, AbstractState> m_memOpsAbstractStates;
 	// Kept for debug purposes only
 	virtual ap_abstract1_t trimAbstractValue(AbstractState & state);
 	virtual AbstractState & getReturnAbstractState();
@@ -46,9 +84,17 @@ public:
 	virtual bool isLastVariable(const char * varname);
 	virtual bool isOffsetVariable(const char * varname);
 	virtual bool isFunctionParameter(const char * varname);
+	// The same, by the id in the function's symbol table
+	virtual bool isVarInOut(SymbolId var);
+	virtual bool isSizeVariable(SymbolId var);
+	virtual bool isLastVariable(SymbolId var);
+	virtual bool isOffsetVariable(SymbolId var);
+	virtual bool isFunctionParameter(SymbolId var);
+	virtual const std::vector<int64_t> & getWideningThresholds();
 	virtual ApronAbstractState minimize(ApronAbstractState & state);
 	virtual std::map<std::string, ApronAbstractState> getErrorStates();
 	virtual ApronAbstractState getSuccessState();
+	virtual void joinSuccessState(const ApronAbstractState & state);
 	virtual const std::string & getName() const;
 	virtual std::vector<std::pair<std::string, std::string> > getArgumentStrings();
 	virtual std::string getSignature();
@@ -58,6 +104,10 @@ public:
 	virtual const std::vector<ImportIovecCall> & getImportIovecCalls();
 	virtual const std::vector<CopyMsghdrFromUserCall> & getCopyMsghdrFromUserCalls();
 	virtual BasicBlock * getRoot() const;
+	virtual SymbolTable & getSymbolTable();
+	// Forget the facts that refer to the body, before it is released.
+	// They are rebuilt if the body is read again.
+	virtual void releaseBody();
 };
 
 class Alias : public Function {
@@ -0,0 +1,75 @@
+#ifndef RESULTS_STORE_H
+#define RESULTS_STORE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct BufferResult {
+	std::string name;
+	// Intervals on return, e.g. "[0,+oo]". Empty if unconstrained.
+	std::string lastRead;
+	std::string lastWrite;
+	std::string size;
+};
+
+/**
+ * The contract's constraints, as printed by ap_tcons1_fprint, after
+ * projection on the in/out variables
+ */
+struct ContractResult {
+	std::map<std::string, std::vector<std::string> > errorStates;
+	std::vector<std::string> successState;
+	std::vector<std::string> returnState;
+};
+
+struct FunctionResult {
+	std::string function;
+	std::string domain;
+	bool isDegraded;
+	std::string degradedReason;
+	double analysisSeconds;
+	double totalSeconds;
+	unsigned blockUpdates;
+	unsigned joins;
+	unsigned widenings;
+	bool hasReturnInterval;
+	std::string returnInf;
+	std::string returnSup;
+	std::vector<BufferResult> buffers;
+	bool hasContract;
+	ContractResult contract;
+
+	FunctionResult() : isDegraded(false), analysisSeconds(0),
+			totalSeconds(0), blockUpdates(0), joins(0), widenings(0),
+			hasReturnInterval(false), hasContract(false) {}
+};
+
+/**
+ * Output of the pass. All files go to -output-dir. Per function, the
+ * return interval (<fn>.txt) and the contract (<fn>.contract.c) are
+ * written to a temporary file and renamed into place. In addition, a
+ * record for every function is appended as a single JSON line to
+ * -results-file. Each record is written with a single write(2) under an
+ * exclusive flock(2), so concurrent runs may share the file.
+ */
+class ResultsStore {
+protected:
+	static ResultsStore * instance;
+	std::string m_outputDir;
+	std::string m_resultsPath;
+	int m_resultsFd;
+
+	ResultsStore();
+	static std::string toJSON(const FunctionResult & result);
+public:
+	static ResultsStore & getInstance();
+	~ResultsStore();
+
+	const std::string & getOutputDir() const;
+	std::string getOutputPath(const std::string & filename) const;
+	bool writeFile(const std::string & filename, const std::string & contents);
+	bool append(const FunctionResult & result);
+};
+
+#endif // RESULTS_STORE_H
@@ -0,0 +1,98 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <ap_var.h>
+
+typedef enum {
+	symbol_kind_ssa,
+	symbol_kind_offset,
+	symbol_kind_last,
+	symbol_kind_size,
+	symbol_kind_unknown
+} symbol_kind_e;
+
+typedef unsigned SymbolId;
+
+struct Symbol {
+	std::string name;
+	symbol_kind_e kind;
+	// offset(base,buffer), last(buffer,op), size(buffer)
+	SymbolId base;
+	SymbolId buffer;
+	int op;
+	// Dense indices into the may-points-to state, if used as such
+	unsigned pointerIndex;
+	unsigned bufferIndex;
+	Symbol(const std::string & name, symbol_kind_e kind,
+			SymbolId base, SymbolId buffer, int op) :
+			name(name), kind(kind), base(base), buffer(buffer), op(op),
+			pointerIndex(-1), bufferIndex(-1) {}
+};
+
+/**
+ * Interned names of the analysis variables of a single function.
+ *
+ * Every variable (SSA value, offset(p,buf), last(buf,op), size(buf)) is
+ * given an integer id once. The name of an id is never moved, so it
+ * doubles as a stable ap_var_t. Composite names are looked up by the ids
+ * of their parts, so they are formatted only the first time they are used.
+ */
+class SymbolTable {
+protected:
+	static SymbolTable * current;
+	static SymbolTable defaultTable;
+
+	std::deque<Symbol> m_symbols;
+	// Looked up without copying the name, e.g. of an ap_var_t
+	llvm::StringMap<SymbolId> m_ids;
+	std::map<std::pair<SymbolId, SymbolId>, SymbolId> m_offsets;
+	std::map<std::pair<SymbolId, int>, SymbolId> m_lasts;
+	std::map<SymbolId, SymbolId> m_sizes;
+	std::vector<SymbolId> m_pointers;
+	std::vector<SymbolId> m_buffers;
+
+	SymbolId add(const std::string & name, symbol_kind_e kind,
+			SymbolId base, SymbolId buffer, int op);
+	static symbol_kind_e parseKind(const char * name);
+public:
+	static const SymbolId invalid = (SymbolId)-1;
+
+	SymbolTable();
+
+	static SymbolTable & getCurrent();
+	void makeCurrent();
+
+	// A new name of kind ssa is given the kind its form implies
+	SymbolId intern(const std::string & name,
+			symbol_kind_e kind = symbol_kind_ssa);
+	SymbolId find(llvm::StringRef name) const;
+	SymbolId getOffset(SymbolId pointer, SymbolId buffer);
+	SymbolId getLast(SymbolId buffer, int op);
+	SymbolId getSize(SymbolId buffer);
+
+	const std::string & getName(SymbolId id) const;
+	ap_var_t getApVar(SymbolId id) const;
+	symbol_kind_e getKind(SymbolId id) const;
+	symbol_kind_e getKind(const char * name) const;
+	const Symbol & getSymbol(SymbolId id) const;
+	unsigned size() const;
+
+	unsigned getPointerIndex(const std::string & name);
+	unsigned findPointerIndex(const std::string & name) const;
+	SymbolId getPointer(unsigned index) const;
+	unsigned getPointerCount() const;
+	unsigned getBufferIndex(const std::string & name);
+	SymbolId getBuffer(unsigned index) const;
+	unsigned getBufferCount() const;
+};
+
+#endif // SYMBOL_TABLE_H
@@ -0,0 +1,56 @@
+#ifndef TRANSFER_CACHE_H
+#define TRANSFER_CACHE_H
+
+#include <cstddef>
+#include <list>
+
+#include <AbstractState.h>
+
+/**
+ * The last few results of a transfer function (of a block, or of an edge),
+ * by input state. Inputs are compared by fingerprint (AbstractState::hash)
+ * first, and then fully (AbstractState::isIdentical).
+ */
+template <class Output>
+class TransferCache {
+protected:
+	struct Entry {
+		size_t fingerprint;
+		AbstractState input;
+		Output output;
+		Entry(size_t fingerprint, const AbstractState & input,
+				const Output & output) :
+				fingerprint(fingerprint), input(input), output(output) {}
+	};
+	// Most recently used first
+	std::list<Entry> m_entries;
+	unsigned m_capacity;
+public:
+	TransferCache(unsigned capacity = 4) : m_capacity(capacity) {}
+
+	const Output * find(const AbstractState & input, size_t fingerprint) {
+		for (auto it = m_entries.begin(), ie = m_entries.end(); it != ie; it++) {
+			if ((it->fingerprint != fingerprint) ||
+					!it->input.isIdentical(input)) {
+				continue;
+			}
+			m_entries.splice(m_entries.begin(), m_entries, it);
+			return &m_entries.front().output;
+		}
+		return 0;
+	}
+
+	void insert(const AbstractState & input, size_t fingerprint,
+			const Output & output) {
+		m_entries.push_front(Entry(fingerprint, input, output));
+		if (m_entries.size() > m_capacity) {
+			m_entries.pop_back();
+		}
+	}
+
+	void clear() {
+		m_entries.clear();
+	}
+};
+
+#endif // TRANSFER_CACHE_H
@@ -0,0 +1,57 @@
+#ifndef USER_MEMORY_MODELS_H
+#define USER_MEMORY_MODELS_H
+
+#include <string>
+#include <unordered_map>
+
+#include <AbstractState.h>
+
+typedef enum {
+	// Access of 'size' bytes at 'ptr'
+	user_memory_handler_memop,
+	// Access of the width of the first argument at 'ptr'
+	user_memory_handler_get_put_user,
+	user_memory_handler_import_iovec,
+	user_memory_handler_copy_msghdr_from_user,
+	// Return value is bounded by 'size'
+	user_memory_handler_account
+} user_memory_handler_e;
+
+struct UserMemoryModel {
+	std::string name;
+	user_memory_handler_e handler;
+	int numArgs;
+	int ptrArg;
+	int sizeArg;
+	int opArg;
+	user_pointer_operation_e op;
+
+	// The highest argument index the handler reads, or -1
+	int getMaxArg() const;
+	// Whether a call with callArgs arguments can be handled by the model
+	bool matches(unsigned callArgs) const;
+};
+
+/**
+ * Models of the kernel functions that access user memory, by called symbol.
+ * The built-in models are listed in UserMemoryModels.def. Additional models
+ * are read from the file given in -user-memory-models. Each line there is:
+ *   <name> <handler> <num_args> <ptr_arg> <size_arg> <op_arg> <read|write>
+ * e.g.
+ *   copy_in_user memop 3 0 2 -1 write
+ * Lines whose argument indices the handler can't use are rejected.
+ */
+class UserMemoryModels {
+protected:
+	static UserMemoryModels * instance;
+	std::unordered_map<std::string, UserMemoryModel> m_models;
+
+	UserMemoryModels();
+	void add(const UserMemoryModel & model);
+public:
+	static UserMemoryModels & getInstance();
+	bool loadSpecFile(const std::string & path);
+	const UserMemoryModel * find(const std::string & name) const;
+};
+
+#endif // USER_MEMORY_MODELS_H
@@ -2,10 +2,14 @@
 #define VALUE_H
 
 #include <map>
+#include <memory>
 #include <string>
 #include <ostream>
 #include <list>
+#include <vector>
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/IR/Instruction.h>
 #include <llvm/Support/raw_ostream.h>
 
@@ -15,21 +19,48 @@
 
 #include <AbstractState.h>
 #include <BasicBlock.h>
+#include <SymbolTable.h>
+
+namespace llvm {
+	class DataLayout;
+	class Function;
+	class Module;
+}
 
 class Value;
 
+/**
+ * Creates and owns the Value wrappers. The arguments and instructions of a
+ * function are numbered, and wrapped, once - the first time any of them is
+ * requested. The wrappers are stored densely by that number.
+ */
 class ValueFactory {
 protected:
 	static ValueFactory * instance;
-	std::map<llvm::Value *, Value *> values;
+	std::vector<Value *> m_values;
+	llvm::DenseMap<llvm::Value *, unsigned> m_indices;
+	llvm::SmallPtrSet<llvm::Function *, 16> m_numberedFunctions;
+	std::map<const llvm::Module *, std::unique_ptr<llvm::DataLayout> > m_dataLayouts;
 	Value * createValue(llvm::Value *);
 	Value * createInstructionValue(llvm::Instruction *);
 	Value * createConstantValue(llvm::Constant *);
+	void addValue(llvm::Value * llvmValue, Value * value);
+	void numberFunction(llvm::Function * function);
 	ValueFactory();
-
-	std::map<Value *, llvm::Value *> m_createdInstances;
+	// Defined where llvm::DataLayout is complete
+	~ValueFactory();
+
+	struct CreatedInstance {
+		llvm::Constant * constant;
+		llvm::Instruction * instruction;
+	};
+	std::map<Value *, CreatedInstance> m_createdInstances;
 public:
 	Value * getValue(llvm::Value *);
+	const llvm::DataLayout & getDataLayout(const llvm::Module * module);
+	// Forget the values of the function's arguments and instructions,
+	// before its body is released
+	void releaseFunction(llvm::Function * function);
 	static ValueFactory * getInstance();
 	static void deleteCreatedInstances();
 };
@@ -40,11 +71,19 @@ protected:
 	static int valuesIndex;
 	llvm::Value * m_value;
 	std::string m_name;
+	// Precomputed by the ValueFactory
+	unsigned m_index;
+	bool m_isPointer;
+	unsigned m_bitSize;
+	SymbolTable * m_nameTable;
+	SymbolId m_nameId;
 
 	Value(llvm::Value * value);
 	virtual std::string llvmValueName(llvm::Value * value);
 public:
 	virtual std::string & getName();
+	unsigned getIndex() const;
+	SymbolId getNameId();
 	virtual std::string getValueString();
 	virtual std::string toString();
 	virtual bool isSkip();
@@ -56,7 +95,7 @@ public:
 	virtual void havoc(AbstractState & state);
 	virtual void assign0(AbstractState & state);
 
-	virtual const std::set<std::string> * mayPointsToUserBuffers(AbstractState & state);
+	virtual const MPTItemAbstractState * mayPointsToUserBuffers(AbstractState & state);
 	virtual void updateAssumptions(BasicBlock * source, BasicBlock * dest, AbstractState & state);
 	virtual void updateConditionalAssumptions(AbstractState & state, bool isNegated);
 
@@ -71,6 +110,8 @@ llvm::raw_ostream& operator<<(llvm::raw_ostream& ro, Value* value);
 
 class InstructionValue : public Value {
 protected:
+	// Operand wrappers, resolved on first use
+	std::vector<Value *> m_operands;
 	virtual llvm::Instruction * asInstruction();
 	virtual BasicBlock * getBasicBlock();
 	virtual Function * getFunction();
@@ -79,8 +120,12 @@ public:
 	virtual void update(AbstractState & state);
 	virtual ap_texpr1_t * createRHSTreeExpression(AbstractState & state);
 	virtual Value * getOperandValue(int idx);
-	virtual const std::set<std::string> * mayPointsToUserBuffers(AbstractState & state);
+	virtual const MPTItemAbstractState * mayPointsToUserBuffers(AbstractState & state);
 	virtual bool isSkip();
+	// True if update only assigns this value from its operands
+	virtual bool isBatchable();
+	// The wrapper class, for profiling
+	virtual const char * getKindName();
 };
 
 class TerminatorInstructionValue : public InstructionValue {
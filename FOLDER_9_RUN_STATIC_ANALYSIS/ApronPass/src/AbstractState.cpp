@@ -1,25 +1,15 @@
 #include <APStream.h>
 #include <AbstractState.h>
 #include <BasicBlock.h>
+#include <SymbolTable.h>
 
 extern "C" {
 #include <Adaptor.h>
 }
 
-ap_manager_t * apron_manager = create_manager();
+extern bool LazyOffsets;
 
-class raw_uniq_string_ostream : public llvm::raw_string_ostream {
-	std::set<std::string> & m_cache;
-	std::string buf;
-public:
-	raw_uniq_string_ostream(std::set<std::string> & cache) :
-		m_cache(cache), llvm::raw_string_ostream(buf) {}
-	const std::string & uniq_str() {
-		std::pair<std::set<std::string>::iterator,bool> inserted =
-				m_cache.insert(str());
-		return *inserted.first;
-	}
-};
+ap_manager_t * apron_manager = create_manager();
 
 MemoryAccessAbstractValue::MemoryAccessAbstractValue(const std::string & var, const std::string & pointer, const std::string & buffer,
 		ap_texpr1_t * size, user_pointer_operation_e operation)
@@ -27,9 +17,7 @@ MemoryAccessAbstractValue::MemoryAccessAbstractValue(const std::string & var, co
 
 ///////////////////////////////////////////////////////////////////////////////
 
-AbstractState::AbstractState() : m_apronAbstractState(ApronAbstractState::bottom()) {
-	m_mayPointsTo.m_mayPointsTo["null"].insert("null");
-}
+AbstractState::AbstractState() : m_apronAbstractState(ApronAbstractState::bottom()) {}
 
 template <class T>
 bool inVector(const std::vector<T> & v, const T & item) {
@@ -68,7 +56,7 @@ bool meetVectors(std::vector<T> & dest, const std::vector<T> & src) {
 
 // This is the constructor used for the root abstract state - which is Top,
 // and not Bottom
-AbstractState::AbstractState(std::vector<std::string> & userBuffers) :
+AbstractState::AbstractState(const std::vector<std::string> & userBuffers) :
 		m_apronAbstractState(ApronAbstractState::top()),
 		m_mayPointsTo(userBuffers) {
 	m_apronAbstractState.start_meet_aggregate();
@@ -81,24 +69,37 @@ AbstractState::AbstractState(std::vector<std::string> & userBuffers) :
 }
 
 const std::string & AbstractState::generateOffsetName(const std::string & valueName, const std::string & bufname) {
-	static std::set<std::string> names;
-	raw_uniq_string_ostream rso(names);
-	rso << "offset(" << valueName << "," << bufname << ")";
-	return rso.uniq_str();
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	SymbolId id = symbols.getOffset(
+			symbols.intern(valueName), symbols.intern(bufname));
+	return symbols.getName(id);
 }
 
 const std::string & AbstractState::generateLastName(const std::string & bufname, user_pointer_operation_e op) {
-	static std::set<std::string> names;
-	raw_uniq_string_ostream rso(names);
-	rso << "last(" << bufname << "," << op << ")";
-	return rso.uniq_str();
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	return symbols.getName(symbols.getLast(symbols.intern(bufname), op));
 }
 
 const std::string & AbstractState::generateSizeName(const std::string & bufname) {
-	static std::set<std::string> names;
-	raw_uniq_string_ostream rso(names);
-	rso << "size(" << bufname << ")";
-	return rso.uniq_str();
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	return symbols.getName(symbols.getSize(symbols.intern(bufname)));
+}
+
+const std::string & AbstractState::generateOffsetName(SymbolId pointer,
+		SymbolId buffer) {
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	return symbols.getName(symbols.getOffset(pointer, buffer));
+}
+
+const std::string & AbstractState::generateLastName(SymbolId buffer,
+		user_pointer_operation_e op) {
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	return symbols.getName(symbols.getLast(buffer, op));
+}
+
+const std::string & AbstractState::generateSizeName(SymbolId buffer) {
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	return symbols.getName(symbols.getSize(buffer));
 }
 
 ap_manager_t * AbstractState::getManager() const {
@@ -106,6 +107,7 @@ ap_manager_t * AbstractState::getManager() const {
 }
 
 void AbstractState::updateByMemoryOperation(MemoryAccessAbstractValue & maav) {
+	materializeOffsets(maav.pointer);
 	const std::string & offsetName = generateOffsetName(maav.pointer, maav.buffer);
 	const std::string & lastName = generateLastName(maav.buffer, maav.operation);
 	bool isLastKnown = m_apronAbstractState.isKnown(lastName);
@@ -166,6 +168,21 @@ bool AbstractState::joinMemoryOperationState(const memory_operation_state_e & ot
 bool AbstractState::join(AbstractState &other)
 {
 	bool isChanged = false;
+	if (m_offsetBases != other.m_offsetBases) {
+		if (m_apronAbstractState.isBottom()) {
+			// The join is other, bases and all
+			m_offsetBases = other.m_offsetBases;
+			isChanged = true;
+		} else if (other.m_apronAbstractState.isBottom()) {
+			AbstractState adopted = other;
+			adopted.m_offsetBases = m_offsetBases;
+			return join(adopted);
+		} else {
+			AbstractState unified = other;
+			isChanged = unifyOffsetBases(unified);
+			return join(unified) || isChanged;
+		}
+	}
 	// Join 'May' reference
 	isChanged = m_mayPointsTo.join(other.m_mayPointsTo) || isChanged;
 	// Join (Apron) analysis of integers
@@ -177,13 +194,29 @@ bool AbstractState::join(AbstractState &other)
 	return isChanged;
 }
 
-bool AbstractState::widen(AbstractState &other)
+bool AbstractState::widen(AbstractState &other,
+		const std::vector<int64_t> & thresholds)
 {
 	bool isChanged = false;
+	if (m_offsetBases != other.m_offsetBases) {
+		if (m_apronAbstractState.isBottom()) {
+			m_offsetBases = other.m_offsetBases;
+			isChanged = true;
+		} else if (other.m_apronAbstractState.isBottom()) {
+			AbstractState adopted = other;
+			adopted.m_offsetBases = m_offsetBases;
+			return widen(adopted, thresholds);
+		} else {
+			AbstractState unified = other;
+			isChanged = unifyOffsetBases(unified);
+			return widen(unified, thresholds) || isChanged;
+		}
+	}
 	// Join 'May' reference
 	isChanged = m_mayPointsTo.join(other.m_mayPointsTo) || isChanged;
 	// Join (Apron) analysis of integers
-	isChanged = m_apronAbstractState.widen(other.m_apronAbstractState) || isChanged;
+	isChanged = m_apronAbstractState.widen(other.m_apronAbstractState,
+			thresholds) || isChanged;
 	// Join (Apron) analysis of (user) read/write/last0 pointers
 	isChanged = joinVectors(m_importedIovecCalls, other.m_importedIovecCalls) || isChanged;
 	isChanged = joinVectors(m_copyMsghdrFromUserCalls, other.m_copyMsghdrFromUserCalls) || isChanged;
@@ -192,6 +225,21 @@ bool AbstractState::widen(AbstractState &other)
 
 bool AbstractState::meet(AbstractState & other) {
 	bool isChanged = false;
+	if (m_offsetBases != other.m_offsetBases) {
+		if (other.m_apronAbstractState.isBottom()) {
+			// The meet is bottom, bases and all
+			m_offsetBases = other.m_offsetBases;
+			isChanged = true;
+		} else if (m_apronAbstractState.isBottom()) {
+			AbstractState adopted = other;
+			adopted.m_offsetBases = m_offsetBases;
+			return meet(adopted);
+		} else {
+			AbstractState unified = other;
+			isChanged = unifyOffsetBases(unified);
+			return meet(unified) || isChanged;
+		}
+	}
 	// Meet 'May' reference
 	isChanged = m_mayPointsTo.meet(other.m_mayPointsTo) || isChanged;
 	// Meet (Apron) analysis of integers
@@ -202,48 +250,287 @@ bool AbstractState::meet(AbstractState & other) {
 	return isChanged;
 }
 
-bool AbstractState::reduce(std::vector<std::string> & userBuffers) {
+bool AbstractState::reduce(const std::vector<std::string> & userBuffers) {
 	AbstractState prev = *this;
-	for (std::pair<const std::string, MPTItemAbstractState > & pt : m_mayPointsTo.m_mayPointsTo) {
-		if (pt.second.empty()) {
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	MPTBufferSet userBufferSet;
+	for (const std::string & buffer : userBuffers) {
+		userBufferSet.set(symbols.getBufferIndex(buffer));
+	}
+	for (unsigned idx = 0; idx < m_mayPointsTo.size(); idx++) {
+		MPTItemAbstractState * pt = m_mayPointsTo.find(idx);
+		if (!pt) {
+			continue;
+		}
+		if (pt->empty()) {
 			llvm::errs() << "Setting state to bottom in reduction, since " <<
-					pt.first << " doesn't point to anything\n";
+					m_mayPointsTo.getPointerName(idx) << " doesn't point to anything\n";
 			makeBottom();
 			return true;
 		}
-		for (const std::string & buffer : userBuffers) {
-			if (pt.second.contains(buffer)) {
-				continue;
-			}
-			const std::string & offsetName = generateOffsetName(
-					pt.first, buffer);
-			m_apronAbstractState.forget(offsetName, true);
+		MPTBufferSet missing = userBufferSet & ~pt->getBuffers();
+		if (missing.none()) {
+			continue;
+		}
+		MPTItemAbstractState missingItem(missing);
+		for (auto it = missingItem.begin(), ie = missingItem.end(); it != ie; ++it) {
+			SymbolId offset = symbols.getOffset(symbols.getPointer(idx),
+					symbols.getBuffer(it.index()));
+			m_apronAbstractState.forget(symbols.getName(offset), true);
 		}
 	}
 	return (prev.m_apronAbstractState != m_apronAbstractState);
 }
 
-void AbstractState::assignPtrToPtr(const std::string & dest, const std::string & src) {
+// left + right, of the state's environment
+static ap_texpr1_t * addTexprs(ApronAbstractState & state,
+		ap_texpr1_t * left, ap_texpr1_t * right) {
+	state.extendEnvironment(left);
+	state.extendEnvironment(right);
+	return ap_texpr1_binop(AP_TEXPR_ADD, left, right,
+			AP_RTYPE_INT, AP_RDIR_ZERO);
+}
+
+void AbstractState::assignPtrToPtr(const std::string & dest, const std::string & src,
+		ap_texpr1_t * delta) {
+	if (LazyOffsets) {
+		std::vector<PointerAssignment> assignments;
+		assignments.push_back(PointerAssignment(dest, src, m_mayPointsTo.find(src)));
+		if (!delta) {
+			assignPtrsToPtrs(assignments);
+			return;
+		}
+		SymbolTable & symbols = SymbolTable::getCurrent();
+		SymbolId srcId = symbols.intern(src);
+		assert((symbols.intern(dest) != srcId) && "SSA assumption broken");
+		// dest = src, and then offset(dest,base) += delta
+		assignPtrsToPtrs(assignments);
+		auto it = m_offsetBases.find(symbols.intern(dest));
+		if (it == m_offsetBases.end()) {
+			// Top
+			ap_texpr1_free(delta);
+			return;
+		}
+		const std::string & offsetName = symbols.getName(
+				symbols.getOffset(it->first, it->second));
+		m_apronAbstractState.assign(offsetName, addTexprs(m_apronAbstractState,
+				m_apronAbstractState.asTexpr(offsetName), delta));
+		return;
+	}
 	MPTItemAbstractState *srcBuffers = m_mayPointsTo.find(src);
 	if (!srcBuffers) {
 		m_mayPointsTo.forget(dest);
+		if (delta) {
+			ap_texpr1_free(delta);
+		}
 		return;
 	}
-	m_mayPointsTo.extend(dest) = *srcBuffers;
-	for (auto & buffer : *srcBuffers) {
-		const std::string & destOffsetName = AbstractState::generateOffsetName(
-				dest, buffer);
+	MPTItemAbstractState buffers = *srcBuffers;
+	m_mayPointsTo.extend(dest) = buffers;
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	SymbolId destId = symbols.intern(dest);
+	SymbolId srcId = symbols.intern(src);
+	for (auto it = buffers.begin(), ie = buffers.end(); it != ie; ++it) {
+		SymbolId buffer = symbols.getBuffer(it.index());
+		const std::string & destOffsetName = generateOffsetName(destId, buffer);
 		m_apronAbstractState.forget(destOffsetName);
-		const std::string & srcOffsetName = AbstractState::generateOffsetName(
-				src, buffer);
+		const std::string & srcOffsetName = generateOffsetName(srcId, buffer);
 		ap_texpr1_t * srcOffsetTexpr =
 				m_apronAbstractState.asTexpr(srcOffsetName);
+		if (delta) {
+			srcOffsetTexpr = addTexprs(m_apronAbstractState,
+					srcOffsetTexpr, ap_texpr1_copy(delta));
+		}
 		m_apronAbstractState.assign(destOffsetName, srcOffsetTexpr);
 	}
+	if (delta) {
+		ap_texpr1_free(delta);
+	}
+}
+
+void AbstractState::assignPtrsToPtrs(
+		const std::vector<PointerAssignment> & assignments) {
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	std::set<SymbolId> dests;
+	for (const PointerAssignment & assignment : assignments) {
+		SymbolId destId = symbols.intern(assignment.dest);
+		dests.insert(destId);
+		// Pointers derived from dest are relative to its previous value
+		materializeDerivedOffsets(destId);
+	}
+	// All sources are read before any dest is assigned
+	std::vector<std::string> names;
+	std::vector<ap_texpr1_t *> values;
+	std::vector<std::pair<std::string, MPTItemAbstractState> > pointsTo;
+	std::vector<std::string> unknownPointsTo;
+	std::map<SymbolId, SymbolId> bases;
+	for (const PointerAssignment & assignment : assignments) {
+		if (!assignment.buffers) {
+			unknownPointsTo.push_back(assignment.dest);
+			continue;
+		}
+		pointsTo.push_back(std::make_pair(assignment.dest, MPTItemAbstractState(
+				assignment.buffers->getBuffers(), true)));
+		SymbolId destId = symbols.intern(assignment.dest);
+		SymbolId srcId = symbols.intern(assignment.src);
+		auto it = m_offsetBases.find(srcId);
+		if (it != m_offsetBases.end()) {
+			// dest = base + offset(src,base)
+			bases[destId] = it->second;
+			names.push_back(symbols.getName(symbols.getOffset(destId, it->second)));
+			values.push_back(m_apronAbstractState.asTexpr(
+					symbols.getName(symbols.getOffset(srcId, it->second))));
+		} else if (LazyOffsets && (dests.find(srcId) == dests.end())) {
+			// dest = src + 0
+			bases[destId] = srcId;
+			names.push_back(symbols.getName(symbols.getOffset(destId, srcId)));
+			values.push_back(m_apronAbstractState.asTexpr((int64_t)0));
+		} else {
+			// Not lazy, or src is assigned here too, so it can't be a base
+			for (auto bufferIt = assignment.buffers->begin(),
+					bufferIe = assignment.buffers->end();
+					bufferIt != bufferIe; ++bufferIt) {
+				SymbolId buffer = symbols.getBuffer(bufferIt.index());
+				names.push_back(generateOffsetName(destId, buffer));
+				values.push_back(m_apronAbstractState.asTexpr(
+						generateOffsetName(srcId, buffer)));
+			}
+		}
+	}
+	for (SymbolId destId : dests) {
+		m_offsetBases.erase(destId);
+	}
+	m_offsetBases.insert(bases.begin(), bases.end());
+	for (const std::string & dest : unknownPointsTo) {
+		m_mayPointsTo.forget(dest);
+	}
+	for (auto & destPointsTo : pointsTo) {
+		m_mayPointsTo.extend(destPointsTo.first) = destPointsTo.second;
+	}
+	m_apronAbstractState.assign(names, values);
+}
+
+void AbstractState::materializeOffsets(const std::string & pointer) {
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	SymbolId pointerId = symbols.intern(pointer);
+	auto it = m_offsetBases.find(pointerId);
+	if (it == m_offsetBases.end()) {
+		return;
+	}
+	SymbolId baseId = it->second;
+	m_offsetBases.erase(it);
+	const std::string & relativeName = symbols.getName(
+			symbols.getOffset(pointerId, baseId));
+	MPTItemAbstractState * buffers = m_mayPointsTo.findSymbol(pointerId);
+	if (!buffers) {
+		m_apronAbstractState.forget(relativeName);
+		return;
+	}
+	// offset(pointer,buffer) = offset(pointer,base) + offset(base,buffer)
+	std::vector<std::string> names;
+	std::vector<ap_texpr1_t *> values;
+	bool isRelativeKept = false;
+	for (auto bufferIt = buffers->begin(), bufferIe = buffers->end();
+			bufferIt != bufferIe; ++bufferIt) {
+		SymbolId buffer = symbols.getBuffer(bufferIt.index());
+		const std::string & offsetName = generateOffsetName(pointerId, buffer);
+		// The base may be the buffer itself
+		isRelativeKept = isRelativeKept || (offsetName == relativeName);
+		names.push_back(offsetName);
+		values.push_back(addTexprs(m_apronAbstractState,
+				m_apronAbstractState.asTexpr(relativeName),
+				m_apronAbstractState.asTexpr(generateOffsetName(
+						baseId, buffer))));
+	}
+	m_apronAbstractState.assign(names, values);
+	if (!isRelativeKept) {
+		m_apronAbstractState.forget(relativeName);
+	}
+}
+
+void AbstractState::materializeDerivedOffsets(SymbolId base) {
+	std::vector<SymbolId> derived;
+	for (auto & offsetBase : m_offsetBases) {
+		if (offsetBase.second == base) {
+			derived.push_back(offsetBase.first);
+		}
+	}
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	for (SymbolId pointer : derived) {
+		materializeOffsets(symbols.getName(pointer));
+	}
+}
+
+// Materialize the offsets of pointers that aren't relative to the same base
+// in both states, so that the offsets are joined variable by variable. A
+// pointer that one state doesn't know at all keeps its relative form, and
+// the other state takes its base.
+// Returns true if this state changed.
+bool AbstractState::unifyOffsetBases(AbstractState & other) {
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	std::vector<SymbolId> mine;
+	std::vector<SymbolId> others;
+	std::map<SymbolId, SymbolId> mineKept;
+	std::map<SymbolId, SymbolId> othersKept;
+	for (auto & offsetBase : m_offsetBases) {
+		auto it = other.m_offsetBases.find(offsetBase.first);
+		if (it == other.m_offsetBases.end()) {
+			if (!other.m_mayPointsTo.findSymbol(offsetBase.first) &&
+					(other.m_offsetBases.find(offsetBase.second) ==
+							other.m_offsetBases.end())) {
+				mineKept.insert(offsetBase);
+				continue;
+			}
+		} else if (it->second == offsetBase.second) {
+			continue;
+		}
+		mine.push_back(offsetBase.first);
+	}
+	for (auto & offsetBase : other.m_offsetBases) {
+		auto it = m_offsetBases.find(offsetBase.first);
+		if (it == m_offsetBases.end()) {
+			if (!m_mayPointsTo.findSymbol(offsetBase.first) &&
+					(m_offsetBases.find(offsetBase.second) ==
+							m_offsetBases.end())) {
+				othersKept.insert(offsetBase);
+				continue;
+			}
+		} else if (it->second == offsetBase.second) {
+			continue;
+		}
+		others.push_back(offsetBase.first);
+	}
+	// A base must not become relative itself
+	for (auto it = mineKept.begin(); it != mineKept.end();) {
+		if (othersKept.find(it->second) != othersKept.end()) {
+			mine.push_back(it->first);
+			it = mineKept.erase(it);
+		} else {
+			++it;
+		}
+	}
+	for (auto it = othersKept.begin(); it != othersKept.end();) {
+		if (mineKept.find(it->second) != mineKept.end()) {
+			others.push_back(it->first);
+			it = othersKept.erase(it);
+		} else {
+			++it;
+		}
+	}
+	for (SymbolId pointer : mine) {
+		materializeOffsets(symbols.getName(pointer));
+	}
+	for (SymbolId pointer : others) {
+		other.materializeOffsets(symbols.getName(pointer));
+	}
+	m_offsetBases.insert(othersKept.begin(), othersKept.end());
+	other.m_offsetBases.insert(mineKept.begin(), mineKept.end());
+	return !mine.empty() || !othersKept.empty();
 }
 
 bool AbstractState::operator==(const AbstractState & other) const {
 	return ((m_mayPointsTo == other.m_mayPointsTo) &&
+			(m_offsetBases == other.m_offsetBases) &&
 			(m_apronAbstractState == other.m_apronAbstractState) &&
 			(m_importedIovecCalls == other.m_importedIovecCalls) &&
 			(m_copyMsghdrFromUserCalls == other.m_copyMsghdrFromUserCalls));
@@ -253,12 +540,61 @@ bool AbstractState::operator!=(const AbstractState & other) const {
 	return !(*this == other);
 }
 
+static size_t hashCombine(size_t seed, size_t value) {
+	return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+size_t AbstractState::hash() const {
+	size_t result = m_apronAbstractState.hash();
+	std::hash<MPTBufferSet> bufferSetHash;
+	for (unsigned idx = 0; idx < m_mayPointsTo.size(); idx++) {
+		const MPTItemAbstractState * item = m_mayPointsTo.find(idx);
+		if (!item) {
+			continue;
+		}
+		result = hashCombine(result, idx);
+		result = hashCombine(result, bufferSetHash(item->getBuffers()));
+	}
+	for (auto & offsetBase : m_offsetBases) {
+		result = hashCombine(result, offsetBase.first);
+		result = hashCombine(result, offsetBase.second);
+	}
+	result = hashCombine(result, m_mos);
+	result = hashCombine(result, m_isHasMemoryOperation);
+	result = hashCombine(result, memoryAccessAbstractValues.size());
+	result = hashCombine(result, m_importedIovecCalls.size());
+	result = hashCombine(result, m_copyMsghdrFromUserCalls.size());
+	return result;
+}
+
+bool AbstractState::isIdentical(const AbstractState & other) const {
+	if ((m_mos != other.m_mos) ||
+			(m_isHasMemoryOperation != other.m_isHasMemoryOperation) ||
+			(memoryAccessAbstractValues.size() !=
+					other.memoryAccessAbstractValues.size())) {
+		return false;
+	}
+	for (unsigned idx = 0; idx < memoryAccessAbstractValues.size(); idx++) {
+		const MemoryAccessAbstractValue & maav = memoryAccessAbstractValues[idx];
+		const MemoryAccessAbstractValue & otherMaav = other.memoryAccessAbstractValues[idx];
+		if ((maav.var != otherMaav.var) ||
+				(maav.pointer != otherMaav.pointer) ||
+				(maav.buffer != otherMaav.buffer) ||
+				(maav.operation != otherMaav.operation) ||
+				!ap_texpr1_equal(maav.size, otherMaav.size)) {
+			return false;
+		}
+	}
+	return (*this == other);
+}
+
 void AbstractState::makeTop() {
 	assert(0 && "TODO: Not yet implemented");
 }
 
 void AbstractState::makeBottom() {
 	m_mayPointsTo.clear();
+	m_offsetBases.clear();
 	m_apronAbstractState.makeBottom();
 	memoryAccessAbstractValues.clear();
 	m_importedIovecCalls.clear();
@@ -1,7 +1,9 @@
+#include <cstdint>
 #include <set>
 
 #include <AbstractStates/ApronAbstractState.h>
 #include <APStream.h>
+#include <Budget.h>
 
 #include <llvm/Support/raw_ostream.h>
 
@@ -32,22 +34,36 @@ ApronAbstractState::ApronAbstractState(const ap_abstract1_t & abst) :
 ApronAbstractState::ApronAbstractState(const ap_abstract1_t * abst) :
 		m_abstract1(*abst) {}
 
-ApronAbstractState::ApronAbstractState(const ApronAbstractState& other) :
-		m_abstract1(ap_abstract1_copy(apron_manager, (ap_abstract1_t*)&other.m_abstract1)) {}
+ApronAbstractState::ApronAbstractState(const ApronAbstractState& other) {
+	// The pending operations are part of the value
+	ApronAbstractState & source = const_cast<ApronAbstractState &>(other);
+	source.flush_meet_aggregate();
+	source.flush_assign_aggregate();
+	m_abstract1 = ap_abstract1_copy(apron_manager, &source.m_abstract1);
+}
 
 ApronAbstractState & ApronAbstractState::operator=(const ApronAbstractState& other) {
+	ApronAbstractState & source = const_cast<ApronAbstractState &>(other);
+	source.flush_meet_aggregate();
+	source.flush_assign_aggregate();
+	if (&source == this) {
+		return *this;
+	}
+	clear_aggregates();
 	ap_abstract1_clear(apron_manager, &m_abstract1);
-	m_abstract1 = ap_abstract1_copy(apron_manager, (ap_abstract1_t*)&other.m_abstract1);
+	m_abstract1 = ap_abstract1_copy(apron_manager, &source.m_abstract1);
 	return *this;
 }
 
 ApronAbstractState & ApronAbstractState::operator=(const ap_abstract1_t& other) {
+	clear_aggregates();
 	ap_abstract1_clear(apron_manager, &m_abstract1);
 	m_abstract1 = other;
 	return *this;
 }
 
 ApronAbstractState::~ApronAbstractState() {
+	clear_aggregates();
 	ap_abstract1_clear(apron_manager, &m_abstract1);
 }
 
@@ -81,7 +97,98 @@ void ApronAbstractState::extendEnvironment(ap_tcons1_t * tcons) {
 	assert(!failed);
 }
 
+// The tightest threshold that bound satisfies: the least threshold >= bound
+// for an upper bound, the greatest threshold <= bound for a lower one.
+// thresholds is sorted. INT64_MIN is never a lower threshold, as x >= c is
+// built as x - c >= 0.
+static bool findThreshold(ap_scalar_t * bound,
+		const std::vector<int64_t> & thresholds, bool isUpper,
+		int64_t & result) {
+	if (ap_scalar_infty(bound) != 0) {
+		return false;
+	}
+	ap_scalar_t * scalar = ap_scalar_alloc();
+	// The number of thresholds below bound, or at most bound if lower
+	size_t low = 0;
+	size_t high = thresholds.size();
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+		ap_scalar_set_int(scalar, thresholds[middle]);
+		int cmp = ap_scalar_cmp(scalar, bound);
+		if ((cmp < 0) || (!isUpper && (cmp == 0))) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	ap_scalar_free(scalar);
+	if (isUpper) {
+		if (low == thresholds.size()) {
+			return false;
+		}
+		result = thresholds[low];
+		return true;
+	}
+	if (low == 0) {
+		return false;
+	}
+	result = thresholds[low - 1];
+	return (result != INT64_MIN);
+}
+
+// x <= c and x >= c, for the integer variables x whose bound in wider (the
+// plain widening) is dropped from other, where c is the tightest threshold
+// other satisfies. Checking every variable against every threshold is too
+// slow on large functions.
+static ap_lincons1_array_t makeThresholdConstraints(ap_abstract1_t & other,
+		ap_abstract1_t & wider, const std::vector<int64_t> & thresholds) {
+	ap_environment_t * environment = ap_abstract1_environment(
+			apron_manager, &wider);
+	std::vector<ap_linexpr0_t *> linexprs;
+	for (size_t dim = 0; dim < environment->intdim; dim++) {
+		ap_interval_t * before = ap_abstract0_bound_dimension(apron_manager,
+				other.abstract0, dim);
+		ap_interval_t * after = ap_abstract0_bound_dimension(apron_manager,
+				wider.abstract0, dim);
+		int64_t threshold;
+		if (!ap_interval_is_bottom(before)) {
+			if ((ap_scalar_infty(after->sup) > 0) &&
+					findThreshold(before->sup, thresholds, true, threshold)) {
+				// c - x >= 0
+				ap_linexpr0_t * linexpr = ap_linexpr0_alloc(AP_LINEXPR_SPARSE, 1);
+				linexpr->p.linterm[0].dim = dim;
+				ap_coeff_set_scalar_int(&linexpr->p.linterm[0].coeff, -1);
+				ap_coeff_set_scalar_int(&linexpr->cst, threshold);
+				linexprs.push_back(linexpr);
+			}
+			if ((ap_scalar_infty(after->inf) < 0) &&
+					findThreshold(before->inf, thresholds, false, threshold)) {
+				// x - c >= 0
+				ap_linexpr0_t * linexpr = ap_linexpr0_alloc(AP_LINEXPR_SPARSE, 1);
+				linexpr->p.linterm[0].dim = dim;
+				ap_coeff_set_scalar_int(&linexpr->p.linterm[0].coeff, 1);
+				ap_coeff_set_scalar_int(&linexpr->cst, -threshold);
+				linexprs.push_back(linexpr);
+			}
+		}
+		ap_interval_free(before);
+		ap_interval_free(after);
+	}
+	ap_lincons1_array_t array = ap_lincons1_array_make(environment,
+			linexprs.size());
+	for (size_t idx = 0; idx < linexprs.size(); idx++) {
+		array.lincons0_array.p[idx] = ap_lincons0_make(
+				AP_CONS_SUPEQ, linexprs[idx], NULL);
+	}
+	return array;
+}
+
 bool ApronAbstractState::widen(const ApronAbstractState & other) {
+	return widen(other, std::vector<int64_t>());
+}
+
+bool ApronAbstractState::widen(const ApronAbstractState & other,
+		const std::vector<int64_t> & thresholds) {
 	ap_abstract1_t prev = ap_abstract1_copy(apron_manager, &m_abstract1);
 	ap_abstract1_t other_abst = ap_abstract1_copy(apron_manager, (ap_abstract1_t*)&other.m_abstract1);
 	ap_abstract1_t this_abst = ap_abstract1_copy(apron_manager, &m_abstract1);
@@ -92,6 +199,17 @@ bool ApronAbstractState::widen(const ApronAbstractState & other) {
 	}
 	m_abstract1 = ap_abstract1_widening(apron_manager,
 			&this_abst, &other_abst);
+	if (!thresholds.empty()) {
+		ap_lincons1_array_t array = makeThresholdConstraints(
+				other_abst, m_abstract1, thresholds);
+		if (ap_lincons1_array_size(&array) > 0) {
+			ap_abstract1_clear(apron_manager, &m_abstract1);
+			m_abstract1 = ap_abstract1_widening_threshold(apron_manager,
+					&this_abst, &other_abst, &array);
+		}
+		ap_lincons1_array_clear(&array);
+	}
+	AnalysisBudget::getInstance().checkApronException(apron_manager, "widen");
 	bool isChanged = (*this != prev);
 	ap_abstract1_clear(apron_manager, &other_abst);
 	ap_abstract1_clear(apron_manager, &this_abst);
@@ -105,6 +223,7 @@ bool ApronAbstractState::join(const ApronAbstractState & other) {
 
 	m_abstract1 = ap_abstract1_join(apron_manager, true,
 			&m_abstract1, &other_abst);
+	AnalysisBudget::getInstance().checkApronException(apron_manager, "join");
 	bool isChanged = (*this != ApronAbstractState(prev));
 	ap_abstract1_clear(apron_manager, &other_abst);
 	return isChanged;
@@ -118,6 +237,7 @@ bool ApronAbstractState::meet(const ApronAbstractState & other) {
 	ap_abstract1_clear(apron_manager, &m_abstract1);
 	m_abstract1 = ap_abstract1_meet(apron_manager, true,
 			&this_abst, &other_abst);
+	AnalysisBudget::getInstance().checkApronException(apron_manager, "meet");
 	bool isChanged = (*this != ApronAbstractState(prev));
 	ap_abstract1_clear(apron_manager, &other_abst);
 	return isChanged;
@@ -148,6 +268,7 @@ bool ApronAbstractState::join(const std::vector<ApronAbstractState> & others) {
 	}
 	m_abstract1 = ap_abstract1_join_array(apron_manager,
 			values.data(), values.size());
+	AnalysisBudget::getInstance().checkApronException(apron_manager, "join");
 	for (ap_abstract1_t & value : values) {
 		ap_abstract1_clear(apron_manager, &value);
 	}
@@ -155,6 +276,18 @@ bool ApronAbstractState::join(const std::vector<ApronAbstractState> & others) {
 }
 
 void ApronAbstractState::assign(const std::string & var, ap_texpr1_t * value) {
+	flush_meet_aggregate();
+	if (m_isAssignAggregate) {
+		// The queued assignments are parallel. Apply them first if this
+		// one reads or redefines any of them.
+		if (isAssignAggregateDependent(var, value)) {
+			flush_assign_aggregate();
+		}
+		extend(var, false);
+		m_assignAggregateVars.push_back(var);
+		m_assignAggregateValues.push_back(value);
+		return;
+	}
 	ap_var_t apvar = (ap_var_t)var.c_str();
 	if (!isKnown(var)) {
 		extend(var, false);
@@ -168,6 +301,37 @@ void ApronAbstractState::assign(const std::string & var, ap_texpr1_t * value) {
 				&m_abstract1, aptmpvar, value, NULL);
 		rename(tmp_name, var);
 	}
+	AnalysisBudget::getInstance().checkApronException(apron_manager, "assign");
+}
+
+// Parallel assignment. Takes ownership of values.
+void ApronAbstractState::assign(const std::vector<std::string> & vars,
+		const std::vector<ap_texpr1_t *> & values) {
+	assert(vars.size() == values.size());
+	if (vars.empty()) {
+		return;
+	}
+	flush_meet_aggregate();
+	for (const std::string & var : vars) {
+		extend(var, false);
+	}
+	ap_environment_t * environment = getEnvironment();
+	std::vector<ap_var_t> apvars;
+	std::vector<ap_texpr1_t> texprs;
+	apvars.reserve(vars.size());
+	texprs.reserve(values.size());
+	for (unsigned idx = 0; idx < vars.size(); idx++) {
+		apvars.push_back((ap_var_t)vars[idx].c_str());
+		bool failed = ap_texpr1_extend_environment_with(values[idx], environment);
+		assert(!failed);
+		texprs.push_back(*values[idx]);
+	}
+	m_abstract1 = ap_abstract1_assign_texpr_array(apron_manager, true,
+			&m_abstract1, apvars.data(), texprs.data(), texprs.size(), NULL);
+	AnalysisBudget::getInstance().checkApronException(apron_manager, "assign");
+	for (ap_texpr1_t * value : values) {
+		ap_texpr1_free(value);
+	}
 }
 
 void ApronAbstractState::extend(const std::string & var, bool isBottom) {
@@ -175,7 +339,8 @@ void ApronAbstractState::extend(const std::string & var, bool isBottom) {
 		return;
 	}
 	ap_environment_t * environment = ap_abstract1_environment(apron_manager, &m_abstract1);
-	ap_var_t apvar = (ap_var_t)strdup(var.c_str());
+	// The environment copies the name
+	ap_var_t apvar = (ap_var_t)var.c_str();
 	environment = ap_environment_add(environment, &apvar, 1, NULL, 0);
 	m_abstract1 = ap_abstract1_change_environment(apron_manager, true,
 			&m_abstract1, environment, isBottom);
@@ -185,7 +350,15 @@ void ApronAbstractState::forget(const std::string & varname, bool isBottom) {
 	if (!isKnown(varname)) {
 		return;
 	}
+	flush_meet_aggregate();
 	ap_var_t var = (ap_var_t)varname.c_str();
+	for (unsigned idx = 0; idx < m_assignAggregateVars.size(); idx++) {
+		if ((m_assignAggregateVars[idx] == varname) ||
+				ap_texpr1_has_var(m_assignAggregateValues[idx], var)) {
+			flush_assign_aggregate();
+			break;
+		}
+	}
 	m_abstract1 = ap_abstract1_forget_array(apron_manager, false,
 			&m_abstract1, &var, 1, isBottom);
 }
@@ -210,6 +383,8 @@ void ApronAbstractState::start_meet_aggregate() {
 
 void ApronAbstractState::meet(ap_tcons1_t & cons) {
 	if (m_isMeetAggregate) {
+		// The guard reads the values assigned so far
+		flush_assign_aggregate();
 		m_meetAggregates.push_back(cons);
 	} else {
 		extendEnvironment(&cons);
@@ -237,17 +412,70 @@ void ApronAbstractState::finish_meet_aggregate() {
 	m_meetAggregates.clear();
 }
 
+void ApronAbstractState::flush_meet_aggregate() {
+	if (m_meetAggregates.empty()) {
+		return;
+	}
+	bool isMeetAggregate = m_isMeetAggregate;
+	finish_meet_aggregate();
+	m_isMeetAggregate = isMeetAggregate;
+}
+
+void ApronAbstractState::start_assign_aggregate() {
+	m_isAssignAggregate = true;
+}
+
+bool ApronAbstractState::isAssignAggregateDependent(const std::string & var,
+		ap_texpr1_t * value) const {
+	for (const std::string & pending : m_assignAggregateVars) {
+		if (pending == var) {
+			return true;
+		}
+		ap_var_t apvar = (ap_var_t)pending.c_str();
+		if (ap_texpr1_has_var(value, apvar)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void ApronAbstractState::flush_assign_aggregate() {
+	if (m_assignAggregateVars.empty()) {
+		return;
+	}
+	bool isAssignAggregate = m_isAssignAggregate;
+	m_isAssignAggregate = false;
+	assign(m_assignAggregateVars, m_assignAggregateValues);
+	m_assignAggregateVars.clear();
+	m_assignAggregateValues.clear();
+	m_isAssignAggregate = isAssignAggregate;
+}
+
+void ApronAbstractState::finish_assign_aggregate() {
+	flush_assign_aggregate();
+	m_isAssignAggregate = false;
+}
+
+void ApronAbstractState::clear_aggregates() {
+	for (ap_texpr1_t * value : m_assignAggregateValues) {
+		ap_texpr1_free(value);
+	}
+	m_assignAggregateVars.clear();
+	m_assignAggregateValues.clear();
+	m_meetAggregates.clear();
+}
+
+// The pending operations would apply to the new value. operator= drops them.
 void ApronAbstractState::makeTop() {
 	*this = ApronAbstractState::top();
-	m_meetAggregates.clear();
 }
 
 void ApronAbstractState::makeBottom() {
 	*this = ApronAbstractState::bottom();
-	m_meetAggregates.clear();
 }
 
 void ApronAbstractState::rename(const std::string & orig, const std::string & new_) {
+	flush_meet_aggregate();
 	ap_var_t origapvar = (ap_var_t)orig.c_str();
 	ap_var_t newapvar = (ap_var_t)new_.c_str();
 	if (isKnown(new_)) {
@@ -291,14 +519,18 @@ std::map<std::string, std::string> ApronAbstractState::renameVarsForC() {
 	std::vector<ap_var_t> oldnames;
 	std::vector<ap_var_t> newnames;
 	std::set<std::string> newnamesSet;
+	// Own the new names until the environment copies them
+	std::vector<std::string> newnamesStorage;
 	ap_environment_t * environment = getEnvironment();
 	int env_size = environment->intdim;
+	newnamesStorage.reserve(env_size);
 	for (int cnt = 0; cnt < env_size; cnt++) {
 		ap_var_t var = ap_environment_var_of_dim(environment, cnt);
 		std::string varName = (char*)var;
 		std::string newName = renameVarForC(varName);
 		oldnames.push_back(var);
-		newnames.push_back((ap_var_t)strdup(newName.c_str()));
+		newnamesStorage.push_back(newName);
+		newnames.push_back((ap_var_t)newnamesStorage.back().c_str());
 		renameMap[varName] = newName;
 		bool collision = !newnamesSet.insert(newName).second;
 		assert(!collision);
@@ -312,6 +544,7 @@ std::map<std::string, std::string> ApronAbstractState::renameVarsForC() {
 void ApronAbstractState::meet(ap_tcons1_array_t & tconsarray) {
 	m_abstract1 = ap_abstract1_meet_tcons_array(
 			apron_manager, true, &m_abstract1, &tconsarray);
+	AnalysisBudget::getInstance().checkApronException(apron_manager, "meet");
 }
 
 bool ApronAbstractState::isTop() const {
@@ -380,6 +613,12 @@ bool ApronAbstractState::isConstrained(const std::string & var) const {
 }
 
 
+size_t ApronAbstractState::hash() const {
+	ap_environment_t * environment = getEnvironment();
+	int hash = ap_abstract1_hash(apron_manager, (ap_abstract1_t*)&m_abstract1);
+	return (size_t)environment->intdim * 31 + (unsigned)hash;
+}
+
 ap_texpr1_t * ApronAbstractState::asTexpr(const std::string & var) {
 	extend(var);
 	ap_var_t apvar = (ap_var_t)var.c_str();
@@ -1,88 +1,120 @@
 #include <AbstractStates/MPTAbstractState.h>
+#include <SymbolTable.h>
 
 #include <cassert>
 #include <algorithm>
 
 // MPTItemAbstractState
 
+MPTItemAbstractState::const_iterator::const_iterator(
+		const MPTBufferSet * buffers, unsigned index) :
+				m_buffers(buffers), m_index(index) {
+	skip();
+}
+
+void MPTItemAbstractState::const_iterator::skip() {
+	while ((m_index < MPT_MAX_BUFFERS) && !m_buffers->test(m_index)) {
+		++m_index;
+	}
+}
+
+const std::string & MPTItemAbstractState::const_iterator::operator*() const {
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	return symbols.getName(symbols.getBuffer(m_index));
+}
+
+MPTItemAbstractState::const_iterator &
+		MPTItemAbstractState::const_iterator::operator++() {
+	++m_index;
+	skip();
+	return *this;
+}
+
 MPTItemAbstractState::MPTItemAbstractState(
-		const std::set<std::string> & buffers, bool isWritable) :
+		const MPTBufferSet & buffers, bool isWritable) :
 				m_buffers(buffers), m_isWritable(isWritable) {}
 
+MPTItemAbstractState::MPTItemAbstractState(
+		unsigned buffer, bool isWritable) : m_isWritable(isWritable) {
+	m_buffers.set(buffer);
+}
+
 MPTItemAbstractState::MPTItemAbstractState() : m_isWritable(true) {}
 
-const std::set<std::string> & MPTItemAbstractState::getBuffers() const {
+const MPTBufferSet & MPTItemAbstractState::getBuffers() const {
 	return m_buffers;
 }
 
-void MPTItemAbstractState::insert(std::string buffer) {
+void MPTItemAbstractState::insert(unsigned buffer) {
 	if (m_isWritable) {
-		m_buffers.insert(buffer);
+		m_buffers.set(buffer);
 	}
 }
 
-void MPTItemAbstractState::erase(std::string buffer) {
+void MPTItemAbstractState::insert(const std::string & buffer) {
+	insert(SymbolTable::getCurrent().getBufferIndex(buffer));
+}
+
+void MPTItemAbstractState::erase(unsigned buffer) {
 	if (m_isWritable) {
-		m_buffers.erase(buffer);
+		m_buffers.reset(buffer);
 	}
 }
 
+void MPTItemAbstractState::erase(const std::string & buffer) {
+	erase(SymbolTable::getCurrent().getBufferIndex(buffer));
+}
+
 void MPTItemAbstractState::clear() {
 	if (m_isWritable) {
-		m_buffers.clear();
+		m_buffers.reset();
 	}
 }
 
-std::set<std::string>::const_iterator MPTItemAbstractState::begin() const {
-	return m_buffers.begin();
+MPTItemAbstractState::const_iterator MPTItemAbstractState::begin() const {
+	return const_iterator(&m_buffers, 0);
 }
 
-std::set<std::string>::const_iterator MPTItemAbstractState::end() const {
-	return m_buffers.end();
+MPTItemAbstractState::const_iterator MPTItemAbstractState::end() const {
+	return const_iterator(&m_buffers, MPT_MAX_BUFFERS);
 }
 
 bool MPTItemAbstractState::join(const MPTItemAbstractState & other) {
 	assert(isWritable() || (m_buffers == other.m_buffers));
-	bool isChanged = false;
-	for (const std::string & userPtr : other.m_buffers) {
-		auto inserted = m_buffers.insert(userPtr);
-		isChanged = isChanged || inserted.second;
-	}
-	return isChanged;
+	MPTBufferSet prev = m_buffers;
+	m_buffers |= other.m_buffers;
+	return (prev != m_buffers);
 }
 
 bool MPTItemAbstractState::meet(const MPTItemAbstractState & other) {
 	assert(isWritable() || (m_buffers == other.m_buffers));
-	bool isChanged = false;
-	for (std::set<std::string>::iterator it = m_buffers.begin(), ie = m_buffers.end();
-			it != ie; it++) {
-		if (other.contains(*it)) {
-			continue;
-		}
-		it = m_buffers.erase(it);
-		isChanged = true;
-	}
-	return isChanged;
+	MPTBufferSet prev = m_buffers;
+	m_buffers &= other.m_buffers;
+	return (prev != m_buffers);
 }
 
 bool MPTItemAbstractState::isProvablyNull() const {
-	return (m_buffers.size() == 1) && (m_buffers.count("null") == 1);
+	return (m_buffers == MPTBufferSet(1ULL << MPT_BUFFER_NULL));
 }
 
 bool MPTItemAbstractState::isProvablyKernel() const {
-	return (m_buffers.size() == 1) && (m_buffers.count("kernel") == 1);
+	return (m_buffers == MPTBufferSet(1ULL << MPT_BUFFER_KERNEL));
 }
 
 bool MPTItemAbstractState::empty() const {
-	return m_buffers.empty();
+	return m_buffers.none();
 }
 
 bool MPTItemAbstractState::isWritable() const {
 	return m_isWritable;
 }
 
+bool MPTItemAbstractState::contains(unsigned buffer) const {
+	return m_buffers.test(buffer);
+}
+
 bool MPTItemAbstractState::contains(const std::string & name) const {
-	return (m_buffers.count(name) == 1);
+	return contains(SymbolTable::getCurrent().getBufferIndex(name));
 }
 
 bool MPTItemAbstractState::operator==(const MPTItemAbstractState & other) const {
@@ -94,48 +126,47 @@ bool MPTItemAbstractState::operator!=(const MPTItemAbstractState & other) const
 }
 
 void MPTItemAbstractState::updateToIntersection(MPTItemAbstractState & left, MPTItemAbstractState & right) {
-	std::set<std::string> intersection;
-	std::set_intersection(left.begin(), left.end(), right.begin(), right.end(),
-			std::inserter(intersection, intersection.end()));
+	MPTBufferSet intersection = left.m_buffers & right.m_buffers;
 	if (left.m_isWritable) {
-		left.clear();
-		left.m_buffers.insert(intersection.begin(), intersection.end());
+		left.m_buffers = intersection;
 	}
 	if (right.m_isWritable) {
-		right.clear();
-		right.m_buffers.insert(intersection.begin(), intersection.end());
+		right.m_buffers = intersection;
 	}
 }
 // MPTAbstractState
 
 MPTAbstractState::MPTAbstractState() {
-	m_mayPointsTo.insert(std::make_pair("null",
-			MPTItemAbstractState({"null"}, false)));
+	extend("null") = MPTItemAbstractState(MPT_BUFFER_NULL, false);
 }
 
 MPTAbstractState::MPTAbstractState(std::vector<std::string> buffers) {
+	SymbolTable & symbols = SymbolTable::getCurrent();
 	for (const std::string & buffer : buffers) {
-		std::set<std::string> identBuffers;
-		identBuffers.insert(buffer);
-		m_mayPointsTo.insert(std::make_pair(
-				buffer, MPTItemAbstractState(identBuffers, false)));
+		extend(buffer) = MPTItemAbstractState(
+				symbols.getBufferIndex(buffer), false);
 	}
-	m_mayPointsTo.insert(std::make_pair("null",
-			MPTItemAbstractState({"null"}, false)));
+	extend("null") = MPTItemAbstractState(MPT_BUFFER_NULL, false);
 }
 
 bool MPTAbstractState::join(const MPTAbstractState & other) {
 	bool isChanged = false;
-	for (auto & otherpt : other.m_mayPointsTo) {
-		std::string name = otherpt.first;
-		const MPTItemAbstractState & buffers = otherpt.second;
-		auto pt_it = m_mayPointsTo.find(name);
-		if (pt_it == m_mayPointsTo.end()) {
+	unsigned otherSize = other.m_items.size();
+	if (m_items.size() < otherSize) {
+		m_items.resize(otherSize);
+		m_isPresent.resize(otherSize, false);
+	}
+	for (unsigned idx = 0; idx < otherSize; idx++) {
+		if (!other.m_isPresent[idx]) {
+			continue;
+		}
+		if (!m_isPresent[idx]) {
 			isChanged = true;
-			m_mayPointsTo.insert(std::make_pair(name,
-					MPTItemAbstractState(buffers.getBuffers(), true)));
+			m_isPresent[idx] = true;
+			m_items[idx] = MPTItemAbstractState(
+					other.m_items[idx].getBuffers(), true);
 		} else {
-			isChanged = pt_it->second.join(buffers) || isChanged;
+			isChanged = m_items[idx].join(other.m_items[idx]) || isChanged;
 		}
 	}
 	return isChanged;
@@ -143,60 +174,103 @@ bool MPTAbstractState::join(const MPTAbstractState & other) {
 
 bool MPTAbstractState::meet(const MPTAbstractState & other) {
 	bool isChanged = false;
-	for (std::map<std::string, MPTItemAbstractState >::iterator it = m_mayPointsTo.begin(),
-			ie = m_mayPointsTo.end();
-			it != ie; it++) {
-		const std::string & name = it->first;
-		MPTItemAbstractState & buffers = it->second;
-		auto pt_it = other.m_mayPointsTo.find(name);
-		if (pt_it == other.m_mayPointsTo.end()) {
+	unsigned otherSize = other.m_items.size();
+	for (unsigned idx = 0; idx < m_items.size(); idx++) {
+		if (!m_isPresent[idx]) {
+			continue;
+		}
+		if ((idx >= otherSize) || !other.m_isPresent[idx]) {
 			// delete it
-			it = m_mayPointsTo.erase(it);
+			m_isPresent[idx] = false;
+			m_items[idx] = MPTItemAbstractState();
 			isChanged = true;
 		} else {
 			// intersect
-			const MPTItemAbstractState & other_buffers = pt_it->second;
-			isChanged = buffers.meet(other_buffers) || isChanged;
+			isChanged = m_items[idx].meet(other.m_items[idx]) || isChanged;
 		}
 	}
 	return isChanged;
 }
 
 void MPTAbstractState::forget(const std::string & name) {
-	std::map<std::string, MPTItemAbstractState>::iterator it = m_mayPointsTo.find(name);
-	if (it == m_mayPointsTo.end()) {
+	unsigned idx = SymbolTable::getCurrent().findPointerIndex(name);
+	if ((idx >= m_items.size()) || !m_isPresent[idx]) {
 		return;
 	}
-	assert(it->second.isWritable());
-	m_mayPointsTo.erase(it);
-	assert(m_mayPointsTo.find(name) == m_mayPointsTo.end());
+	assert(m_items[idx].isWritable());
+	m_isPresent[idx] = false;
+	m_items[idx] = MPTItemAbstractState();
 }
 
 MPTItemAbstractState & MPTAbstractState::extend(const std::string& name) {
-	return m_mayPointsTo[name];
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	unsigned idx = symbols.getPointerIndex(name);
+	if (idx >= m_items.size()) {
+		// Make room for every pointer known so far, to resize rarely
+		unsigned size = std::max(idx + 1, symbols.getPointerCount());
+		m_items.resize(size);
+		m_isPresent.resize(size, false);
+	}
+	m_isPresent[idx] = true;
+	return m_items[idx];
 }
 
 void MPTAbstractState::clear() {
-	for (std::map<std::string, MPTItemAbstractState >::iterator it = m_mayPointsTo.begin(),
-	                                                            ie = m_mayPointsTo.end();
-			it != ie; it++) {
-		MPTItemAbstractState & item = it->second;
-		if (item.isWritable()) {
-			it = m_mayPointsTo.erase(it);
+	for (unsigned idx = 0; idx < m_items.size(); idx++) {
+		if (m_isPresent[idx] && m_items[idx].isWritable()) {
+			m_isPresent[idx] = false;
+			m_items[idx] = MPTItemAbstractState();
 		}
 	}
 }
 
-MPTItemAbstractState * MPTAbstractState::find(const std::string& name) {
-	std::map<std::string, MPTItemAbstractState>::iterator it = m_mayPointsTo.find(name);
-	if (it == m_mayPointsTo.end()) {
+unsigned MPTAbstractState::size() const {
+	return m_items.size();
+}
+
+const std::string & MPTAbstractState::getPointerName(unsigned index) const {
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	return symbols.getName(symbols.getPointer(index));
+}
+
+MPTItemAbstractState * MPTAbstractState::find(unsigned index) {
+	if ((index >= m_items.size()) || !m_isPresent[index]) {
 		return 0;
 	}
-	return &it->second;
+	return &m_items[index];
+}
+
+const MPTItemAbstractState * MPTAbstractState::find(unsigned index) const {
+	if ((index >= m_items.size()) || !m_isPresent[index]) {
+		return 0;
+	}
+	return &m_items[index];
+}
+
+MPTItemAbstractState * MPTAbstractState::find(const std::string& name) {
+	return find(SymbolTable::getCurrent().findPointerIndex(name));
+}
+
+MPTItemAbstractState * MPTAbstractState::findSymbol(SymbolId symbolId) {
+	return find(SymbolTable::getCurrent().getSymbol(symbolId).pointerIndex);
 }
 
 bool MPTAbstractState::operator==(const MPTAbstractState& other) const {
-	return (m_mayPointsTo == other.m_mayPointsTo);
+	unsigned size = std::max(m_items.size(), other.m_items.size());
+	for (unsigned idx = 0; idx < size; idx++) {
+		const MPTItemAbstractState * item = find(idx);
+		const MPTItemAbstractState * otherItem = other.find(idx);
+		if (!item || !otherItem) {
+			if (item != otherItem) {
+				return false;
+			}
+			continue;
+		}
+		if (*item != *otherItem) {
+			return false;
+		}
+	}
+	return true;
 }
 
 bool MPTAbstractState::operator!=(const MPTAbstractState& other) const {
@@ -1,16 +1,19 @@
 #include <BasicBlock.h>
 #include <Value.h>
 #include <Function.h>
+#include <FixpointProfiler.h>
 extern "C" {
 #include <Adaptor.h>
 }
 #include <APStream.h>
 
+#include <cassert>
 #include <cstdio>
 #include <iostream>
 #include <sstream>
 
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/IR/Function.h>
 #include <llvm/IR/Instructions.h>
 
 #include <ap_global0.h>
@@ -25,6 +28,9 @@ extern "C" {
 #include <ap_ppl.h>
 
 extern bool Debug;
+extern bool BatchTransfer;
+extern bool MemoizeTransfer;
+extern bool LazyOffsets;
 // TODO This should go in apron lib
 void ap_tcons1_array_resize(ap_tcons1_array_t * array, size_t size) {
 	ap_tcons0_array_resize(&(array->tcons0_array), size);
@@ -41,6 +47,18 @@ BasicBlock * BasicBlockManager::createBasicBlock(llvm::BasicBlock * basicBlock)
 	return result;
 }
 
+void BasicBlockManager::releaseFunction(llvm::Function * function) {
+	for (llvm::BasicBlock & basicBlock : *function) {
+		std::map<llvm::BasicBlock *, BasicBlock *>::iterator it =
+				instances.find(&basicBlock);
+		if (it == instances.end()) {
+			continue;
+		}
+		delete it->second;
+		instances.erase(it);
+	}
+}
+
 BasicBlock * BasicBlockManager::getBasicBlock(llvm::BasicBlock * basicBlock) {
 	std::map<llvm::BasicBlock *, BasicBlock *>::iterator it =
 			instances.find(basicBlock);
@@ -60,6 +78,8 @@ int BasicBlock::basicBlockCount = 0;
 
 BasicBlock::BasicBlock(llvm::BasicBlock * basicBlock) :
 		m_basicBlock(basicBlock),
+		m_isReleased(false),
+		m_releasedMos(memory_operation_state_bottom),
 		updateCount(0) {
 	if (!basicBlock->hasName()) {
 		initialiseBlockName();
@@ -142,6 +162,10 @@ void BasicBlock::extendTconsEnvironment(ap_tcons1_t * tcons) {
 void BasicBlock::updateAbstract1MetWithIncomingPhis(BasicBlock & basicBlock, AbstractState & otherAS) {
 	Value * terminator = basicBlock.getTerminatorValue();
 	terminator->updateAssumptions(&basicBlock, this, otherAS);
+	if (BatchTransfer) {
+		assignIncomingPhis(basicBlock, otherAS);
+		return;
+	}
 	ValueFactory * factory = ValueFactory::getInstance();
 	llvm::BasicBlock * llvmBB = getLLVMBasicBlock();
 	for (auto iit = llvmBB->begin(), iie = llvmBB->end(); iit != iie; iit++) {
@@ -172,21 +196,96 @@ void BasicBlock::updateAbstractStateMetWithIncomingPhis(
 		Value * incomingValue = factory->getValue(incoming);
 		const std::string & phiname = phiValue->getName();
 		otherAS.m_mayPointsTo.forget(phiname);
-		const std::set<std::string> * buffers = incomingValue->mayPointsToUserBuffers(otherAS);
+		const MPTItemAbstractState * buffers = incomingValue->mayPointsToUserBuffers(otherAS);
 		if (buffers) {
-			auto & dest = otherAS.m_mayPointsTo.extend(phiname);
-			for (const std::string & buffer : *buffers) {
-				dest.insert(buffer);
-			}
+			MPTItemAbstractState incomingBuffers = *buffers;
+			otherAS.m_mayPointsTo.extend(phiname).join(incomingBuffers);
 		}
 	}
 }
 
+void BasicBlock::assignIncomingPhis(
+		BasicBlock & predecessor, AbstractState & state) {
+	// All incoming values are read before any PHI is assigned, as PHIs
+	// may read each other (e.g. a swap in a loop)
+	std::vector<std::string> names;
+	std::vector<ap_texpr1_t *> values;
+	std::vector<std::pair<Value *, MPTItemAbstractState> > pointerPhis;
+	std::vector<Value *> unknownPointerPhis;
+	std::vector<PointerAssignment> lazyPointerPhis;
+	ValueFactory * factory = ValueFactory::getInstance();
+	llvm::BasicBlock * llvmBB = getLLVMBasicBlock();
+	llvm::BasicBlock * llvmPredecessor = predecessor.getLLVMBasicBlock();
+	for (auto iit = llvmBB->begin(), iie = llvmBB->end(); iit != iie; iit++) {
+		llvm::PHINode * phi = llvm::dyn_cast<llvm::PHINode>(iit);
+		if (!phi) {
+			// PHIs are grouped at the start of the block
+			break;
+		}
+		Value * phiValue = factory->getValue(phi);
+		Value * incomingValue = factory->getValue(
+				phi->getIncomingValueForBlock(llvmPredecessor));
+		if (!phiValue->isPointer()) {
+			names.push_back(phiValue->getName());
+			values.push_back(incomingValue->createTreeExpression(state));
+			continue;
+		}
+		const MPTItemAbstractState * buffers =
+				incomingValue->mayPointsToUserBuffers(state);
+		if (LazyOffsets) {
+			lazyPointerPhis.push_back(PointerAssignment(
+					phiValue->getName(), incomingValue->getName(), buffers));
+			continue;
+		}
+		if (!buffers) {
+			unknownPointerPhis.push_back(phiValue);
+			continue;
+		}
+		pointerPhis.push_back(std::make_pair(phiValue, MPTItemAbstractState(
+				buffers->getBuffers(), true)));
+		SymbolTable & symbols = SymbolTable::getCurrent();
+		for (auto it = buffers->begin(), ie = buffers->end(); it != ie; ++it) {
+			SymbolId buffer = symbols.getBuffer(it.index());
+			names.push_back(AbstractState::generateOffsetName(
+					phiValue->getNameId(), buffer));
+			values.push_back(state.m_apronAbstractState.asTexpr(
+					AbstractState::generateOffsetName(
+							incomingValue->getNameId(), buffer)));
+		}
+	}
+	for (Value * phiValue : unknownPointerPhis) {
+		state.m_mayPointsTo.forget(phiValue->getName());
+	}
+	for (auto & pointerPhi : pointerPhis) {
+		state.m_mayPointsTo.extend(pointerPhi.first->getName()) =
+				pointerPhi.second;
+	}
+	state.m_apronAbstractState.assign(names, values);
+	if (!lazyPointerPhis.empty()) {
+		state.assignPtrsToPtrs(lazyPointerPhis);
+	}
+}
+
 AbstractState BasicBlock::getAbstractStateWithAssumptions(
 		BasicBlock & predecessor, AbstractState & state) {
+	size_t fingerprint = 0;
+	if (MemoizeTransfer) {
+		fingerprint = state.hash();
+		const AbstractState * cached =
+				m_edgeCaches[&predecessor].find(state, fingerprint);
+		if (cached) {
+			return *cached;
+		}
+	}
 	AbstractState otherAS = state;
-	updateAbstractStateMetWithIncomingPhis(predecessor, otherAS);
+	if (!BatchTransfer) {
+		// Otherwise done together with the numeric PHIs
+		updateAbstractStateMetWithIncomingPhis(predecessor, otherAS);
+	}
 	updateAbstract1MetWithIncomingPhis(predecessor, otherAS);
+	if (MemoizeTransfer) {
+		m_edgeCaches[&predecessor].insert(state, fingerprint, otherAS);
+	}
 	return otherAS;
 }
 
@@ -210,30 +309,63 @@ bool BasicBlock::isBottom() {
 
 void BasicBlock::update(AbstractState & state) {
 	++updateCount;
-	/* Process the block. Return true if the block's context is modified.*/
+	if (!MemoizeTransfer) {
+		transfer(state);
+		return;
+	}
+	Function * function = getFunction();
+	size_t fingerprint = state.hash();
+	const BlockTransferResult * cached = m_blockCache.find(state, fingerprint);
+	if (cached) {
+		if (cached->isHasMemOpsState) {
+			function->joinSuccessState(cached->memOpsState);
+		}
+		state = cached->state;
+		return;
+	}
+	BlockTransferResult result;
+	AbstractState input = state;
+	result.isHasMemOpsState = transfer(state, &result.memOpsState);
+	result.state = state;
+	m_blockCache.insert(input, fingerprint, result);
+}
+
+bool BasicBlock::transfer(AbstractState & state,
+		ApronAbstractState * memOpsState, bool isReplay) {
+	/* Process the block. Return true if a memory operation state was recorded.*/
 
-	ApronAbstractState & aas = state.m_apronAbstractState;
 	AbstractState prev = state;
 	llvm::BasicBlock::iterator it;
 	for (it = m_basicBlock->begin(); it != m_basicBlock->end(); it ++) {
 		llvm::Instruction & inst = *it;
-		processInstruction(state, inst);
+		processInstruction(state, inst, !isReplay);
 	}
+	flushAssignments(state, !isReplay);
 	Function * function = getFunction();
-	if (!state.memoryAccessAbstractValues.empty()) {
-		function->m_memOpsAbstractStates[this] = state;
-		AbstractState & copy = function->m_memOpsAbstractStates[this];
+	bool isHasMemOpsState = !state.memoryAccessAbstractValues.empty();
+	if (isHasMemOpsState && isReplay) {
+		// Already joined into the success state by the fixpoint
+		state.memoryAccessAbstractValues.clear();
+	} else if (isHasMemOpsState) {
+		AbstractState copy = state;
 		state.memoryAccessAbstractValues.clear();
 		copy.updateUserOperationAbstract1();
 		if (Debug) {
 			llvm::errs() << getName() << ": State with memory: " << copy << "\n";
 		}
+		// Only the in/out variables are kept
+		ApronAbstractState projected = function->minimize(copy.m_apronAbstractState);
+		function->joinSuccessState(projected);
+		if (memOpsState) {
+			*memOpsState = projected;
+		}
 	}
-	std::vector<std::string> userBuffers = function->getUserPointers();
+	const std::vector<std::string> & userBuffers = function->getUserPointers();
 	bool isReduceChanged = state.reduce(userBuffers);
 	if (Debug) {
 		llvm::errs() << getName() << ": Update: " << prev << " -> " << state;
 	}
+	return isHasMemOpsState;
 }
 
 Value * BasicBlock::getTerminatorValue() {
@@ -244,7 +376,7 @@ Value * BasicBlock::getTerminatorValue() {
 }
 
 void BasicBlock::processInstruction(AbstractState & state,
-		llvm::Instruction & inst) {
+		llvm::Instruction & inst, bool isProfiled) {
 	// TODO Circular dependancy (Still?)
 	ValueFactory * factory = ValueFactory::getInstance();
 	Value * value = factory->getValue(&inst);
@@ -262,16 +394,41 @@ void BasicBlock::processInstruction(AbstractState & state,
 			//// << scope->getFilename() << ": "
 			//<< debugLoc.getLine() << ": "
 			//<< value->toString() << "\n";
-	// TODO Is this needed?
-	state.m_apronAbstractState.forget(value->getName());
 	InstructionValue * instructionValue =
 			static_cast<InstructionValue*>(value);
+	bool isBatched = BatchTransfer && instructionValue->isBatchable();
+	if (isBatched) {
+		// Applied together at the next non-batchable instruction
+		state.m_apronAbstractState.start_assign_aggregate();
+	} else {
+		flushAssignments(state, isProfiled);
+	}
+	isProfiled = isProfiled && FixpointProfiler::isEnabled();
+	double start = isProfiled ? FixpointProfiler::now() : 0;
+	// TODO Is this needed?
+	state.m_apronAbstractState.forget(value->getName());
 	instructionValue->update(state);
-	if (state.m_apronAbstractState.isTop()) {
+	if (isProfiled) {
+		FixpointProfiler::getInstance().recordInstruction(this,
+				instructionValue->getKindName(), start,
+				FixpointProfiler::now());
+	}
+	if (!isBatched && state.m_apronAbstractState.isTop()) {
 		llvm::errs() << "Warning: Instruction " << value->getName() << " caused state to be top\n";
 	}
 }
 
+void BasicBlock::flushAssignments(AbstractState & state, bool isProfiled) {
+	// Nothing is queued without -batch-transfer
+	isProfiled = isProfiled && BatchTransfer && FixpointProfiler::isEnabled();
+	double start = isProfiled ? FixpointProfiler::now() : 0;
+	state.m_apronAbstractState.finish_assign_aggregate();
+	if (isProfiled) {
+		FixpointProfiler::getInstance().recordInstruction(this, "flush",
+				start, FixpointProfiler::now());
+	}
+}
+
 std::string BasicBlock::toString() {
 	std::ostringstream oss;
 	ApronAbstractState & aas = getAbstractState().m_apronAbstractState;
@@ -281,9 +438,58 @@ std::string BasicBlock::toString() {
 
 
 AbstractState & BasicBlock::getAbstractState() {
+	if (m_isReleased) {
+		recomputeAbstractState();
+	}
+	return m_abstractState;
+}
+
+AbstractState & BasicBlock::getStoredAbstractState() {
+	m_isReleased = false;
 	return m_abstractState;
 }
 
+memory_operation_state_e BasicBlock::getMemoryOperationState() {
+	if (m_isReleased) {
+		return m_releasedMos;
+	}
+	return m_abstractState.m_mos;
+}
+
+bool BasicBlock::isCutPoint() {
+	// getSinglePredecessor is NULL for the entry, and for more than one
+	// incoming edge. Every reachable loop contains a block with two
+	// incoming edges.
+	llvm::BasicBlock * predecessor = m_basicBlock->getSinglePredecessor();
+	return (!predecessor || (predecessor == m_basicBlock));
+}
+
+void BasicBlock::releaseAbstractState() {
+	assert(!isCutPoint());
+	m_releasedMos = m_abstractState.m_mos;
+	m_abstractState = AbstractState();
+	m_isReleased = true;
+}
+
+void BasicBlock::recomputeAbstractState() {
+	// Replay the transfer of the single predecessor, which is recomputed
+	// as well if it was released
+	BasicBlock * predecessor = BasicBlockManager::getInstance().getBasicBlock(
+			m_basicBlock->getSinglePredecessor());
+	AbstractState state = predecessor->getAbstractState();
+	const BlockTransferResult * cached = NULL;
+	if (MemoizeTransfer) {
+		cached = predecessor->m_blockCache.find(state, state.hash());
+	}
+	if (cached) {
+		state = cached->state;
+	} else {
+		predecessor->transfer(state, NULL, true);
+	}
+	m_abstractState = getAbstractStateWithAssumptions(*predecessor, state);
+	m_isReleased = false;
+}
+
 Function * BasicBlock::getFunction() {
 	FunctionManager & manager = FunctionManager::getInstance();
 	llvm::Function * function = m_basicBlock->getParent();
@@ -0,0 +1,127 @@
+#include <Budget.h>
+
+#include <cstdio>
+#include <unistd.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+extern unsigned FunctionTimeBudget;
+extern unsigned FunctionMemoryBudget;
+extern unsigned ApronOperationTimeout;
+extern unsigned ApronMaxObjectSize;
+
+// Reading /proc is not free. Sample the memory only every so many checks.
+static const unsigned MEMORY_CHECK_INTERVAL = 16;
+
+AnalysisBudget AnalysisBudget::instance;
+AnalysisBudget & AnalysisBudget::getInstance() {
+	return instance;
+}
+
+AnalysisBudget::AnalysisBudget() : m_startRSS(0), m_lastRSS(0),
+		m_checkCount(0), m_isDegraded(false) {
+	clock_gettime(CLOCK_MONOTONIC, &m_start);
+}
+
+void AnalysisBudget::configureManager(ap_manager_t * manager) {
+	for (int funid = AP_FUNID_COPY; funid < AP_FUNID_SIZE; funid++) {
+		ap_funopt_t funopt = ap_manager_get_funopt(manager, (ap_funid_t)funid);
+		funopt.timeout = ApronOperationTimeout;
+		funopt.max_object_size = ApronMaxObjectSize;
+		ap_manager_set_funopt(manager, (ap_funid_t)funid, &funopt);
+	}
+	// A timed out or oversized operation returns a sound approximation.
+	// Record it (see checkApronException) rather than abort the process.
+	ap_manager_set_abort_if_exception(manager, AP_EXC_TIMEOUT, false);
+	ap_manager_set_abort_if_exception(manager, AP_EXC_OUT_OF_SPACE, false);
+}
+
+size_t AnalysisBudget::getResidentSetSize() {
+	FILE * statm = fopen("/proc/self/statm", "r");
+	if (!statm) {
+		return 0;
+	}
+	unsigned long size = 0;
+	unsigned long resident = 0;
+	int matched = fscanf(statm, "%lu %lu", &size, &resident);
+	fclose(statm);
+	if (matched != 2) {
+		return 0;
+	}
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+void AnalysisBudget::start() {
+	clock_gettime(CLOCK_MONOTONIC, &m_start);
+	m_startRSS = getResidentSetSize();
+	m_lastRSS = m_startRSS;
+	m_checkCount = 0;
+	m_isDegraded = false;
+	m_degradedReason.clear();
+}
+
+double AnalysisBudget::getElapsedSeconds() const {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - m_start.tv_sec) +
+			(now.tv_nsec - m_start.tv_nsec) / 1e9;
+}
+
+size_t AnalysisBudget::getMemoryGrowth() const {
+	if (m_lastRSS < m_startRSS) {
+		return 0;
+	}
+	return m_lastRSS - m_startRSS;
+}
+
+bool AnalysisBudget::isExhausted() {
+	if ((FunctionTimeBudget != 0) &&
+			(getElapsedSeconds() > FunctionTimeBudget)) {
+		degrade("time budget exhausted");
+		return true;
+	}
+	if (FunctionMemoryBudget == 0) {
+		return false;
+	}
+	if ((m_checkCount++ % MEMORY_CHECK_INTERVAL) == 0) {
+		m_lastRSS = getResidentSetSize();
+	}
+	if (getMemoryGrowth() > ((size_t)FunctionMemoryBudget << 20)) {
+		degrade("memory budget exhausted");
+		return true;
+	}
+	return false;
+}
+
+bool AnalysisBudget::checkApronException(ap_manager_t * manager,
+		const char * operation) {
+	ap_exclog_t * exclog = manager->result.exclog;
+	if (!exclog) {
+		return false;
+	}
+	std::string reason;
+	llvm::raw_string_ostream rso(reason);
+	rso << "apron exception " << exclog->exn << " in " << operation;
+	if (exclog->msg) {
+		rso << ": " << exclog->msg;
+	}
+	degrade(rso.str());
+	ap_manager_clear_exclog(manager);
+	return true;
+}
+
+void AnalysisBudget::degrade(const std::string & reason) {
+	if (!m_isDegraded) {
+		llvm::errs() << "Warning: Analysis degraded: " << reason << "\n";
+		m_degradedReason = reason;
+	}
+	m_isDegraded = true;
+}
+
+bool AnalysisBudget::isDegraded() const {
+	return m_isDegraded;
+}
+
+const std::string & AnalysisBudget::getDegradedReason() const {
+	return m_degradedReason;
+}
@@ -2,11 +2,16 @@
 #include <list>
 
 #include <BasicBlock.h>
+#include <Budget.h>
 #include <CallGraph.h>
 #include <ChaoticExecution.h>
+#include <FixpointProfiler.h>
+#include <Function.h>
 
 extern unsigned UpdateCountMax;
 extern unsigned WideningThreshold;
+extern bool WideningThresholds;
+extern state_storage_e StateStorage;
 
 template <class T>
 class UniqueQueue {
@@ -34,7 +39,8 @@ public:
 };
 
 ChaoticExecution::ChaoticExecution(CallGraph & callGraph) :
-		callGraph(callGraph) {}
+		callGraph(callGraph), m_updateCount(0), m_joinTotal(0),
+		m_widenTotal(0) {}
 
 bool ChaoticExecution::isSeen(BasicBlock * block) {
 	return !(seen.find(block) == seen.end());
@@ -47,9 +53,9 @@ void ChaoticExecution::see(BasicBlock * block) {
 void ChaoticExecution::execute() {
 	UniqueQueue<BasicBlock *> worklist;
 	BasicBlock * root = callGraph.getRoot();
-	std::vector<std::string> userPointers = root->getFunction()->getUserPointers();
+	const std::vector<std::string> & userPointers = root->getFunction()->getUserPointers();
 	AbstractState state(userPointers);
-	root->getAbstractState() = state;
+	root->getStoredAbstractState() = state;
 	worklist.push(root);
 	while (!worklist.empty()) {
 		BasicBlock * block = worklist.pop();
@@ -63,9 +69,23 @@ void ChaoticExecution::execute() {
 				continue;
 			}
 		}
-		AbstractState state = block->getAbstractState();
-		block->update(state);
+		AbstractState state = block->getStoredAbstractState();
+		++m_updateCount;
+		if (FixpointProfiler::isEnabled()) {
+			double start = FixpointProfiler::now();
+			block->update(state);
+			FixpointProfiler::getInstance().recordUpdate(block, start,
+					FixpointProfiler::now(),
+					state.m_apronAbstractState.getEnvironment()->intdim);
+		} else {
+			block->update(state);
+		}
 		populateWithSuccessors(worklist, block, state);
+		if ((StateStorage == state_storage_cutpoints) && !block->isCutPoint()) {
+			// Its state is a function of its predecessor's. If that changes,
+			// this block is joined into (from bottom) and updated again.
+			block->releaseAbstractState();
+		}
 	}
 }
 
@@ -83,22 +103,47 @@ void ChaoticExecution::populateWithSuccessors(
 bool ChaoticExecution::join(BasicBlock * source, BasicBlock * dest, AbstractState & state) {
 	int & joinCount = m_joinCount[dest];
 	++joinCount;
-	AbstractState prev = dest->getAbstractState();
+	double start = FixpointProfiler::isEnabled() ? FixpointProfiler::now() : 0;
+	AbstractState & destState = dest->getStoredAbstractState();
+	AbstractState prev = destState;
 	AbstractState incoming = dest->getAbstractStateWithAssumptions(*source, state);
 	bool isChanged;
 	bool isJoin = true;
-	if (joinCount >= WideningThreshold) {
-		isChanged = dest->getAbstractState().widen(incoming);
+	// Out of budget: widen everywhere to reach a fixpoint quickly
+	if ((joinCount >= WideningThreshold) ||
+			AnalysisBudget::getInstance().isExhausted()) {
+		isChanged = WideningThresholds ?
+				destState.widen(incoming,
+						dest->getFunction()->getWideningThresholds()) :
+				destState.widen(incoming);
 		isJoin = false;
+		++m_widenTotal;
 	} else {
-		isChanged = dest->getAbstractState().join(incoming);
+		isChanged = destState.join(incoming);
+		++m_joinTotal;
+	}
+	if (FixpointProfiler::isEnabled()) {
+		FixpointProfiler::getInstance().recordJoin(dest, !isJoin, start,
+				FixpointProfiler::now());
 	}
 	llvm::errs() << dest->getName() << ": " << (isJoin ? "Joined" : "Widened") << " from " << source->getName() << ":\n";
-	llvm::errs() << "Prev: " << prev << "Other: " << incoming << " New: " << dest->getAbstractState();
-	llvm::errs() << "isChanged: " << isChanged << " and " << bool(prev != dest->getAbstractState()) << "\n";
+	llvm::errs() << "Prev: " << prev << "Other: " << incoming << " New: " << destState;
+	llvm::errs() << "isChanged: " << isChanged << " and " << bool(prev != destState) << "\n";
 	return isChanged;
 }
 
+unsigned ChaoticExecution::getUpdateCount() const {
+	return m_updateCount;
+}
+
+unsigned ChaoticExecution::getJoinCount() const {
+	return m_joinTotal;
+}
+
+unsigned ChaoticExecution::getWidenCount() const {
+	return m_widenTotal;
+}
+
 void ChaoticExecution::print() {
 	llvm::errs() << "Apron: Library " <<
 			apron_manager->library <<
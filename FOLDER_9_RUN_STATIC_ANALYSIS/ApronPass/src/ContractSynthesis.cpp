@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+#include <AbstractState.h>
+#include <Budget.h>
+#include <ContractSynthesis.h>
+#include <Function.h>
+
+extern "C" {
+#include <Adaptor.h>
+}
+
+// Larger systems are printed as is. Removal is quadratic in apron calls.
+static const size_t MaxRedundancyCheckSize = 128;
+
+static ap_tcons1_array_t keptConstraints(ap_tcons1_array_t & array,
+		const std::vector<bool> & isKept) {
+	size_t count = std::count(isKept.begin(), isKept.end(), true);
+	ap_tcons1_array_t result = ap_tcons1_array_make(array.env, count);
+	size_t resultIdx = 0;
+	for (size_t idx = 0; idx < isKept.size(); idx++) {
+		if (!isKept[idx]) {
+			continue;
+		}
+		ap_tcons1_t tcons = ap_tcons1_array_get(&array, idx);
+		ap_tcons1_t copy = ap_tcons1_copy(&tcons);
+		ap_tcons1_array_set(&result, resultIdx++, &copy);
+	}
+	return result;
+}
+
+ContractSynthesis::ContractSynthesis(Function * function) :
+		m_function(function), m_isDone(false) {}
+
+ContractSynthesis::~ContractSynthesis() {
+	for (Job & job : m_jobs) {
+		if (m_isDone) {
+			ap_tcons1_array_clear(&job.constraints);
+		} else {
+			ap_abstract1_clear(apron_manager, &job.input);
+		}
+	}
+}
+
+unsigned ContractSynthesis::add(ApronAbstractState & state) {
+	// Everything that reads the function or the symbol table is done
+	// here, on the calling thread
+	m_jobs.push_back(Job());
+	Job & job = m_jobs.back();
+	ApronAbstractState projected = m_function->minimize(state);
+	// The job gets environments of its own, as their reference counts are
+	// not atomic, and the state's are shared with the rest of the analysis
+	ap_environment_t * environment = projected.getEnvironment();
+	job.input.env = ap_environment_alloc(environment->var_of_dim,
+			environment->intdim,
+			environment->var_of_dim + environment->intdim,
+			environment->realdim);
+	assert(job.input.env);
+	job.input.abstract0 = ap_abstract0_copy(apron_manager,
+			projected.m_abstract1.abstract0);
+	ApronAbstractState::Variables variables(projected);
+	for (std::string variable : variables) {
+		job.renames[variable] = projected.renameVarForC(variable);
+	}
+	return m_jobs.size() - 1;
+}
+
+void ContractSynthesis::project(ap_manager_t * manager, Job & job) {
+	ap_abstract1_t & value = job.input;
+	// Rename for C
+	ap_environment_t * environment = ap_abstract1_environment(manager, &value);
+	std::vector<ap_var_t> oldnames;
+	std::vector<ap_var_t> newnames;
+	for (size_t dim = 0; dim < environment->intdim; dim++) {
+		ap_var_t var = ap_environment_var_of_dim(environment, dim);
+		auto it = job.renames.find((char*)var);
+		assert(it != job.renames.end());
+		job.appliedRenames.insert(*it);
+		oldnames.push_back(var);
+		newnames.push_back((ap_var_t)it->second.c_str());
+	}
+	if (!oldnames.empty()) {
+		value = ap_abstract1_rename_array(manager, true, &value,
+				oldnames.data(), newnames.data(), oldnames.size());
+	}
+	ap_abstract1_minimize(manager, &value);
+	ap_tcons1_array_t array = ap_abstract1_to_tcons_array(manager, &value);
+	job.constraints = removeRedundant(manager, array);
+	ap_abstract1_clear(manager, &value);
+}
+
+ap_tcons1_array_t ContractSynthesis::removeRedundant(ap_manager_t * manager,
+		ap_tcons1_array_t & array) {
+	size_t size = ap_tcons1_array_size(&array);
+	if ((size <= 1) || (size > MaxRedundancyCheckSize)) {
+		return array;
+	}
+	// Drop each constraint that the remaining ones imply
+	std::vector<bool> isKept(size, true);
+	ap_abstract1_t top = ap_abstract1_top(manager, array.env);
+	for (size_t idx = 0; idx < size; idx++) {
+		isKept[idx] = false;
+		ap_tcons1_array_t rest = keptConstraints(array, isKept);
+		ap_abstract1_t restValue = ap_abstract1_meet_tcons_array(
+				manager, false, &top, &rest);
+		ap_tcons1_t tcons = ap_tcons1_array_get(&array, idx);
+		isKept[idx] = !ap_abstract1_sat_tcons(manager, &restValue, &tcons);
+		ap_abstract1_clear(manager, &restValue);
+		ap_tcons1_array_clear(&rest);
+	}
+	ap_abstract1_clear(manager, &top);
+	ap_tcons1_array_t result = keptConstraints(array, isKept);
+	ap_tcons1_array_clear(&array);
+	return result;
+}
+
+void ContractSynthesis::runJobs(std::vector<Job> * jobs,
+		std::atomic<unsigned> * next, ap_manager_t * manager) {
+	while (true) {
+		unsigned idx = (*next)++;
+		if (idx >= jobs->size()) {
+			break;
+		}
+		project(manager, (*jobs)[idx]);
+	}
+}
+
+void ContractSynthesis::run(unsigned threads) {
+	std::atomic<unsigned> next(0);
+	threads = std::min<unsigned>(threads, m_jobs.size());
+	if (threads <= 1) {
+		runJobs(&m_jobs, &next, apron_manager);
+	} else {
+		// Created here, as create_manager isn't thread safe either
+		std::vector<ap_manager_t *> managers;
+		for (unsigned count = 0; count < threads; count++) {
+			ap_manager_t * manager = create_manager();
+			AnalysisBudget::configureManager(manager);
+			managers.push_back(manager);
+		}
+		std::vector<std::thread> workers;
+		for (ap_manager_t * manager : managers) {
+			workers.push_back(std::thread(&ContractSynthesis::runJobs,
+					&m_jobs, &next, manager));
+		}
+		for (std::thread & worker : workers) {
+			worker.join();
+		}
+		for (ap_manager_t * manager : managers) {
+			ap_manager_free(manager);
+		}
+	}
+	m_isDone = true;
+}
+
+ap_tcons1_array_t * ContractSynthesis::getConstraints(unsigned job) {
+	assert(m_isDone);
+	return &m_jobs[job].constraints;
+}
+
+const std::map<std::string, std::string> & ContractSynthesis::getRenames(unsigned job) {
+	assert(m_isDone);
+	return m_jobs[job].appliedRenames;
+}
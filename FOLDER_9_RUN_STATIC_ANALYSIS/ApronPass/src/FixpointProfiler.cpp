@@ -0,0 +1,208 @@
+#include <FixpointProfiler.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <time.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+#include <BasicBlock.h>
+#include <ResultsStore.h>
+
+extern bool ProfileFixpoint;
+
+FixpointProfiler FixpointProfiler::instance;
+
+FixpointProfiler & FixpointProfiler::getInstance() {
+	return instance;
+}
+
+FixpointProfiler::FixpointProfiler() : m_start(0) {}
+
+bool FixpointProfiler::isEnabled() {
+	return ProfileFixpoint;
+}
+
+double FixpointProfiler::now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void FixpointProfiler::start() {
+	m_start = now();
+	m_blocks.clear();
+	m_kinds.clear();
+	m_folded.clear();
+	m_events.clear();
+}
+
+FixpointProfiler::BlockProfile & FixpointProfiler::getBlockProfile(
+		BasicBlock * block) {
+	BlockProfile & profile = m_blocks[block];
+	if (profile.name.empty()) {
+		profile.name = block->getName();
+	}
+	return profile;
+}
+
+void FixpointProfiler::addEvent(char phase, const char * category,
+		const std::string & name, double start, double end, unsigned value) {
+	TraceEvent event = { phase, category, name, start - m_start, end - start, value };
+	m_events.push_back(event);
+}
+
+void FixpointProfiler::recordUpdate(BasicBlock * block, double start,
+		double end, unsigned envSize) {
+	BlockProfile & profile = getBlockProfile(block);
+	++profile.updates;
+	profile.updateTime += end - start;
+	profile.maxEnvSize = std::max(profile.maxEnvSize, envSize);
+	profile.lastEnvSize = envSize;
+	addEvent('X', "update", profile.name, start, end);
+	addEvent('C', "environment", "intdim", end, end, envSize);
+}
+
+void FixpointProfiler::recordJoin(BasicBlock * dest, bool isWiden,
+		double start, double end) {
+	BlockProfile & profile = getBlockProfile(dest);
+	if (isWiden) {
+		++profile.widenings;
+	} else {
+		++profile.joins;
+	}
+	profile.joinTime += end - start;
+	addEvent('X', isWiden ? "widen" : "join", profile.name, start, end);
+}
+
+void FixpointProfiler::recordInstruction(BasicBlock * block,
+		const char * kind, double start, double end) {
+	KindProfile & profile = m_kinds[kind];
+	++profile.calls;
+	profile.time += end - start;
+	m_folded[std::make_pair(getBlockProfile(block).name, std::string(kind))] +=
+			end - start;
+	addEvent('X', "instruction", kind, start, end);
+}
+
+template <class stream>
+static stream & quoted(stream & s, const std::string & str) {
+	s << '"';
+	for (char c : str) {
+		if ((c == '"') || (c == '\\')) {
+			s << '\\';
+		}
+		s << c;
+	}
+	s << '"';
+	return s;
+}
+
+std::string FixpointProfiler::getTrace() const {
+	std::string result;
+	llvm::raw_string_ostream s(result);
+	s << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	bool isFirst = true;
+	for (const TraceEvent & event : m_events) {
+		if (!isFirst) {
+			s << ",\n";
+		}
+		isFirst = false;
+		// Chrome traces are in microseconds
+		s << "{\"ph\":\"" << event.phase << "\",\"cat\":\"" << event.category <<
+				"\",\"name\":";
+		quoted(s, event.name);
+		s << ",\"pid\":1,\"tid\":1,\"ts\":" << event.start / 1000;
+		if (event.phase == 'C') {
+			s << ",\"args\":{\"intdim\":" << event.value << "}}";
+		} else {
+			s << ",\"dur\":" << event.duration / 1000 << "}";
+		}
+	}
+	s << "\n]}\n";
+	return s.str();
+}
+
+std::string FixpointProfiler::getFolded(const std::string & function) const {
+	std::map<std::string, double> instructionTime;
+	std::string result;
+	llvm::raw_string_ostream s(result);
+	for (auto & folded : m_folded) {
+		s << function << ";" << folded.first.first << ";" <<
+				folded.first.second << " " << (unsigned long)folded.second << "\n";
+		instructionTime[folded.first.first] += folded.second;
+	}
+	for (auto & blockPair : m_blocks) {
+		const BlockProfile & profile = blockPair.second;
+		double self = profile.updateTime - instructionTime[profile.name];
+		if (self > 0) {
+			s << function << ";" << profile.name << " " <<
+					(unsigned long)self << "\n";
+		}
+		if (profile.joinTime > 0) {
+			s << function << ";join;" << profile.name << " " <<
+					(unsigned long)profile.joinTime << "\n";
+		}
+	}
+	return s.str();
+}
+
+template <class T>
+static bool isMoreExpensive(const T * left, const T * right) {
+	return left->second.time > right->second.time;
+}
+
+std::string FixpointProfiler::getSummary(const std::string & function) const {
+	std::string result;
+	llvm::raw_string_ostream s(result);
+	char line[256];
+	s << "Function " << function << ": " <<
+			(unsigned long)((now() - m_start) / 1e6) << " ms\n\n";
+
+	std::vector<const BlockProfile *> blocks;
+	for (auto & blockPair : m_blocks) {
+		blocks.push_back(&blockPair.second);
+	}
+	std::sort(blocks.begin(), blocks.end(),
+			[](const BlockProfile * left, const BlockProfile * right) {
+				return (left->updateTime + left->joinTime) >
+						(right->updateTime + right->joinTime);
+			});
+	snprintf(line, sizeof(line), "%-32s %8s %8s %8s %12s %12s %8s %8s\n",
+			"block", "updates", "joins", "widens", "update(us)", "join(us)",
+			"maxdim", "lastdim");
+	s << line;
+	for (const BlockProfile * profile : blocks) {
+		snprintf(line, sizeof(line), "%-32s %8u %8u %8u %12.1f %12.1f %8u %8u\n",
+				profile->name.c_str(), profile->updates, profile->joins,
+				profile->widenings, profile->updateTime / 1000,
+				profile->joinTime / 1000, profile->maxEnvSize,
+				profile->lastEnvSize);
+		s << line;
+	}
+
+	typedef std::pair<const std::string, KindProfile> KindPair;
+	std::vector<const KindPair *> kinds;
+	for (auto & kindPair : m_kinds) {
+		kinds.push_back(&kindPair);
+	}
+	std::sort(kinds.begin(), kinds.end(), isMoreExpensive<KindPair>);
+	snprintf(line, sizeof(line), "\n%-32s %8s %12s %12s\n",
+			"instruction", "calls", "total(us)", "avg(us)");
+	s << line;
+	for (const KindPair * kind : kinds) {
+		snprintf(line, sizeof(line), "%-32s %8u %12.1f %12.2f\n",
+				kind->first.c_str(), kind->second.calls,
+				kind->second.time / 1000,
+				kind->second.time / 1000 / kind->second.calls);
+		s << line;
+	}
+	return s.str();
+}
+
+void FixpointProfiler::write(const std::string & function) {
+	ResultsStore & store = ResultsStore::getInstance();
+	store.writeFile(function + ".trace.json", getTrace());
+	store.writeFile(function + ".folded", getFolded(function));
+	store.writeFile(function + ".profile.txt", getSummary(function));
+}
@@ -1,7 +1,10 @@
+#include <algorithm>
+
 #include <AbstractState.h>
 #include <APStream.h>
 #include <Function.h>
 #include <BasicBlock.h>
+#include <UserMemoryModels.h>
 
 #include <llvm/IR/Function.h>
 #include <llvm/IR/GlobalAlias.h>
@@ -9,6 +12,8 @@
 #include <llvm/IR/Instructions.h>
 #include <llvm/Support/raw_ostream.h>
 
+extern bool WideningThresholds;
+
 FunctionManager FunctionManager::instance;
 FunctionManager & FunctionManager::getInstance() {
 	return instance;
@@ -45,35 +50,104 @@ Function * FunctionManager::getFunction(llvm::GlobalAlias * alias) {
 	return result;
 }
 
-Function::Function(llvm::Function * function) : m_function(function), m_name(function->getName()) {}
+Function::Function(llvm::Function * function) : m_function(function),
+		m_name(function->getName()), m_isInfoBuilt(false),
+		m_successState(ApronAbstractState::bottom()) {}
+
+static void pushBackIfConstant(std::vector<int64_t> & constants,
+		llvm::Value * value) {
+	llvm::ConstantInt * constant = llvm::dyn_cast<llvm::ConstantInt>(value);
+	if (constant && (constant->getBitWidth() <= 64)) {
+		constants.push_back(constant->getSExtValue());
+	}
+}
+
+static void collectWideningThresholds(llvm::Function & F,
+		std::vector<int64_t> & thresholds) {
+	UserMemoryModels & models = UserMemoryModels::getInstance();
+	for (llvm::BasicBlock & basicBlock : F) {
+		for (llvm::Instruction & instruction : basicBlock) {
+			if (llvm::ICmpInst * icmp = llvm::dyn_cast<llvm::ICmpInst>(&instruction)) {
+				pushBackIfConstant(thresholds, icmp->getOperand(0));
+				pushBackIfConstant(thresholds, icmp->getOperand(1));
+			} else if (llvm::SwitchInst * switchInst = llvm::dyn_cast<llvm::SwitchInst>(&instruction)) {
+				for (auto it = switchInst->case_begin(), ie = switchInst->case_end();
+						it != ie; ++it) {
+					pushBackIfConstant(thresholds, it.getCaseValue());
+				}
+			} else if (llvm::CallInst * callInst = llvm::dyn_cast<llvm::CallInst>(&instruction)) {
+				llvm::Value * called = callInst->getCalledValue()->stripPointerCasts();
+				const UserMemoryModel * model = models.find(called->getName().str());
+				if (model && (model->sizeArg >= 0) &&
+						((unsigned)model->sizeArg < callInst->getNumArgOperands())) {
+					pushBackIfConstant(thresholds,
+							callInst->getArgOperand(model->sizeArg));
+				}
+			}
+		}
+	}
+	std::sort(thresholds.begin(), thresholds.end());
+	thresholds.erase(std::unique(thresholds.begin(), thresholds.end()),
+			thresholds.end());
+}
+
 bool Function::isUserPointer(std::string & ptrname) {
 	return ptrname.find("buf") == 0;
 }
 
-llvm::ReturnInst * Function::getReturnInstruction() {
+bool Function::isUserPointer(SymbolId ptr) {
+	return m_symbolTable.getName(ptr).compare(0, 3, "buf") == 0;
+}
+
+FunctionInfo & Function::getInfo() {
+	if (m_isInfoBuilt) {
+		return m_info;
+	}
+	m_isInfoBuilt = true;
+	m_info.returnInstruction = NULL;
+	m_info.returnBasicBlock = NULL;
+	m_info.returnValueId = SymbolTable::invalid;
+	m_info.isWideningThresholdsCollected = false;
 	llvm::Function &F = *m_function;
 	for (auto bbit = F.begin(), bbie = F.end(); bbit != bbie; bbit++) {
-		llvm::BasicBlock & bb = *bbit;
-		for (auto iit = bb.begin(), iie = bb.end(); iit != iie; iit++) {
-			llvm::Instruction & inst = *iit;
-			if (llvm::isa<llvm::ReturnInst>(inst)) {
-				llvm::ReturnInst & result = llvm::cast<llvm::ReturnInst>(inst);
-				return &result;
-			}
+		llvm::TerminatorInst * terminator = bbit->getTerminator();
+		if (terminator && llvm::isa<llvm::ReturnInst>(terminator)) {
+			m_info.returnInstruction = llvm::cast<llvm::ReturnInst>(terminator);
+			break;
+		}
+	}
+	if (m_info.returnInstruction) {
+		llvm::BasicBlock * basicBlock = m_info.returnInstruction->getParent();
+		BasicBlockManager & basicBlockManager = BasicBlockManager::getInstance();
+		m_info.returnBasicBlock = basicBlockManager.getBasicBlock(basicBlock);
+		llvm::Value * returnValue = m_info.returnInstruction->getReturnValue();
+		if (returnValue) {
+			m_info.returnValueName = returnValue->getName().str();
+			m_info.returnValueId = m_symbolTable.intern(m_info.returnValueName);
 		}
 	}
-	return NULL;
+	const llvm::Function::ArgumentListType & arguments = m_function->getArgumentList();
+	for (const llvm::Argument & argument : arguments) {
+		std::string name = argument.getName().str();
+		SymbolId id = m_symbolTable.intern(name);
+		m_info.argumentIds.insert(id);
+		if (isUserPointer(id)) {
+			m_info.userPointers.push_back(name);
+		}
+	}
+	return m_info;
+}
+
+llvm::ReturnInst * Function::getReturnInstruction() {
+	return getInfo().returnInstruction;
 }
 
 BasicBlock * Function::getReturnBasicBlock() {
-	llvm::ReturnInst * returnInst = getReturnInstruction();
-	llvm::BasicBlock * basicBlock = returnInst->getParent();
-	BasicBlockManager & basicBlockManager = BasicBlockManager::getInstance();
-	return basicBlockManager.getBasicBlock(basicBlock);
+	return getInfo().returnBasicBlock;
 }
 
 const std::string & Function::getReturnValueName() {
-	llvm::ReturnInst * returnInst = getReturnInstruction();
+	llvm::ReturnInst * returnInst = getInfo().returnInstruction;
 	llvm::Value * returnValue = returnInst->getReturnValue();
 	ValueFactory * factory = ValueFactory::getInstance();
 	Value * returnValueValue = factory->getValue(returnValue);
@@ -81,49 +155,58 @@ const std::string & Function::getReturnValueName() {
 }
 
 bool Function::isSizeVariable(const char * varname) {
-	if ((strncmp(varname, "size(", sizeof("size(")-1) == 0) &&
-			varname[strlen(varname)-1] == ')') {
-		return true;
-	}
-	return false;
+	return m_symbolTable.getKind(varname) == symbol_kind_size;
 }
 
 bool Function::isOffsetVariable(const char * varname) {
-	if ((strncmp(varname, "offset(", sizeof("offset(")-1) == 0) &&
-			varname[strlen(varname)-1] == ')') {
-		return true;
-	}
-	return false;
+	return m_symbolTable.getKind(varname) == symbol_kind_offset;
 }
 
 bool Function::isLastVariable(const char * varname) {
-	if ((strncmp(varname, "last(", sizeof("last(")-1) == 0) &&
-			varname[strlen(varname)-1] == ')') {
-		return true;
-	}
-	return false;
+	return m_symbolTable.getKind(varname) == symbol_kind_last;
 }
 
 bool Function::isFunctionParameter(const char * varname) {
-	const llvm::Function::ArgumentListType & arguments = m_function->getArgumentList();
-	for (const llvm::Argument & argument : arguments) {
-		if (argument.getName() == varname) {
-			return true;
-		}
+	// The arguments are interned by getInfo
+	getInfo();
+	SymbolId id = m_symbolTable.find(varname);
+	return (id != SymbolTable::invalid) && isFunctionParameter(id);
+}
+
+bool Function::isSizeVariable(SymbolId var) {
+	return m_symbolTable.getKind(var) == symbol_kind_size;
+}
+
+bool Function::isOffsetVariable(SymbolId var) {
+	return m_symbolTable.getKind(var) == symbol_kind_offset;
+}
+
+bool Function::isLastVariable(SymbolId var) {
+	return m_symbolTable.getKind(var) == symbol_kind_last;
+}
+
+bool Function::isFunctionParameter(SymbolId var) {
+	FunctionInfo & info = getInfo();
+	return info.argumentIds.find(var) != info.argumentIds.end();
+}
+
+const std::vector<int64_t> & Function::getWideningThresholds() {
+	FunctionInfo & info = getInfo();
+	if (WideningThresholds && !info.isWideningThresholdsCollected) {
+		info.isWideningThresholdsCollected = true;
+		collectWideningThresholds(*m_function, info.wideningThresholds);
 	}
-	return false;
+	return info.wideningThresholds;
 }
 
-bool Function::isVarInOut(const char * varname) {
+bool Function::classifyVarInOut(const char * varname) {
 	// Return true iff:
 	// 	varname is argument
 	// 	varname is last(*)
 	// 	varname is size(*)
 	// 	varname is the return value
-	// XXX Memoize this value?
-	llvm::ReturnInst * returnInst = getReturnInstruction();
-	llvm::Value * returnValue = returnInst->getReturnValue();
-	if (returnValue && returnValue->getName() == varname) {
+	FunctionInfo & info = getInfo();
+	if (!info.returnValueName.empty() && (info.returnValueName == varname)) {
 		return true;
 	}
 	return isSizeVariable(varname) ||
@@ -132,6 +215,38 @@ bool Function::isVarInOut(const char * varname) {
 			isFunctionParameter(varname);
 }
 
+bool Function::classifyVarInOut(SymbolId var) {
+	FunctionInfo & info = getInfo();
+	if (var == info.returnValueId) {
+		return true;
+	}
+	return isSizeVariable(var) ||
+			// isOffsetVariable(var) ||
+			isLastVariable(var) ||
+			isFunctionParameter(var);
+}
+
+bool Function::isVarInOut(const char * varname) {
+	SymbolId id = m_symbolTable.find(varname);
+	if (id == SymbolTable::invalid) {
+		// Not created through the table (e.g. renamed for C)
+		return classifyVarInOut(varname);
+	}
+	return isVarInOut(id);
+}
+
+bool Function::isVarInOut(SymbolId var) {
+	std::vector<char> & varInOut = getInfo().varInOut;
+	if (var >= varInOut.size()) {
+		varInOut.resize(m_symbolTable.size(), var_in_out_unknown);
+	}
+	if (varInOut[var] == var_in_out_unknown) {
+		varInOut[var] = classifyVarInOut(var) ?
+				var_in_out_yes : var_in_out_no;
+	}
+	return (varInOut[var] == var_in_out_yes);
+}
+
 ap_abstract1_t Function::trimAbstractValue(AbstractState & state) {
 	ApronAbstractState apronAbstractState = state.m_apronAbstractState;
 	ap_abstract1_t & asAbstract1 = apronAbstractState.m_abstract1;
@@ -160,20 +275,12 @@ AbstractState & Function::getReturnAbstractState() {
 	return as;
 }
 
-std::vector<std::string> Function::getUserPointers() {
-	std::vector<std::string> result;
-	const llvm::Function::ArgumentListType & arguments = m_function->getArgumentList();
-	for (const llvm::Argument & argument : arguments) {
-		std::string name = argument.getName().str();
-		if (isUserPointer(name)) {
-			result.push_back(name);
-		}
-	}
-	return result;
+const std::vector<std::string> & Function::getUserPointers() {
+	return getInfo().userPointers;
 }
 
 std::vector<std::string> Function::getConstrainedUserPointers(AbstractState & state) {
-	std::vector<std::string> userBuffers = getUserPointers();
+	const std::vector<std::string> & userBuffers = getUserPointers();
 	std::vector<std::string> result;
 	for (const std::string & userBuffer : userBuffers) {
 		const std::string & lastName = state.generateLastName(userBuffer, user_pointer_operation_write);
@@ -187,7 +294,7 @@ std::vector<std::string> Function::getConstrainedUserPointers(AbstractState & st
 void Function::pushBackIfConstrainsUserPointers(
 		std::map<std::string, ApronAbstractState> & result,
 		AbstractState & state,
-		std::vector<std::string> & userBuffers) {
+		const std::vector<std::string> & userBuffers) {
 	std::vector<std::string> constrainedBuffers = getConstrainedUserPointers(state);
 	for (const std::string & userBuffer : constrainedBuffers) {
 		result.insert(std::make_pair(userBuffer, state.m_apronAbstractState));
@@ -195,17 +302,19 @@ void Function::pushBackIfConstrainsUserPointers(
 }
 
 std::map<std::string, ApronAbstractState> Function::getErrorStates() {
-	std::vector<std::string> userBuffers = getUserPointers();
+	const std::vector<std::string> & userBuffers = getUserPointers();
 	std::map<std::string, ApronAbstractState> result;
 	BasicBlockManager & basicBlockManager = BasicBlockManager::getInstance();
 	for (llvm::BasicBlock & llvmbb : *m_function) {
 		BasicBlock * bb = basicBlockManager.getBasicBlock(&llvmbb);
-		AbstractState & state = bb->getAbstractState();
-		if ((state.m_mos != memory_operation_state_top) &&
-				(state.m_mos != memory_operation_state_failure)) {
+		// Checked first, so that only failure blocks are recomputed
+		memory_operation_state_e mos = bb->getMemoryOperationState();
+		if ((mos != memory_operation_state_top) &&
+				(mos != memory_operation_state_failure)) {
 			// Not a failure
 			continue;
 		}
+		AbstractState & state = bb->getAbstractState();
 		pushBackIfConstrainsUserPointers(result, state, userBuffers);
 	}
 	return result;
@@ -213,13 +322,13 @@ std::map<std::string, ApronAbstractState> Function::getErrorStates() {
 
 // TODO(oanson) This will have to be a map: buffer -> state
 ApronAbstractState Function::getSuccessState() {
-	ApronAbstractState result = ApronAbstractState::bottom();
-	std::vector<ApronAbstractState> successStates;
-	for (auto & memOpsState : m_memOpsAbstractStates) {
-		successStates.push_back(memOpsState.second.m_apronAbstractState);
-	}
-	result.join(successStates);
-	return result;
+	return m_successState;
+}
+
+void Function::joinSuccessState(const ApronAbstractState & state) {
+	// A block's states only grow during the fixpoint, so joining every
+	// visit gives the same result as joining the last ones
+	m_successState.join(state);
 }
 
 ApronAbstractState Function::minimize(ApronAbstractState & state) {
@@ -317,6 +426,16 @@ BasicBlock * Function::getRoot() const {
 	return root;
 }
 
+SymbolTable & Function::getSymbolTable() {
+	return m_symbolTable;
+}
+
+void Function::releaseBody() {
+	m_isInfoBuilt = false;
+	m_info = FunctionInfo();
+	m_successState = ApronAbstractState::bottom();
+}
+
 Alias::Alias(llvm::GlobalAlias * alias, llvm::Function * function) :
 		Function(function), m_alias(alias) {
 	m_name = alias->getName();
@@ -0,0 +1,245 @@
+#include <ResultsStore.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+extern std::string OutputDir;
+extern std::string ResultsFile;
+
+static bool makeDirectories(const std::string & path) {
+	std::string::size_type pos = 0;
+	while (pos != std::string::npos) {
+		pos = path.find('/', pos + 1);
+		std::string prefix = path.substr(0, pos);
+		if (prefix.empty()) {
+			continue;
+		}
+		if ((mkdir(prefix.c_str(), 0755) != 0) && (errno != EEXIST)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool writeAll(int fd, const std::string & data) {
+	const char * buffer = data.data();
+	size_t remaining = data.size();
+	while (remaining > 0) {
+		ssize_t written = write(fd, buffer, remaining);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		buffer += written;
+		remaining -= written;
+	}
+	return true;
+}
+
+template <class stream>
+static stream & quoted(stream & s, const std::string & str) {
+	s << '"';
+	for (char c : str) {
+		switch (c) {
+		case '"':
+			s << "\\\"";
+			break;
+		case '\\':
+			s << "\\\\";
+			break;
+		case '\n':
+			s << "\\n";
+			break;
+		case '\t':
+			s << "\\t";
+			break;
+		default:
+			if ((unsigned char)c < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				s << escaped;
+			} else {
+				s << c;
+			}
+		}
+	}
+	s << '"';
+	return s;
+}
+
+template <class stream>
+static stream & quoted(stream & s, const std::vector<std::string> & strs) {
+	s << '[';
+	bool isFirst = true;
+	for (const std::string & str : strs) {
+		if (!isFirst) {
+			s << ',';
+		}
+		isFirst = false;
+		quoted(s, str);
+	}
+	s << ']';
+	return s;
+}
+
+ResultsStore * ResultsStore::instance = NULL;
+
+ResultsStore & ResultsStore::getInstance() {
+	if (!instance) {
+		instance = new ResultsStore();
+	}
+	return *instance;
+}
+
+ResultsStore::ResultsStore() : m_outputDir(OutputDir), m_resultsFd(-1) {
+	if (!makeDirectories(m_outputDir)) {
+		llvm::errs() << "Error: Cannot create " << m_outputDir << ": " <<
+				strerror(errno) << "\n";
+	}
+	if (ResultsFile.empty()) {
+		return;
+	}
+	m_resultsPath = getOutputPath(ResultsFile);
+	m_resultsFd = open(m_resultsPath.c_str(),
+			O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+	if (m_resultsFd < 0) {
+		llvm::errs() << "Error: Cannot open " << m_resultsPath << ": " <<
+				strerror(errno) << "\n";
+	}
+}
+
+ResultsStore::~ResultsStore() {
+	if (m_resultsFd >= 0) {
+		close(m_resultsFd);
+	}
+}
+
+const std::string & ResultsStore::getOutputDir() const {
+	return m_outputDir;
+}
+
+std::string ResultsStore::getOutputPath(const std::string & filename) const {
+	if (!filename.empty() && (filename[0] == '/')) {
+		return filename;
+	}
+	return m_outputDir + "/" + filename;
+}
+
+bool ResultsStore::writeFile(const std::string & filename,
+		const std::string & contents) {
+	std::string path = getOutputPath(filename);
+	char pid[16];
+	snprintf(pid, sizeof(pid), "%d", (int)getpid());
+	std::string tmpPath = path + ".tmp." + pid;
+	int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		llvm::errs() << "Error: Cannot open " << tmpPath << ": " <<
+				strerror(errno) << "\n";
+		return false;
+	}
+	bool isWritten = writeAll(fd, contents);
+	isWritten = (close(fd) == 0) && isWritten;
+	// Readers see either the old file or the complete new one
+	if (!isWritten || (rename(tmpPath.c_str(), path.c_str()) != 0)) {
+		llvm::errs() << "Error: Cannot write " << path << ": " <<
+				strerror(errno) << "\n";
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+std::string ResultsStore::toJSON(const FunctionResult & result) {
+	std::string json;
+	llvm::raw_string_ostream s(json);
+	s << "{\"function\":";
+	quoted(s, result.function);
+	s << ",\"domain\":";
+	quoted(s, result.domain);
+	s << ",\"pid\":" << (int)getpid();
+	s << ",\"degraded\":" << (result.isDegraded ? "true" : "false");
+	if (result.isDegraded) {
+		s << ",\"degraded_reason\":";
+		quoted(s, result.degradedReason);
+	}
+	s << ",\"analysis_seconds\":" << result.analysisSeconds;
+	s << ",\"total_seconds\":" << result.totalSeconds;
+	s << ",\"block_updates\":" << result.blockUpdates;
+	s << ",\"joins\":" << result.joins;
+	s << ",\"widenings\":" << result.widenings;
+	if (result.hasReturnInterval) {
+		s << ",\"return\":{\"inf\":";
+		quoted(s, result.returnInf);
+		s << ",\"sup\":";
+		quoted(s, result.returnSup);
+		s << "}";
+	}
+	s << ",\"buffers\":[";
+	bool isFirst = true;
+	for (const BufferResult & buffer : result.buffers) {
+		if (!isFirst) {
+			s << ',';
+		}
+		isFirst = false;
+		s << "{\"name\":";
+		quoted(s, buffer.name);
+		s << ",\"last_read\":";
+		quoted(s, buffer.lastRead);
+		s << ",\"last_write\":";
+		quoted(s, buffer.lastWrite);
+		s << ",\"size\":";
+		quoted(s, buffer.size);
+		s << "}";
+	}
+	s << "]";
+	if (result.hasContract) {
+		const ContractResult & contract = result.contract;
+		s << ",\"error_states\":{";
+		isFirst = true;
+		for (auto & errorState : contract.errorStates) {
+			if (!isFirst) {
+				s << ',';
+			}
+			isFirst = false;
+			quoted(s, errorState.first);
+			s << ':';
+			quoted(s, errorState.second);
+		}
+		s << "},\"success_state\":";
+		quoted(s, contract.successState);
+		s << ",\"return_state\":";
+		quoted(s, contract.returnState);
+	}
+	s << "}\n";
+	return s.str();
+}
+
+bool ResultsStore::append(const FunctionResult & result) {
+	if (m_resultsFd < 0) {
+		return false;
+	}
+	std::string line = toJSON(result);
+	// O_APPEND places each write at the end. The lock keeps a record
+	// whole even if write(2) is split.
+	if (flock(m_resultsFd, LOCK_EX) != 0) {
+		llvm::errs() << "Error: Cannot lock " << m_resultsPath << ": " <<
+				strerror(errno) << "\n";
+		return false;
+	}
+	bool isWritten = writeAll(m_resultsFd, line);
+	flock(m_resultsFd, LOCK_UN);
+	if (!isWritten) {
+		llvm::errs() << "Error: Cannot write " << m_resultsPath << ": " <<
+				strerror(errno) << "\n";
+	}
+	return isWritten;
+}
@@ -0,0 +1,203 @@
+#include <cassert>
+#include <cstring>
+
+#include <SymbolTable.h>
+#include <AbstractState.h>
+#include <Budget.h>
+#include <AbstractStates/MPTAbstractState.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+SymbolTable SymbolTable::defaultTable;
+SymbolTable * SymbolTable::current = &SymbolTable::defaultTable;
+
+SymbolTable & SymbolTable::getCurrent() {
+	return *current;
+}
+
+void SymbolTable::makeCurrent() {
+	current = this;
+}
+
+SymbolTable::SymbolTable() {
+	// Fixed indices. See MPTAbstractState.h
+	unsigned idx = getBufferIndex("null");
+	assert(idx == MPT_BUFFER_NULL);
+	idx = getBufferIndex("kernel");
+	assert(idx == MPT_BUFFER_KERNEL);
+	idx = getBufferIndex("user");
+	assert(idx == MPT_BUFFER_USER);
+}
+
+SymbolId SymbolTable::add(const std::string & name, symbol_kind_e kind,
+		SymbolId base, SymbolId buffer, int op) {
+	SymbolId id = m_symbols.size();
+	m_symbols.push_back(Symbol(name, kind, base, buffer, op));
+	if (!m_ids.count(name)) {
+		m_ids[name] = id;
+	}
+	return id;
+}
+
+SymbolId SymbolTable::intern(const std::string & name, symbol_kind_e kind) {
+	auto it = m_ids.find(name);
+	if (it != m_ids.end()) {
+		return it->second;
+	}
+	if (kind == symbol_kind_ssa) {
+		kind = parseKind(name.c_str());
+	}
+	return add(name, kind, invalid, invalid, 0);
+}
+
+SymbolId SymbolTable::find(llvm::StringRef name) const {
+	auto it = m_ids.find(name);
+	if (it == m_ids.end()) {
+		return invalid;
+	}
+	return it->second;
+}
+
+SymbolId SymbolTable::getOffset(SymbolId pointer, SymbolId buffer) {
+	std::pair<SymbolId, SymbolId> key(pointer, buffer);
+	auto it = m_offsets.find(key);
+	if (it != m_offsets.end()) {
+		return it->second;
+	}
+	std::string name;
+	llvm::raw_string_ostream rso(name);
+	rso << "offset(" << getName(pointer) << "," << getName(buffer) << ")";
+	SymbolId id = add(rso.str(), symbol_kind_offset, pointer, buffer, 0);
+	m_offsets.insert(std::make_pair(key, id));
+	return id;
+}
+
+SymbolId SymbolTable::getLast(SymbolId buffer, int op) {
+	std::pair<SymbolId, int> key(buffer, op);
+	auto it = m_lasts.find(key);
+	if (it != m_lasts.end()) {
+		return it->second;
+	}
+	std::string name;
+	llvm::raw_string_ostream rso(name);
+	rso << "last(" << getName(buffer) << "," <<
+			(user_pointer_operation_e)op << ")";
+	SymbolId id = add(rso.str(), symbol_kind_last, invalid, buffer, op);
+	m_lasts.insert(std::make_pair(key, id));
+	return id;
+}
+
+SymbolId SymbolTable::getSize(SymbolId buffer) {
+	auto it = m_sizes.find(buffer);
+	if (it != m_sizes.end()) {
+		return it->second;
+	}
+	std::string name;
+	llvm::raw_string_ostream rso(name);
+	rso << "size(" << getName(buffer) << ")";
+	SymbolId id = add(rso.str(), symbol_kind_size, invalid, buffer, 0);
+	m_sizes.insert(std::make_pair(buffer, id));
+	return id;
+}
+
+const std::string & SymbolTable::getName(SymbolId id) const {
+	return m_symbols[id].name;
+}
+
+ap_var_t SymbolTable::getApVar(SymbolId id) const {
+	return (ap_var_t)m_symbols[id].name.c_str();
+}
+
+symbol_kind_e SymbolTable::getKind(SymbolId id) const {
+	return m_symbols[id].kind;
+}
+
+symbol_kind_e SymbolTable::getKind(const char * name) const {
+	SymbolId id = find(name);
+	if (id != invalid) {
+		return getKind(id);
+	}
+	// Not created through this table (e.g. renamed for C)
+	return parseKind(name);
+}
+
+symbol_kind_e SymbolTable::parseKind(const char * name) {
+	size_t length = strlen(name);
+	if ((length == 0) || (name[length-1] != ')')) {
+		return symbol_kind_ssa;
+	}
+	if (strncmp(name, "offset(", sizeof("offset(")-1) == 0) {
+		return symbol_kind_offset;
+	}
+	if (strncmp(name, "last(", sizeof("last(")-1) == 0) {
+		return symbol_kind_last;
+	}
+	if (strncmp(name, "size(", sizeof("size(")-1) == 0) {
+		return symbol_kind_size;
+	}
+	return symbol_kind_unknown;
+}
+
+const Symbol & SymbolTable::getSymbol(SymbolId id) const {
+	return m_symbols[id];
+}
+
+unsigned SymbolTable::size() const {
+	return m_symbols.size();
+}
+
+unsigned SymbolTable::getPointerIndex(const std::string & name) {
+	SymbolId id = intern(name);
+	Symbol & symbol = m_symbols[id];
+	if (symbol.pointerIndex == (unsigned)-1) {
+		symbol.pointerIndex = m_pointers.size();
+		m_pointers.push_back(id);
+	}
+	return symbol.pointerIndex;
+}
+
+unsigned SymbolTable::findPointerIndex(const std::string & name) const {
+	SymbolId id = find(name);
+	if (id == invalid) {
+		return -1;
+	}
+	return m_symbols[id].pointerIndex;
+}
+
+SymbolId SymbolTable::getPointer(unsigned index) const {
+	return m_pointers[index];
+}
+
+unsigned SymbolTable::getPointerCount() const {
+	return m_pointers.size();
+}
+
+unsigned SymbolTable::getBufferIndex(const std::string & name) {
+	SymbolId id = intern(name);
+	Symbol & symbol = m_symbols[id];
+	if (symbol.bufferIndex == (unsigned)-1) {
+		if (m_buffers.size() < MPT_MAX_BUFFERS) {
+			symbol.bufferIndex = m_buffers.size();
+			m_buffers.push_back(id);
+			return symbol.bufferIndex;
+		}
+		symbol.bufferIndex = MPT_BUFFER_USER;
+	}
+	if ((symbol.bufferIndex == MPT_BUFFER_USER) &&
+			(id != m_buffers[MPT_BUFFER_USER])) {
+		// Sound, but no longer told apart from any other user buffer.
+		// Flagged on every use, as the budget is reset per function.
+		AnalysisBudget::getInstance().degrade(
+				"more than " + std::to_string(MPT_MAX_BUFFERS) +
+				" buffers. " + name + " is treated as user");
+	}
+	return symbol.bufferIndex;
+}
+
+SymbolId SymbolTable::getBuffer(unsigned index) const {
+	return m_buffers[index];
+}
+
+unsigned SymbolTable::getBufferCount() const {
+	return m_buffers.size();
+}
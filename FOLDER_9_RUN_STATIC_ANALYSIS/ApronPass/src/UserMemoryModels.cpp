@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <UserMemoryModels.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+extern std::string UserMemoryModelsFile;
+
+static const UserMemoryModel builtinModels[] = {
+#define USER_MEMORY_MODEL(name, handler, num_args, ptr_arg, size_arg, op_arg, op) \
+	{ name, user_memory_handler_##handler, num_args, ptr_arg, size_arg, op_arg, \
+			user_pointer_operation_##op },
+#include <UserMemoryModels.def>
+#undef USER_MEMORY_MODEL
+};
+
+static const struct {
+	const char * name;
+	user_memory_handler_e handler;
+} handlerNames[] = {
+	{ "memop", user_memory_handler_memop },
+	{ "get_put_user", user_memory_handler_get_put_user },
+	{ "import_iovec", user_memory_handler_import_iovec },
+	{ "copy_msghdr_from_user", user_memory_handler_copy_msghdr_from_user },
+	{ "account", user_memory_handler_account },
+};
+
+int UserMemoryModel::getMaxArg() const {
+	int result = std::max(std::max(ptrArg, sizeArg), opArg);
+	if (handler == user_memory_handler_get_put_user) {
+		// The width of the first argument is the size
+		result = std::max(result, 0);
+	}
+	return result;
+}
+
+bool UserMemoryModel::matches(unsigned callArgs) const {
+	if ((numArgs >= 0) && (callArgs != (unsigned)numArgs)) {
+		return false;
+	}
+	return getMaxArg() < (int)callArgs;
+}
+
+// The error in the argument indices of model, or NULL if there is none
+static const char * checkArguments(const UserMemoryModel & model) {
+	if (model.numArgs < -1) {
+		return "Invalid number of arguments";
+	}
+	for (int arg : { model.ptrArg, model.sizeArg, model.opArg }) {
+		if ((arg < -1) || ((model.numArgs >= 0) && (arg >= model.numArgs))) {
+			return "Argument index out of range";
+		}
+	}
+	switch (model.handler) {
+	case user_memory_handler_memop:
+	case user_memory_handler_import_iovec:
+		if ((model.ptrArg < 0) || (model.sizeArg < 0)) {
+			return "The handler needs a pointer and a size argument";
+		}
+		break;
+	case user_memory_handler_get_put_user:
+	case user_memory_handler_copy_msghdr_from_user:
+		if (model.ptrArg < 0) {
+			return "The handler needs a pointer argument";
+		}
+		break;
+	case user_memory_handler_account:
+		if (model.sizeArg < 0) {
+			return "The handler needs a size argument";
+		}
+		break;
+	}
+	if ((model.numArgs >= 0) && (model.getMaxArg() >= model.numArgs)) {
+		return "Argument index out of range";
+	}
+	return NULL;
+}
+
+UserMemoryModels * UserMemoryModels::instance = NULL;
+
+UserMemoryModels & UserMemoryModels::getInstance() {
+	if (!instance) {
+		instance = new UserMemoryModels();
+	}
+	return *instance;
+}
+
+UserMemoryModels::UserMemoryModels() {
+	for (const UserMemoryModel & model : builtinModels) {
+		add(model);
+	}
+	if (!UserMemoryModelsFile.empty()) {
+		loadSpecFile(UserMemoryModelsFile);
+	}
+}
+
+void UserMemoryModels::add(const UserMemoryModel & model) {
+	// Later models override earlier ones
+	m_models[model.name] = model;
+}
+
+bool UserMemoryModels::loadSpecFile(const std::string & path) {
+	std::ifstream spec(path.c_str());
+	if (!spec) {
+		llvm::errs() << "Error: Cannot open user memory models " << path << "\n";
+		return false;
+	}
+	std::string line;
+	unsigned lineno = 0;
+	bool result = true;
+	while (std::getline(spec, line)) {
+		++lineno;
+		std::string::size_type comment = line.find('#');
+		if (comment != std::string::npos) {
+			line.erase(comment);
+		}
+		std::istringstream iss(line);
+		UserMemoryModel model;
+		std::string handler;
+		std::string op;
+		if (!(iss >> model.name)) {
+			// Empty line
+			continue;
+		}
+		if (!(iss >> handler >> model.numArgs >> model.ptrArg >>
+				model.sizeArg >> model.opArg >> op)) {
+			llvm::errs() << path << ":" << lineno << ": Error: Malformed model\n";
+			result = false;
+			continue;
+		}
+		bool isKnownHandler = false;
+		for (auto & handlerName : handlerNames) {
+			if (handler == handlerName.name) {
+				model.handler = handlerName.handler;
+				isKnownHandler = true;
+				break;
+			}
+		}
+		if (!isKnownHandler) {
+			llvm::errs() << path << ":" << lineno << ": Error: Unknown handler " << handler << "\n";
+			result = false;
+			continue;
+		}
+		if (op == "read") {
+			model.op = user_pointer_operation_read;
+		} else if (op == "write") {
+			model.op = user_pointer_operation_write;
+		} else {
+			llvm::errs() << path << ":" << lineno << ": Error: Unknown operation " << op << "\n";
+			result = false;
+			continue;
+		}
+		const char * error = checkArguments(model);
+		if (error) {
+			llvm::errs() << path << ":" << lineno << ": Error: " << error << "\n";
+			result = false;
+			continue;
+		}
+		add(model);
+	}
+	return result;
+}
+
+const UserMemoryModel * UserMemoryModels::find(const std::string & name) const {
+	auto it = m_models.find(name);
+	if (it == m_models.end()) {
+		return 0;
+	}
+	return &it->second;
+}
@@ -11,8 +11,10 @@
 /*************************/
 #include <APStream.h>
 #include <AbstractState.h>
+#include <Budget.h>
 #include <Function.h>
 #include <Value.h>
+#include <UserMemoryModels.h>
 
 /*************************/
 /* INCLUDE FILES :: llvm */
@@ -29,6 +31,9 @@
 #include <llvm/DebugInfo.h>
 #include <llvm/IR/Constants.h>
 
+extern bool BatchTransfer;
+extern bool LazyOffsets;
+
 typedef enum {
 	cons_cond_eq,
 	cons_cond_eqmod,
@@ -62,12 +67,14 @@ void appendValue(std::ostringstream & oss,
 class NopInstructionValue : public InstructionValue {
 public:
 	NopInstructionValue(llvm::Value * value) : InstructionValue(value) {}
+	virtual const char * getKindName() { return "NopInstructionValue"; }
 	virtual bool isSkip() { return true; }
 };
 
 class AllocaValue : public InstructionValue {
 public:
 	AllocaValue(llvm::Value * value) : InstructionValue(value) {}
+	virtual const char * getKindName() { return "AllocaValue"; }
 	virtual void update(AbstractState & state);
 	virtual bool isSkip();
 };
@@ -77,9 +84,9 @@ bool AllocaValue::isSkip() {
 }
 
 void AllocaValue::update(AbstractState & state) {
-	MPTItemAbstractState & pt = state.m_mayPointsTo.m_mayPointsTo[getName()];
+	MPTItemAbstractState & pt = state.m_mayPointsTo.extend(getName());
 	pt.clear();
-	pt.insert("kernel");
+	pt.insert(MPT_BUFFER_KERNEL);
 }
 
 class LoadValue : public InstructionValue {
@@ -87,6 +94,7 @@ protected:
 	llvm::LoadInst * asLoadInst();
 public:
 	LoadValue(llvm::Value * value) : InstructionValue(value) {}
+	virtual const char * getKindName() { return "LoadValue"; }
 	virtual void update(AbstractState & state);
 	virtual bool isSkip();
 };
@@ -98,7 +106,7 @@ llvm::LoadInst * LoadValue::asLoadInst() {
 void LoadValue::update(AbstractState & state) {
 	Value * srcValue = getOperandValue(0);
 	MPTAbstractState & mptas = state.m_mayPointsTo;
-	MPTItemAbstractState * pt = mptas.find(srcValue->getName());
+	MPTItemAbstractState * pt = mptas.findSymbol(srcValue->getNameId());
 	if (!pt) {
 		// Value is top.
 		llvm::errs() << "WARNING: Direct load from top pointer: " << srcValue->getName() << "\n";
@@ -107,20 +115,19 @@ void LoadValue::update(AbstractState & state) {
 		}
 		return;
 	}
-	pt->erase("null");
+	pt->erase(MPT_BUFFER_NULL);
+	// Copied, as extending the destination may move the source
+	MPTItemAbstractState src = *pt;
 	if (isPointer()) {
-		MPTItemAbstractState & destpt = state.m_mayPointsTo.m_mayPointsTo[getName()];
+		MPTItemAbstractState & destpt = state.m_mayPointsTo.extend(getName());
 		destpt.clear();
-		for (std::string & buffer : getFunction()->getUserPointers()) {
+		for (const std::string & buffer : getFunction()->getUserPointers()) {
 			destpt.insert(buffer);
 		}
-		if (!pt->contains("kernel")) {
-			pt->erase("kernel");
-		}
 	} else {
 		havoc(state);
 	}
-	if (!pt->isProvablyKernel()) {
+	if (!src.isProvablyKernel()) {
 		llvm::errs() << "WARNING: Direct load from user pointer: " << srcValue->getName() << "\n";
 	}
 }
@@ -134,6 +141,7 @@ protected:
 	virtual llvm::StoreInst * asStoreInst();
 public:
 	StoreValue(llvm::Value * value) : InstructionValue(value) {}
+	virtual const char * getKindName() { return "StoreValue"; }
 	virtual void update(AbstractState & state);
 	virtual bool isSkip();
 };
@@ -143,13 +151,13 @@ llvm::StoreInst * StoreValue::asStoreInst() {
 }
 void StoreValue::update(AbstractState & state) {
 	Value * destValue = getOperandValue(1);
-	MPTItemAbstractState * pt = state.m_mayPointsTo.find(destValue->getName());
+	MPTItemAbstractState * pt = state.m_mayPointsTo.findSymbol(destValue->getNameId());
 	if (!pt) {
 		// Value is top. Do nothing
 		llvm::errs() << "WARNING: Direct store to top pointer: " << destValue->getName() << "\n";
 		return;
 	}
-	pt->erase("null");
+	pt->erase(MPT_BUFFER_NULL);
 	if (!pt->isProvablyKernel()) {
 		llvm::errs() << "WARNING: Direct store to user pointer: " << destValue->getName() << "\n";
 	}
@@ -164,6 +172,7 @@ public:
 	virtual llvm::GetElementPtrInst * asGetElementPtrInst();
 public:
 	GepValue (llvm::Value * value) : InstructionValue(value) {}
+	virtual const char * getKindName() { return "GepValue"; }
 	virtual std::string getValueString();
 	virtual bool isSkip() { return false; }
 	virtual void update(AbstractState & state);
@@ -192,23 +201,34 @@ void GepValue::update(AbstractState & state) {
 
 	Value * offset = getOperandValue(1);
 
+	if (LazyOffsets) {
+		// Only offset(this,base) = offset(src,base) + offset
+		state.assignPtrToPtr(getName(), src->getName(),
+				offset->createTreeExpression(state));
+		return;
+	}
+
 	std::string pointerName = src->getName();
-	MPTItemAbstractState * srcUserPointers = state.m_mayPointsTo.find(pointerName);
-	if (!srcUserPointers) {
+	MPTItemAbstractState * srcUserPointersPtr = state.m_mayPointsTo.findSymbol(src->getNameId());
+	if (!srcUserPointersPtr) {
 		// is top
 		llvm::errs() << "Setting pt for " << getName() << " to top since pt for " << pointerName << " is top\n";
 		state.m_mayPointsTo.forget(getName());
 		return;
 	}
-	MPTItemAbstractState & dest = state.m_mayPointsTo.m_mayPointsTo[getName()];
+	MPTItemAbstractState srcUserPointers = *srcUserPointersPtr;
+	MPTItemAbstractState & dest = state.m_mayPointsTo.extend(getName());
 	dest.clear();
 	const std::string & offsetName = state.generateOffsetName(getName(), pointerName);
 	state.m_apronAbstractState.forget(offsetName); // XXX is this needed?
 	ap_texpr1_t * offset_texpr = offset->createTreeExpression(state);
-	for (auto & srcPtrName : *srcUserPointers) {
-		dest.insert(srcPtrName);
+	dest.join(srcUserPointers);
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	for (auto it = srcUserPointers.begin(), ie = srcUserPointers.end();
+			it != ie; ++it) {
+		SymbolId srcPtr = symbols.getBuffer(it.index());
 		const std::string & offsetVar = AbstractState::generateOffsetName(
-				src->getName(), srcPtrName);
+				src->getNameId(), srcPtr);
 		ap_texpr1_t * offset_var_texpr = state.m_apronAbstractState.asTexpr(offsetVar);		ap_texpr1_t * offset_texpr_copy = ap_texpr1_copy(offset_texpr);
 		state.m_apronAbstractState.extendEnvironment(offset_texpr_copy);
 		state.m_apronAbstractState.extendEnvironment(offset_var_texpr);
@@ -217,7 +237,7 @@ void GepValue::update(AbstractState & state) {
 				AP_RTYPE_INT, AP_RDIR_ZERO);
 		assert(value_texpr);
 		const std::string & offsetName = AbstractState::generateOffsetName(
-				getName(), srcPtrName);
+				getNameId(), srcPtr);
 		state.m_apronAbstractState.assign(offsetName, value_texpr);
 	}
 	ap_texpr1_free(offset_texpr);
@@ -227,7 +247,7 @@ class VariableValue : public Value {
 protected:
 	virtual llvm::Argument * asArgument();
 	virtual Function * getFunction();
-	std::set<std::string> userPointers;
+	MPTItemAbstractState userPointers;
 public:
 	VariableValue(llvm::Value * value) : Value(value) {
 		std::string & name = getName();
@@ -237,7 +257,7 @@ public:
 	}
 	virtual std::string getValueString();
 	virtual std::string toString() ;
-	virtual const std::set<std::string> * mayPointsToUserBuffers(AbstractState & state);
+	virtual const MPTItemAbstractState * mayPointsToUserBuffers(AbstractState & state);
 };
 std::string VariableValue::getValueString() {
 	return getName();
@@ -257,7 +277,7 @@ Function * VariableValue::getFunction() {
 	return manager.getFunction(function);
 }
 
-const std::set<std::string> * VariableValue::mayPointsToUserBuffers(AbstractState & state) {
+const MPTItemAbstractState * VariableValue::mayPointsToUserBuffers(AbstractState & state) {
 	return &userPointers;
 }
 
@@ -279,18 +299,22 @@ ap_texpr1_t * InstructionValue::createRHSTreeExpression(AbstractState & state) {
 	abort();
 }
 
-const std::set<std::string> * InstructionValue::mayPointsToUserBuffers(AbstractState & state) {
-	MPTItemAbstractState * asbuffers = state.m_mayPointsTo.find(getName());
-	if (!asbuffers) {
-		return 0;
-	}
-	return &asbuffers->getBuffers();
+const MPTItemAbstractState * InstructionValue::mayPointsToUserBuffers(AbstractState & state) {
+	return state.m_mayPointsTo.findSymbol(getNameId());
 }
 
 bool InstructionValue::isSkip() {
 	return true;
 }
 
+bool InstructionValue::isBatchable() {
+	return false;
+}
+
+const char * InstructionValue::getKindName() {
+	return asInstruction()->getOpcodeName();
+}
+
 BasicBlock * InstructionValue::getBasicBlock() {
 	llvm::Instruction * instruction = asInstruction();
 	llvm::BasicBlock * llvmBasicBlock = instruction->getParent();
@@ -305,9 +329,20 @@ Function * InstructionValue::getFunction() {
 
 Value * InstructionValue::getOperandValue(int idx) {
 	llvm::Instruction * inst = asInstruction();
+	if (m_operands.empty()) {
+		m_operands.resize(inst->getNumOperands(), 0);
+	}
+	Value * value = m_operands[idx];
+	if (value) {
+		return value;
+	}
 	llvm::Value * operand = inst->getOperand(idx);
 	ValueFactory * factory = ValueFactory::getInstance();
-	Value * value = factory->getValue(operand);
+	value = factory->getValue(operand);
+	// Constant expressions are re-created per function. Don't keep them.
+	if (!llvm::isa<llvm::ConstantExpr>(operand)) {
+		m_operands[idx] = value;
+	}
 	return value;
 }
 
@@ -321,6 +356,7 @@ protected:
 	llvm::ReturnInst * asReturnInst() ;
 public:
 	ReturnInstValue(llvm::Value * value) : TerminatorInstructionValue(value) {}
+	virtual const char * getKindName() { return "ReturnInstValue"; }
 	virtual std::string toString() ;
 };
 
@@ -358,8 +394,10 @@ protected:
 	virtual ap_texpr1_t * createRHSTreeExpression(AbstractState & state);
 public:
 	BinaryOperationValue(llvm::Value * value) : InstructionValue(value) {}
+	virtual const char * getKindName() { return "BinaryOperationValue"; }
 	virtual ap_texpr1_t * createOperandTreeExpression(AbstractState & state, int idx);
 	virtual bool isSkip();
+	virtual bool isBatchable();
 };
 
 llvm::BinaryOperator * BinaryOperationValue::asBinaryOperator()  {
@@ -401,10 +439,12 @@ bool BinaryOperationValue::isSkip() {
 	return false;
 }
 
+bool BinaryOperationValue::isBatchable() {
+	return true;
+}
+
 ap_texpr1_t * BinaryOperationValue::createOperandTreeExpression(AbstractState & state, int idx) {
-	ValueFactory * factory = ValueFactory::getInstance();
-	llvm::Value * llvmOperand = asUser()->getOperand(idx);
-	Value * operand = factory->getValue(llvmOperand);
+	Value * operand = getOperandValue(idx);
 	return operand->createTreeExpression(state);
 }
 
@@ -428,6 +468,7 @@ protected:
 	virtual ap_texpr_op_t getTreeOperation()  { return AP_TEXPR_ADD; }
 public:
 	AdditionOperationValue(llvm::Value * value) : BinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "AdditionOperationValue"; }
 };
 
 class SubtractionOperationValue : public BinaryOperationValue {
@@ -436,6 +477,7 @@ protected:
 	virtual ap_texpr_op_t getTreeOperation()  { return AP_TEXPR_SUB; }
 public:
 	SubtractionOperationValue(llvm::Value * value) : BinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "SubtractionOperationValue"; }
 	virtual void update(AbstractState & state);
 };
 
@@ -453,9 +495,11 @@ void SubtractionOperationValue::update(AbstractState & state) {
 		Value * leftPtrVal = factory->getValue(leftPtr);
 		Value * rightPtrVal = factory->getValue(rightPtr);
 
-		MPTItemAbstractState & leftPT = state.m_mayPointsTo.m_mayPointsTo[leftPtrVal->getName()];
-		leftPT.erase("null");
-		MPTItemAbstractState & rightPT = state.m_mayPointsTo.m_mayPointsTo[rightPtrVal->getName()];
+		state.m_mayPointsTo.extend(leftPtrVal->getName()).erase(MPT_BUFFER_NULL);
+		state.m_mayPointsTo.extend(rightPtrVal->getName());
+		// Both extended, so the items no longer move
+		MPTItemAbstractState & leftPT = *state.m_mayPointsTo.find(leftPtrVal->getName());
+		MPTItemAbstractState & rightPT = *state.m_mayPointsTo.find(rightPtrVal->getName());
 
 		MPTItemAbstractState::updateToIntersection(leftPT, rightPT);
 		return;
@@ -469,6 +513,7 @@ protected:
 	virtual ap_texpr_op_t getTreeOperation()  { return AP_TEXPR_MUL; }
 public:
 	MultiplicationOperationValue(llvm::Value * value) : BinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "MultiplicationOperationValue"; }
 };
 
 class DivisionOperationValue : public BinaryOperationValue {
@@ -477,6 +522,7 @@ protected:
 	virtual ap_texpr_op_t getTreeOperation()  { return AP_TEXPR_DIV; }
 public:
 	DivisionOperationValue(llvm::Value * value) : BinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "DivisionOperationValue"; }
 };
 
 class RemainderOperationValue : public BinaryOperationValue {
@@ -485,6 +531,7 @@ protected:
 	virtual ap_texpr_op_t getTreeOperation()  { return AP_TEXPR_MOD; }
 public:
 	RemainderOperationValue(llvm::Value * value) : BinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "RemainderOperationValue"; }
 };
 
 
@@ -495,6 +542,7 @@ protected:
 	virtual ap_texpr1_t * createRHSTreeExpression(AbstractState & state);
 public:
 	SHLOperationValue(llvm::Value * value) : BinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "SHLOperationValue"; }
 };
 
 ap_texpr1_t * SHLOperationValue::createRHSTreeExpression(AbstractState & state) {
@@ -522,7 +570,9 @@ protected:
 	virtual bool updateByInverseOfSHL(AbstractState & state);
 public:
 	SHROperationValue(llvm::Value * value) : BinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "SHROperationValue"; }
 	virtual void update(AbstractState & state);
+	virtual bool isBatchable();
 };
 
 bool SHROperationValue::updateByInverseMultiplication(AbstractState & state) {
@@ -586,6 +636,10 @@ bool SHROperationValue::updateByInverseOfSHL(AbstractState & state) {
 	return true;
 }
 
+bool SHROperationValue::isBatchable() {
+	return false;
+}
+
 void SHROperationValue::update(AbstractState & state) {
 	if (updateByInverseOfSHL(state)) {
 		return;
@@ -677,12 +731,12 @@ class ConstantNullValue : public ConstantValue {
 protected:
 	virtual std::string getConstantString() ;
 	virtual ap_texpr1_t * createTreeExpression(ApronAbstractState & state);
-	std::set<std::string> mayPointsTo;
+	MPTItemAbstractState mayPointsTo;
 public:
-	ConstantNullValue(llvm::Value * value) : ConstantValue(value), mayPointsTo({"null"}) {
+	ConstantNullValue(llvm::Value * value) : ConstantValue(value), mayPointsTo(MPT_BUFFER_NULL) {
 		llvm::errs() << "Null ptr: llvm name: " << value->getName() << " my name: " << getName() << "\n";
 	}
-	virtual const std::set<std::string> * mayPointsToUserBuffers(AbstractState & state) {
+	virtual const MPTItemAbstractState * mayPointsToUserBuffers(AbstractState & state) {
 		return &mayPointsTo;
 	}
 };
@@ -698,39 +752,41 @@ ap_texpr1_t * ConstantNullValue::createTreeExpression(ApronAbstractState & state
 
 class CallValue : public InstructionValue {
 protected:
+	// Resolved once, on first use
+	bool m_isResolved;
+	std::string m_calledFunctionName;
+	const UserMemoryModel * m_model;
+	// The called function is modelled, but not with this many arguments
+	bool m_isModelMismatch;
+	bool m_isSkip;
+
 	llvm::CallInst * asCallInst();
+	virtual void resolve();
 	virtual std::string getCalledFunctionName();
+	virtual std::string getInlineAsmFunctionName();
 	bool isDebugFunction(const std::string & funcName) const;
-	bool isKernelUserMemoryOperation(const std::string & funcName) const;
 
 	virtual void updateForAccount(AbstractState & state);
-	virtual void updateForAccessOK(AbstractState & state);
-	virtual void updateForGetUser(AbstractState & state);
-	virtual void updateForPutUser(AbstractState & state);
-	virtual void updateForClearUser(AbstractState & state);
-	virtual void updateForCopyToUser(AbstractState & state);
-	virtual void updateForCopyFromUser(AbstractState & state);
-	virtual void updateForStrnlenUser(AbstractState & state);
-	virtual void updateForStrncpyFromUser(AbstractState & state);
+	virtual void updateForModelMismatch(AbstractState & state);
+	virtual void updateForMemoryOperation(AbstractState & state);
 	virtual void updateForUserMemoryOperation(AbstractState & state,
 			const std::string & ptr, ap_texpr1_t * size,
 			user_pointer_operation_e op);
 	virtual void updateForUserMemoryOperation(AbstractState & state,
 			Value * ptr, ap_texpr1_t * size,
 			user_pointer_operation_e op);
-	virtual void updateForGetPutUser(AbstractState & state,
-			user_pointer_operation_e op);
-	virtual void updateForCopyToFromUser(AbstractState & state, user_pointer_operation_e op);
+	virtual void updateForGetPutUser(AbstractState & state);
 	virtual void updateForImportIovec(AbstractState & state);
 	virtual void updateForCopyMsghdrFromUser(AbstractState & state);
 	virtual user_pointer_operation_e getArgumentUserOperation(int arg);
-	virtual user_pointer_operation_e getImportIovecOp();
+	virtual user_pointer_operation_e getModelUserOperation();
 	virtual const std::string & getArgumentName(int arg);
-	virtual const std::string & getImportIovecPtrName();
-	virtual const std::string & getImportIovecLenName();
 
 public:
-	CallValue(llvm::Value * value) : InstructionValue(value) {}
+	CallValue(llvm::Value * value) : InstructionValue(value),
+			m_isResolved(false), m_model(0), m_isModelMismatch(false),
+			m_isSkip(false) {}
+	virtual const char * getKindName() { return "CallValue"; }
 	virtual std::string getValueString();
 	virtual bool isSkip();
 	virtual void update(AbstractState & state);
@@ -740,35 +796,53 @@ llvm::CallInst * CallValue::asCallInst() {
 	return &llvm::cast<llvm::CallInst>(*m_value);
 }
 
-std::string CallValue::getCalledFunctionName() {
+void CallValue::resolve() {
+	if (m_isResolved) {
+		return;
+	}
+	m_isResolved = true;
 	llvm::CallInst * callInst = asCallInst();
-	if (callInst->isInlineAsm())
-	{
-		llvm::InlineAsm *orenInlineAsm = ((llvm::InlineAsm *) (callInst->getCalledValue()));
-		const char *orenString = orenInlineAsm->getAsmString().c_str();
-		int n=strlen(orenString);
-		int i=0;
-		
-		for (i=0;i<n;i++)
-		{
-			if (strncmp(orenString,"put_user",strlen("put_user")) == 0)
-			{
-				assert(0);
-				return "put_user";
-			}
-			else
-			{
-				if (strncmp(orenString,"get_user",strlen("get_user")) == 0)
-				{
-					// assert(0);
-					return "get_user";
-				}
-				else
-				{
-					orenString++;
-				}
-			}
+	if (callInst->isInlineAsm()) {
+		m_calledFunctionName = getInlineAsmFunctionName();
+		if (m_calledFunctionName.empty()) {
+			llvm::errs() << "Warning: Skipping inline asm: " << *callInst->getCalledValue() << "\n";
+			m_isSkip = true;
+			return;
 		}
+	} else {
+		m_calledFunctionName = getCalledFunctionName();
+		m_isSkip = isDebugFunction(m_calledFunctionName);
+	}
+	m_model = UserMemoryModels::getInstance().find(m_calledFunctionName);
+	if (m_model && !m_model->matches(callInst->getNumArgOperands())) {
+		llvm::errs() << "Warning: Not modelling " << m_calledFunctionName <<
+				": called with " << callInst->getNumArgOperands() <<
+				" arguments\n";
+		m_model = NULL;
+		m_isModelMismatch = true;
+	}
+}
+
+std::string CallValue::getInlineAsmFunctionName() {
+	llvm::CallInst * callInst = asCallInst();
+	llvm::InlineAsm * inlineAsm = llvm::cast<llvm::InlineAsm>(callInst->getCalledValue());
+	const std::string & asmString = inlineAsm->getAsmString();
+	std::string::size_type putUser = asmString.find("put_user");
+	std::string::size_type getUser = asmString.find("get_user");
+	if ((putUser != std::string::npos) && (putUser < getUser)) {
+		assert(0);
+		return "put_user";
+	}
+	if (getUser != std::string::npos) {
+		return "get_user";
+	}
+	return "";
+}
+
+std::string CallValue::getCalledFunctionName() {
+	llvm::CallInst * callInst = asCallInst();
+	if (callInst->isInlineAsm()) {
+		return getInlineAsmFunctionName();
 	}
 	llvm::Function * function = callInst->getCalledFunction();
 	if (!function)
@@ -818,184 +892,40 @@ bool CallValue::isDebugFunction(const std::string & funcName) const {
 			funcName, 0, comparator.size()) == 0;
 }
 
-bool CallValue::isKernelUserMemoryOperation(const std::string & funcName) const {
-	// TODO Memoize this method
-	if ("access_ok" == funcName) {
-		return true;
-	}
-	if ("get_user" == funcName) {
-		return true;
-	}
-	if ("put_user" == funcName) {
-		return true;
-	}
-	if ("clear_user" == funcName) {
-		return true;
-	}
-	if ("copy_to_user" == funcName) {
-		return true;
-	}
-	if ("_copy_to_user" == funcName) {
-		return true;
-	}
-	if ("copy_from_user" == funcName) {
-		return true;
-	}
-	if ("strnlen_user" == funcName) {
-		return true;
-	}
-	if ("strncpy_from_user" == funcName) {
-		return true;
-	}
-	if ("import_iovec" == funcName) {
-		return true;
-	}
-	if ("copy_msghdr_from_user" == funcName) {
-		return true;
-	}
-	if ("account" == funcName) {
-		return true;
-	}
-	return false;
-}
-
-bool GetUser(llvm::CallInst *callInst)
-{
-	llvm::InlineAsm *orenInlineAsm = ((llvm::InlineAsm *) (callInst->getCalledValue()));
-	const char *orenString = orenInlineAsm->getAsmString().c_str();
-	int n=strlen(orenString);
-	int i=0;
-		
-	for (i=0;i<n;i++)
-	{
-		if (strncmp(orenString,"put_user",strlen("put_user")) == 0)
-		{
-			assert(0);
-			return true;
-		}
-		else
-		{
-			if (strncmp(orenString,"get_user",strlen("get_user")) == 0)
-			{
-				// assert(0);
-				return true;
-			}
-			else
-			{
-				orenString++;
-			}
-		}
-	}
-	return false;
-}
-
-bool PutUser(llvm::CallInst *callInst	)
-{
-	llvm::InlineAsm *orenInlineAsm = ((llvm::InlineAsm *) (callInst->getCalledValue()));
-	const char *orenString = orenInlineAsm->getAsmString().c_str();
-	int n=strlen(orenString);
-	int i=0;
-		
-	for (i=0;i<n;i++)
-	{
-		if (strncmp(orenString,"put_user",strlen("put_user")) == 0)
-		{
-			assert(0);
-			return true;
-		}
-		else
-		{
-			if (strncmp(orenString,"get_user",strlen("get_user")) == 0)
-			{
-				// assert(0);
-				return true;
-			}
-			else
-			{
-				orenString++;
-			}
-		}
-	}
-	return false;
-}
-
-
 bool CallValue::isSkip()
 {
-	llvm::CallInst * callInst = asCallInst();
-	if (asCallInst()->isInlineAsm())
-	{
-		if (GetUser(callInst) || PutUser(callInst))
-		{
-			return false;
-		}
-		else
-		{
-			llvm::errs() << "Warning: Skipping inline asm: " << *callInst->getCalledValue() << "\n";
-			return true;
-		}
-	}
-	const std::string funcName = getCalledFunctionName();
-	if (isDebugFunction(funcName)) {
-		return true;
-	}
-	return false;
+	resolve();
+	return m_isSkip;
 }
 
 void CallValue::update(AbstractState & state) {
-	const std::string funcName = getCalledFunctionName();
-	if (isKernelUserMemoryOperation(funcName)) {
-		if ("access_ok" == funcName) {
-			updateForAccessOK(state);
-			return;
-		}
-		if ("get_user" == funcName) {
-			updateForGetUser(state);
-			return;
-		}
-		if ("put_user" == funcName) {
-			updateForPutUser(state);
-			return;
-		}
-		if ("clear_user" == funcName) {
-			updateForClearUser(state);
-			return;
-		}
-		if ("copy_to_user" == funcName) {
-			updateForCopyToUser(state);
-			return;
-		}
-		if ("_copy_to_user" == funcName) {
-			updateForCopyToUser(state);
-			return;
-		}
-		if ("copy_from_user" == funcName) {
-			updateForCopyFromUser(state);
-			return;
-		}
-		if ("strnlen_user" == funcName) {
-			updateForStrnlenUser(state);
-			return;
-		}
-		if ("strncpy_from_user" == funcName) {
-			updateForStrncpyFromUser(state);
-			return;
-		}
-		if ("import_iovec" == funcName) {
-			updateForImportIovec(state);
-			return;
-		}
-		if ("copy_msghdr_from_user" == funcName) {
-			updateForCopyMsghdrFromUser(state);
-			return;
-		}
-		if ("account" == funcName) {
-			updateForAccount(state);
-			return;
-		}
+	resolve();
+	if (m_isModelMismatch) {
+		updateForModelMismatch(state);
+		return;
+	}
+	if (!m_model) {
+		havoc(state);
+		return;
+	}
+	switch (m_model->handler) {
+	case user_memory_handler_memop:
+		updateForMemoryOperation(state);
+		return;
+	case user_memory_handler_get_put_user:
+		updateForGetPutUser(state);
+		return;
+	case user_memory_handler_import_iovec:
+		updateForImportIovec(state);
+		return;
+	case user_memory_handler_copy_msghdr_from_user:
+		updateForCopyMsghdrFromUser(state);
+		return;
+	case user_memory_handler_account:
+		updateForAccount(state);
+		return;
 	}
 	havoc(state);
-	return;
 }
 
 user_pointer_operation_e CallValue::getArgumentUserOperation(int arg) {
@@ -1009,8 +939,11 @@ user_pointer_operation_e CallValue::getArgumentUserOperation(int arg) {
 			user_pointer_operation_write);
 }
 
-user_pointer_operation_e CallValue::getImportIovecOp() {
-	return getArgumentUserOperation(0);
+user_pointer_operation_e CallValue::getModelUserOperation() {
+	if (m_model->opArg >= 0) {
+		return getArgumentUserOperation(m_model->opArg);
+	}
+	return m_model->op;
 }
 
 const std::string & CallValue::getArgumentName(int arg) {
@@ -1022,23 +955,15 @@ const std::string & CallValue::getArgumentName(int arg) {
 	return name;
 }
 
-const std::string & CallValue::getImportIovecPtrName() {
-	return getArgumentName(1);
-}
-
-const std::string & CallValue::getImportIovecLenName() {
-	return getArgumentName(2);
-}
-
 void CallValue::updateForImportIovec(AbstractState & state) {
 	/* The op sent to import_iovec is the oposite of what we plan to do,
 	 * i.e. read -> write, and write -> read */
-	user_pointer_operation_e op = (getImportIovecOp() == user_pointer_operation_read) ?
+	user_pointer_operation_e op = (getModelUserOperation() == user_pointer_operation_read) ?
 			user_pointer_operation_write : user_pointer_operation_read;
 	state.m_importedIovecCalls.push_back(ImportIovecCall(
-		op, getImportIovecPtrName(), getImportIovecLenName()));
+		op, getArgumentName(m_model->ptrArg),
+		getArgumentName(m_model->sizeArg)));
 
-	ap_texpr1_t * zero = state.m_apronAbstractState.asTexpr((int64_t)0);
 	assign0(state);
 }
 
@@ -1046,17 +971,18 @@ void CallValue::updateForImportIovec(AbstractState & state) {
 void CallValue::updateForCopyMsghdrFromUser(
 		AbstractState & state) {
 	llvm::CallInst * callinst = asCallInst();
-	assert(callinst->getNumArgOperands() == 4);
 
-	user_pointer_operation_e op = user_pointer_operation_write;
-	llvm::Value * llvmOp = callinst->getArgOperand(2);
-	llvm::Constant * opValue = llvm::dyn_cast<llvm::Constant>(llvmOp);
-	if (opValue && opValue->isZeroValue()) {
-		op = user_pointer_operation_read;
+	user_pointer_operation_e op = m_model->op;
+	if (m_model->opArg >= 0) {
+		llvm::Value * llvmOp = callinst->getArgOperand(m_model->opArg);
+		llvm::Constant * opValue = llvm::dyn_cast<llvm::Constant>(llvmOp);
+		if (opValue && opValue->isZeroValue()) {
+			op = user_pointer_operation_read;
+		}
 	}
 
 	state.m_copyMsghdrFromUserCalls.push_back(
-			CopyMsghdrFromUserCall(op, getArgumentName(1)));
+			CopyMsghdrFromUserCall(op, getArgumentName(m_model->ptrArg)));
 	assign0(state);
 }
 
@@ -1068,7 +994,7 @@ void CallValue::updateForAccount(AbstractState & state) {
 		name = &tmpname;
 		state.m_apronAbstractState.extend(tmpname);
 	}
-	Value * limit = getOperandValue(1);
+	Value * limit = getOperandValue(m_model->sizeArg);
 	ap_texpr1_t * this_texpr = state.m_apronAbstractState.asTexpr(*name);
 	ap_texpr1_t * other_texpr = limit->createTreeExpression(state);
 	ap_texpr1_t * texpr = ap_texpr1_binop(
@@ -1082,22 +1008,37 @@ void CallValue::updateForAccount(AbstractState & state) {
 	}
 }
 
-void CallValue::updateForAccessOK(AbstractState & state) {
-	llvm::CallInst * callinst = asCallInst();
-	assert(callinst->getNumArgOperands() == 3);
-	user_pointer_operation_e op = getArgumentUserOperation(0);
-	Value * ptr = getOperandValue(1);
-	Value * sizeValue = getOperandValue(2);
+// The call may access any user buffer, by an unknown amount
+void CallValue::updateForModelMismatch(AbstractState & state) {
+	AnalysisBudget::getInstance().degrade("unmodelled call to " +
+			m_calledFunctionName);
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	for (unsigned idx = MPT_BUFFER_USER; idx < symbols.getBufferCount(); idx++) {
+		const std::string & buffer = symbols.getName(symbols.getBuffer(idx));
+		for (int op = 0; op < user_pointer_operation_count; op++) {
+			state.m_apronAbstractState.forget(AbstractState::generateLastName(
+					buffer, (user_pointer_operation_e)op));
+		}
+		state.m_apronAbstractState.forget(
+				AbstractState::generateSizeName(buffer));
+	}
+	havoc(state);
+}
+
+void CallValue::updateForMemoryOperation(AbstractState & state) {
+	// TODO Ignores first0 of strnlen_user and strncpy_from_user
+	Value * ptr = getOperandValue(m_model->ptrArg);
+	Value * sizeValue = getOperandValue(m_model->sizeArg);
 	ap_texpr1_t * size = sizeValue->createTreeExpression(state);
-	updateForUserMemoryOperation(state, ptr, size, op);
+	updateForUserMemoryOperation(state, ptr, size, getModelUserOperation());
 }
 
 void CallValue::updateForUserMemoryOperation(AbstractState & state,
 		const std::string & ptrName, ap_texpr1_t * size,
 		user_pointer_operation_e op) {
-	MPTItemAbstractState & userBuffers = state.m_mayPointsTo.m_mayPointsTo[ptrName];
-	userBuffers.erase("null");
-	userBuffers.erase("kernel");
+	MPTItemAbstractState & userBuffers = state.m_mayPointsTo.extend(ptrName);
+	userBuffers.erase(MPT_BUFFER_NULL);
+	userBuffers.erase(MPT_BUFFER_KERNEL);
 	for (auto & userBuffer : userBuffers) {
 		MemoryAccessAbstractValue maav(getName(), ptrName, userBuffer, ap_texpr1_copy(size), op);
 		// Placed back in abstractState to be joined at end of BB
@@ -1113,70 +1054,17 @@ void CallValue::updateForUserMemoryOperation(AbstractState & state,
 	updateForUserMemoryOperation(state, ptr->getName(), size, op);
 }
 
-void CallValue::updateForGetPutUser(AbstractState & state,
-		user_pointer_operation_e op) {
+void CallValue::updateForGetPutUser(AbstractState & state) {
 	/*
 	 * Update the constraints to include that the pointer was 'read from'
 	 */
-	llvm::CallInst * callinst = asCallInst();
-	assert(callinst->getNumArgOperands() == 2);
 	// Size: Width of first parameter
 	Value * dest = getOperandValue(0);
 	unsigned size = dest->getByteSize();
 	ap_texpr1_t * apsize = state.m_apronAbstractState.asTexpr((int64_t)size);
-	// Pointer + offset: Second parameter
-	Value * src = getOperandValue(1);
-	updateForUserMemoryOperation(state, src, apsize, op);
-}
-
-void CallValue::updateForGetUser(AbstractState & state) {
-	updateForGetPutUser(state, user_pointer_operation_read);
-}
-
-void CallValue::updateForPutUser(AbstractState & state) {
-	updateForGetPutUser(state, user_pointer_operation_write);
-}
-
-void CallValue::updateForClearUser(AbstractState & state) {
-	llvm::CallInst * callinst = asCallInst();
-	assert(callinst->getNumArgOperands() == 2);
-	Value * ptr = getOperandValue(0);
-	Value * sizeValue = getOperandValue(1);
-	ap_texpr1_t * size = sizeValue->createTreeExpression(state);
-	updateForUserMemoryOperation(state, ptr, size, user_pointer_operation_write);
-}
-
-void CallValue::updateForCopyToFromUser(AbstractState & state,
-		user_pointer_operation_e op) {
-	llvm::CallInst * callinst = asCallInst();
-	assert(callinst->getNumArgOperands() == 3);
-	Value * ptr = getOperandValue(0);
-	Value * sizeValue = getOperandValue(2);
-	ap_texpr1_t * size = sizeValue->createTreeExpression(state);
-	updateForUserMemoryOperation(state, ptr, size, op);
-}
-
-void CallValue::updateForCopyToUser(AbstractState & state) {
-	updateForCopyToFromUser(state, user_pointer_operation_write);
-}
-
-void CallValue::updateForCopyFromUser(AbstractState & state) {
-	updateForCopyToFromUser(state, user_pointer_operation_read);
-}
-
-void CallValue::updateForStrnlenUser(AbstractState & state) {
-	// TODO Ignores first0
-	llvm::CallInst * callinst = asCallInst();
-	assert(callinst->getNumArgOperands() == 3);
-	Value * ptr = getOperandValue(0);
-	Value * sizeValue = getOperandValue(1);
-	ap_texpr1_t * size = sizeValue->createTreeExpression(state);
-	updateForUserMemoryOperation(state, ptr, size, user_pointer_operation_read);
-}
-
-void CallValue::updateForStrncpyFromUser(AbstractState & state) {
-	// TODO Ignores first0
-	updateForCopyFromUser(state);
+	// Pointer + offset
+	Value * src = getOperandValue(m_model->ptrArg);
+	updateForUserMemoryOperation(state, src, apsize, getModelUserOperation());
 }
 
 class LogicalBinaryOperationValue : public BinaryOperationValue {
@@ -1184,6 +1072,7 @@ protected:
 	virtual ap_texpr_op_t getTreeOperation() { abort(); /* Can't be done */ }
 public:
 	LogicalBinaryOperationValue(llvm::Value * value) : BinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "LogicalBinaryOperationValue"; }
 	virtual bool isSkip();
 	virtual void updateConditionalAssumptions(AbstractState & state, bool isNegated=false) = 0;
 };
@@ -1195,6 +1084,7 @@ bool LogicalBinaryOperationValue::isSkip() {
 class CompareValue : public LogicalBinaryOperationValue {
 public:
 	CompareValue(llvm::Value * value) : LogicalBinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "CompareValue"; }
 	// TODO These probably work differently
 	virtual ap_texpr_op_t getTreeOperation()  { abort(); }
 	virtual constraint_condition_t getConditionType() = 0;
@@ -1223,6 +1113,7 @@ protected:
 		constraint_condition_t condType, Value * left, Value * right);
 public:
 	IntegerCompareValue(llvm::Value * value) : CompareValue(value) {}
+	virtual const char * getKindName() { return "IntegerCompareValue"; }
 	virtual constraint_condition_t getConditionType();
 	virtual constraint_condition_t getNegatedConditionType();
 	virtual void updateConditionalAssumptions(AbstractState & state, bool isNegated=false);
@@ -1451,6 +1342,11 @@ void IntegerCompareValue::updateMayPointsToAssumptions(AbstractState & state,
 	}
 	Value * condOperand1Value = getOperandValue(1);
 	assert(condOperand1Value->isPointer() && "Pointer and non-pointer comparison");
+	if (!condOperand0Value->isConstant() && !condOperand1Value->isConstant()) {
+		// Compared pointers keep their offsets explicit
+		state.materializeOffsets(condOperand0Value->getName());
+		state.materializeOffsets(condOperand1Value->getName());
+	}
 
 	meetMayPointsToByAssumption(state, consCond, condOperand0Value, condOperand1Value);
 }
@@ -1459,7 +1355,7 @@ void IntegerCompareValue::removeNullIfOtherIsProvablyNull(
 		MPTItemAbstractState & left, MPTItemAbstractState & right) {
 	if (right.isProvablyNull()) {
 		// TODO If left is provably null, make bottom
-		left.erase("null");
+		left.erase(MPT_BUFFER_NULL);
 	}
 }
 
@@ -1475,11 +1371,13 @@ void IntegerCompareValue::meetMayPointsToByAssumption(AbstractState & state,
 			return;
 		}
 		if (!pt_left) {
-			state.m_mayPointsTo.extend(left->getName()) = *pt_right;
+			MPTItemAbstractState right_buffers = *pt_right;
+			state.m_mayPointsTo.extend(left->getName()) = right_buffers;
 			return;
 		}
 		if (!pt_right) {
-			state.m_mayPointsTo.extend(right->getName()) = *pt_left;
+			MPTItemAbstractState left_buffers = *pt_left;
+			state.m_mayPointsTo.extend(right->getName()) = left_buffers;
 			return;
 		}
 		MPTItemAbstractState::updateToIntersection(*pt_left, *pt_right);
@@ -1532,6 +1430,7 @@ protected:
 	virtual void updateConditionalAssumptionsNegative(AbstractState & state);
 public:
 	OrOperationValue(llvm::Value * value) : LogicalBinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "OrOperationValue"; }
 	virtual void updateConditionalAssumptions(AbstractState & state, bool isNegated=false);
 };
 
@@ -1581,6 +1480,7 @@ protected:
 	virtual void updateConditionalAssumptionsNegative(AbstractState & state);
 public:
 	AndOperationValue(llvm::Value * value) : LogicalBinaryOperationValue(value) {}
+	virtual const char * getKindName() { return "AndOperationValue"; }
 	virtual void updateConditionalAssumptions(AbstractState & state, bool isNegated=false);
 };
 
@@ -1622,6 +1522,7 @@ protected:
 	virtual void updateNumericalAssumptions(AbstractState & state, Value * incomingValue);
 public:
 	PhiValue(llvm::Value * value) : InstructionValue(value) {}
+	virtual const char * getKindName() { return "PhiValue"; }
 	virtual std::string getValueString();
 	virtual bool isSkip();
 	virtual void updateAssumptions(BasicBlock * source, BasicBlock * dest, AbstractState & state);
@@ -1655,9 +1556,10 @@ bool PhiValue::isSkip() {
 Value * PhiValue::getIncomingValue(BasicBlock * source) {
 	llvm::PHINode * phi = asPHINode();
 	llvm::BasicBlock * llvmsource = source->getLLVMBasicBlock();
-	llvm::Value * incoming = phi->getIncomingValueForBlock(llvmsource);
-	ValueFactory * factory = ValueFactory::getInstance();
-	return factory->getValue(incoming);
+	// The incoming values are the operands of the phi
+	int idx = phi->getBasicBlockIndex(llvmsource);
+	assert(idx >= 0);
+	return getOperandValue(idx);
 }
 
 void PhiValue::updateMayPointsToAssumptions(AbstractState & state, Value * incomingValue) {
@@ -1707,6 +1609,7 @@ protected:
 	virtual const std::string & getTemporaryName();
 public:
 	SelectValueInstruction(llvm::Value * value) : InstructionValue(value) {}
+	virtual const char * getKindName() { return "SelectValueInstruction"; }
 	virtual std::string getValueString();
 	virtual bool isSkip();
 	virtual void update(AbstractState & state);
@@ -1717,13 +1620,11 @@ llvm::SelectInst * SelectValueInstruction::asSelectInst() {
 }
 
 Value * SelectValueInstruction::getTrueValue() {
-	ValueFactory * factory = ValueFactory::getInstance();
-	return factory->getValue(asSelectInst()->getTrueValue());
+	return getOperandValue(1);
 }
 
 Value * SelectValueInstruction::getFalseValue() {
-	ValueFactory * factory = ValueFactory::getInstance();
-	return factory->getValue(asSelectInst()->getFalseValue());
+	return getOperandValue(2);
 }
 
 std::string SelectValueInstruction::getValueString() {
@@ -1795,6 +1696,7 @@ protected:
 	llvm::UnaryInstruction * asUnaryInstruction();
 public:
 	UnaryOperationValue(llvm::Value * value) : InstructionValue(value) {}
+	virtual const char * getKindName() { return "UnaryOperationValue"; }
 };
 
 llvm::UnaryInstruction * UnaryOperationValue::asUnaryInstruction() {
@@ -1806,8 +1708,10 @@ protected:
 	virtual ap_texpr1_t * createRHSTreeExpression(AbstractState & state);
 public:
 	CastOperationValue(llvm::Value * value) : UnaryOperationValue(value) {}
+	virtual const char * getKindName() { return "CastOperationValue"; }
 	virtual std::string getValueString();
 	virtual bool isSkip();
+	virtual bool isBatchable();
 	virtual void update(AbstractState & state);
 };
 
@@ -1824,6 +1728,11 @@ bool CastOperationValue::isSkip() {
 	return false;
 }
 
+bool CastOperationValue::isBatchable() {
+	// Pointer casts also copy the offsets
+	return !isPointer();
+}
+
 ap_texpr1_t * CastOperationValue::createRHSTreeExpression(AbstractState & state) {
 	Value * value = getOperandValue(0);
 	return value->createTreeExpression(state);
@@ -1847,6 +1756,7 @@ protected:
 			AbstractState & state);
 public:
 	BranchInstructionValue(llvm::Value * value) : TerminatorInstructionValue(value) {}
+	virtual const char * getKindName() { return "BranchInstructionValue"; }
 	virtual void updateAssumptions(BasicBlock * source, BasicBlock * dest, AbstractState & state);
 };
 
@@ -1884,7 +1794,14 @@ void BranchInstructionValue::updateAssumptions(
 	} else {
 		abort();
 	}
-	condition->updateConditionalAssumptions(state, isNegated);
+	if (BatchTransfer) {
+		// The whole guard as a single meet
+		state.m_apronAbstractState.start_meet_aggregate();
+		condition->updateConditionalAssumptions(state, isNegated);
+		state.m_apronAbstractState.finish_meet_aggregate();
+	} else {
+		condition->updateConditionalAssumptions(state, isNegated);
+	}
 	// We assume that the condition contains the result of the memory
 	// operation, if there was one in the basic block
 	if (state.m_isHasMemoryOperation) {
@@ -1933,6 +1850,7 @@ protected:
 	llvm::SwitchInst * asSwitchInst();
 public:
 	SwitchInstructionValue(llvm::Value * value) : TerminatorInstructionValue(value) {}
+	virtual const char * getKindName() { return "SwitchInstructionValue"; }
 	virtual void updateAssumptions(BasicBlock * source, BasicBlock * dest, AbstractState & state);
 };
 
@@ -1948,10 +1866,25 @@ void SwitchInstructionValue::updateAssumptions(
 	Value * condVar = factory->getValue(llvmCondVar);
 	llvm::ConstantInt * llvmCaseValue = switchInst->findCaseDest(dest->getLLVMBasicBlock());
 	state.m_apronAbstractState.extend(condVar->getName());
-	if (llvmCaseValue) {
+	if (llvmCaseValue && !BatchTransfer) {
 		Value * caseValue = factory->getValue(llvmCaseValue);
 		state.m_apronAbstractState.assign(condVar->getName(),
 				caseValue->createTreeExpression(state));
+	} else if (llvmCaseValue) {
+		// Meet rather than assign, so that other relations of condVar
+		// are kept, and infeasible cases become bottom. The whole guard
+		// as a single meet, as for a branch.
+		state.m_apronAbstractState.start_meet_aggregate();
+		Value * caseValue = factory->getValue(llvmCaseValue);
+		ap_texpr1_t * condTexpr = condVar->createTreeExpression(state);
+		ap_texpr1_t * caseTexpr = caseValue->createTreeExpression(state);
+		ap_texpr1_t * diff = ap_texpr1_binop(
+				AP_TEXPR_SUB, condTexpr, caseTexpr,
+				AP_RTYPE_INT, AP_RDIR_ZERO);
+		ap_tcons1_t cons = ap_tcons1_make(AP_CONS_EQ, diff,
+				state.m_apronAbstractState.zero());
+		state.m_apronAbstractState.meet(cons);
+		state.m_apronAbstractState.finish_meet_aggregate();
 	} else {
 		// TODO Add constraints that condVar is different from all other cases
 		// Verify the value is top:
@@ -1960,7 +1893,9 @@ void SwitchInstructionValue::updateAssumptions(
 }
 
 Value::Value(llvm::Value * value) : m_value(value),
-		m_name(llvmValueName(value))
+		m_name(llvmValueName(value)), m_index(-1),
+		m_isPointer(value->getType()->isPointerTy()),
+		m_bitSize(-1), m_nameTable(0), m_nameId(SymbolTable::invalid)
 	{}
 
 int Value::valuesIndex = 0;
@@ -1982,7 +1917,7 @@ std::string Value::llvmValueName(llvm::Value * value) {
 }
 
 bool Value::isPointer() {
-	return m_value->getType()->isPointerTy();
+	return m_isPointer;
 }
 
 static const llvm::Module *getModuleFromVal(const llvm::Value *V) {
@@ -2003,16 +1938,19 @@ static const llvm::Module *getModuleFromVal(const llvm::Value *V) {
 }
 
 unsigned Value::getBitSize() {
+	if (m_bitSize != (unsigned)-1) {
+		return m_bitSize;
+	}
 	llvm::Type * type = m_value->getType();
 	const llvm::Module * module = getModuleFromVal(m_value);
 	if (!module) {
 		llvm::errs() << "No module for? :" << *m_value << "\n";
 		abort();
 	}
-	std::string dlstr = module->getDataLayout();
-	const llvm::DataLayout dataLayout(module);
-	unsigned bits = dataLayout.getTypeSizeInBits(type);
-	return bits;
+	ValueFactory * factory = ValueFactory::getInstance();
+	const llvm::DataLayout & dataLayout = factory->getDataLayout(module);
+	m_bitSize = dataLayout.getTypeSizeInBits(type);
+	return m_bitSize;
 }
 
 unsigned Value::getByteSize() {
@@ -2024,6 +1962,19 @@ std::string & Value::getName()  {
 	return m_name;
 }
 
+unsigned Value::getIndex() const {
+	return m_index;
+}
+
+SymbolId Value::getNameId() {
+	SymbolTable & symbols = SymbolTable::getCurrent();
+	if (m_nameTable != &symbols) {
+		m_nameId = symbols.intern(m_name);
+		m_nameTable = &symbols;
+	}
+	return m_nameId;
+}
+
 std::string Value::getValueString()  {
 	return getName();
 }
@@ -2060,7 +2011,7 @@ void Value::assign0(AbstractState & state) {
 	state.m_apronAbstractState.assign(getName(), zero);
 }
 
-const std::set<std::string> * Value::mayPointsToUserBuffers(AbstractState & state) {
+const MPTItemAbstractState * Value::mayPointsToUserBuffers(AbstractState & state) {
 	return 0;
 }
 
@@ -2077,7 +2028,7 @@ void Value::updateConditionalAssumptions(AbstractState & state, bool isNegated)
 			state.m_apronAbstractState.assign(getName(), zero);
 		}
 	} else {
-		MPTItemAbstractState & mptItem = state.m_mayPointsTo.m_mayPointsTo[getName()];
+		MPTItemAbstractState & mptItem = state.m_mayPointsTo.extend(getName());
 		bool isNull = mptItem.isProvablyNull();
 		if (isNull) {
 			if (!isNegated) {
@@ -2088,14 +2039,14 @@ void Value::updateConditionalAssumptions(AbstractState & state, bool isNegated)
 			if (!isNegated) {
 				if (mptItem.isWritable()) {
 					mptItem.clear();
-					mptItem.insert("null");
-				} else if (!mptItem.contains("null")) {
+					mptItem.insert(MPT_BUFFER_NULL);
+				} else if (!mptItem.contains(MPT_BUFFER_NULL)) {
 					llvm::errs() << "Setting state to bottom, since " << getName() << " isn't null and that can't be changed\n";
 					state.makeBottom();
 				}
 			} else {
 				if (mptItem.isWritable()) {
-					mptItem.erase("null");
+					mptItem.erase(MPT_BUFFER_NULL);
 				}
 			}
 		}
@@ -2134,6 +2085,8 @@ ValueFactory * ValueFactory::instance = NULL;
 
 ValueFactory::ValueFactory() {}
 
+ValueFactory::~ValueFactory() {}
+
 ValueFactory * ValueFactory::getInstance() {
 	if (!instance) {
 		instance = new ValueFactory();
@@ -2141,23 +2094,107 @@ ValueFactory * ValueFactory::getInstance() {
 	return instance;
 }
 
+static llvm::Function * getParentFunction(llvm::Value * value) {
+	if (llvm::Argument * argument = llvm::dyn_cast<llvm::Argument>(value)) {
+		return argument->getParent();
+	}
+	if (llvm::Instruction * instruction = llvm::dyn_cast<llvm::Instruction>(value)) {
+		llvm::BasicBlock * basicBlock = instruction->getParent();
+		return basicBlock ? basicBlock->getParent() : 0;
+	}
+	return 0;
+}
+
 Value * ValueFactory::getValue(llvm::Value * value) {
-	std::map<llvm::Value *, Value*>::iterator it;
-	it = values.find(value);
-	if (it != values.end()) {
-		return it->second;
+	llvm::DenseMap<llvm::Value *, unsigned>::iterator it;
+	it = m_indices.find(value);
+	Value * result;
+	if (it != m_indices.end()) {
+		result = m_values[it->second];
+	} else {
+		llvm::Function * function = getParentFunction(value);
+		if (function && !m_numberedFunctions.count(function)) {
+			numberFunction(function);
+			return getValue(value);
+		}
+		result = createValue(value);
+		if (result) {
+			addValue(value, result);
+		}
 	}
-	Value * result = createValue(value);
 	if (!result) {
 		llvm::errs() << "Unknown value: ";
 		value->print(llvm::errs());
 		llvm::errs() << "\n";
 		abort();
 	}
-	values.insert(std::pair<llvm::Value *, Value*>(value, result));
 	return result;
 }
 
+void ValueFactory::addValue(llvm::Value * llvmValue, Value * value) {
+	unsigned index = m_values.size();
+	m_values.push_back(value);
+	m_indices[llvmValue] = index;
+	if (value) {
+		value->m_index = index;
+	}
+}
+
+void ValueFactory::numberFunction(llvm::Function * function) {
+	m_numberedFunctions.insert(function);
+	for (llvm::Argument & argument : function->getArgumentList()) {
+		addValue(&argument, new VariableValue(&argument));
+	}
+	for (llvm::BasicBlock & basicBlock : *function) {
+		for (llvm::Instruction & instruction : basicBlock) {
+			// Unsupported instructions are numbered too, and
+			// reported only if used
+			addValue(&instruction, createInstructionValue(&instruction));
+		}
+	}
+}
+
+void ValueFactory::releaseFunction(llvm::Function * function) {
+	if (!m_numberedFunctions.erase(function)) {
+		return;
+	}
+	std::vector<llvm::Value *> llvmValues;
+	for (llvm::Argument & argument : function->getArgumentList()) {
+		llvmValues.push_back(&argument);
+	}
+	for (llvm::BasicBlock & basicBlock : *function) {
+		for (llvm::Instruction & instruction : basicBlock) {
+			llvmValues.push_back(&instruction);
+		}
+	}
+	for (llvm::Value * llvmValue : llvmValues) {
+		llvm::DenseMap<llvm::Value *, unsigned>::iterator it =
+				m_indices.find(llvmValue);
+		if (it == m_indices.end()) {
+			continue;
+		}
+		delete m_values[it->second];
+		m_values[it->second] = 0;
+		m_indices.erase(it);
+	}
+	// The module's layout is rebuilt if another of its functions is read
+	const llvm::Module * module = function->getParent();
+	for (llvm::Function * numbered : m_numberedFunctions) {
+		if (numbered->getParent() == module) {
+			return;
+		}
+	}
+	m_dataLayouts.erase(module);
+}
+
+const llvm::DataLayout & ValueFactory::getDataLayout(const llvm::Module * module) {
+	std::unique_ptr<llvm::DataLayout> & dataLayout = m_dataLayouts[module];
+	if (!dataLayout) {
+		dataLayout.reset(new llvm::DataLayout(module));
+	}
+	return *dataLayout;
+}
+
 Value * ValueFactory::createValue(llvm::Value * value) {
 	if (llvm::isa<llvm::Instruction>(value)) {
 		llvm::Instruction & instruction =
@@ -2305,9 +2342,10 @@ Value * ValueFactory::createConstantValue(llvm::Constant * constant) {
 	}
 	if (llvm::isa<llvm::ConstantExpr>(constant)) {
 		llvm::ConstantExpr & expr = llvm::cast<llvm::ConstantExpr>(*constant);
-		llvm::Value * instruction = expr.getAsInstruction();
+		llvm::Instruction * instruction = expr.getAsInstruction();
 		Value * result = getValue(instruction);
-		m_createdInstances.insert(std::make_pair(result, instruction));
+		CreatedInstance created = { constant, instruction };
+		m_createdInstances.insert(std::make_pair(result, created));
 		return result;
 	}
 	return NULL;
@@ -2317,10 +2355,21 @@ void ValueFactory::deleteCreatedInstances() {
 	ValueFactory * instance = getInstance();
 	for (auto & pair : instance->m_createdInstances) {
 		Value * value = pair.first;
-		llvm::Value * llvmValue = pair.second;
-		instance->values.erase(llvmValue);
+		const CreatedInstance & created = pair.second;
+		// Both the constant and its instruction map to the value
+		llvm::Value * llvmValues[] = { created.constant, created.instruction };
+		for (llvm::Value * llvmValue : llvmValues) {
+			llvm::DenseMap<llvm::Value *, unsigned>::iterator it =
+					instance->m_indices.find(llvmValue);
+			if (it == instance->m_indices.end()) {
+				continue;
+			}
+			instance->m_values[it->second] = 0;
+			instance->m_indices.erase(it);
+		}
 		delete value;
-		delete llvmValue;
+		delete created.instruction;
 	}
 	instance->m_createdInstances.clear();
+	instance->m_dataLayouts.clear();
 }
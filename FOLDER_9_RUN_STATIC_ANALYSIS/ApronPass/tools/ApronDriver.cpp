@@ -0,0 +1,68 @@
+/*
+ * Runs the apron pass like opt does, but loads the input bitcode lazily.
+ *
+ * opt parses every function body of the input before running the pass.
+ * Here, bodies are read only when the pass reaches them (see materialize()
+ * and release() in apron.cpp), so with -closure-root or
+ * -run-on-single-function, startup time and memory depend on the analysed
+ * functions, and not on the size of the object file.
+ *
+ * Usage is as with opt:
+ *   apron-driver -load lib<domain>_debug.so -load libapron_debug.so \
+ *       -load lib<domain>_adaptor.so -load libapronpass.so \
+ *       -closure-root=sys_read <other pass options> input.bc
+ */
+#include <string>
+
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Pass.h>
+#include <llvm/PassManager.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/PluginLoader.h>
+#include <llvm/Support/PrettyStackTrace.h>
+#include <llvm/Support/Signals.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+
+static llvm::cl::opt<std::string> InputFilename(llvm::cl::Positional,
+		llvm::cl::desc("<input bitcode file>"),
+		llvm::cl::init("-"),
+		llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<std::string> PassName("pass",
+		llvm::cl::init("apron"),
+		llvm::cl::desc("The pass to run. (apron)"));
+
+int main(int argc, char ** argv) {
+	llvm::sys::PrintStackTraceOnErrorSignal();
+	llvm::PrettyStackTraceProgram stackTrace(argc, argv);
+	llvm::llvm_shutdown_obj shutdown;
+	llvm::LLVMContext & context = llvm::getGlobalContext();
+
+	llvm::cl::ParseCommandLineOptions(argc, argv,
+			"apron pass driver with lazy bitcode loading\n");
+
+	llvm::SMDiagnostic error;
+	llvm::OwningPtr<llvm::Module> module(
+			llvm::getLazyIRFileModule(InputFilename, error, context));
+	if (!module) {
+		error.print(argv[0], llvm::errs());
+		return 1;
+	}
+
+	const llvm::PassInfo * passInfo =
+			llvm::PassRegistry::getPassRegistry()->getPassInfo(PassName);
+	if (!passInfo) {
+		llvm::errs() << argv[0] << ": Pass " << PassName <<
+				" is not registered. Is libapronpass.so loaded with -load?\n";
+		return 1;
+	}
+	llvm::PassManager passes;
+	passes.add(passInfo->createPass());
+	passes.run(*module);
+	return 0;
+}
@@ -0,0 +1,381 @@
+/*
+ * Long running analysis server. Loads the apron libraries, the adaptor
+ * and the pass once (with -load, as opt and apron-driver), keeps the
+ * bitcode modules it has read, and analyses each request in a forked
+ * worker, which shares all of these copy-on-write.
+ *
+ * A request is one line on the Unix socket, with tab separated fields:
+ *   <syscall> <domain> [<pass option>...]
+ * e.g. "read\tbox\t-update-count-max=1000\t-d". The domain is checked
+ * against the loaded adaptor; it may be empty. Run a server per domain.
+ * The module is <bitcode-dir>/<syscall>.bc, unless a -module=<path>
+ * option is given. Unless -closure-root or -run-on-single-function is
+ * given, sys_<syscall> is analysed.
+ *
+ * The worker's output is sent back on the connection, followed by a last
+ * line "exit <status>". Results are written to the pass's -output-dir.
+ *
+ * Usage:
+ *   apron-server -load ... -load libapronpass.so \
+ *       -bitcode-dir=FOLDER_2_LLVM_BITCODE_FILES/ALL_SYSCALLS
+ *   printf 'read\tbox\t-update-count-max=1000\n' | nc -U /tmp/llvm_apron_pass/apron.sock
+ */
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include <map>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Pass.h>
+#include <llvm/PassManager.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/PluginLoader.h>
+#include <llvm/Support/Signals.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <ap_manager.h>
+
+static llvm::cl::opt<std::string> SocketPath("socket",
+		llvm::cl::init("/tmp/llvm_apron_pass/apron.sock"),
+		llvm::cl::desc("The Unix socket to listen on. (/tmp/llvm_apron_pass/apron.sock)"));
+
+static llvm::cl::opt<std::string> BitcodeDir("bitcode-dir",
+		llvm::cl::init("."),
+		llvm::cl::desc("Directory of the <syscall>.bc modules. (.)"));
+
+static llvm::cl::list<std::string> Preload("preload",
+		llvm::cl::desc("Syscall whose module is read at startup. May be repeated"));
+
+static llvm::cl::opt<unsigned> MaxWorkers("max-workers",
+		llvm::cl::init(4),
+		llvm::cl::desc("Number of requests analysed at once. (4)"));
+
+/*
+ * The modules read so far, lazily: workers read the bodies they analyse
+ * into their own copy. A module is read again if its file changed.
+ */
+class ModuleCache {
+protected:
+	struct Entry {
+		llvm::Module * module;
+		time_t mtime;
+	};
+	std::map<std::string, Entry> m_modules;
+public:
+	llvm::Module * get(const std::string & path, std::string & error) {
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0) {
+			error = path + ": " + strerror(errno);
+			return 0;
+		}
+		std::map<std::string, Entry>::iterator it = m_modules.find(path);
+		if (it != m_modules.end()) {
+			if (it->second.mtime == st.st_mtime) {
+				return it->second.module;
+			}
+			delete it->second.module;
+			m_modules.erase(it);
+		}
+		llvm::SMDiagnostic diagnostic;
+		llvm::Module * module = llvm::getLazyIRFileModule(path, diagnostic,
+				llvm::getGlobalContext());
+		if (!module) {
+			std::string message;
+			llvm::raw_string_ostream stream(message);
+			diagnostic.print("apron-server", stream);
+			error = stream.str();
+			return 0;
+		}
+		Entry entry = { module, st.st_mtime };
+		m_modules[path] = entry;
+		return module;
+	}
+};
+
+static std::vector<std::string> split(const std::string & line, char separator) {
+	std::vector<std::string> result;
+	std::string::size_type start = 0;
+	while (true) {
+		std::string::size_type end = line.find(separator, start);
+		result.push_back(line.substr(start, end - start));
+		if (end == std::string::npos) {
+			return result;
+		}
+		start = end + 1;
+	}
+}
+
+static bool readLine(int fd, std::string & line) {
+	char c;
+	line.clear();
+	while (true) {
+		ssize_t count = read(fd, &c, 1);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return !line.empty();
+		}
+		if (c == '\n') {
+			return true;
+		}
+		if (c != '\r') {
+			line.push_back(c);
+		}
+	}
+}
+
+static void reply(int fd, const std::string & message) {
+	std::string::size_type written = 0;
+	while (written < message.size()) {
+		ssize_t count = write(fd, message.data() + written, message.size() - written);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return;
+		}
+		written += count;
+	}
+}
+
+static const char * getLoadedDomain() {
+	ap_manager_t ** manager = (ap_manager_t **)dlsym(RTLD_DEFAULT, "apron_manager");
+	if (!manager || !*manager) {
+		return 0;
+	}
+	return (*manager)->library;
+}
+
+// Set the pass options of a request, as if given on the command line.
+// Options given to the server are the defaults, and may be overridden.
+static bool setOptions(const std::vector<std::string> & options, std::string & error) {
+	llvm::StringMap<llvm::cl::Option *> registered;
+	llvm::cl::getRegisteredOptions(registered);
+	for (const std::string & option : options) {
+		std::string::size_type start = option.find_first_not_of('-');
+		std::string::size_type equals = option.find('=');
+		if ((start == 0) || (start == std::string::npos)) {
+			error = "Malformed option " + option;
+			return false;
+		}
+		std::string name = option.substr(start, equals - start);
+		std::string value = (equals == std::string::npos) ? "" : option.substr(equals + 1);
+		llvm::StringMap<llvm::cl::Option *>::iterator it = registered.find(name);
+		if (it == registered.end()) {
+			error = "Unknown option " + option;
+			return false;
+		}
+		llvm::cl::Option * clOption = it->second;
+		if (clOption->getNumOccurrencesFlag() == llvm::cl::Optional) {
+			clOption->setNumOccurrencesFlag(llvm::cl::ZeroOrMore);
+		}
+		if (clOption->addOccurrence(0, name, value)) {
+			error = "Bad value for " + option;
+			return false;
+		}
+	}
+	return true;
+}
+
+// In the worker, whose output goes to the client
+static int analyse(llvm::Module * module, const std::vector<std::string> & options) {
+	std::string error;
+	if (!setOptions(options, error)) {
+		llvm::errs() << error << "\n";
+		return 2;
+	}
+	const llvm::PassInfo * passInfo =
+			llvm::PassRegistry::getPassRegistry()->getPassInfo("apron");
+	if (!passInfo) {
+		llvm::errs() << "The apron pass is not loaded\n";
+		return 2;
+	}
+	llvm::PassManager passes;
+	passes.add(passInfo->createPass());
+	passes.run(*module);
+	llvm::outs().flush();
+	llvm::errs().flush();
+	return 0;
+}
+
+struct Request {
+	std::string modulePath;
+	std::vector<std::string> options;
+};
+
+// In the server, so that the module read for it stays in the cache
+static bool readRequest(int client, Request & request, std::string & error) {
+	std::string line;
+	if (!readLine(client, line)) {
+		error = "No request";
+		return false;
+	}
+	std::vector<std::string> fields = split(line, '\t');
+	const std::string & syscall = fields[0];
+	std::string domain = (fields.size() > 1) ? fields[1] : "";
+	const char * loadedDomain = getLoadedDomain();
+	if (!domain.empty() && (!loadedDomain || (domain != loadedDomain))) {
+		error = "Domain " + domain + " is not loaded (" +
+				(loadedDomain ? loadedDomain : "none") + ")";
+		return false;
+	}
+	request.modulePath = BitcodeDir + "/" + syscall + ".bc";
+	bool isRootGiven = false;
+	for (unsigned idx = 2; idx < fields.size(); idx++) {
+		const std::string & option = fields[idx];
+		if (option.compare(0, 8, "-module=") == 0) {
+			request.modulePath = option.substr(8);
+			continue;
+		}
+		if ((option.find("-closure-root") == 0) ||
+				(option.find("-run-on-single-function") == 0)) {
+			isRootGiven = true;
+		}
+		request.options.push_back(option);
+	}
+	if (!isRootGiven) {
+		request.options.push_back("-run-on-single-function=sys_" + syscall);
+	}
+	return true;
+}
+
+// In the worker
+static void handle(int client, llvm::Module * module,
+		const std::vector<std::string> & options) {
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(STDIN_FILENO);
+		dup2(client, STDOUT_FILENO);
+		dup2(client, STDERR_FILENO);
+		close(client);
+		_exit(analyse(module, options));
+	}
+	int status = 0;
+	if (pid < 0) {
+		reply(client, "fork failed\n");
+		status = 2;
+	} else {
+		while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR)) {}
+		status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+	}
+	char last[32];
+	snprintf(last, sizeof(last), "exit %d\n", status);
+	reply(client, last);
+}
+
+static int listenOn(const std::string & path) {
+	struct sockaddr_un address;
+	if (path.size() >= sizeof(address.sun_path)) {
+		llvm::errs() << path << ": Path too long\n";
+		return -1;
+	}
+	std::string::size_type slash = path.rfind('/');
+	if ((slash != std::string::npos) && (slash > 0)) {
+		mkdir(path.substr(0, slash).c_str(), 0755);
+	}
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("socket");
+		return -1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path.c_str());
+	unlink(path.c_str());
+	if ((bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) ||
+			(listen(fd, 16) != 0)) {
+		perror(path.c_str());
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int main(int argc, char ** argv) {
+	llvm::sys::PrintStackTraceOnErrorSignal();
+	llvm::llvm_shutdown_obj shutdown;
+	llvm::cl::ParseCommandLineOptions(argc, argv,
+			"apron analysis server\n");
+	// A client that goes away must not kill the server
+	signal(SIGPIPE, SIG_IGN);
+
+	ModuleCache cache;
+	for (const std::string & syscall : Preload) {
+		std::string error;
+		if (!cache.get(BitcodeDir + "/" + syscall + ".bc", error)) {
+			llvm::errs() << error << "\n";
+		}
+	}
+	int server = listenOn(SocketPath);
+	if (server < 0) {
+		return 1;
+	}
+	llvm::errs() << "apron-server: Listening on " << SocketPath << " (" <<
+			(getLoadedDomain() ? getLoadedDomain() : "no domain") << ")\n";
+
+	// A worker per connection. It forks again to analyse, so that it can
+	// report the analysis' exit status, including crashes.
+	unsigned workers = 0;
+	unsigned maxWorkers = (MaxWorkers > 0) ? MaxWorkers : 1;
+	while (true) {
+		int status;
+		while ((workers > 0) && (waitpid(-1, &status, WNOHANG) > 0)) {
+			--workers;
+		}
+		if (workers >= maxWorkers) {
+			if (waitpid(-1, &status, 0) > 0) {
+				--workers;
+			}
+			continue;
+		}
+		int client = accept(server, 0, 0);
+		if (client < 0) {
+			if (errno != EINTR) {
+				perror("accept");
+			}
+			continue;
+		}
+		// A silent client must not stall the server
+		struct timeval timeout = { 5, 0 };
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		Request request;
+		std::string error;
+		llvm::Module * module = 0;
+		if (readRequest(client, request, error)) {
+			module = cache.get(request.modulePath, error);
+		}
+		if (!module) {
+			reply(client, error + "\nexit 2\n");
+			close(client);
+			continue;
+		}
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(server);
+			handle(client, module, request.options);
+			close(client);
+			_exit(0);
+		}
+		if (pid > 0) {
+			++workers;
+		}
+		close(client);
+	}
+	return 0;
+}
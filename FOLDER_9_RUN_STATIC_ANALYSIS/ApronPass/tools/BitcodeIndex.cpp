@@ -0,0 +1,188 @@
+#include <BitcodeIndex.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <list>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+
+static std::vector<std::string> split(const std::string & line, char separator) {
+	std::vector<std::string> result;
+	std::string::size_type start = 0;
+	while (true) {
+		std::string::size_type end = line.find(separator, start);
+		result.push_back(line.substr(start, end - start));
+		if (end == std::string::npos) {
+			return result;
+		}
+		start = end + 1;
+	}
+}
+
+// A decimal index, all of text
+static bool parseIndex(const std::string & text, unsigned & index) {
+	if (text.empty() || (text[0] < '0') || (text[0] > '9')) {
+		return false;
+	}
+	char * end;
+	errno = 0;
+	unsigned long value = strtoul(text.c_str(), &end, 10);
+	if ((errno != 0) || (*end != '\0') || (value > UINT_MAX)) {
+		return false;
+	}
+	index = value;
+	return true;
+}
+
+bool BitcodeIndex::read(const std::string & path, std::string & error) {
+	std::ifstream input(path.c_str());
+	if (!input) {
+		error = "Cannot open " + path;
+		return false;
+	}
+	std::string line;
+	unsigned lineNumber = 0;
+	while (std::getline(input, line)) {
+		++lineNumber;
+		if (line.empty() || (line[0] == '#')) {
+			continue;
+		}
+		std::vector<std::string> fields = split(line, '\t');
+		const std::string & kind = fields[0];
+		bool isValid = true;
+		if ((kind == "root") && (fields.size() == 2)) {
+			m_root = fields[1];
+		} else if ((kind == "file") && (fields.size() == 2)) {
+			m_files.push_back(fields[1]);
+		} else if ((kind == "fn") && (fields.size() == 5)) {
+			IndexedFunction function;
+			isValid = parseIndex(fields[1], function.file);
+			function.isLocal = (fields[2] == "L");
+			function.name = fields[3];
+			if (!fields[4].empty()) {
+				for (const std::string & callee : split(fields[4], ',')) {
+					unsigned calleeIndex = 0;
+					isValid = parseIndex(callee, calleeIndex) && isValid;
+					function.callees.push_back(calleeIndex);
+				}
+			}
+			if (!function.isLocal) {
+				m_globals.insert(std::make_pair(function.name,
+						m_functions.size()));
+			}
+			m_functions.push_back(function);
+		} else if ((kind == "alias") && (fields.size() == 3)) {
+			isValid = parseIndex(fields[2], m_aliases[fields[1]]);
+		} else {
+			isValid = false;
+		}
+		if (!isValid) {
+			std::ostringstream oss;
+			oss << path << ":" << lineNumber << ": Malformed record";
+			error = oss.str();
+			return false;
+		}
+	}
+	// The indices are used as is from here on
+	for (const IndexedFunction & function : m_functions) {
+		if (function.file >= m_files.size()) {
+			error = path + ": Function " + function.name + " is in an unknown file";
+			return false;
+		}
+		for (unsigned callee : function.callees) {
+			if (callee >= m_functions.size()) {
+				error = path + ": Function " + function.name + " calls an unknown function";
+				return false;
+			}
+		}
+	}
+	for (auto & alias : m_aliases) {
+		if (alias.second >= m_functions.size()) {
+			error = path + ": Alias " + alias.first + " is of an unknown function";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool BitcodeIndex::write(const std::string & path, std::string & error) const {
+	// Written aside and renamed, so that readers never see a partial index
+	std::ostringstream tmpPath;
+	tmpPath << path << ".tmp." << getpid();
+	{
+		std::ofstream output(tmpPath.str().c_str());
+		if (!output) {
+			error = "Cannot create " + tmpPath.str();
+			return false;
+		}
+		output << "# apron bitcode index\n";
+		output << "root\t" << m_root << "\n";
+		for (const std::string & file : m_files) {
+			output << "file\t" << file << "\n";
+		}
+		for (const IndexedFunction & function : m_functions) {
+			output << "fn\t" << function.file << "\t" <<
+					(function.isLocal ? "L" : "G") << "\t" << function.name << "\t";
+			bool isFirst = true;
+			for (unsigned callee : function.callees) {
+				output << (isFirst ? "" : ",") << callee;
+				isFirst = false;
+			}
+			output << "\n";
+		}
+		for (auto & alias : m_aliases) {
+			output << "alias\t" << alias.first << "\t" << alias.second << "\n";
+		}
+		if (!output.flush()) {
+			error = "Cannot write " + tmpPath.str();
+			return false;
+		}
+	}
+	if (rename(tmpPath.str().c_str(), path.c_str()) != 0) {
+		error = "Cannot rename " + tmpPath.str() + " to " + path;
+		return false;
+	}
+	return true;
+}
+
+bool BitcodeIndex::find(const std::string & name, unsigned & function) const {
+	std::map<std::string, unsigned>::const_iterator it = m_globals.find(name);
+	if (it == m_globals.end()) {
+		it = m_aliases.find(name);
+		if (it == m_aliases.end()) {
+			return false;
+		}
+	}
+	function = it->second;
+	return true;
+}
+
+std::vector<unsigned> BitcodeIndex::getClosure(unsigned root) const {
+	std::vector<unsigned> result;
+	std::set<unsigned> seen;
+	std::list<unsigned> worklist;
+	seen.insert(root);
+	worklist.push_back(root);
+	while (!worklist.empty()) {
+		unsigned function = worklist.front();
+		worklist.pop_front();
+		result.push_back(function);
+		for (unsigned callee : m_functions[function].callees) {
+			if (seen.insert(callee).second) {
+				worklist.push_back(callee);
+			}
+		}
+	}
+	return result;
+}
+
+std::string BitcodeIndex::getPath(unsigned file) const {
+	if (m_root.empty()) {
+		return m_files[file];
+	}
+	return m_root + "/" + m_files[file];
+}
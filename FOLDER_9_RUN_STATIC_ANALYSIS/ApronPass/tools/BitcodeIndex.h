@@ -0,0 +1,48 @@
+#ifndef BITCODE_INDEX_H
+#define BITCODE_INDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * The functions defined in a tree of bitcode files (e.g. kernel-bc-files),
+ * and their direct calls, as built by bitcode-indexer.
+ *
+ * Stored as text, one record per line, fields separated by tabs:
+ *   root    <directory the file paths are relative to>
+ *   file    <path>
+ *   fn      <file#> <G|L> <name> <callee fn#>,<callee fn#>,...
+ *   alias   <name> <fn#>
+ * Records are numbered by kind, in order. Calls are resolved when
+ * indexing: to a local (static) function of the caller's file, else to the
+ * first global definition, else to an alias. Calls to functions not defined
+ * in the tree are dropped.
+ */
+struct IndexedFunction {
+	std::string name;
+	unsigned file;
+	bool isLocal;
+	std::vector<unsigned> callees;
+};
+
+class BitcodeIndex {
+public:
+	std::string m_root;
+	std::vector<std::string> m_files;
+	std::vector<IndexedFunction> m_functions;
+	// Global functions and aliases, by name
+	std::map<std::string, unsigned> m_globals;
+	std::map<std::string, unsigned> m_aliases;
+
+	bool read(const std::string & path, std::string & error);
+	bool write(const std::string & path, std::string & error) const;
+	// The global function or alias named name. Returns false if there is
+	// none.
+	bool find(const std::string & name, unsigned & function) const;
+	// Functions reachable from root by direct calls, root first
+	std::vector<unsigned> getClosure(unsigned root) const;
+	std::string getPath(unsigned file) const;
+};
+
+#endif // BITCODE_INDEX_H
@@ -0,0 +1,211 @@
+/*
+ * Builds a BitcodeIndex (see BitcodeIndex.h) of a tree of bitcode files,
+ * e.g. kernel-bc-files. Every file is read once, and released before the
+ * next one is read.
+ *
+ * By default only the per-object files (.<name>.o.bc) are indexed. The
+ * visible <name>.o.bc and built-in.o.bc files repeat their definitions.
+ *
+ * Usage:
+ *   bitcode-indexer -o kernel.index .../kernel-bc-files
+ */
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/IR/GlobalAlias.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/CallSite.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <BitcodeIndex.h>
+
+static llvm::cl::opt<std::string> RootDirectory(llvm::cl::Positional,
+		llvm::cl::Required,
+		llvm::cl::desc("<bitcode directory>"));
+
+static llvm::cl::opt<std::string> OutputFilename("o",
+		llvm::cl::init("bitcode.index"),
+		llvm::cl::desc("The index file to write. (bitcode.index)"),
+		llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<bool> AllFiles("all-files",
+		llvm::cl::init(false),
+		llvm::cl::desc("Index every *.bc file, not only .<name>.o.bc"));
+
+static bool isIndexed(const std::string & path) {
+	llvm::StringRef filename = llvm::sys::path::filename(path);
+	if (!filename.endswith(".bc")) {
+		return false;
+	}
+	if (AllFiles) {
+		return true;
+	}
+	return filename.startswith(".") && filename.endswith(".o.bc") &&
+			!filename.startswith(".built-in.");
+}
+
+static llvm::Function * getFunction(llvm::Value * value) {
+	value = value->stripPointerCasts();
+	llvm::GlobalAlias * alias = llvm::dyn_cast<llvm::GlobalAlias>(value);
+	if (alias) {
+		value = alias->getAliasedGlobal();
+	}
+	return llvm::dyn_cast<llvm::Function>(value);
+}
+
+class Indexer {
+protected:
+	struct PendingCall {
+		unsigned caller;
+		std::string callee;
+	};
+	BitcodeIndex & m_index;
+	// Functions of each file, by name, to resolve calls to static functions
+	std::vector<std::map<std::string, unsigned> > m_fileFunctions;
+	std::vector<PendingCall> m_calls;
+	std::vector<std::pair<std::string, unsigned> > m_pendingAliases;
+	unsigned m_duplicates;
+
+	void addModule(llvm::Module & module, unsigned file) {
+		std::map<std::string, unsigned> & functions = m_fileFunctions[file];
+		for (llvm::Function & F : module) {
+			if (F.isDeclaration()) {
+				continue;
+			}
+			unsigned index = m_index.m_functions.size();
+			IndexedFunction function;
+			function.name = F.getName();
+			function.file = file;
+			function.isLocal = F.hasLocalLinkage();
+			m_index.m_functions.push_back(function);
+			functions[function.name] = index;
+			if (!function.isLocal &&
+					!m_index.m_globals.insert(std::make_pair(function.name, index)).second) {
+				++m_duplicates;
+			}
+			for (llvm::BasicBlock & basicBlock : F) {
+				for (llvm::Instruction & instruction : basicBlock) {
+					llvm::CallSite callSite(&instruction);
+					if (!callSite) {
+						continue;
+					}
+					llvm::Function * callee = getFunction(callSite.getCalledValue());
+					if (callee && !callee->isIntrinsic()) {
+						PendingCall call = { index, callee->getName() };
+						m_calls.push_back(call);
+					}
+				}
+			}
+		}
+		for (llvm::GlobalAlias & alias : module.getAliasList()) {
+			llvm::Function * aliasee = getFunction(&alias);
+			if (aliasee && !aliasee->isDeclaration()) {
+				m_pendingAliases.push_back(std::make_pair(
+						std::string(alias.getName()), functions[aliasee->getName()]));
+			}
+		}
+	}
+
+	void resolve() {
+		// Calls may go through an alias defined in another file
+		for (auto & alias : m_pendingAliases) {
+			m_index.m_aliases.insert(alias);
+		}
+		m_pendingAliases.clear();
+		for (const PendingCall & call : m_calls) {
+			IndexedFunction & caller = m_index.m_functions[call.caller];
+			std::map<std::string, unsigned> & functions = m_fileFunctions[caller.file];
+			std::map<std::string, unsigned>::iterator it = functions.find(call.callee);
+			if (it == functions.end()) {
+				it = m_index.m_globals.find(call.callee);
+				if (it == m_index.m_globals.end()) {
+					it = m_index.m_aliases.find(call.callee);
+					if (it == m_index.m_aliases.end()) {
+						continue;
+					}
+				}
+			}
+			std::vector<unsigned> & callees = caller.callees;
+			if (std::find(callees.begin(), callees.end(), it->second) == callees.end()) {
+				callees.push_back(it->second);
+			}
+		}
+		m_calls.clear();
+	}
+
+public:
+	Indexer(BitcodeIndex & index) : m_index(index), m_duplicates(0) {}
+
+	bool run(const std::string & root) {
+		m_index.m_root = root;
+		std::vector<std::string> paths;
+		llvm::error_code ec;
+		for (llvm::sys::fs::recursive_directory_iterator it(root, ec), end;
+				(it != end) && !ec; it.increment(ec)) {
+			if (isIndexed(it->path())) {
+				paths.push_back(it->path());
+			}
+		}
+		if (ec) {
+			llvm::errs() << root << ": " << ec.message() << "\n";
+			return false;
+		}
+		std::sort(paths.begin(), paths.end());
+		for (const std::string & path : paths) {
+			unsigned file = m_index.m_files.size();
+			m_index.m_files.push_back(path.substr(root.size() + 1));
+			m_fileFunctions.resize(file + 1);
+			// A context per file, so that its types are released with it
+			llvm::LLVMContext context;
+			llvm::SMDiagnostic error;
+			llvm::OwningPtr<llvm::Module> module(
+					llvm::ParseIRFile(path, error, context));
+			if (!module) {
+				error.print("bitcode-indexer", llvm::errs());
+				continue;
+			}
+			addModule(*module, file);
+		}
+		resolve();
+		llvm::errs() << "Indexed " << m_index.m_files.size() << " files, " <<
+				m_index.m_functions.size() << " functions, " <<
+				m_duplicates << " duplicate global definitions\n";
+		return true;
+	}
+};
+
+int main(int argc, char ** argv) {
+	llvm::llvm_shutdown_obj shutdown;
+	llvm::cl::ParseCommandLineOptions(argc, argv,
+			"Index the functions and calls of a tree of bitcode files\n");
+	// Absolute, so that the index can be used from any directory
+	llvm::SmallString<256> absoluteRoot(RootDirectory);
+	llvm::sys::fs::make_absolute(absoluteRoot);
+	std::string root = absoluteRoot.str();
+	while ((root.size() > 1) && (root[root.size() - 1] == '/')) {
+		root.erase(root.size() - 1);
+	}
+	BitcodeIndex index;
+	Indexer indexer(index);
+	if (!indexer.run(root)) {
+		return 1;
+	}
+	std::string error;
+	if (!index.write(OutputFilename, error)) {
+		llvm::errs() << error << "\n";
+		return 1;
+	}
+	return 0;
+}
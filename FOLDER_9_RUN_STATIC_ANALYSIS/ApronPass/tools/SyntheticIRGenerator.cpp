@@ -0,0 +1,380 @@
+/*
+ * Emits a synthetic syscall of a controlled shape, to study how the
+ * analysis scales with each dimension of its input alone. The IR is in the
+ * form the pipeline gives -apron (after -O3, -mergereturn and -instnamer):
+ * named values, a single return block, and the user memory calls as
+ * UserMemoryModels.def models them.
+ *
+ * The function takes the user pointers buf0..buf<n-1>, a size for each,
+ * and a loop bound. Its body is -loop-depth nested loops. The innermost
+ * body is a chain of -blocks diamonds, with -select-density selects per
+ * block, followed by a switch of -switch-width cases. The -user-calls
+ * calls to copy_from_user and access_ok are spread over the diamonds. Each
+ * accesses a buffer through a chain of -gep-chain GEPs, and returns
+ * -EFAULT if it fails.
+ *
+ * Usage:
+ *   synthetic-ir-generator -blocks=64 -loop-depth=2 -user-buffers=4 -o synthetic.bc
+ */
+#include <cerrno>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <llvm/Analysis/Verifier.h>
+#include <llvm/Bitcode/ReaderWriter.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/raw_ostream.h>
+
+static llvm::cl::opt<std::string> OutputFilename("o",
+		llvm::cl::init("synthetic.bc"),
+		llvm::cl::desc("Output file. (synthetic.bc)"),
+		llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<bool> OutputAssembly("S",
+		llvm::cl::init(false),
+		llvm::cl::desc("Write LLVM assembly rather than bitcode"));
+
+static llvm::cl::opt<std::string> FunctionName("function",
+		llvm::cl::init("sys_synthetic"),
+		llvm::cl::desc("Name of the function. (sys_synthetic)"));
+
+static llvm::cl::opt<unsigned> Blocks("blocks",
+		llvm::cl::init(16),
+		llvm::cl::desc("Number of diamonds, of three blocks each, in the innermost body. (16)"));
+
+static llvm::cl::opt<unsigned> LoopDepth("loop-depth",
+		llvm::cl::init(1),
+		llvm::cl::desc("Nesting depth of the loops around the body. (1)"));
+
+static llvm::cl::opt<unsigned> UserBuffers("user-buffers",
+		llvm::cl::init(1),
+		llvm::cl::desc("Number of buf* user pointer parameters. (1)"));
+
+static llvm::cl::opt<unsigned> GepChain("gep-chain",
+		llvm::cl::init(1),
+		llvm::cl::desc("Number of GEPs from a buffer to the pointer a call accesses. (1)"));
+
+static llvm::cl::opt<unsigned> UserCalls("user-calls",
+		llvm::cl::init(2),
+		llvm::cl::desc("Number of copy_from_user and access_ok calls, alternately. (2)"));
+
+static llvm::cl::opt<double> SelectDensity("select-density",
+		llvm::cl::init(0.5),
+		llvm::cl::desc("Expected number of selects per block. (0.5)"));
+
+static llvm::cl::opt<unsigned> SwitchWidth("switch-width",
+		llvm::cl::init(0),
+		llvm::cl::desc("Number of cases of the switch in the body. 0 for none. (0)"));
+
+static llvm::cl::opt<unsigned> Seed("seed",
+		llvm::cl::init(1),
+		llvm::cl::desc("Seed of the constants and the selects. (1)"));
+
+static const uint64_t KernelBufferSize = 64;
+
+class SyntheticFunctionBuilder {
+protected:
+	llvm::LLVMContext & m_context;
+	llvm::Module * m_module;
+	llvm::IRBuilder<> m_builder;
+	std::mt19937 m_random;
+	llvm::Function * m_function;
+	llvm::Function * m_copyFromUser;
+	llvm::Function * m_accessOk;
+	std::vector<llvm::Value *> m_buffers;
+	std::vector<llvm::Value *> m_sizes;
+	llvm::Value * m_bound;
+	llvm::Value * m_kernelBuffer;
+	llvm::BasicBlock * m_returnBlock;
+	llvm::PHINode * m_returnValue;
+	// Indices of the enclosing loops, innermost last
+	std::vector<llvm::Value *> m_indices;
+	unsigned m_callCount;
+
+	llvm::BasicBlock * createBlock(const std::string & name);
+	int64_t randomConstant();
+	void declareUserMemoryFunctions();
+	void createFunction();
+	llvm::Value * emitLoop(unsigned depth, llvm::Value * acc);
+	llvm::Value * emitBody(llvm::Value * acc);
+	llvm::Value * emitDiamond(unsigned calls, llvm::Value * acc);
+	llvm::Value * emitSelects(llvm::Value * acc);
+	llvm::Value * emitSwitch(llvm::Value * acc);
+	void emitUserCall(llvm::Value * acc);
+public:
+	SyntheticFunctionBuilder(llvm::Module * module, unsigned seed);
+	llvm::Function * build();
+};
+
+SyntheticFunctionBuilder::SyntheticFunctionBuilder(llvm::Module * module,
+		unsigned seed) : m_context(module->getContext()), m_module(module),
+		m_builder(module->getContext()), m_random(seed), m_function(0),
+		m_copyFromUser(0), m_accessOk(0), m_bound(0), m_kernelBuffer(0),
+		m_returnBlock(0), m_returnValue(0), m_callCount(0) {}
+
+llvm::BasicBlock * SyntheticFunctionBuilder::createBlock(const std::string & name) {
+	return llvm::BasicBlock::Create(m_context, name, m_function);
+}
+
+int64_t SyntheticFunctionBuilder::randomConstant() {
+	return std::uniform_int_distribution<int64_t>(-256, 256)(m_random);
+}
+
+void SyntheticFunctionBuilder::declareUserMemoryFunctions() {
+	llvm::Type * i8ptr = m_builder.getInt8PtrTy();
+	llvm::Type * i64 = m_builder.getInt64Ty();
+	llvm::Type * i32 = m_builder.getInt32Ty();
+	// copy_from_user(user pointer, kernel pointer, size): bytes not copied
+	llvm::Type * copyArgs[] = { i8ptr, i8ptr, i64 };
+	m_copyFromUser = llvm::cast<llvm::Function>(m_module->getOrInsertFunction(
+			"copy_from_user", llvm::FunctionType::get(i64, copyArgs, false)));
+	// access_ok(operation, user pointer, size): non-zero if accessible
+	llvm::Type * accessArgs[] = { i32, i8ptr, i64 };
+	m_accessOk = llvm::cast<llvm::Function>(m_module->getOrInsertFunction(
+			"access_ok", llvm::FunctionType::get(i32, accessArgs, false)));
+}
+
+void SyntheticFunctionBuilder::createFunction() {
+	std::vector<llvm::Type *> params;
+	params.insert(params.end(), UserBuffers, m_builder.getInt8PtrTy());
+	params.insert(params.end(), UserBuffers, m_builder.getInt64Ty());
+	params.push_back(m_builder.getInt64Ty());
+	llvm::FunctionType * type = llvm::FunctionType::get(
+			m_builder.getInt64Ty(), params, false);
+	m_function = llvm::Function::Create(type,
+			llvm::GlobalValue::ExternalLinkage, FunctionName, m_module);
+	llvm::Function::arg_iterator arg = m_function->arg_begin();
+	for (unsigned idx = 0; idx < UserBuffers; idx++, arg++) {
+		arg->setName("buf" + std::to_string(idx));
+		m_buffers.push_back(arg);
+	}
+	for (unsigned idx = 0; idx < UserBuffers; idx++, arg++) {
+		arg->setName("count" + std::to_string(idx));
+		m_sizes.push_back(arg);
+	}
+	arg->setName("n");
+	m_bound = arg;
+}
+
+llvm::Function * SyntheticFunctionBuilder::build() {
+	declareUserMemoryFunctions();
+	createFunction();
+	llvm::BasicBlock * entry = createBlock("entry");
+	// As -mergereturn makes it: the last block, and the only return
+	m_returnBlock = llvm::BasicBlock::Create(m_context, "UnifiedReturnBlock");
+	m_returnValue = llvm::PHINode::Create(m_builder.getInt64Ty(), 0,
+			"UnifiedRetVal", m_returnBlock);
+	llvm::ReturnInst::Create(m_context, m_returnValue, m_returnBlock);
+
+	m_builder.SetInsertPoint(entry);
+	llvm::Value * kernelBuffer = m_builder.CreateAlloca(
+			llvm::ArrayType::get(m_builder.getInt8Ty(), KernelBufferSize),
+			0, "kbuf");
+	m_kernelBuffer = m_builder.CreateConstInBoundsGEP2_64(kernelBuffer, 0, 0,
+			"kbuf.ptr");
+	llvm::Value * acc = emitLoop(LoopDepth, m_builder.getInt64(0));
+	m_returnValue->addIncoming(acc, m_builder.GetInsertBlock());
+	m_builder.CreateBr(m_returnBlock);
+	m_function->getBasicBlockList().push_back(m_returnBlock);
+	return m_function;
+}
+
+llvm::Value * SyntheticFunctionBuilder::emitLoop(unsigned depth,
+		llvm::Value * acc) {
+	if (depth == 0) {
+		return emitBody(acc);
+	}
+	llvm::BasicBlock * preheader = m_builder.GetInsertBlock();
+	llvm::BasicBlock * header = createBlock("loop.header");
+	llvm::BasicBlock * body = createBlock("loop.body");
+	m_builder.CreateBr(header);
+
+	m_builder.SetInsertPoint(header);
+	llvm::PHINode * index = m_builder.CreatePHI(m_builder.getInt64Ty(), 2, "i");
+	llvm::PHINode * headerAcc = m_builder.CreatePHI(m_builder.getInt64Ty(), 2,
+			"acc");
+	index->addIncoming(m_builder.getInt64(0), preheader);
+	headerAcc->addIncoming(acc, preheader);
+	llvm::Value * isInside = m_builder.CreateICmpSLT(index, m_bound,
+			"loop.cond");
+	llvm::BasicBlock * exit = createBlock("loop.exit");
+	m_builder.CreateCondBr(isInside, body, exit);
+
+	m_builder.SetInsertPoint(body);
+	m_indices.push_back(index);
+	llvm::Value * bodyAcc = emitLoop(depth - 1, headerAcc);
+	m_indices.pop_back();
+	llvm::BasicBlock * latch = m_builder.GetInsertBlock();
+	llvm::Value * next = m_builder.CreateNSWAdd(index, m_builder.getInt64(1),
+			"i.next");
+	m_builder.CreateBr(header);
+	index->addIncoming(next, latch);
+	headerAcc->addIncoming(bodyAcc, latch);
+
+	// The exit follows the blocks of the body
+	exit->moveAfter(latch);
+	m_builder.SetInsertPoint(exit);
+	return headerAcc;
+}
+
+llvm::Value * SyntheticFunctionBuilder::emitBody(llvm::Value * acc) {
+	// The calls are spread evenly over the diamonds
+	unsigned diamonds = Blocks;
+	if (diamonds == 0) {
+		for (unsigned idx = 0; idx < UserCalls; idx++) {
+			emitUserCall(acc);
+		}
+	}
+	for (unsigned idx = 0; idx < diamonds; idx++) {
+		unsigned calls = ((idx + 1) * UserCalls) / diamonds -
+				(idx * UserCalls) / diamonds;
+		acc = emitDiamond(calls, acc);
+	}
+	if (SwitchWidth > 0) {
+		acc = emitSwitch(acc);
+	}
+	return acc;
+}
+
+llvm::Value * SyntheticFunctionBuilder::emitDiamond(unsigned calls,
+		llvm::Value * acc) {
+	llvm::BasicBlock * head = m_builder.GetInsertBlock();
+	llvm::BasicBlock * thenBlock = createBlock("if.then");
+	llvm::BasicBlock * join = createBlock("if.end");
+	llvm::Value * isLess = m_builder.CreateICmpSLT(acc,
+			m_builder.getInt64(randomConstant()), "cmp");
+	m_builder.CreateCondBr(isLess, thenBlock, join);
+
+	m_builder.SetInsertPoint(thenBlock);
+	llvm::Value * step = m_indices.empty() ?
+			(llvm::Value *)m_builder.getInt64(randomConstant()) : m_indices.back();
+	llvm::Value * thenAcc = m_builder.CreateNSWAdd(acc, step, "add");
+	thenAcc = emitSelects(thenAcc);
+	for (unsigned idx = 0; idx < calls; idx++) {
+		emitUserCall(thenAcc);
+	}
+	llvm::BasicBlock * thenEnd = m_builder.GetInsertBlock();
+	m_builder.CreateBr(join);
+
+	join->moveAfter(thenEnd);
+	m_builder.SetInsertPoint(join);
+	llvm::PHINode * joinAcc = m_builder.CreatePHI(m_builder.getInt64Ty(), 2,
+			"acc");
+	joinAcc->addIncoming(acc, head);
+	joinAcc->addIncoming(thenAcc, thenEnd);
+	return emitSelects(joinAcc);
+}
+
+// Clamps, as -O3 makes of min and max
+llvm::Value * SyntheticFunctionBuilder::emitSelects(llvm::Value * acc) {
+	double density = SelectDensity;
+	unsigned count = (unsigned)density;
+	if (std::bernoulli_distribution(density - count)(m_random)) {
+		++count;
+	}
+	for (unsigned idx = 0; idx < count; idx++) {
+		llvm::Value * limit = m_builder.getInt64(randomConstant());
+		llvm::Value * isGreater = m_builder.CreateICmpSGT(acc, limit, "cmp");
+		acc = m_builder.CreateSelect(isGreater, limit, acc, "cond");
+	}
+	return acc;
+}
+
+llvm::Value * SyntheticFunctionBuilder::emitSwitch(llvm::Value * acc) {
+	llvm::BasicBlock * head = m_builder.GetInsertBlock();
+	llvm::BasicBlock * join = llvm::BasicBlock::Create(m_context, "sw.epilog");
+	llvm::SwitchInst * switchInst = m_builder.CreateSwitch(acc, join,
+			SwitchWidth);
+	std::vector<std::pair<llvm::Value *, llvm::BasicBlock *> > incoming;
+	incoming.push_back(std::make_pair(acc, head));
+	for (unsigned idx = 0; idx < SwitchWidth; idx++) {
+		llvm::BasicBlock * caseBlock = createBlock("sw.bb");
+		switchInst->addCase(m_builder.getInt64(idx), caseBlock);
+		m_builder.SetInsertPoint(caseBlock);
+		llvm::Value * caseAcc = m_builder.CreateNSWAdd(acc,
+				m_builder.getInt64(randomConstant()), "add");
+		m_builder.CreateBr(join);
+		incoming.push_back(std::make_pair(caseAcc, caseBlock));
+	}
+	m_function->getBasicBlockList().push_back(join);
+	m_builder.SetInsertPoint(join);
+	llvm::PHINode * joinAcc = m_builder.CreatePHI(m_builder.getInt64Ty(),
+			incoming.size(), "acc");
+	for (auto & pair : incoming) {
+		joinAcc->addIncoming(pair.first, pair.second);
+	}
+	return joinAcc;
+}
+
+// if (call(...)) return -EFAULT;
+void SyntheticFunctionBuilder::emitUserCall(llvm::Value * acc) {
+	if (UserBuffers == 0) {
+		return;
+	}
+	unsigned buffer = m_callCount % UserBuffers;
+	bool isCopy = (m_callCount % 2) == 0;
+	++m_callCount;
+	llvm::Value * ptr = m_buffers[buffer];
+	for (unsigned idx = 0; idx < GepChain; idx++) {
+		llvm::Value * offset = ((idx == 0) && !m_indices.empty()) ?
+				m_indices.back() : (llvm::Value *)m_builder.getInt64(idx + 1);
+		ptr = m_builder.CreateGEP(ptr, offset, "add.ptr");
+	}
+	// Alternately the size parameter and a value bounded by the body
+	llvm::Value * size = isCopy ? m_sizes[buffer] :
+			m_builder.CreateAnd(acc, m_builder.getInt64(KernelBufferSize - 1),
+					"and");
+	llvm::Value * isFailed;
+	if (isCopy) {
+		llvm::Value * left = m_builder.CreateCall3(m_copyFromUser, ptr,
+				m_kernelBuffer, size, "call");
+		isFailed = m_builder.CreateICmpNE(left, m_builder.getInt64(0), "tobool");
+	} else {
+		llvm::Value * isOk = m_builder.CreateCall3(m_accessOk,
+				m_builder.getInt32(0), ptr, size, "call");
+		isFailed = m_builder.CreateICmpEQ(isOk, m_builder.getInt32(0), "tobool");
+	}
+	llvm::BasicBlock * error = createBlock("if.efault");
+	llvm::BasicBlock * next = createBlock("if.cont");
+	m_builder.CreateCondBr(isFailed, error, next);
+	m_builder.SetInsertPoint(error);
+	m_builder.CreateBr(m_returnBlock);
+	m_returnValue->addIncoming(m_builder.getInt64(-EFAULT), error);
+	m_builder.SetInsertPoint(next);
+}
+
+int main(int argc, char ** argv) {
+	llvm::llvm_shutdown_obj shutdown;
+	llvm::cl::ParseCommandLineOptions(argc, argv,
+			"Emit a synthetic syscall of a given shape\n");
+
+	llvm::LLVMContext & context = llvm::getGlobalContext();
+	llvm::Module module("synthetic", context);
+	SyntheticFunctionBuilder builder(&module, Seed);
+	builder.build();
+	std::string errorInfo;
+	if (llvm::verifyModule(module, llvm::ReturnStatusAction, &errorInfo)) {
+		llvm::errs() << "Invalid module: " << errorInfo << "\n";
+		return 1;
+	}
+
+	llvm::raw_fd_ostream output(OutputFilename.c_str(), errorInfo,
+			OutputAssembly ? llvm::sys::fs::F_None : llvm::sys::fs::F_Binary);
+	if (!errorInfo.empty()) {
+		llvm::errs() << OutputFilename << ": " << errorInfo << "\n";
+		return 1;
+	}
+	if (OutputAssembly) {
+		module.print(output, 0);
+	} else {
+		llvm::WriteBitcodeToFile(&module, output);
+	}
+	return 0;
+}
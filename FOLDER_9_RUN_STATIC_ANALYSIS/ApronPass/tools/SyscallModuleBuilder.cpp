@@ -0,0 +1,234 @@
+/*
+ * Builds the minimal module of a syscall from a BitcodeIndex: the
+ * definitions of the syscall's call closure, linked from the files that
+ * define them. Only those files are read, lazily, and only the bodies in
+ * the closure are materialized (as llvm-extract does).
+ *
+ * Syscalls are built in parallel, in -j worker processes. Each writes
+ * <output-dir>/<syscall>.bc, and reports a line:
+ *   <syscall> <functions> <files> <milliseconds>
+ *
+ * Usage:
+ *   syscall-module-builder -index=kernel.index -o ALL_SYSCALLS -j 8 read write
+ */
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/Bitcode/ReaderWriter.h>
+#include <llvm/IR/GlobalAlias.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker.h>
+#include <llvm/PassManager.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/IPO.h>
+
+#include <BitcodeIndex.h>
+
+static llvm::cl::list<std::string> Syscalls(llvm::cl::Positional,
+		llvm::cl::desc("<syscall>..."));
+
+static llvm::cl::opt<std::string> IndexFilename("index",
+		llvm::cl::init("bitcode.index"),
+		llvm::cl::desc("The index written by bitcode-indexer. (bitcode.index)"),
+		llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<std::string> OutputDirectory("o",
+		llvm::cl::init("."),
+		llvm::cl::desc("Directory of the <syscall>.bc files. (.)"),
+		llvm::cl::value_desc("directory"));
+
+static llvm::cl::opt<std::string> SyscallsFile("syscalls",
+		llvm::cl::init(""),
+		llvm::cl::desc("CSV file with a syscall name in the first column of each line, "
+				"e.g. SYSCALLS_LOCATION.csv. Built in addition to the positional ones"));
+
+static llvm::cl::opt<std::string> Prefix("prefix",
+		llvm::cl::init("sys_"),
+		llvm::cl::desc("Prefix of the syscall functions. (sys_)"));
+
+static llvm::cl::opt<unsigned> Jobs("j",
+		llvm::cl::init(1),
+		llvm::cl::desc("Number of syscalls to build in parallel. (1)"));
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static bool buildModule(const BitcodeIndex & index, const std::string & syscall) {
+	double start = now();
+	std::string rootName = Prefix + syscall;
+	unsigned root;
+	if (!index.find(rootName, root)) {
+		llvm::errs() << syscall << ": " << rootName << " not found in the index\n";
+		return false;
+	}
+	// Names of the closure's functions, by file
+	std::map<unsigned, std::set<std::string> > closure;
+	std::vector<unsigned> functions = index.getClosure(root);
+	for (unsigned function : functions) {
+		const IndexedFunction & indexed = index.m_functions[function];
+		closure[indexed.file].insert(indexed.name);
+	}
+	llvm::LLVMContext context;
+	llvm::OwningPtr<llvm::Module> result(new llvm::Module(syscall, context));
+	for (auto & filePair : closure) {
+		const std::string path = index.getPath(filePair.first);
+		llvm::SMDiagnostic error;
+		llvm::Module * module = llvm::getLazyIRFileModule(path, error, context);
+		if (!module) {
+			error.print(syscall.c_str(), llvm::errs());
+			return false;
+		}
+		std::vector<llvm::GlobalValue *> globals;
+		for (const std::string & name : filePair.second) {
+			llvm::Function * F = module->getFunction(name);
+			std::string errorInfo;
+			if (!F || F->Materialize(&errorInfo)) {
+				llvm::errs() << syscall << ": " << path << ": " << name <<
+						": Cannot read: " << errorInfo << "\n";
+				delete module;
+				return false;
+			}
+			globals.push_back(F);
+		}
+		llvm::GlobalAlias * alias = module->getNamedAlias(rootName);
+		if (alias) {
+			globals.push_back(alias);
+		}
+		// Everything else becomes a declaration
+		llvm::PassManager passes;
+		passes.add(llvm::createGVExtractionPass(globals));
+		passes.add(llvm::createGlobalDCEPass());
+		passes.add(llvm::createStripDeadPrototypesPass());
+		passes.run(*module);
+		std::string errorInfo;
+		if (llvm::Linker::LinkModules(result.get(), module,
+				llvm::Linker::DestroySource, &errorInfo)) {
+			llvm::errs() << syscall << ": " << path << ": " << errorInfo << "\n";
+			delete module;
+			return false;
+		}
+		delete module;
+	}
+
+	// Written aside and renamed, so that a module is never seen partially
+	std::string path = OutputDirectory + "/" + syscall + ".bc";
+	char tmpPath[PATH_MAX];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp.%d", path.c_str(), getpid());
+	std::string errorInfo;
+	{
+		llvm::raw_fd_ostream output(tmpPath, errorInfo, llvm::sys::fs::F_Binary);
+		if (!errorInfo.empty()) {
+			llvm::errs() << syscall << ": " << errorInfo << "\n";
+			return false;
+		}
+		llvm::WriteBitcodeToFile(result.get(), output);
+	}
+	if (rename(tmpPath, path.c_str()) != 0) {
+		llvm::errs() << syscall << ": Cannot rename " << tmpPath << " to " <<
+				path << "\n";
+		return false;
+	}
+	llvm::outs() << syscall << "\t" << functions.size() << "\t" <<
+			closure.size() << "\t" << (unsigned long)(now() - start) << "\n";
+	llvm::outs().flush();
+	return true;
+}
+
+static bool readSyscalls(const std::string & path, std::vector<std::string> & syscalls) {
+	FILE * file = fopen(path.c_str(), "r");
+	if (!file) {
+		return false;
+	}
+	char line[1024];
+	bool isHeader = true;
+	while (fgets(line, sizeof(line), file)) {
+		std::string name(line, strcspn(line, ",\r\n"));
+		if (isHeader) {
+			isHeader = false;
+			continue;
+		}
+		if (!name.empty()) {
+			syscalls.push_back(name);
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char ** argv) {
+	llvm::llvm_shutdown_obj shutdown;
+	llvm::cl::ParseCommandLineOptions(argc, argv,
+			"Build per-syscall modules from a bitcode index\n");
+
+	BitcodeIndex index;
+	std::string error;
+	if (!index.read(IndexFilename, error)) {
+		llvm::errs() << error << "\n";
+		return 1;
+	}
+	std::vector<std::string> syscalls(Syscalls.begin(), Syscalls.end());
+	if (!SyscallsFile.empty() && !readSyscalls(SyscallsFile, syscalls)) {
+		llvm::errs() << "Cannot read " << SyscallsFile << "\n";
+		return 1;
+	}
+	if ((mkdir(OutputDirectory.c_str(), 0755) != 0) && (errno != EEXIST)) {
+		llvm::errs() << "Cannot create " << OutputDirectory << "\n";
+		return 1;
+	}
+
+	// Each syscall in its own process, so that the workers share the index
+	// and nothing else
+	unsigned jobs = (Jobs > 0) ? Jobs : 1;
+	unsigned running = 0;
+	unsigned failed = 0;
+	for (const std::string & syscall : syscalls) {
+		int status;
+		if (running >= jobs) {
+			if ((wait(&status) > 0) && !(WIFEXITED(status) && (WEXITSTATUS(status) == 0))) {
+				++failed;
+			}
+			--running;
+		}
+		pid_t pid = fork();
+		if (pid < 0) {
+			llvm::errs() << syscall << ": fork failed\n";
+			++failed;
+			continue;
+		}
+		if (pid == 0) {
+			_exit(buildModule(index, syscall) ? 0 : 1);
+		}
+		++running;
+	}
+	int status;
+	while ((running > 0) && (wait(&status) > 0)) {
+		if (!(WIFEXITED(status) && (WEXITSTATUS(status) == 0))) {
+			++failed;
+		}
+		--running;
+	}
+	if (failed) {
+		llvm::errs() << failed << " of " << syscalls.size() << " syscalls failed\n";
+	}
+	return failed ? 1 : 0;
+}